@@ -116,6 +116,8 @@ AllJoynObj::~AllJoynObj()
         joinSessionThreadsLock.Lock();
     }
     joinSessionThreadsLock.Unlock();
+
+    DeleteRemovedVirtualEndpoints();
 }
 
 QStatus AllJoynObj::Init()
@@ -2262,20 +2264,15 @@ void AllJoynObj::FindAdvertisedName(const InterfaceDescription::Member* member,
     BusEndpoint* srcEp = router.FindEndpoint(sender);
     replyCode = ALLJOYN_FINDADVERTISEDNAME_REPLY_SUCCESS;
     AcquireLocks();
-    multimap<qcc::String, qcc::String>::const_iterator it = discoverMap.find(namePrefix);
-    while ((it != discoverMap.end()) && (it->first == namePrefix)) {
-        if (it->second == sender) {
-            replyCode = ALLJOYN_FINDADVERTISEDNAME_REPLY_ALREADY_DISCOVERING;
-            break;
-        }
-        ++it;
+    if (discoverMap.Contains(namePrefix, sender)) {
+        replyCode = ALLJOYN_FINDADVERTISEDNAME_REPLY_ALREADY_DISCOVERING;
     }
     if (ALLJOYN_FINDADVERTISEDNAME_REPLY_SUCCESS == replyCode) {
         /* Notify transports if this is a new prefix */
-        bool notifyTransports = (discoverMap.find(namePrefix) == discoverMap.end());
+        bool notifyTransports = (discoverMap.Count(namePrefix) == 0);
 
         /* Add to discover map */
-        discoverMap.insert(pair<String, String>(namePrefix, sender));
+        discoverMap.Insert(namePrefix, sender);
 
         /* Find name  on all remote transports */
         if (notifyTransports) {
@@ -2302,7 +2299,7 @@ void AllJoynObj::FindAdvertisedName(const InterfaceDescription::Member* member,
 
         /* Add entry to denote that the sender is not allowed to discover the service over the forbidden transports*/
         if (transForbidden) {
-            transForbidMap.insert(pair<qcc::String, pair<TransportMask, qcc::String> >(namePrefix, pair<TransportMask, String>(transForbidden, sender)));
+            transForbidMap.Insert(namePrefix, pair<TransportMask, String>(transForbidden, sender));
         }
     }
 
@@ -2379,30 +2376,21 @@ QStatus AllJoynObj::ProcCancelFindName(const qcc::String& sender, const qcc::Str
     QStatus status = ER_OK;
 
     /* Check to see if this prefix exists and delete it */
-    bool foundNamePrefix = false;
     AcquireLocks();
-    multimap<qcc::String, qcc::String>::iterator it = discoverMap.lower_bound(namePrefix);
-    while ((it != discoverMap.end()) && (it->first == namePrefix)) {
-        if (it->second == sender) {
-            discoverMap.erase(it);
-            foundNamePrefix = true;
-            break;
-        }
-        ++it;
-    }
+    bool foundNamePrefix = discoverMap.Erase(namePrefix, sender);
 
     /* Check and delete the transport restriction info on this sender and prefix*/
-    multimap<String, std::pair<TransportMask, String> >::iterator forbitIt = transForbidMap.lower_bound(namePrefix);
-    while ((forbitIt != transForbidMap.end()) && (forbitIt->first == namePrefix)) {
-        if (forbitIt->second.second == sender) {
-            transForbidMap.erase(forbitIt);
+    vector<pair<TransportMask, String> > forbids;
+    transForbidMap.Get(namePrefix, forbids);
+    for (size_t i = 0; i < forbids.size(); ++i) {
+        if (forbids[i].second == sender) {
+            transForbidMap.Erase(namePrefix, forbids[i]);
             break;
         }
-        ++forbitIt;
     }
 
     /* Disable discovery if we removed the last discoverMap entry with a given prefix */
-    bool isLastEntry = (discoverMap.find(namePrefix) == discoverMap.end());
+    bool isLastEntry = (discoverMap.Count(namePrefix) == 0);
     if (foundNamePrefix && isLastEntry) {
         TransportList& transList = bus.GetInternal().GetTransportList();
         for (size_t i = 0; i < transList.GetNumTransports(); ++i) {
@@ -2511,6 +2499,8 @@ void AllJoynObj::RemoveBusToBusEndpoint(RemoteEndpoint& endpoint)
     /* Remove the B2B endpoint itself */
     b2bEndpoints.erase(endpoint.GetUniqueName());
     ReleaseLocks();
+
+    DeleteRemovedVirtualEndpoints();
 }
 
 QStatus AllJoynObj::ExchangeNames(RemoteEndpoint& endpoint)
@@ -2651,11 +2641,17 @@ void AllJoynObj::ExchangeNamesSignalHandler(const InterfaceDescription::Member*
         AcquireLocks();
         map<qcc::StringMapKey, RemoteEndpoint*>::const_iterator bit = b2bEndpoints.find(msg->GetRcvEndpointName());
         map<qcc::StringMapKey, RemoteEndpoint*>::iterator it = b2bEndpoints.begin();
+        /*
+         * Set the sender once, the copy for each endpoint then only needs a new header and serial
+         * number and shares the body.
+         */
+        Message fwd(msg, true);
+        fwd->ReMarshal(bus.GetInternal().GetLocalEndpoint().GetUniqueName().c_str());
         while (it != b2bEndpoints.end()) {
             if ((bit == b2bEndpoints.end()) || (bit->second->GetRemoteGUID() != it->second->GetRemoteGUID())) {
                 QCC_DbgPrintf(("Propagating ExchangeName signal to %s", it->second->GetUniqueName().c_str()));
-                Message m2(msg, true);
-                m2->ReMarshal(bus.GetInternal().GetLocalEndpoint().GetUniqueName().c_str(), true);
+                Message m2(fwd, true);
+                m2->ReMarshal(NULL, true);
                 QStatus status = it->second->PushMessage(m2);
                 if (ER_OK != status) {
                     QCC_LogError(status, ("Failed to forward ExchangeNames to %s", it->second->GetUniqueName().c_str()));
@@ -2714,6 +2710,7 @@ void AllJoynObj::NameChangedSignalHandler(const InterfaceDescription::Member* me
             QCC_LogError(ER_BUS_NO_ENDPOINT, ("Cannot find bus-to-bus endpoint %s", msg->GetRcvEndpointName()));
         }
         ReleaseLocks();
+        DeleteRemovedVirtualEndpoints();
     } else {
         /* Change affects a well-known name (name table only) */
         VirtualEndpoint* remoteController = FindVirtualEndpoint(msg->GetSender());
@@ -2730,11 +2727,17 @@ void AllJoynObj::NameChangedSignalHandler(const InterfaceDescription::Member* me
         AcquireLocks();
         map<qcc::StringMapKey, RemoteEndpoint*>::const_iterator bit = b2bEndpoints.find(msg->GetRcvEndpointName());
         map<qcc::StringMapKey, RemoteEndpoint*>::iterator it = b2bEndpoints.begin();
+        /*
+         * Set the sender once, the copy for each endpoint then only needs a new header and serial
+         * number and shares the body.
+         */
+        Message fwd(msg, true);
+        fwd->ReMarshal(bus.GetInternal().GetLocalEndpoint().GetUniqueName().c_str());
         while (it != b2bEndpoints.end()) {
             if ((bit == b2bEndpoints.end()) || (bit->second->GetRemoteGUID() != it->second->GetRemoteGUID())) {
                 QCC_DbgPrintf(("Propagating NameChanged signal to %s", it->second->GetUniqueName().c_str()));
-                Message m2(msg, true);
-                m2->ReMarshal(bus.GetInternal().GetLocalEndpoint().GetUniqueName().c_str(), true);
+                Message m2(fwd, true);
+                m2->ReMarshal(NULL, true);
                 QStatus status = it->second->PushMessage(m2);
                 if (ER_OK != status) {
                     QCC_LogError(status, ("Failed to forward NameChanged to %s", it->second->GetUniqueName().c_str()));
@@ -2793,8 +2796,26 @@ void AllJoynObj::RemoveVirtualEndpoint(VirtualEndpoint& vep)
     router.RemoveVirtualAliases(vep);
     router.UnregisterEndpoint(vep);
     virtualEndpoints.erase(vep.GetUniqueName());
+    removedVirtualEndpoints.push_back(&vep);
     ReleaseLocks();
-    delete &vep;
+}
+
+void AllJoynObj::DeleteRemovedVirtualEndpoints()
+{
+    AcquireLocks();
+    vector<VirtualEndpoint*> removed;
+    removed.swap(removedVirtualEndpoints);
+    ReleaseLocks();
+
+    /*
+     * The endpoints can no longer be found by the router but it may still be delivering to them
+     */
+    vector<VirtualEndpoint*>::iterator it = removed.begin();
+    while (it != removed.end()) {
+        (*it)->WaitForRouteRefs();
+        delete *it;
+        ++it;
+    }
 }
 
 VirtualEndpoint* AllJoynObj::FindVirtualEndpoint(const qcc::String& uniqueName)
@@ -2980,17 +3001,15 @@ void AllJoynObj::NameOwnerChanged(const qcc::String& alias, const qcc::String* o
             }
 
             /* Remove endpoint refs from discover map */
-            it = discoverMap.begin();
-            while (it != discoverMap.end()) {
-                if (it->second == *oldOwner) {
-                    last = it++->first;
+            vector<PrefixTrie<String>::Entry> discovers;
+            discoverMap.GetAll(discovers);
+            for (size_t i = 0; i < discovers.size(); ++i) {
+                if (discovers[i].second == *oldOwner) {
                     QCC_DbgPrintf(("Calling ProcCancelFindName from NameOwnerChanged [%s]", Thread::GetThread()->GetName().c_str()));
-                    QStatus status = ProcCancelFindName(*oldOwner, last);
+                    QStatus status = ProcCancelFindName(*oldOwner, discovers[i].first);
                     if (ER_OK != status) {
-                        QCC_LogError(status, ("Failed to cancel discover for name \"%s\"", last.c_str()));
+                        QCC_LogError(status, ("Failed to cancel discover for name \"%s\"", discovers[i].first.c_str()));
                     }
-                } else {
-                    ++it;
                 }
             }
             ReleaseLocks();
@@ -3054,35 +3073,33 @@ void AllJoynObj::FoundNames(const qcc::String& busAddr,
             if (0 < ttl) {
                 if (isNew) {
                     /* Add new name to map */
-                    nameMap.insert(pair<String, NameMapEntry>(*nit, NameMapEntry(busAddr,
-                                                                                 guid,
-                                                                                 transport,
-                                                                                 (ttl == numeric_limits<uint8_t>::max()) ? numeric_limits<uint32_t>::max() : (1000 * ttl))));
+                    it = nameMap.insert(pair<String, NameMapEntry>(*nit, NameMapEntry(busAddr,
+                                                                                      guid,
+                                                                                      transport,
+                                                                                      (ttl == numeric_limits<uint8_t>::max()) ? numeric_limits<uint32_t>::max() : (1000 * ttl))));
+                    ScheduleNameExpiry(it->first, it->second);
 
                     /* Send FoundAdvertisedName to anyone who is discovering *nit */
-                    if (0 < discoverMap.size()) {
-                        multimap<String, String>::const_iterator dit = discoverMap.lower_bound((*nit)[0]);
-                        while ((dit != discoverMap.end()) && (dit->first.compare(*nit) <= 0)) {
-
-                            if (nit->compare(0, dit->first.size(), dit->first) == 0) {
-                                /* Check whether the discoverer is allowed to use the transport over which the advertised name if found*/
-                                bool forbidden = false;
-                                multimap<String, std::pair<TransportMask, String> >::const_iterator forbitIt = transForbidMap.lower_bound((*nit)[0]);
-                                while ((forbitIt != transForbidMap.end()) && (forbitIt->first.compare(*nit) <= 0)) {
-                                    if (nit->compare(0, forbitIt->first.size(), forbitIt->first) == 0 &&
-                                        forbitIt->second.second.compare(dit->second) == 0 &&
-                                        (forbitIt->second.first & transport) != 0) {
-                                        forbidden = true;
-                                        QCC_DbgPrintf(("FoundNames: Forbit to send advertised name %s over transport %d to %s due to lack of permission", (*nit).c_str(), transport, forbitIt->second.second.c_str()));
-                                        break;
-                                    }
-                                    ++forbitIt;
-                                }
-                                if (!forbidden) {
-                                    foundNameSet.insert(FoundNameEntry(*nit, dit->first, dit->second));
+                    if (!discoverMap.Empty()) {
+                        vector<PrefixTrie<String>::Entry> discovers;
+                        discoverMap.Match(*nit, discovers);
+                        vector<PrefixTrie<pair<TransportMask, String> >::Entry> forbids;
+                        if (!discovers.empty() && !transForbidMap.Empty()) {
+                            transForbidMap.Match(*nit, forbids);
+                        }
+                        for (size_t d = 0; d < discovers.size(); ++d) {
+                            /* Check whether the discoverer is allowed to use the transport over which the advertised name if found*/
+                            bool forbidden = false;
+                            for (size_t f = 0; f < forbids.size(); ++f) {
+                                if ((forbids[f].second.second == discovers[d].second) && ((forbids[f].second.first & transport) != 0)) {
+                                    forbidden = true;
+                                    QCC_DbgPrintf(("FoundNames: Forbit to send advertised name %s over transport %d to %s due to lack of permission", (*nit).c_str(), transport, forbids[f].second.second.c_str()));
+                                    break;
                                 }
                             }
-                            ++dit;
+                            if (!forbidden) {
+                                foundNameSet.insert(FoundNameEntry(*nit, discovers[d].first, discovers[d].second));
+                            }
                         }
                     }
                 } else {
@@ -3094,9 +3111,9 @@ void AllJoynObj::FoundNames(const qcc::String& busAddr,
                      */
                     if (busAddr == it->second.busAddr) {
                         it->second.timestamp = GetTimestamp();
+                        ScheduleNameExpiry(it->first, it->second);
                     }
                 }
-                nameMapReaper.Alert();
             } else {
                 /* 0 == ttl means flush the record */
                 if (!isNew) {
@@ -3148,59 +3165,73 @@ QStatus AllJoynObj::SendLostAdvertisedName(const String& name, TransportMask tra
 
     /* Send LostAdvertisedName to anyone who is discovering name */
     AcquireLocks();
-    if (0 < discoverMap.size()) {
-        multimap<String, String>::const_iterator dit = discoverMap.lower_bound(name[0]);
-        while ((dit != discoverMap.end()) && (dit->first.compare(name) <= 0)) {
-            if (name.compare(0, dit->first.size(), dit->first) == 0) {
-                MsgArg args[3];
-                args[0].Set("s", name.c_str());
-                args[1].Set("q", transport);
-                args[2].Set("s", dit->first.c_str());
-                QCC_DbgPrintf(("Sending LostAdvertisedName(%s, 0x%x, %s) to %s", name.c_str(), transport, dit->first.c_str(), dit->second.c_str()));
-                QStatus tStatus = Signal(dit->second.c_str(), 0, *lostAdvNameSignal, args, ArraySize(args));
-                if (ER_OK != tStatus) {
-                    status = (ER_OK == status) ? tStatus : status;
-                    QCC_LogError(tStatus, ("Failed to send LostAdvertisedName to %s (name=%s)", dit->second.c_str(), name.c_str()));
-                }
-            }
-            ++dit;
-        }
+    vector<PrefixTrie<String>::Entry> discovers;
+    discoverMap.Match(name, discovers);
+    vector<PrefixTrie<String>::Entry>::const_iterator dit = discovers.begin();
+    while (dit != discovers.end()) {
+        MsgArg args[3];
+        args[0].Set("s", name.c_str());
+        args[1].Set("q", transport);
+        args[2].Set("s", dit->first.c_str());
+        QCC_DbgPrintf(("Sending LostAdvertisedName(%s, 0x%x, %s) to %s", name.c_str(), transport, dit->first.c_str(), dit->second.c_str()));
+        QStatus tStatus = Signal(dit->second.c_str(), 0, *lostAdvNameSignal, args, ArraySize(args));
+        if (ER_OK != tStatus) {
+            status = (ER_OK == status) ? tStatus : status;
+            QCC_LogError(tStatus, ("Failed to send LostAdvertisedName to %s (name=%s)", dit->second.c_str(), name.c_str()));
+        }
+        ++dit;
     }
     ReleaseLocks();
     return status;
 }
 
+void AllJoynObj::ScheduleNameExpiry(const qcc::String& name, const NameMapEntry& nme)
+{
+    if (nme.ttl != numeric_limits<uint32_t>::max()) {
+        multimap<uint32_t, String, ExpiryLess>::iterator eit = nameExpiry.insert(pair<uint32_t, String>(nme.timestamp + nme.ttl, name));
+        if (eit == nameExpiry.begin()) {
+            nameMapReaper.Alert();
+        }
+    }
+}
+
 ThreadReturn STDCALL AllJoynObj::NameMapReaperThread::Run(void* arg)
 {
     uint32_t waitTime(Event::WAIT_FOREVER);
     Event evt(waitTime);
     while (!IsStopping()) {
         ajnObj->AcquireLocks();
-        set<qcc::String> expiredBuses;
-        multimap<String, NameMapEntry>::iterator it = ajnObj->nameMap.begin();
         uint32_t now = GetTimestamp();
+        size_t numExpired = 0;
         waitTime = Event::WAIT_FOREVER;
-        while (it != ajnObj->nameMap.end()) {
-            if ((now - it->second.timestamp) >= it->second.ttl) {
-                QCC_DbgPrintf(("Expiring discovered name %s for guid %s", it->first.c_str(), it->second.guid.c_str()));
-                expiredBuses.insert(it->second.busAddr);
-                ajnObj->SendLostAdvertisedName(it->first, it->second.transport);
-                ajnObj->nameMap.erase(it++);
-            } else {
-                if (it->second.ttl != numeric_limits<uint32_t>::max()) {
-                    uint32_t nextTime(it->second.ttl - (now - it->second.timestamp));
-                    if (nextTime < waitTime) {
-                        waitTime = nextTime;
-                    }
+
+        /* Only visit names whose scheduled expiry has passed */
+        multimap<uint32_t, String, ExpiryLess>::iterator eit = ajnObj->nameExpiry.begin();
+        while ((eit != ajnObj->nameExpiry.end()) && (static_cast<int32_t>(now - eit->first) >= 0)) {
+            if (numExpired >= MAX_EXPIRE_PER_PASS) {
+                /* Let other threads have the locks before expiring the rest */
+                waitTime = 0;
+                break;
+            }
+            String name = eit->second;
+            ajnObj->nameExpiry.erase(eit);
+            multimap<String, NameMapEntry>::iterator it = ajnObj->nameMap.lower_bound(name);
+            while ((it != ajnObj->nameMap.end()) && (it->first == name)) {
+                if ((now - it->second.timestamp) >= it->second.ttl) {
+                    QCC_DbgPrintf(("Expiring discovered name %s for guid %s", it->first.c_str(), it->second.guid.c_str()));
+                    ajnObj->SendLostAdvertisedName(it->first, it->second.transport);
+                    ajnObj->nameMap.erase(it++);
+                    ++numExpired;
+                } else {
+                    ++it;
                 }
-                ++it;
             }
+            eit = ajnObj->nameExpiry.begin();
         }
-        ajnObj->ReleaseLocks();
-
-        while (expiredBuses.begin() != expiredBuses.end()) {
-            expiredBuses.erase(expiredBuses.begin());
+        if ((waitTime != 0) && (eit != ajnObj->nameExpiry.end())) {
+            waitTime = eit->first - now;
         }
+        ajnObj->ReleaseLocks();
 
         evt.ResetTime(waitTime, 0);
         QStatus status = Event::Wait(evt);
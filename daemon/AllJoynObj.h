@@ -36,6 +36,7 @@
 
 #include "Bus.h"
 #include "NameTable.h"
+#include "PrefixTrie.h"
 #include "RemoteEndpoint.h"
 #include "Transport.h"
 #include "VirtualEndpoint.h"
@@ -381,11 +382,11 @@ class AllJoynObj : public BusObject, public NameListener, public TransportListen
     /** Map of active advertised names to requesting local endpoint name(s) */
     std::multimap<qcc::String, std::pair<TransportMask, qcc::String> > advertiseMap;
 
-    /** Map of active discovery names to requesting local endpoint name(s) */
-    std::multimap<qcc::String, qcc::String> discoverMap;
+    /** Map of active discovery name prefixes to requesting local endpoint name(s) */
+    PrefixTrie<qcc::String> discoverMap;
 
-    /** Map of discovery names to forbidden transports (due to lack of permissions) of local endpoint */
-    std::multimap<qcc::String, std::pair<TransportMask, qcc::String> > transForbidMap;
+    /** Map of discovery name prefixes to forbidden transports (due to lack of permissions) of local endpoint */
+    PrefixTrie<std::pair<TransportMask, qcc::String> > transForbidMap;
 
     /** Map of discovered bus names (protected by discoverMapLock) */
     struct NameMapEntry {
@@ -404,6 +405,18 @@ class AllJoynObj : public BusObject, public NameListener, public TransportListen
     };
     std::multimap<qcc::String, NameMapEntry> nameMap;
 
+    /** Orders expiry times that may wrap but lie within half the timestamp range of each other */
+    struct ExpiryLess {
+        bool operator()(uint32_t a, uint32_t b) const { return static_cast<int32_t>(a - b) < 0; }
+    };
+
+    /**
+     * Expiry times of nameMap entries with a finite ttl, soonest first. Entries are not removed
+     * when their name is flushed or refreshed; the reaper drops them when they come due and
+     * only expires the nameMap entries whose ttl has actually elapsed.
+     */
+    std::multimap<uint32_t, qcc::String, ExpiryLess> nameExpiry;
+
     /* Session map */
     struct SessionMapEntry {
         qcc::String endpointName;
@@ -431,6 +444,7 @@ class AllJoynObj : public BusObject, public NameListener, public TransportListen
     const InterfaceDescription::Member* detachSessionSignal;   /**< org.alljoyn.Daemon.DetachSession signal member */
 
     std::map<qcc::String, VirtualEndpoint*> virtualEndpoints;  /**< Map of endpoints that reside behind a connected AllJoyn daemon */
+    std::vector<VirtualEndpoint*> removedVirtualEndpoints;     /**< Removed virtual endpoints waiting to be deleted */
 
     std::map<qcc::StringMapKey, RemoteEndpoint*> b2bEndpoints;    /**< Map of bus-to-bus endpoints that are connected to external daemons */
 
@@ -442,6 +456,9 @@ class AllJoynObj : public BusObject, public NameListener, public TransportListen
         qcc::ThreadReturn STDCALL Run(void* arg);
 
       private:
+        /** Maximum number of names expired before the locks are released and re-acquired */
+        static const size_t MAX_EXPIRE_PER_PASS = 32;
+
         AllJoynObj* ajnObj;
     };
 
@@ -504,6 +521,15 @@ class AllJoynObj : public BusObject, public NameListener, public TransportListen
      */
     QStatus SendLostAdvertisedName(const qcc::String& name, TransportMask transport);
 
+    /**
+     * Schedule the expiry of a nameMap entry and wake the reaper if it is now the first to expire.
+     * Must be called with AllJoynObj locks held.
+     *
+     * @param name   Well-known name of the entry.
+     * @param nme    The nameMap entry.
+     */
+    void ScheduleNameExpiry(const qcc::String& name, const NameMapEntry& nme);
+
     /**
      * Utility method used to invoke SessionAttach remote method.
      *
@@ -601,6 +627,12 @@ class AllJoynObj : public BusObject, public NameListener, public TransportListen
      */
     void RemoveVirtualEndpoint(VirtualEndpoint& endpoint);
 
+    /**
+     * Delete the virtual endpoints removed by RemoveVirtualEndpoint() once the router has finished
+     * delivering to them. This must be called without the AllJoynObj locks held.
+     */
+    void DeleteRemovedVirtualEndpoints();
+
     /**
      * Find a virtual endpoint by its name.
      *
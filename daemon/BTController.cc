@@ -1561,12 +1561,15 @@ QStatus BTController::DeferredSendSetState(const BTNodeInfo& node)
     lock.Unlock();
     QCC_DbgPrintf(("Sending SetState method call to %s (%s)",
                    node->GetUniqueName().c_str(), node->GetBusAddress().ToString().c_str()));
+    SetStateReplyContext* replyCtx = new SetStateReplyContext(newMaster, node);
     status = newMaster->MethodCallAsync(*org.alljoyn.Bus.BTController.SetState,
                                         this, ReplyHandler(&BTController::HandleSetStateReply),
                                         args, ArraySize(args),
-                                        new SetStateReplyContext(newMaster, node));
+                                        replyCtx);
 
     if (status != ER_OK) {
+        /* The reply handler is not called so the context is ours to free. */
+        delete replyCtx;
         delete newMaster;
         QCC_LogError(status, ("Dropping %s due to internal error", node->GetBusAddress().ToString().c_str()));
         bt.Disconnect(node->GetUniqueName());
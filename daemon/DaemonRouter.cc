@@ -23,6 +23,7 @@
 #include <qcc/platform.h>
 
 #include <assert.h>
+#include <algorithm>
 
 #include <qcc/Debug.h>
 #include <qcc/Logger.h>
@@ -35,6 +36,7 @@
 #include "BusEndpoint.h"
 #include "ConfigDB.h"
 #include "PermissionDB.h"
+#include "RemoteEndpoint.h"
 #include "DaemonRouter.h"
 
 #define QCC_MODULE "ALLJOYN"
@@ -81,11 +83,79 @@ void DeferredMsg::ServiceStarted(const qcc::String& serviceName, QStatus result)
 }
 
 
-DaemonRouter::DaemonRouter() : localEndpoint(NULL), ruleTable(), nameTable(), busController(NULL)
+DaemonRouter::DaemonRouter() : localEndpoint(NULL), ruleTable(), nameTable(), busController(NULL),
+    reactor(NULL), reactorConfigured(false)
 {
     AddBusNameListener(ConfigDB::GetConfigDB());
 }
 
+DaemonRouter::~DaemonRouter()
+{
+    delete reactor;
+}
+
+EndpointReactor* DaemonRouter::GetEndpointReactor()
+{
+    static const uint32_t NO_REACTOR = 0xFFFFFFFF;
+
+    reactorLock.Lock();
+    if (!reactorConfigured) {
+        reactorConfigured = true;
+        uint32_t numThreads = ConfigDB::GetConfigDB()->GetLimit("reactor_threads", NO_REACTOR);
+        if ((numThreads != NO_REACTOR) && EndpointReactor::IsSupported()) {
+            reactor = new EndpointReactor(numThreads);
+            QStatus status = reactor->Start();
+            if (status == ER_OK) {
+                QCC_DbgHLPrintf(("Remote endpoints serviced by %u reactor threads", (uint32_t)reactor->GetNumThreads()));
+            } else {
+                QCC_LogError(status, ("Failed to start endpoint reactor, using per-endpoint threads"));
+                delete reactor;
+                reactor = NULL;
+            }
+        }
+    }
+    reactorLock.Unlock();
+    return reactor;
+}
+
+void DaemonRouter::ConfigureEndpoint(RemoteEndpoint& endpoint)
+{
+    if (endpoint.GetFeatures().isBusToBus) {
+        return;
+    }
+    ConfigDB* config = ConfigDB::GetConfigDB();
+    RemoteEndpoint::TxQueueLimits limits;
+    limits.maxMessages = config->GetLimit("max_tx_queue_messages", limits.maxMessages);
+    limits.maxBytes = config->GetLimit("max_tx_queue_bytes", limits.maxBytes);
+    uint32_t policy = config->GetLimit("tx_queue_overflow_policy", limits.policy);
+    if (policy <= RemoteEndpoint::TX_OVERFLOW_DISCONNECT) {
+        limits.policy = static_cast<RemoteEndpoint::TxOverflowPolicy>(policy);
+    } else {
+        QCC_LogError(ER_INVALID_DATA, ("Ignoring invalid tx_queue_overflow_policy %u", policy));
+    }
+    if ((limits.maxMessages == 0) && (limits.maxBytes == 0)) {
+        QCC_LogError(ER_INVALID_DATA, ("Tx queues must be limited by messages or bytes, using default limits"));
+        limits = RemoteEndpoint::TxQueueLimits();
+    }
+    endpoint.SetTxQueueLimits(limits);
+}
+
+/*
+ * Encrypt a secure signal that is about to be queued to several remote endpoints. Does nothing
+ * if the message has already been encrypted for an earlier destination.
+ */
+static QStatus EncryptForFanOut(Message& msg)
+{
+    QStatus status = ER_OK;
+    if (msg->encrypt) {
+        status = msg->EncryptMessage();
+        if (status != ER_OK) {
+            QCC_LogError(status, ("Failed to encrypt %s", msg->Description().c_str()));
+        }
+    }
+    return status;
+}
+
 static QStatus SendThroughEndpoint(Message& msg, BusEndpoint& ep, SessionId sessionId)
 {
     QStatus status;
@@ -137,9 +207,13 @@ QStatus DaemonRouter::PushMessage(Message& msg, BusEndpoint& origSender)
     }
 
     bool destinationEmpty = destination[0] == '\0';
+
     if (!destinationEmpty) {
-        nameTable.Lock();
-        BusEndpoint* destEndpoint = nameTable.FindEndpoint(destination);
+        /*
+         * The name table lock is not held while the message is delivered. A routing reference
+         * keeps destEndpoint from being unregistered while we use it.
+         */
+        BusEndpoint* destEndpoint = nameTable.AcquireEndpoint(destination);
         if (destEndpoint) {
             if (destEndpoint != localEndpoint) {
                 ALLJOYN_POLICY_DEBUG(Log(LOG_DEBUG, "Checking OK for %s to receive %s.%s from %s\n",
@@ -185,13 +259,7 @@ QStatus DaemonRouter::PushMessage(Message& msg, BusEndpoint& origSender)
                         msg->ErrorMsg("org.alljoyn.Bus.Blocked", "Method reply would be blocked because caller does not allow remote messages");
                         PushMessage(msg, *localEndpoint);
                     } else {
-                        if (destEndpoint == localEndpoint) {
-                            nameTable.Unlock();
-                            status = SendThroughEndpoint(msg, *destEndpoint, sessionId);
-                            nameTable.Lock();
-                        } else {
-                            status = SendThroughEndpoint(msg, *destEndpoint, sessionId);
-                        }
+                        status = SendThroughEndpoint(msg, *destEndpoint, sessionId);
                     }
                 } else {
                     QCC_DbgPrintf(("Blocking message from %s to %s (serial=%d) because receiver does not allow remote messages",
@@ -210,9 +278,8 @@ QStatus DaemonRouter::PushMessage(Message& msg, BusEndpoint& origSender)
                     QCC_LogError(status, ("BusEndpoint::PushMessage failed"));
                 }
             }
-            nameTable.Unlock();
+            destEndpoint->DecrementRouteRef();
         } else {
-            nameTable.Unlock();
             if ((msg->GetFlags() & ALLJOYN_FLAG_AUTO_START) && (sender->GetEndpointType() != BusEndpoint::ENDPOINT_TYPE_BUS2BUS)) {
                 /* Need to auto start the service targeted by the message and postpone delivery of the message. */
                 Bus& bus(reinterpret_cast<Bus&>(msg->bus));
@@ -233,58 +300,97 @@ QStatus DaemonRouter::PushMessage(Message& msg, BusEndpoint& origSender)
         }
     }
 
-    /* Forward broadcast to endpoints (local or remote) whose rules allow it */
-    if ((destinationEmpty && (sessionId == 0)) || policydb->EavesdropEnabled()) {
+    /*
+     * Select the broadcast and session multicast destinations before anything is delivered so a
+     * secure signal is only encrypted if it actually goes somewhere remote.
+     */
+    vector<BusEndpoint*> dests;
+    vector<BusEndpoint*> castDests;
+    bool broadcast = (destinationEmpty && (sessionId == 0)) || policydb->EavesdropEnabled();
+    if (broadcast) {
+        /* Take routing references so the rule table lock need not be held while delivering */
         ruleTable.Lock();
-        RuleIterator it = ruleTable.Begin();
-        while (it != ruleTable.End()) {
-            if (it->second.IsMatch(msg)) {
-                BusEndpoint* dest = it->first;
-                bool allow;
-                QCC_DbgPrintf(("Routing %s (%d) to %s",
-                               msg->Description().c_str(),
-                               msg->GetCallSerial(),
-                               dest->GetUniqueName().c_str()));
+        ruleTable.FindMatchingEndpoints(msg, dests);
+        for (vector<BusEndpoint*>::const_iterator it = dests.begin(); it != dests.end(); ++it) {
+            (*it)->IncrementRouteRef();
+        }
+        ruleTable.Unlock();
+    }
+    if (destinationEmpty && (sessionId != 0)) {
+        /* Deliver without holding the table lock; route refs keep the destinations alive */
+        sessionCastTable.GetDestinations(sessionId, msg->GetSender(), castDests);
+    }
+
+    /*
+     * Secure broadcast and session multicast signals are encrypted with the group key once, just
+     * before the first remote destination is queued, rather than by whichever tx thread gets to
+     * them first. Every remote destination then queues the same ciphertext buffer. The local
+     * endpoint decrypts in place so it is handed an unencrypted copy taken before encryption.
+     */
+    bool fanOutEncrypt = destinationEmpty && msg->encrypt;
+    Message localMsg(msg);
+    if (fanOutEncrypt && ((find(dests.begin(), dests.end(), static_cast<BusEndpoint*>(localEndpoint)) != dests.end()) ||
+                          (find(castDests.begin(), castDests.end(), static_cast<BusEndpoint*>(localEndpoint)) != castDests.end()))) {
+        localMsg = Message(msg, true);
+    }
+
+    /*
+     * Delivery to the local endpoint is deferred until every other destination has been queued.
+     * Its handlers run synchronously on this thread and may unregister other endpoints, which must
+     * not still be waiting on references held here.
+     */
+    uint32_t localDeliveries = 0;
+
+    /* Forward broadcast to endpoints (local or remote) whose rules allow it */
+    for (vector<BusEndpoint*>::const_iterator it = dests.begin(); it != dests.end(); ++it) {
+        BusEndpoint* dest = *it;
+        bool allow;
+        QCC_DbgPrintf(("Routing %s (%d) to %s",
+                       msg->Description().c_str(),
+                       msg->GetCallSerial(),
+                       dest->GetUniqueName().c_str()));
+        if (dest == localEndpoint) {
+            allow = true;
+        } else {
+            ALLJOYN_POLICY_DEBUG(Log(LOG_DEBUG, "Checking OK for %s to receive %s.%s from %s\n",
+                                     dest->GetUniqueName().c_str(),
+                                     msg->GetInterface(),
+                                     msg->GetMemberName() ? msg->GetMemberName() : msg->GetErrorName(),
+                                     msg->GetSender()));
+
+            allow = (policydb->OKToReceive(nmh, dest->GetUserId(), dest->GetGroupId()) ||
+                     (policydb->EavesdropEnabled() &&
+                      policydb->OKToEavesdrop(nmh,
+                                              sender->GetUserId(), sender->GetGroupId(),
+                                              dest->GetUserId(), dest->GetGroupId())));
+
+            ALLJOYN_POLICY_DEBUG(Log(LOG_INFO, "%s %s (uid:%d gid:%d) %s %s.%s %s message from %s.\n",
+                                     allow ? "Allowing" : "Denying",
+                                     dest->GetUniqueName().c_str(),
+                                     dest->GetUserId(), dest->GetGroupId(),
+                                     allow ? "to receive" : "from receiving",
+                                     msg->GetInterface(), msg->GetMemberName(),
+                                     (msg->GetType() == MESSAGE_SIGNAL ? "signal" :
+                                      (msg->GetType() == MESSAGE_METHOD_CALL ? "method call" :
+                                       (msg->GetType() == MESSAGE_METHOD_RET ? "method reply" : "error reply"))),
+                                     msg->GetSender()));
+        }
+        if (allow) {
+            // Broadcast status must not trump directed message
+            // status, especially for eavesdropped messages.
+            if (policydb->EavesdropEnabled() || !((sender->GetEndpointType() == BusEndpoint::ENDPOINT_TYPE_BUS2BUS) && !dest->AllowRemoteMessages())) {
                 if (dest == localEndpoint) {
-                    allow = true;
+                    ++localDeliveries;
                 } else {
-                    ALLJOYN_POLICY_DEBUG(Log(LOG_DEBUG, "Checking OK for %s to receive %s.%s from %s\n",
-                                             dest->GetUniqueName().c_str(),
-                                             msg->GetInterface(),
-                                             msg->GetMemberName() ? msg->GetMemberName() : msg->GetErrorName(),
-                                             msg->GetSender()));
-
-                    allow = (policydb->OKToReceive(nmh, dest->GetUserId(), dest->GetGroupId()) ||
-                             (policydb->EavesdropEnabled() &&
-                              policydb->OKToEavesdrop(nmh,
-                                                      sender->GetUserId(), sender->GetGroupId(),
-                                                      dest->GetUserId(), dest->GetGroupId())));
-
-                    ALLJOYN_POLICY_DEBUG(Log(LOG_INFO, "%s %s (uid:%d gid:%d) %s %s.%s %s message from %s.\n",
-                                             allow ? "Allowing" : "Denying",
-                                             dest->GetUniqueName().c_str(),
-                                             dest->GetUserId(), dest->GetGroupId(),
-                                             allow ? "to receive" : "from receiving",
-                                             msg->GetInterface(), msg->GetMemberName(),
-                                             (msg->GetType() == MESSAGE_SIGNAL ? "signal" :
-                                              (msg->GetType() == MESSAGE_METHOD_CALL ? "method call" :
-                                               (msg->GetType() == MESSAGE_METHOD_RET ? "method reply" : "error reply"))),
-                                             msg->GetSender()));
-                }
-                if (allow) {
-                    // Broadcast status must not trump directed message
-                    // status, especially for eavesdropped messages.
-                    if (policydb->EavesdropEnabled() || !((sender->GetEndpointType() == BusEndpoint::ENDPOINT_TYPE_BUS2BUS) && !dest->AllowRemoteMessages())) {
-                        QStatus tStatus = SendThroughEndpoint(msg, *dest, sessionId);
-                        status = (status == ER_OK) ? tStatus : status;
+                    QStatus tStatus = fanOutEncrypt ? EncryptForFanOut(msg) : ER_OK;
+                    if (tStatus == ER_OK) {
+                        tStatus = SendThroughEndpoint(msg, *dest, sessionId);
                     }
+                    status = (status == ER_OK) ? tStatus : status;
                 }
-                ruleTable.AdvanceToNextEndpoint(it);
-            } else {
-                ++it;
             }
         }
-        ruleTable.Unlock();
+        dest->DecrementRouteRef();
     }
 
     /* Send global broadcast to all busToBus endpoints that aren't the sender of the message */
@@ -293,7 +399,10 @@ QStatus DaemonRouter::PushMessage(Message& msg, BusEndpoint& origSender)
         vector<RemoteEndpoint*>::const_iterator it = m_b2bEndpoints.begin();
         while (it != m_b2bEndpoints.end()) {
             if ((*it) != &origSender) {
-                QStatus tStatus = SendThroughEndpoint(msg, **it, sessionId);
+                QStatus tStatus = fanOutEncrypt ? EncryptForFanOut(msg) : ER_OK;
+                if (tStatus == ER_OK) {
+                    tStatus = SendThroughEndpoint(msg, **it, sessionId);
+                }
                 status = (status == ER_OK) ? tStatus : status;
             }
             ++it;
@@ -302,20 +411,22 @@ QStatus DaemonRouter::PushMessage(Message& msg, BusEndpoint& origSender)
     }
 
     /* Send session multicast messages */
-    if (destinationEmpty && (sessionId != 0)) {
-        sessionCastSetLock.Lock();
-        RemoteEndpoint* lastB2b = NULL;
-        SessionCastEntry sce(sessionId, msg->GetSender(), NULL, NULL);
-        set<SessionCastEntry>::iterator sit = sessionCastSet.lower_bound(sce);
-        while ((sit != sessionCastSet.end()) && (sit->id == sce.id) && (sit->src == sce.src)) {
-            if (!sit->b2bEp || (sit->b2bEp != lastB2b)) {
-                QStatus tStatus = SendThroughEndpoint(msg, *sit->destEp, sessionId);
-                status = (status == ER_OK) ? tStatus : status;
-                lastB2b = sit->b2bEp;
+    for (vector<BusEndpoint*>::iterator dit = castDests.begin(); dit != castDests.end(); ++dit) {
+        if (*dit == localEndpoint) {
+            ++localDeliveries;
+        } else {
+            QStatus tStatus = fanOutEncrypt ? EncryptForFanOut(msg) : ER_OK;
+            if (tStatus == ER_OK) {
+                tStatus = SendThroughEndpoint(msg, **dit, sessionId);
             }
-            ++sit;
+            status = (status == ER_OK) ? tStatus : status;
         }
-        sessionCastSetLock.Unlock();
+        (*dit)->DecrementRouteRef();
+    }
+
+    while (localDeliveries--) {
+        QStatus tStatus = SendThroughEndpoint(localMsg, *localEndpoint, sessionId);
+        status = (status == ER_OK) ? tStatus : status;
     }
     return status;
 }
@@ -397,17 +508,8 @@ void DaemonRouter::UnregisterEndpoint(BusEndpoint& endpoint)
         }
         m_b2bEndpointsLock.Unlock();
 
-        /* Remove entries from sessionCastSet with same b2bEp */
-        sessionCastSetLock.Lock();
-        set<SessionCastEntry>::iterator sit = sessionCastSet.begin();
-        while (sit != sessionCastSet.end()) {
-            set<SessionCastEntry>::iterator doomed = sit;
-            ++sit;
-            if (doomed->b2bEp == &endpoint) {
-                sessionCastSet.erase(doomed);
-            }
-        }
-        sessionCastSetLock.Unlock();
+        /* Remove session multicast routes through this b2bEp */
+        sessionCastTable.RemoveB2bEndpoint(&endpoint);
     } else {
         /* Remove any session routes */
         qcc::String uniqueName = endpoint.GetUniqueName();
@@ -419,6 +521,16 @@ void DaemonRouter::UnregisterEndpoint(BusEndpoint& endpoint)
         GetPermissionDB().RemovePermissionCache(endpoint);
     }
 
+    /*
+     * The endpoint can no longer be found in the name or rule tables. Wait for any routing
+     * threads that are still delivering to it before letting the caller destroy it. Virtual
+     * endpoints are unregistered with the AllJoynObj locks held so AllJoynObj waits for them
+     * itself once it has released its locks.
+     */
+    if (endpoint.GetEndpointType() != BusEndpoint::ENDPOINT_TYPE_VIRTUAL) {
+        endpoint.WaitForRouteRefs();
+    }
+
     /* Unregister static endpoints */
     if (&endpoint == localEndpoint) {
         localEndpoint = NULL;
@@ -457,12 +569,8 @@ QStatus DaemonRouter::AddSessionRoute(SessionId id, BusEndpoint& srcEp, RemoteEn
 
     /* Add sessionCast entries */
     if (status == ER_OK) {
-        sessionCastSetLock.Lock();
-        SessionCastEntry entry(id, srcEp.GetUniqueName(), destB2bEp, &destEp);
-        sessionCastSet.insert(entry);
-        SessionCastEntry entry2(id, destEp.GetUniqueName(), srcB2bEp, &srcEp);
-        sessionCastSet.insert(entry2);
-        sessionCastSetLock.Unlock();
+        sessionCastTable.Add(id, srcEp.GetUniqueName(), destB2bEp, &destEp);
+        sessionCastTable.Add(id, destEp.GetUniqueName(), srcB2bEp, &srcEp);
     }
     return status;
 }
@@ -488,21 +596,10 @@ QStatus DaemonRouter::RemoveSessionRoute(SessionId id, BusEndpoint& srcEp, BusEn
         vSrcEp.RemoveSessionRef(id);
     }
 
-    /* Remove entries from sessionCastSet */
+    /* Remove sessionCast entries */
     if (status == ER_OK) {
-        sessionCastSetLock.Lock();
-        SessionCastEntry entry(id, srcEp.GetUniqueName(), destB2bEp, &destEp);
-        set<SessionCastEntry>::iterator it = sessionCastSet.find(entry);
-        if (it != sessionCastSet.end()) {
-            sessionCastSet.erase(it);
-        }
-
-        SessionCastEntry entry2(id, destEp.GetUniqueName(), srcB2bEp, &srcEp);
-        set<SessionCastEntry>::iterator it2 = sessionCastSet.find(entry2);
-        if (it2 != sessionCastSet.end()) {
-            sessionCastSet.erase(it2);
-        }
-        sessionCastSetLock.Unlock();
+        sessionCastTable.Remove(id, srcEp.GetUniqueName(), destB2bEp, &destEp);
+        sessionCastTable.Remove(id, destEp.GetUniqueName(), srcB2bEp, &srcEp);
     }
     return status;
 }
@@ -516,19 +613,13 @@ void DaemonRouter::RemoveSessionRoutes(const char* src, SessionId id)
         return;
     }
 
-    sessionCastSetLock.Lock();
-    set<SessionCastEntry>::iterator it = sessionCastSet.begin();
-    while (it != sessionCastSet.end()) {
-        if (((it->id == id) || (id == 0)) && ((it->src == src) || (it->destEp == ep))) {
-            if ((it->id != 0) && (it->destEp->GetEndpointType() == BusEndpoint::ENDPOINT_TYPE_VIRTUAL)) {
-                static_cast<VirtualEndpoint*>(it->destEp)->RemoveSessionRef(it->id);
-            }
-            sessionCastSet.erase(it++);
-        } else {
-            ++it;
+    vector<SessionCastTable::RemovedRoute> removed;
+    sessionCastTable.RemoveRoutes(srcStr, ep, id, removed);
+    for (vector<SessionCastTable::RemovedRoute>::iterator it = removed.begin(); it != removed.end(); ++it) {
+        if ((it->id != 0) && (it->destEp->GetEndpointType() == BusEndpoint::ENDPOINT_TYPE_VIRTUAL)) {
+            static_cast<VirtualEndpoint*>(it->destEp)->RemoveSessionRef(it->id);
         }
     }
-    sessionCastSetLock.Unlock();
 }
 
 }
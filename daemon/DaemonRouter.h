@@ -35,6 +35,8 @@
 #include "NameTable.h"
 #include "RuleTable.h"
 #include "PermissionDB.h"
+#include "EndpointReactor.h"
+#include "SessionCastTable.h"
 
 namespace ajn {
 
@@ -59,6 +61,11 @@ class DaemonRouter : public Router {
      */
     DaemonRouter();
 
+    /**
+     * Destructor
+     */
+    ~DaemonRouter();
+
     /**
      * Set the busController associated with this router.
      *
@@ -307,36 +314,40 @@ class DaemonRouter : public Router {
     void RemoveSessionRoutes(const char* uniqueName, SessionId id);
 
     PermissionDB& GetPermissionDB() { return permDb; }
+
+    /**
+     * Get the reactor that services the sockets of remote endpoints. The reactor is created the
+     * first time this is called if the "reactor_threads" limit is configured (0 means one thread
+     * per processor).
+     *
+     * @return  The reactor or NULL if remote endpoints should run their own rx and tx threads.
+     */
+    EndpointReactor* GetEndpointReactor();
+
+    /**
+     * Apply the tx queue limits from the "max_tx_queue_messages", "max_tx_queue_bytes" and
+     * "tx_queue_overflow_policy" limits to a remote endpoint. The overflow policy is the numeric
+     * value of a RemoteEndpoint::TxOverflowPolicy. Bus-to-bus endpoints keep the default limits
+     * so a busy client cannot cause a daemon-to-daemon link to be shed.
+     *
+     * @param endpoint   The remote endpoint that is starting.
+     */
+    void ConfigureEndpoint(RemoteEndpoint& endpoint);
+
   private:
     LocalEndpoint* localEndpoint;   /**< The local endpoint */
     RuleTable ruleTable;            /**< Routing rule table */
     NameTable nameTable;            /**< BusName to transport lookupl table */
     BusController* busController;   /**< The bus controller used with this router */
     PermissionDB permDb;            /**< Permission security information cache */
+    EndpointReactor* reactor;       /**< Reactor servicing remote endpoint sockets (NULL if not configured) */
+    bool reactorConfigured;         /**< True once the reactor configuration has been read */
+    qcc::Mutex reactorLock;         /**< Lock that protects reactor creation */
 
     std::vector<RemoteEndpoint*> m_b2bEndpoints;  /**< Collection of Bus-to-bus endpoints */
     qcc::Mutex m_b2bEndpointsLock;       /**< Lock that protects m_b2bEndpoints */
 
-    /** Session multicast destination map */
-    struct SessionCastEntry {
-        SessionId id;
-        qcc::String src;
-        RemoteEndpoint* b2bEp;
-        BusEndpoint* destEp;
-
-        SessionCastEntry(SessionId id, const qcc::String& src, RemoteEndpoint* b2bEp, BusEndpoint* destEp) :
-            id(id), src(src), b2bEp(b2bEp), destEp(destEp) { }
-
-        bool operator<(const SessionCastEntry& other) const {
-            return (id < other.id) || ((id == other.id) && ((src < other.src) || ((src == other.src) && ((b2bEp < other.b2bEp) || ((b2bEp == other.b2bEp) && (destEp < other.destEp))))));
-        }
-
-        bool operator==(const SessionCastEntry& other) const {
-            return (id == other.id)  && (src == other.src) && (b2bEp == other.b2bEp) && (destEp == other.destEp);
-        }
-    };
-    std::set<SessionCastEntry> sessionCastSet;
-    qcc::Mutex sessionCastSetLock;      /**< Lock that protects sessionCastSet */
+    SessionCastTable sessionCastTable;   /**< Session multicast destinations */
 };
 
 }
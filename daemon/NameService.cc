@@ -21,6 +21,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 #include <ctype.h>
 #include <algorithm>
@@ -43,6 +44,8 @@
 #include <sys/ioctl.h>
 
 #if defined(QCC_OS_ANDROID) || defined(QCC_OS_LINUX)
+#include <fcntl.h>
+#include <unistd.h>
 #include <linux/netlink.h>
 #include <linux/rtnetlink.h>
 #endif
@@ -252,6 +255,7 @@ bool WildcardMatch(qcc::String str, qcc::String pat)
 
 NameService::NameService()
     : Thread("NameService"), m_state(IMPL_SHUTDOWN), m_callback(0),
+    m_sequence(0), m_tick(0), m_snapshotTick(0),
     m_port(0), m_timer(0), m_tDuration(DEFAULT_DURATION),
     m_tRetransmit(RETRANSMIT_TIME), m_tQuestion(QUESTION_TIME),
     m_modulus(QUESTION_MODULUS), m_retries(NUMBER_RETRIES),
@@ -260,6 +264,8 @@ NameService::NameService()
 {
     QCC_DbgPrintf(("NameService::NameService()\n"));
 
+    memset(&m_stats, 0, sizeof(m_stats));
+
 #if defined(QCC_OS_WINDOWS)
     //
     // Without commenting on the wisdom of this hidden jewel, it turns
@@ -374,7 +380,13 @@ static int NetlinkRouteSocket(uint32_t bufsize)
     struct sockaddr_nl addr;
     memset(&addr, 0, sizeof(addr));
     addr.nl_family = AF_NETLINK;
-    addr.nl_pid = getpid();
+
+    //
+    // Let the kernel pick the port ID.  Only one netlink socket in a process
+    // can be bound to the process ID, and the interface watcher in Run() keeps
+    // one open all of the time.
+    //
+    addr.nl_pid = 0;
 
     if (bind(sockFd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
         QCC_LogError(ER_FAIL, ("NetlinkRouteSocket: Can't bind to NETLINK_ROUTE socket: %s", strerror(errno)));
@@ -439,6 +451,86 @@ static uint32_t NetlinkRecv(int sockFd, char* buffer, int buflen)
     return nBytes;
 }
 
+//
+// Open a routing netlink socket on which the kernel tells us about links and
+// addresses as they come and go.
+//
+static int NetlinkWatchSocket(void)
+{
+    int sockFd;
+
+    if ((sockFd = socket(AF_NETLINK, SOCK_RAW, NETLINK_ROUTE)) < 0) {
+        QCC_LogError(ER_FAIL, ("NetlinkWatchSocket: Error obtaining socket: %s", strerror(errno)));
+        return -1;
+    }
+
+    struct sockaddr_nl addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.nl_family = AF_NETLINK;
+    addr.nl_groups = RTMGRP_LINK | RTMGRP_IPV4_IFADDR | RTMGRP_IPV6_IFADDR;
+
+    if (bind(sockFd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        QCC_LogError(ER_FAIL, ("NetlinkWatchSocket: Can't bind to NETLINK_ROUTE socket: %s", strerror(errno)));
+        close(sockFd);
+        return -1;
+    }
+
+    int flags = fcntl(sockFd, F_GETFL, 0);
+    if (flags < 0 || fcntl(sockFd, F_SETFL, flags | O_NONBLOCK) < 0) {
+        QCC_LogError(ER_FAIL, ("NetlinkWatchSocket: Can't make NETLINK_ROUTE socket non-blocking: %s", strerror(errno)));
+        close(sockFd);
+        return -1;
+    }
+
+    return sockFd;
+}
+
+//
+// Read everything the kernel has sent to a socket opened by NetlinkWatchSocket()
+// and return true if any link or address was added, removed or changed.
+//
+static bool NetlinkWatchChanged(int sockFd)
+{
+    bool changed = false;
+    char buffer[8192];
+
+    while (1) {
+        int nBytes = recv(sockFd, buffer, sizeof(buffer), 0);
+
+        if (nBytes < 0) {
+            //
+            // ENOBUFS means the kernel dropped notifications because we did
+            // not read them fast enough, so we can't tell what changed.
+            //
+            if (errno == ENOBUFS) {
+                changed = true;
+                continue;
+            }
+            break;
+        }
+
+        if (nBytes == 0) {
+            break;
+        }
+
+        for (struct nlmsghdr* p = (struct nlmsghdr*)buffer; NLMSG_OK(p, nBytes); p = NLMSG_NEXT(p, nBytes)) {
+            switch (p->nlmsg_type) {
+            case RTM_NEWLINK:
+            case RTM_DELLINK:
+            case RTM_NEWADDR:
+            case RTM_DELADDR:
+                changed = true;
+                break;
+
+            default:
+                break;
+            }
+        }
+    }
+
+    return changed;
+}
+
 class IfEntry {
   public:
     uint32_t m_index;
@@ -1377,85 +1469,95 @@ void NameService::ClearLiveInterfaces(void)
     QCC_DbgPrintf(("NameService::ClearLiveInterfaces()\n"));
 
     for (uint32_t i = 0; i < m_liveInterfaces.size(); ++i) {
-        if (m_liveInterfaces[i].m_sockFd == -1) {
-            continue;
-        }
+        CloseLiveInterface(m_liveInterfaces[i]);
+    }
 
-        //
-        // Arrange an IGMP drop via the appropriate setsockopt. Android
-        // doesn't bother to compile its kernel with CONFIG_IP_MULTICAST set.
-        // This doesn't mean that there is no multicast code in the Android
-        // kernel, it means there is no IGMP code in the kernel.  What this
-        // means to us is that even through we are doing an IP_DROP_MEMBERSHIP
-        // request, which is ultimately an IGMP operation, the request will
-        // filter through the IP code before being ignored and will do useful
-        // things in the kernel even though CONFIG_IP_MULTICAST was not set
-        // for the Android build -- i.e., we have to do it anyway.
-        //
-        if (m_liveInterfaces[i].m_address.IsIPv4()) {
-            struct ip_mreq mreq;
-            mreq.imr_multiaddr.s_addr = inet_addr(IPV4_MULTICAST_GROUP);
-            mreq.imr_interface.s_addr = m_liveInterfaces[i].m_address.GetIPv4AddressNetOrder();
+    m_liveInterfaces.clear();
+}
 
-            if (setsockopt(m_liveInterfaces[i].m_sockFd, IPPROTO_IP, IP_DROP_MEMBERSHIP,
-                           reinterpret_cast<const char*>(&mreq), sizeof(mreq)) < 0) {
-                QCC_DbgPrintf(("NameService::ClearLiveInterfaces(void): setsockopt(IP_DROP_MEMBERSHIP) failed\n"));
-            }
-        } else if (m_liveInterfaces[i].m_address.IsIPv6()) {
-            struct ipv6_mreq mreq;
+void NameService::CloseLiveInterface(LiveInterface& live)
+{
+    QCC_DbgPrintf(("NameService::CloseLiveInterface(): %s\n", live.m_interfaceName.c_str()));
 
-            //
-            // If we can't convert the multicast group to an IP address, there's
-            // nothing we can do about letting routers on the net know that we
-            // are closing down.
-            //
-            qcc::String mcGroup = qcc::String(IPV6_MULTICAST_GROUP);
-            if (INET_PTON(AF_INET6, mcGroup.c_str(), &mreq.ipv6mr_multiaddr) == 0) {
-                QCC_DbgPrintf(("NameService::ClearLiveInterfaces(void): INET_PTON failed\n"));
-                continue;
-            }
+    if (live.m_sockFd == -1) {
+        return;
+    }
 
-            //
-            // The IPv6 version of selecting the multicast interface works on
-            // an interface index instead of an IP address.  This index may
-            // be changed on a per-socket basis so We have to figure out what
-            // this index is using a getsockopt.
-            //
-            uint32_t index = 0;
-            socklen_t indexLen = sizeof(index);
+    //
+    // Arrange an IGMP drop via the appropriate setsockopt. Android
+    // doesn't bother to compile its kernel with CONFIG_IP_MULTICAST set.
+    // This doesn't mean that there is no multicast code in the Android
+    // kernel, it means there is no IGMP code in the kernel.  What this
+    // means to us is that even through we are doing an IP_DROP_MEMBERSHIP
+    // request, which is ultimately an IGMP operation, the request will
+    // filter through the IP code before being ignored and will do useful
+    // things in the kernel even though CONFIG_IP_MULTICAST was not set
+    // for the Android build -- i.e., we have to do it anyway.
+    //
+    if (live.m_address.IsIPv4()) {
+        struct ip_mreq mreq;
+        mreq.imr_multiaddr.s_addr = inet_addr(IPV4_MULTICAST_GROUP);
+        mreq.imr_interface.s_addr = live.m_address.GetIPv4AddressNetOrder();
 
-            if (getsockopt(m_liveInterfaces[i].m_sockFd, IPPROTO_IPV6, IPV6_MULTICAST_IF,
-                           reinterpret_cast<char*>(&index), &indexLen) < 0) {
-                QCC_DbgPrintf(("NameService::ClearLiveInterfaces(void): getsockopt(IPV6_MULTICAST_IF) failed\n"));
-                continue;
-            }
+        if (setsockopt(live.m_sockFd, IPPROTO_IP, IP_DROP_MEMBERSHIP,
+                       reinterpret_cast<const char*>(&mreq), sizeof(mreq)) < 0) {
+            QCC_DbgPrintf(("NameService::CloseLiveInterface(): setsockopt(IP_DROP_MEMBERSHIP) failed\n"));
+        }
+    } else if (live.m_address.IsIPv6()) {
+        struct ipv6_mreq mreq;
 
-            mreq.ipv6mr_interface = index;
+        //
+        // If we can't convert the multicast group to an IP address, there's
+        // nothing we can do about letting routers on the net know that we
+        // are closing down.
+        //
+        qcc::String mcGroup = qcc::String(IPV6_MULTICAST_GROUP);
+        if (INET_PTON(AF_INET6, mcGroup.c_str(), &mreq.ipv6mr_multiaddr) == 0) {
+            QCC_DbgPrintf(("NameService::CloseLiveInterface(): INET_PTON failed\n"));
+            qcc::Close(live.m_sockFd);
+            live.m_sockFd = -1;
+            return;
+        }
 
-            //
-            // This call tells the OS to issue an IGMP leave event.  This is
-            // primarily going to send an IGMP packet to routers on the local
-            // subnet telling them that we are no longer interested in hearing
-            // packets destined for our multicast group.  Various operating
-            // systems take this with various degrees of seriousness.  Android
-            // ignores it completely, Linux generates the packet but leaves the
-            // net device enabled for multicast reception, and Windows does
-            // everything.
-            //
-            if (setsockopt(m_liveInterfaces[i].m_sockFd, IPPROTO_IPV6, IPV6_DROP_MEMBERSHIP,
-                           reinterpret_cast<const char*>(&mreq), sizeof(mreq)) < 0) {
-                QCC_DbgPrintf(("NameService::ClearLiveInterfaces(void): setsockopt(IPV6_DROP_MEMBERSHIP) failed\n"));
-                continue;
-            }
-        } else {
-            QCC_LogError(ER_FAIL, ("NameService:ClearLiveInterfaces: Address not IPv4 or IPv6"));
+        //
+        // The IPv6 version of selecting the multicast interface works on
+        // an interface index instead of an IP address.  This index may
+        // be changed on a per-socket basis so We have to figure out what
+        // this index is using a getsockopt.
+        //
+        uint32_t index = 0;
+        socklen_t indexLen = sizeof(index);
+
+        if (getsockopt(live.m_sockFd, IPPROTO_IPV6, IPV6_MULTICAST_IF,
+                       reinterpret_cast<char*>(&index), &indexLen) < 0) {
+            QCC_DbgPrintf(("NameService::CloseLiveInterface(): getsockopt(IPV6_MULTICAST_IF) failed\n"));
+            qcc::Close(live.m_sockFd);
+            live.m_sockFd = -1;
+            return;
         }
 
-        qcc::Close(m_liveInterfaces[i].m_sockFd);
-        m_liveInterfaces[i].m_sockFd = -1;
+        mreq.ipv6mr_interface = index;
+
+        //
+        // This call tells the OS to issue an IGMP leave event.  This is
+        // primarily going to send an IGMP packet to routers on the local
+        // subnet telling them that we are no longer interested in hearing
+        // packets destined for our multicast group.  Various operating
+        // systems take this with various degrees of seriousness.  Android
+        // ignores it completely, Linux generates the packet but leaves the
+        // net device enabled for multicast reception, and Windows does
+        // everything.
+        //
+        if (setsockopt(live.m_sockFd, IPPROTO_IPV6, IPV6_DROP_MEMBERSHIP,
+                       reinterpret_cast<const char*>(&mreq), sizeof(mreq)) < 0) {
+            QCC_DbgPrintf(("NameService::CloseLiveInterface(): setsockopt(IPV6_DROP_MEMBERSHIP) failed\n"));
+        }
+    } else {
+        QCC_LogError(ER_FAIL, ("NameService::CloseLiveInterface: Address not IPv4 or IPv6"));
     }
 
-    m_liveInterfaces.clear();
+    qcc::Close(live.m_sockFd);
+    live.m_sockFd = -1;
 }
 
 //
@@ -1463,7 +1565,7 @@ void NameService::ClearLiveInterfaces(void)
 // the list of requested interfaces that can also be modified by the user in the
 // context of her thread(s).
 //
-void NameService::LazyUpdateInterfaces(void)
+void NameService::LazyUpdateInterfaces(bool rebuild)
 {
     QCC_DbgPrintf(("NameService::LazyUpdateInterfaces()\n"));
 
@@ -1493,7 +1595,17 @@ void NameService::LazyUpdateInterfaces(void)
     // of IGMP packets every 30 seconds we take the conservative approach
     // and tear down all of our sockets and restart them every time through.
     //
-    ClearLiveInterfaces();
+    // On Linux and Android we do know when the state of the system changes:
+    // Run() listens to the routing netlink socket for links and addresses
+    // coming and going and updates the interfaces when it hears something.
+    // There, tearing everything down closes sockets that are in the middle of
+    // receiving discovery traffic for no reason, so we keep the sockets of
+    // interfaces that are still there unchanged.  Interfaces that went down or
+    // changed address are closed below and opened again when they come back.
+    //
+    if (rebuild) {
+        ClearLiveInterfaces();
+    }
 
     //
     // Call IfConfig to get the list of interfaces currently configured in the
@@ -1517,83 +1629,45 @@ void NameService::LazyUpdateInterfaces(void)
     // m_any mode that means match all real IfConfig entries, we need to walk
     // the real IfConfig entries.
     //
-    for (uint32_t i = 0; i < entries.size(); ++i) {
-        //
-        // We expect that every device in the system must have a name.
-        // It might be some crazy random GUID in Windows, but it will have
-        // a name.
-        //
-        assert(entries[i].m_name.size());
-        QCC_DbgPrintf(("NameService::LazyUpdateInterfaces(): Checking out interface %s\n", entries[i].m_name.c_str()));
-
-        //
-        // We are never interested in interfaces that are not UP, do not support
-        // MULTICAST, or are LOOPBACK interfaces.  We don't allow loopbacks
-        // since sending messages to the local host is handled by the
-        // MULTICAST_LOOP socket option which is enabled by default.
-        //
-        if ((entries[i].m_flags & IfConfigEntry::UP) == 0 ||
-            (entries[i].m_flags & IfConfigEntry::MULTICAST) == 0 ||
-            (entries[i].m_flags & IfConfigEntry::LOOPBACK) != 0) {
-            QCC_DbgPrintf(("NameService::LazyUpdateInterfaces(): not UP and MULTICAST or LOOPBACK\n"));
-            continue;
-        }
-
-        //
-        // When initializing the name service, the user can decide whether or
-        // not she wants to advertise and listen over IPv4 or IPv6.  We need
-        // to check for that configuration here.  Since the rest of the code
-        // just works with the live interfaces irrespective of address family,
-        // this is the only place we need to do this check.
-        //
-        if ((m_enableIPv4 == false && entries[i].m_family == AF_INET) ||
-            (m_enableIPv6 == false && entries[i].m_family == AF_INET6)) {
-            QCC_DbgPrintf(("NameService::LazyUpdateInterfaces(): family %d not enabled\n", entries[i].m_family));
-            continue;
+    // First find the entries we already have live interfaces for.  A live
+    // interface is kept if an entry we would still use has the same name,
+    // index and address, in which case the entry is not opened again below.
+    // All other live interfaces are closed.
+    //
+    std::vector<bool> isLive(entries.size(), false);
+    std::vector<LiveInterface>::iterator li = m_liveInterfaces.begin();
+    while (li != m_liveInterfaces.end()) {
+        bool found = false;
+        for (uint32_t i = 0; i < entries.size(); ++i) {
+            if (isLive[i] == false &&
+                li->m_interfaceName == entries[i].m_name &&
+                li->m_index == entries[i].m_index &&
+                li->m_address == qcc::IPAddress(entries[i].m_addr) &&
+                UseInterface(entries[i])) {
+                li->m_mtu = entries[i].m_mtu;
+#if NS_BROADCAST
+                li->m_prefixlen = entries[i].m_prefixlen;
+#endif
+                isLive[i] = found = true;
+                break;
+            }
         }
 
-        //
-        // The current real interface entry is a candidate for use.  We need to
-        // decide if we are actually going to use it either based on the
-        // wildcard mode or the list of requestedInterfaces provided by our
-        // user.
-        //
-        bool useEntry = false;
-
-        if (m_any) {
-            QCC_DbgPrintf(("NameService::LazyUpdateInterfaces(): Use because wildcard mode\n"));
-            useEntry = true;
+        if (found) {
+            ++li;
         } else {
-            for (uint32_t j = 0; j < m_requestedInterfaces.size(); ++j) {
-                //
-                // If the current real interface name matches the name in the
-                // requestedInterface list, we will try to use it.
-                //
-                if (m_requestedInterfaces[j].m_interfaceName.size() != 0 &&
-                    m_requestedInterfaces[j].m_interfaceName == entries[i].m_name) {
-                    QCC_DbgPrintf(("NameService::LazyUpdateInterfaces(): Found matching requestedInterface name\n"));
-                    useEntry = true;
-                    break;
-                }
+            CloseLiveInterface(*li);
+            li = m_liveInterfaces.erase(li);
+        }
+    }
 
-                //
-                // If the current real interface IP Address matches the name in
-                // the requestedInterface list, we will try to use it.
-                //
-                if (m_requestedInterfaces[j].m_interfaceName.size() == 0 &&
-                    m_requestedInterfaces[j].m_interfaceAddr == qcc::IPAddress(entries[i].m_addr)) {
-                    QCC_DbgPrintf(("NameService::LazyUpdateInterfaces(): Found matching requestedInterface address\n"));
-                    useEntry = true;
-                    break;
-                }
-            }
+    for (uint32_t i = 0; i < entries.size(); ++i) {
+        if (isLive[i]) {
+            QCC_DbgPrintf(("NameService::LazyUpdateInterfaces(): Interface %s is already live\n", entries[i].m_name.c_str()));
+            continue;
         }
 
-        //
-        // If we aren't configured to use this entry, or have no idea how to use
-        // this entry (not AF_INET or AF_INET6), try the next one.
-        //
-        if (useEntry == false || (entries[i].m_family != AF_INET && entries[i].m_family != AF_INET6)) {
+        if (UseInterface(entries[i]) == false) {
             QCC_DbgPrintf(("NameService::LazyUpdateInterfaces(): Won't use this IfConfig entry\n"));
             continue;
         }
@@ -1806,6 +1880,91 @@ void NameService::LazyUpdateInterfaces(void)
     }
 }
 
+//
+// N.B. This function must be called with m_mutex locked since we wander through
+// the list of requested interfaces that can also be modified by the user in the
+// context of her thread(s).
+//
+bool NameService::UseInterface(const IfConfigEntry& entry)
+{
+    //
+    // We expect that every device in the system must have a name.
+    // It might be some crazy random GUID in Windows, but it will have
+    // a name.
+    //
+    assert(entry.m_name.size());
+    QCC_DbgPrintf(("NameService::UseInterface(): Checking out interface %s\n", entry.m_name.c_str()));
+
+    //
+    // We are never interested in interfaces that are not UP, do not support
+    // MULTICAST, or are LOOPBACK interfaces.  We don't allow loopbacks
+    // since sending messages to the local host is handled by the
+    // MULTICAST_LOOP socket option which is enabled by default.
+    //
+    if ((entry.m_flags & IfConfigEntry::UP) == 0 ||
+        (entry.m_flags & IfConfigEntry::MULTICAST) == 0 ||
+        (entry.m_flags & IfConfigEntry::LOOPBACK) != 0) {
+        QCC_DbgPrintf(("NameService::UseInterface(): not UP and MULTICAST or LOOPBACK\n"));
+        return false;
+    }
+
+    //
+    // When initializing the name service, the user can decide whether or
+    // not she wants to advertise and listen over IPv4 or IPv6.  We need
+    // to check for that configuration here.  Since the rest of the code
+    // just works with the live interfaces irrespective of address family,
+    // this is the only place we need to do this check.
+    //
+    if ((m_enableIPv4 == false && entry.m_family == AF_INET) ||
+        (m_enableIPv6 == false && entry.m_family == AF_INET6)) {
+        QCC_DbgPrintf(("NameService::UseInterface(): family %d not enabled\n", entry.m_family));
+        return false;
+    }
+
+    //
+    // The current real interface entry is a candidate for use.  We need to
+    // decide if we are actually going to use it either based on the
+    // wildcard mode or the list of requestedInterfaces provided by our
+    // user.
+    //
+    bool useEntry = false;
+
+    if (m_any) {
+        QCC_DbgPrintf(("NameService::UseInterface(): Use because wildcard mode\n"));
+        useEntry = true;
+    } else {
+        for (uint32_t j = 0; j < m_requestedInterfaces.size(); ++j) {
+            //
+            // If the current real interface name matches the name in the
+            // requestedInterface list, we will try to use it.
+            //
+            if (m_requestedInterfaces[j].m_interfaceName.size() != 0 &&
+                m_requestedInterfaces[j].m_interfaceName == entry.m_name) {
+                QCC_DbgPrintf(("NameService::UseInterface(): Found matching requestedInterface name\n"));
+                useEntry = true;
+                break;
+            }
+
+            //
+            // If the current real interface IP Address matches the name in
+            // the requestedInterface list, we will try to use it.
+            //
+            if (m_requestedInterfaces[j].m_interfaceName.size() == 0 &&
+                m_requestedInterfaces[j].m_interfaceAddr == qcc::IPAddress(entry.m_addr)) {
+                QCC_DbgPrintf(("NameService::UseInterface(): Found matching requestedInterface address\n"));
+                useEntry = true;
+                break;
+            }
+        }
+    }
+
+    //
+    // If we aren't configured to use this entry, or have no idea how to use
+    // this entry (not AF_INET or AF_INET6), we won't use it.
+    //
+    return useEntry && (entry.m_family == AF_INET || entry.m_family == AF_INET6);
+}
+
 QStatus NameService::Locate(const qcc::String& wkn, LocatePolicy policy)
 {
     QCC_DbgHLPrintf(("NameService::Locate(): %s with policy %d\n", wkn.c_str(), policy));
@@ -1819,6 +1978,11 @@ QStatus NameService::Locate(const qcc::String& wkn, LocatePolicy policy)
     whoHas.SetIPv4Flag(true);
     whoHas.AddName(wkn);
 
+    //
+    // Version 0 daemons drop any other version, and version 1 daemons answer
+    // a version 0 question with the complete list of their names, so ask the
+    // question in version 0.
+    //
     Header header;
     header.SetVersion(0);
     header.SetTimer(m_tDuration);
@@ -1995,20 +2159,24 @@ QStatus NameService::Advertise(vector<qcc::String>& wkn)
     // respond to protocol questions in the future.  Only allow one entry per
     // name.
     //
+    vector<qcc::String> added;
     for (uint32_t i = 0; i < wkn.size(); ++i) {
         list<qcc::String>::iterator j = find(m_advertised.begin(), m_advertised.end(), wkn[i]);
         if (j == m_advertised.end()) {
             m_advertised.push_back(wkn[i]);
-        } else {
-            //
-            // Nothing has changed, so don't bother.
-            //
-            QCC_DbgPrintf(("NameService::Advertise(): Duplicate advertisement\n"));
-            m_mutex.Unlock();
-            return ER_OK;
+            added.push_back(wkn[i]);
         }
     }
 
+    //
+    // Nothing has changed, so don't bother.
+    //
+    if (added.empty()) {
+        QCC_DbgPrintf(("NameService::Advertise(): Duplicate advertisement\n"));
+        m_mutex.Unlock();
+        return ER_OK;
+    }
+
     //
     // Keep the list sorted so we can easily distinguish a change in
     // the content of the advertised names versus a change in the order of the
@@ -2025,56 +2193,24 @@ QStatus NameService::Advertise(vector<qcc::String>& wkn)
         m_timer = m_tDuration;
     }
 
-    m_mutex.Unlock();
-
-    //
-    // The underlying protocol is capable of identifying both TCP and UDP
-    // services.  Right now, the only possibility is TCP, so this is not
-    // exposed to the user unneccesarily.
-    //
-    IsAt isAt;
-    isAt.SetTcpFlag(true);
-    isAt.SetUdpFlag(false);
-
-    //
-    // Always send the provided daemon GUID out with the reponse.
-    //
-    isAt.SetGuid(m_guid);
-
-    //
-    // Send a protocol message describing the entire list of names we have
-    // for the provided protocol.
-    //
-    isAt.SetCompleteFlag(true);
-
     //
-    // Set the port here.  When the message goes out a selected interface, the
-    // protocol handler will write out the addresses according to its rules.
+    // Only tell the world about the names that were added.  Daemons that heard
+    // our previous sequence number apply the delta and the others will ask us
+    // for a snapshot.  The mutex stays locked so deltas are queued in sequence
+    // order.
     //
-    isAt.SetPort(m_port);
+    ++m_sequence;
+    QueueAnswer(NS_VERSION, false, m_tDuration, added);
 
     //
-    // Always advertise the whole list of advertisements that match the protocol
-    // type, not just the (possibly one) entry the user has updated us with.
+    // Version 0 daemons drop version 1 messages, so if there are any around
+    // tell them about the entire list of names the way they expect.
     //
-    for (list<qcc::String>::iterator i = m_advertised.begin(); i != m_advertised.end(); ++i) {
-        isAt.AddName(*i);
+    if (HeardVersionZero()) {
+        QueueAnswer(0, true, m_tDuration, vector<qcc::String>(m_advertised.begin(), m_advertised.end()));
     }
 
-    //
-    // The header ties the whole protocol message together.  By setting the
-    // timer, we are asking for everyone who hears the message to remember
-    // the advertisements for that number of seconds.
-    //
-    Header header;
-    header.SetVersion(0);
-    header.SetTimer(m_tDuration);
-    header.AddAnswer(isAt);
-
-    //
-    // Queue this message for transmission out on the various live interfaces.
-    //
-    QueueProtocolMessage(header);
+    m_mutex.Unlock();
     return ER_OK;
 }
 
@@ -2116,13 +2252,12 @@ QStatus NameService::Cancel(vector<qcc::String>& wkn)
     //
     // Remove the given services from our list of services we are advertising.
     //
-    bool changed = false;
-
+    vector<qcc::String> removed;
     for (uint32_t i = 0; i < wkn.size(); ++i) {
         list<qcc::String>::iterator j = find(m_advertised.begin(), m_advertised.end(), wkn[i]);
         if (j != m_advertised.end()) {
             m_advertised.erase(j);
-            changed = true;
+            removed.push_back(wkn[i]);
         }
     }
 
@@ -2135,20 +2270,41 @@ QStatus NameService::Cancel(vector<qcc::String>& wkn)
         m_timer = 0;
     }
 
-    m_mutex.Unlock();
-
     //
     // If we didn't actually make a change, just return.
     //
-    if (changed == false) {
+    if (removed.empty()) {
+        m_mutex.Unlock();
         return ER_OK;
     }
 
     //
-    // Send a protocol answer message describing the list of names we have just
-    // been asked to withdraw.
+    // Send a delta describing the list of names we have just been asked to
+    // withdraw.  We want to signal that everyone can forget about these names
+    // so we set the timer value to 0.
+    //
+    ++m_sequence;
+    QueueAnswer(NS_VERSION, false, 0, removed);
+
+    //
+    // Version 0 daemons drop version 1 messages, so if there are any around
+    // withdraw the names from them in version 0 as well.  There the complete
+    // flag means that we are withdrawing all of our advertisements.
+    //
+    if (HeardVersionZero()) {
+        QueueAnswer(0, m_advertised.empty(), 0, removed);
+    }
+
+    m_mutex.Unlock();
+    return ER_OK;
+}
+
+void NameService::QueueAnswer(uint8_t version, bool complete, uint32_t timer, const vector<qcc::String>& names)
+{
     //
-    // This code assumes that the daemon talks over TCP.  True for now.
+    // The underlying protocol is capable of identifying both TCP and UDP
+    // services.  Right now, the only possibility is TCP, so this is not
+    // exposed to the user unneccesarily.
     //
     IsAt isAt;
     isAt.SetTcpFlag(true);
@@ -2158,49 +2314,160 @@ QStatus NameService::Cancel(vector<qcc::String>& wkn)
     // Always send the provided daemon GUID out with the reponse.
     //
     isAt.SetGuid(m_guid);
+    isAt.SetCompleteFlag(complete);
 
     //
     // Set the port here.  When the message goes out a selected interface, the
     // protocol handler will write out the addresses according to its rules.
     //
     isAt.SetPort(m_port);
+    isAt.SetVersion(version);
 
-    //
-    // Copy the names we are withdrawing the advertisement for into the
-    // protocol message object.
-    //
-    for (uint32_t i = 0; i < wkn.size(); ++i) {
-        isAt.AddName(wkn[i]);
+    for (uint32_t i = 0; i < names.size(); ++i) {
+        isAt.AddName(names[i]);
     }
 
     //
-    // When witdrawing advertisements, a complete flag means that we are
-    // withdrawing all of the advertisements.  If the complete flag is
-    // not set, we have some advertisements remaining.
+    // The header ties the whole protocol message together.  By setting the
+    // timer, we are asking for everyone who hears the message to remember
+    // the advertisements for that number of seconds.
     //
-    if (m_advertised.size() == 0) {
-        isAt.SetCompleteFlag(true);
+    Header header;
+    header.SetVersion(version);
+    header.SetTimer(timer);
+
+    m_mutex.Lock();
+
+    if (version == 0) {
+        ++m_stats.v0AnswersQueued;
     }
 
     //
-    // The header ties the whole protocol message together.  We're at version
-    // zero of the protocol.
+    // Split the names over as many answers as it takes for each to fit in a
+    // packet on every live interface, with room for the interface addresses
+    // that are written into it on the way out.
     //
-    Header header;
-    header.SetVersion(0);
+    size_t answerMax = GetPacketMax() - header.GetSerializedSize() - NS_ADDRESS_RESERVE;
+    isAt.SetSequence(m_sequence);
+    vector<IsAt> parts;
+    if (isAt.Split(answerMax, parts) == false) {
+        QCC_LogError(ER_FAIL, ("NameService::QueueAnswer(): Name longer than %d bytes or too many names", answerMax));
+        m_mutex.Unlock();
+        return;
+    }
+
+    for (uint32_t i = 0; i < parts.size(); ++i) {
+        //
+        // Each part of a delta is a delta of its own, so it moves the sequence
+        // number along.  The parts of a snapshot all describe the same list
+        // and are numbered so the receiver knows when it has all of them.
+        //
+        if ((version >= 1) && !complete) {
+            if (i > 0) {
+                parts[i].SetSequence(++m_sequence);
+            }
+            parts[i].SetPart(0, 1);
+        }
+
+        Header message = header;
+        message.AddAnswer(parts[i]);
+
+        //
+        // Queue this message for transmission out on the various live
+        // interfaces.
+        //
+        QueueProtocolMessage(message);
+    }
+
+    m_mutex.Unlock();
+}
+
+size_t NameService::GetPacketMax(void)
+{
+    size_t packetMax = NS_MESSAGE_MAX;
+
+    m_mutex.Lock();
+    for (uint32_t i = 0; i < m_liveInterfaces.size(); ++i) {
+        if ((m_liveInterfaces[i].m_sockFd == -1) || (m_liveInterfaces[i].m_mtu < NS_MTU_MIN)) {
+            continue;
+        }
+
+        //
+        // Take the IP and UDP headers off the MTU to get the largest payload
+        // that is not fragmented.
+        //
+        size_t overhead = 8 + (m_liveInterfaces[i].m_address.IsIPv4() ? 20 : 40);
+        if (m_liveInterfaces[i].m_mtu - overhead < packetMax) {
+            packetMax = m_liveInterfaces[i].m_mtu - overhead;
+        }
+    }
+    m_mutex.Unlock();
+
+    return packetMax;
+}
+
+void NameService::QueueSnapshot(uint8_t version)
+{
+    QCC_DbgPrintf(("NameService::QueueSnapshot()\n"));
 
     //
-    // We want to signal that everyone can forget about these names
-    // so we set the timer value to 0.
+    // We need a valid port before we send something out to the local subnet.
     //
-    header.SetTimer(0);
-    header.AddAnswer(isAt);
+    if (m_port == 0) {
+        QCC_DbgPrintf(("NameService::QueueSnapshot(): Port not set\n"));
+        return;
+    }
+
+    m_mutex.Lock();
 
     //
-    // Queue this message for transmission out on the various live interfaces.
+    // Every daemon that hears a question or notices a gap asks for our names.
+    // One snapshot answers all of them, so don't send more than one a second.
+    // Version 0 daemons get the complete list every time they ask, as before.
     //
+    if (version >= 1) {
+        if (m_tick < m_snapshotTick) {
+            QCC_DbgPrintf(("NameService::QueueSnapshot(): Snapshot already queued\n"));
+            m_mutex.Unlock();
+            return;
+        }
+        m_snapshotTick = m_tick + 1;
+    }
+
+    vector<qcc::String> names(m_advertised.begin(), m_advertised.end());
+    ++m_stats.snapshotsSent;
+    QueueAnswer(version, true, m_tDuration, names);
+
+    m_mutex.Unlock();
+}
+
+void NameService::RequestSnapshot(const qcc::String& guid)
+{
+    QCC_DbgHLPrintf(("NameService::RequestSnapshot(): %s\n", guid.c_str()));
+
+    WhoHas whoHas;
+    whoHas.SetTcpFlag(true);
+    whoHas.SetIPv4Flag(true);
+    whoHas.SetCompleteFlag(true);
+    whoHas.AddName(guid);
+
+    Header header;
+    header.SetVersion(NS_VERSION);
+    header.SetTimer(m_tDuration);
+    header.AddQuestion(whoHas);
+
+    m_mutex.Lock();
+    ++m_stats.snapshotRequests;
+    m_mutex.Unlock();
+
     QueueProtocolMessage(header);
-    return ER_OK;
+}
+
+void NameService::GetStats(Stats& stats)
+{
+    m_mutex.Lock();
+    stats = m_stats;
+    m_mutex.Unlock();
 }
 
 void NameService::QueueProtocolMessage(Header& header)
@@ -2345,7 +2612,8 @@ void NameService::SendProtocolMessage(qcc::SocketFd sockFd, bool sockFdIsIPv4, H
     header.Serialize(buffer);
 
     //
-    // Send the packet.
+    // Send the packet.  The main thread holds m_mutex while it sends, so the
+    // traffic counters can be updated directly.
     //
     size_t sent;
     if (sockFdIsIPv4) {
@@ -2354,6 +2622,9 @@ void NameService::SendProtocolMessage(qcc::SocketFd sockFd, bool sockFdIsIPv4, H
         QStatus status = qcc::SendTo(sockFd, ipv4Multicast, MULTICAST_PORT, buffer, size, sent);
         if (status != ER_OK) {
             QCC_LogError(ER_FAIL, ("NameService::SendProtocolMessage():  Error sending to IPv4 (multicast)\n"));
+        } else {
+            ++m_stats.packetsSent;
+            m_stats.bytesSent += size;
         }
 
 #if NS_BROADCAST
@@ -2396,6 +2667,9 @@ void NameService::SendProtocolMessage(qcc::SocketFd sockFd, bool sockFdIsIPv4, H
             status = qcc::SendTo(sockFd, ipv4Broadcast, BROADCAST_PORT, buffer, size, sent);
             if (status != ER_OK) {
                 QCC_LogError(ER_FAIL, ("NameService::SendProtocolMessage():  Error sending to IPv4 (broadcast)\n"));
+            } else {
+                ++m_stats.packetsSent;
+                m_stats.bytesSent += size;
             }
         } else {
             QCC_DbgPrintf(("NameService::SendProtocolMessage():  subnet directed broadcasts are disabled\n"));
@@ -2408,6 +2682,9 @@ void NameService::SendProtocolMessage(qcc::SocketFd sockFd, bool sockFdIsIPv4, H
         QStatus status = qcc::SendTo(sockFd, ipv6, MULTICAST_PORT, buffer, size, sent);
         if (status != ER_OK) {
             QCC_LogError(ER_FAIL, ("NameService::SendProtocolMessage():  Error sending to IPv6\n"));
+        } else {
+            ++m_stats.packetsSent;
+            m_stats.bytesSent += size;
         }
     }
 
@@ -2454,6 +2731,19 @@ void* NameService::Run(void* arg)
     qcc::Timespec tNow, tLastLazyUpdate;
     GetTimeNow(&tLastLazyUpdate);
 
+    //
+    // Where we can, listen for links and addresses coming and going so that
+    // we update the interfaces we use as soon as something changes, and
+    // only the ones that changed.  Elsewhere we fall back to tearing down and
+    // rebuilding all of our sockets periodically.  See LazyUpdateInterfaces().
+    //
+#if defined(QCC_OS_LINUX) || defined(QCC_OS_ANDROID)
+    int watchFd = NetlinkWatchSocket();
+#else
+    int watchFd = -1;
+#endif
+    bool interfacesChanged = false;
+
     while (!IsStopping()) {
         GetTimeNow(&tNow);
 
@@ -2501,13 +2791,43 @@ void* NameService::Run(void* arg)
         //     3) If LAZY_UPDATE_MAX_INTERVAL has elapsed since the last lazy
         //        update, we need to update.
         //
-        if (m_forceLazyUpdate ||
-            (m_outbound.size() && tLastLazyUpdate + qcc::Timespec(LAZY_UPDATE_MIN_INTERVAL * MS_PER_SEC) < tNow) ||
+        // If we are watching the routing netlink socket, the kernel tells us
+        // when interfaces change, so we update when it does and don't need to
+        // guess in case 2).  The updates only touch the interfaces that
+        // changed; the update every LAZY_UPDATE_MAX_INTERVAL is kept in case
+        // we missed something.
+        //
+        if (m_forceLazyUpdate || interfacesChanged ||
+            (watchFd == -1 && m_outbound.size() && tLastLazyUpdate + qcc::Timespec(LAZY_UPDATE_MIN_INTERVAL * MS_PER_SEC) < tNow) ||
             (tLastLazyUpdate + qcc::Timespec(LAZY_UPDATE_MAX_INTERVAL * MS_PER_SEC) < tNow)) {
 
-            LazyUpdateInterfaces();
+            LazyUpdateInterfaces(watchFd == -1);
             tLastLazyUpdate = tNow;
             m_forceLazyUpdate = false;
+            interfacesChanged = false;
+        }
+
+        //
+        // Every packet we send costs a random delay and, on lossy wireless
+        // networks, another chance of being lost.  Pack queued messages that
+        // fit together into one packet, leaving room for the interface
+        // addresses written into the answers below.  Only neighbors are
+        // merged so receivers see the messages in the order they were queued.
+        //
+        if (m_outbound.size() > 1) {
+            size_t packetMax = GetPacketMax();
+            list<Header>::iterator it = m_outbound.begin();
+            list<Header>::iterator next = it;
+            ++next;
+            while (next != m_outbound.end()) {
+                size_t reserve = NS_ADDRESS_RESERVE * (it->GetNumberAnswers() + next->GetNumberAnswers());
+                if ((reserve < packetMax) && it->Merge(*next, packetMax - reserve)) {
+                    next = m_outbound.erase(next);
+                } else {
+                    it = next;
+                    ++next;
+                }
+            }
         }
 
         //
@@ -2652,6 +2972,17 @@ void* NameService::Run(void* arg)
             }
         }
 
+        //
+        // And on the netlink socket that tells us about interface changes.
+        //
+#if defined(QCC_OS_LINUX) || defined(QCC_OS_ANDROID)
+        qcc::Event* watchEvent = NULL;
+        if (watchFd != -1) {
+            watchEvent = new qcc::Event(watchFd, qcc::Event::IO_READ, false);
+            checkEvents.push_back(watchEvent);
+        }
+#endif
+
         //
         // We are going to go to sleep for possibly as long as a second, so
         // we definitely need to release other (user) threads that might
@@ -2698,6 +3029,18 @@ void* NameService::Run(void* arg)
                 // it.
                 //
                 m_wakeEvent.ResetEvent();
+#if defined(QCC_OS_LINUX) || defined(QCC_OS_ANDROID)
+            } else if (*i == watchEvent) {
+                QCC_DbgPrintf(("NameService::Run(): Interface watch event fired\n"));
+                //
+                // The kernel told us about links or addresses.  Drain the
+                // socket and update the interfaces the next time through the
+                // loop if any of them changed.
+                //
+                if (NetlinkWatchChanged(watchFd)) {
+                    interfacesChanged = true;
+                }
+#endif
             } else {
                 QCC_DbgPrintf(("NameService::Run(): Socket event fired\n"));
                 //
@@ -2749,6 +3092,12 @@ void* NameService::Run(void* arg)
         }
     }
 
+#if defined(QCC_OS_LINUX) || defined(QCC_OS_ANDROID)
+    if (watchFd != -1) {
+        close(watchFd);
+    }
+#endif
+
     delete [] buffer;
     return 0;
 }
@@ -2814,55 +3163,24 @@ void NameService::Retransmit(void)
     }
 
     //
-    // There are at least two threads wandering through the advertised list.
-    // We are running short on toes, so don't shoot any more off by not being
-    // thread-unaware.
-    //
-    m_mutex.Lock();
-
-    //
-    // The underlying protocol is capable of identifying both TCP and UDP
-    // services.  Right now, the only possibility is TCP.
-    //
-    IsAt isAt;
-    isAt.SetTcpFlag(true);
-    isAt.SetUdpFlag(false);
-
-    //
-    // Always send the provided daemon GUID out with the reponse.
-    //
-    isAt.SetGuid(m_guid);
-
-    //
-    // Send a protocol message describing the entire (complete) list of names
-    // we have.
+    // Daemons that are in sync with our sequence number already know our
+    // names, so all they need is a keepalive (a delta without names) to keep
+    // remembering them.  Daemons that are not in sync will ask for a snapshot
+    // when they hear it.
     //
-    isAt.SetCompleteFlag(true);
-
-    isAt.SetPort(m_port);
+    QueueAnswer(NS_VERSION, false, m_tDuration, vector<qcc::String>());
 
     //
-    // Add all of our adversised names to the protocol answer message.
+    // Version 0 daemons drop the keepalive, so if there are any around they
+    // still need the entire list of names to keep remembering them.  Version 1
+    // daemons that know us ignore it.
     //
-    for (list<qcc::String>::iterator i = m_advertised.begin(); i != m_advertised.end(); ++i) {
-        isAt.AddName(*i);
+    m_mutex.Lock();
+    if (HeardVersionZero()) {
+        vector<qcc::String> names(m_advertised.begin(), m_advertised.end());
+        QueueAnswer(0, true, m_tDuration, names);
     }
     m_mutex.Unlock();
-
-    //
-    // The header ties the whole protocol message together.  By setting the
-    // timer, we are asking for everyone who hears the message to remember
-    // the advertisements for that number of seconds.
-    //
-    Header header;
-    header.SetVersion(0);
-    header.SetTimer(m_tDuration);
-    header.AddAnswer(isAt);
-
-    //
-    // Send the message out over the multicast link.
-    //
-    QueueProtocolMessage(header);
 }
 
 void NameService::DoPeriodicMaintenance(void)
@@ -2872,12 +3190,19 @@ void NameService::DoPeriodicMaintenance(void)
 #endif
     m_mutex.Lock();
 
+    ++m_tick;
+
     //
     // Retry all Locate requests to ensure that those requests actually make
     // it out on the wire.
     //
     Retry();
 
+    //
+    // Forget about daemons that have gone quiet.
+    //
+    ExpirePeers();
+
     //
     // If we have something exported, we will have a retransmit timer value
     // set.  If not, this value will be zero and there's nothing to be done.
@@ -2894,10 +3219,24 @@ void NameService::DoPeriodicMaintenance(void)
     m_mutex.Unlock();
 }
 
-void NameService::HandleProtocolQuestion(WhoHas whoHas, qcc::IPAddress address)
+void NameService::HandleProtocolQuestion(WhoHas whoHas, uint8_t version, qcc::IPAddress address)
 {
     QCC_DbgHLPrintf(("NameService::HandleProtocolQuestion()\n"));
 
+    //
+    // A question with the complete flag set asks the daemons with the listed
+    // GUIDs for snapshots of their names.
+    //
+    if (whoHas.GetCompleteFlag()) {
+        for (uint32_t i = 0; i < whoHas.GetNumberNames(); ++i) {
+            if (whoHas.GetName(i) == m_guid) {
+                QueueSnapshot(version);
+                break;
+            }
+        }
+        return;
+    }
+
     //
     // There are at least two threads wandering through the advertised list.
     // We are running short on toes, so don't shoot any more off by not being
@@ -2953,11 +3292,11 @@ void NameService::HandleProtocolQuestion(WhoHas whoHas, qcc::IPAddress address)
     m_mutex.Unlock();
 
     //
-    // Since any response we send must include all of the advertisements we
-    // are exporting; this just means to retransmit all of our advertisements.
+    // The questioner may not have heard any of our advertisements, so answer
+    // with all of them.
     //
     if (respond) {
-        Retransmit();
+        QueueSnapshot(version);
     }
 }
 
@@ -2988,8 +3327,243 @@ void NameService::HandleProtocolAnswer(IsAt isAt, uint32_t timer, qcc::IPAddress
     //
     sort(wkn.begin(), wkn.end());
 
+    ReportNames(isAt, wkn, timer, address);
+}
+
+void NameService::HandleProtocolUpdate(IsAt isAt, uint32_t timer, qcc::IPAddress address)
+{
+    QCC_DbgHLPrintf(("NameService::HandleProtocolUpdate()\n"));
+
+    //
+    // If there are no callbacks we can't tell the user anything about what is
+    // going on the net, so there is no point in keeping track of it either.
+    //
+    if (m_callback == 0) {
+        QCC_DbgHLPrintf(("NameService::HandleProtocolUpdate(): No callback, so nothing to do\n"));
+        return;
+    }
+
+    vector<qcc::String> wkn;
+    for (uint8_t i = 0; i < isAt.GetNumberNames(); ++i) {
+        wkn.push_back(isAt.GetName(i));
+    }
+    sort(wkn.begin(), wkn.end());
+
     qcc::String guid = isAt.GetGuid();
-    QCC_DbgHLPrintf(("NameService::HandleProtocolAnswer(): Got GUID %s\n", guid.c_str()));
+    uint32_t sequence = isAt.GetSequence();
+    QCC_DbgHLPrintf(("NameService::HandleProtocolUpdate(): GUID %s sequence %u %s with %d names\n", guid.c_str(), sequence,
+                     isAt.GetCompleteFlag() ? "snapshot" : "delta", wkn.size()));
+
+    //
+    // We assume a daemon we have never heard of had no names at sequence
+    // zero.  That lets us take the very first delta of a new daemon as it is
+    // without asking for a snapshot.
+    //
+    map<qcc::String, PeerState>::iterator it = m_peers.find(guid);
+    if (it == m_peers.end()) {
+        it = m_peers.insert(pair<qcc::String, PeerState>(guid, PeerState())).first;
+    }
+    PeerState& peer = it->second;
+
+    //
+    // Sequence numbers wrap, so compare them the way TCP does.
+    //
+    int32_t delta = static_cast<int32_t>(sequence - peer.sequence);
+
+    if (isAt.GetCompleteFlag() && (delta == 0) && peer.synced) {
+        //
+        // We already know the list at this sequence number, so this is
+        // either a snapshot someone else asked for or a further part of a
+        // snapshot that did not fit in one packet.  Either way its names are
+        // in the list and are only refreshed.
+        //
+        for (uint32_t i = 0; i < wkn.size(); ++i) {
+            peer.names.insert(wkn[i]);
+        }
+        if (!wkn.empty()) {
+            ReportNames(isAt, wkn, timer, address);
+        }
+    } else if (isAt.GetCompleteFlag()) {
+        if (delta < 0) {
+            QCC_DbgHLPrintf(("NameService::HandleProtocolUpdate(): Ignoring stale snapshot\n"));
+            return;
+        }
+
+        //
+        // Collect the parts of the snapshot.  Hearing a part of a newer
+        // snapshot throws away the parts of an older one we never finished.
+        //
+        if ((peer.pendingSequence != sequence) || (peer.pendingParts.size() != isAt.GetParts())) {
+            peer.pendingSequence = sequence;
+            peer.pendingParts.assign(isAt.GetParts(), false);
+            peer.pendingNames.clear();
+        }
+        peer.pendingParts[isAt.GetPart()] = true;
+        peer.pendingNames.insert(wkn.begin(), wkn.end());
+
+        //
+        // The names in any part are advertised, so refresh them right away.
+        //
+        if (!wkn.empty()) {
+            ReportNames(isAt, wkn, timer, address);
+        }
+
+        //
+        // Once all parts are in, the snapshot replaces whatever we knew about
+        // the daemon.  Withdraw the names it no longer has.
+        //
+        if (find(peer.pendingParts.begin(), peer.pendingParts.end(), false) == peer.pendingParts.end()) {
+            vector<qcc::String> gone;
+            for (set<qcc::String>::iterator i = peer.names.begin(); i != peer.names.end(); ++i) {
+                if (peer.pendingNames.find(*i) == peer.pendingNames.end()) {
+                    gone.push_back(*i);
+                }
+            }
+            peer.names.swap(peer.pendingNames);
+            peer.pendingNames.clear();
+            peer.pendingParts.clear();
+            peer.sequence = sequence;
+            peer.synced = true;
+
+            if (!gone.empty()) {
+                ReportNames(isAt, gone, 0, address);
+            }
+        }
+    } else {
+        if (delta < 0) {
+            QCC_DbgHLPrintf(("NameService::HandleProtocolUpdate(): Ignoring stale delta\n"));
+            return;
+        }
+
+        //
+        // A delta at the next sequence number moves us along.  A delta or
+        // keepalive further ahead means we missed something.  A delta at the
+        // current sequence number is a copy of the last one heard on another
+        // interface (or a keepalive) and changes nothing.
+        //
+        if (delta > 0) {
+            for (uint32_t i = 0; i < wkn.size(); ++i) {
+                if (timer) {
+                    peer.names.insert(wkn[i]);
+                } else {
+                    peer.names.erase(wkn[i]);
+                }
+            }
+            if ((delta > 1) || wkn.empty()) {
+                peer.synced = false;
+            }
+            peer.sequence = sequence;
+        }
+
+        //
+        // A keepalive refreshes all of the names we know the daemon has.
+        //
+        if (wkn.empty()) {
+            wkn.assign(peer.names.begin(), peer.names.end());
+        }
+        if (!wkn.empty()) {
+            ReportNames(isAt, wkn, timer, address);
+        }
+
+        if (!peer.synced && (m_tick >= peer.nextRequestTick)) {
+            peer.nextRequestTick = m_tick + SNAPSHOT_REQUEST_INTERVAL;
+            RequestSnapshot(guid);
+        }
+    }
+
+    //
+    // The names of the daemon are good for timer seconds unless we hear from
+    // it again.
+    //
+    if (timer) {
+        peer.expireTick = m_tick + timer;
+    }
+
+    //
+    // Forget about daemons that have withdrawn all of their names, unless we
+    // are still collecting the parts of a snapshot.
+    //
+    if (peer.synced && peer.names.empty() && peer.pendingParts.empty()) {
+        m_peers.erase(it);
+    }
+}
+
+void NameService::ExpirePeers(void)
+{
+    //
+    // A daemon that we have not heard from for as long as its last timer said
+    // to remember its names has gone away without withdrawing them.  Whoever
+    // we reported the names to lets them expire on the same timer.
+    //
+    for (map<qcc::String, PeerState>::iterator i = m_peers.begin(); i != m_peers.end();) {
+        if (static_cast<int32_t>(m_tick - i->second.expireTick) >= 0) {
+            QCC_DbgHLPrintf(("NameService::ExpirePeers(): Forgetting %s\n", i->first.c_str()));
+            m_peers.erase(i++);
+        } else {
+            ++i;
+        }
+    }
+
+    //
+    // Once the version 0 daemons have gone quiet we stop sending version 0
+    // copies of our answers.
+    //
+    for (map<qcc::String, SenderVersion>::iterator i = m_senderVersions.begin(); i != m_senderVersions.end();) {
+        if (static_cast<int32_t>(m_tick - i->second.expireTick) >= 0) {
+            m_senderVersions.erase(i++);
+        } else {
+            ++i;
+        }
+    }
+}
+
+void NameService::NoteVersion(const qcc::String& guid, uint8_t version, uint32_t timer)
+{
+    m_mutex.Lock();
+
+    map<qcc::String, SenderVersion>::iterator it = m_senderVersions.find(guid);
+    if (it == m_senderVersions.end()) {
+        //
+        // A daemon withdrawing its names does not need to hear ours.
+        //
+        if (timer) {
+            SenderVersion sender = { version, m_tick + timer };
+            m_senderVersions.insert(pair<qcc::String, SenderVersion>(guid, sender));
+        }
+    } else if (version >= it->second.version) {
+        //
+        // The version 0 copies sent by a version 1 daemon don't make it a
+        // version 0 daemon.
+        //
+        it->second.version = version;
+        if (timer) {
+            it->second.expireTick = m_tick + timer;
+        }
+    }
+
+    m_mutex.Unlock();
+}
+
+bool NameService::HeardVersionZero(void)
+{
+    bool heard = false;
+
+    m_mutex.Lock();
+    for (map<qcc::String, SenderVersion>::iterator i = m_senderVersions.begin(); i != m_senderVersions.end(); ++i) {
+        if ((i->second.version == 0) && (static_cast<int32_t>(m_tick - i->second.expireTick) < 0)) {
+            heard = true;
+            break;
+        }
+    }
+    m_mutex.Unlock();
+
+    return heard;
+}
+
+void NameService::ReportNames(const IsAt& isAt, vector<qcc::String>& wkn, uint32_t timer, const qcc::IPAddress& address)
+{
+    qcc::String guid = isAt.GetGuid();
+    QCC_DbgHLPrintf(("NameService::ReportNames(): Got GUID %s\n", guid.c_str()));
 
     //
     // We always get an address since we got the message over a call to
@@ -3008,20 +3582,20 @@ void NameService::HandleProtocolAnswer(IsAt isAt, uint32_t timer, qcc::IPAddress
     qcc::String recvfromAddress, ipv4address, ipv6address;
 
     recvfromAddress = address.ToString();
-    QCC_DbgHLPrintf(("NameService::HandleProtocolAnswer(): Got IP %s from protocol\n", recvfromAddress.c_str()));
+    QCC_DbgHLPrintf(("NameService::ReportNames(): Got IP %s from protocol\n", recvfromAddress.c_str()));
 
     if (isAt.GetIPv4Flag()) {
         ipv4address = isAt.GetIPv4();
-        QCC_DbgHLPrintf(("NameService::HandleProtocolAnswer(): Got IPv4 %s from message\n", ipv4address.c_str()));
+        QCC_DbgHLPrintf(("NameService::ReportNames(): Got IPv4 %s from message\n", ipv4address.c_str()));
     }
 
     if (isAt.GetIPv6Flag()) {
         ipv6address = isAt.GetIPv6();
-        QCC_DbgHLPrintf(("NameService::HandleProtocolAnswer(): Got IPv6 %s from message\n", ipv6address.c_str()));
+        QCC_DbgHLPrintf(("NameService::ReportNames(): Got IPv6 %s from message\n", ipv6address.c_str()));
     }
 
     uint16_t port = isAt.GetPort();
-    QCC_DbgHLPrintf(("NameService::HandleProtocolAnswer(): Got port %d from message\n", port));
+    QCC_DbgHLPrintf(("NameService::ReportNames(): Got port %d from message\n", port));
 
     //
     // The longest bus address we can generate is going to be the larger
@@ -3041,7 +3615,7 @@ void NameService::HandleProtocolAnswer(IsAt isAt, uint32_t timer, qcc::IPAddress
     //
     if ((address.IsIPv4() && !ipv4address.size()) || (address.IsIPv6() && !ipv6address.size())) {
         snprintf(addrbuf, sizeof(addrbuf), "tcp:addr=%s,port=%d", recvfromAddress.c_str(), port);
-        QCC_DbgHLPrintf(("NameService::HandleProtocolAnswer(): Calling back with %s\n", addrbuf));
+        QCC_DbgHLPrintf(("NameService::ReportNames(): Calling back with %s\n", addrbuf));
         qcc::String busAddress(addrbuf);
 
         if (m_callback) {
@@ -3054,7 +3628,7 @@ void NameService::HandleProtocolAnswer(IsAt isAt, uint32_t timer, qcc::IPAddress
     //
     if (ipv4address.size()) {
         snprintf(addrbuf, sizeof(addrbuf), "tcp:addr=%s,port=%d", ipv4address.c_str(), port);
-        QCC_DbgHLPrintf(("NameService::HandleProtocolAnswer(): Calling back with %s\n", addrbuf));
+        QCC_DbgHLPrintf(("NameService::ReportNames(): Calling back with %s\n", addrbuf));
         qcc::String busAddress(addrbuf);
 
         if (m_callback) {
@@ -3067,7 +3641,7 @@ void NameService::HandleProtocolAnswer(IsAt isAt, uint32_t timer, qcc::IPAddress
     //
     if (ipv6address.size()) {
         snprintf(addrbuf, sizeof(addrbuf), "tcp:addr=%s,port=%d", ipv6address.c_str(), port);
-        QCC_DbgHLPrintf(("NameService::HandleProtocolAnswer(): Calling back with %s\n", addrbuf));
+        QCC_DbgHLPrintf(("NameService::ReportNames(): Calling back with %s\n", addrbuf));
         qcc::String busAddress(addrbuf);
 
         if (m_callback) {
@@ -3089,6 +3663,11 @@ void NameService::HandleProtocolMessage(uint8_t const* buffer, uint32_t nbytes,
     }
 #endif
 
+    m_mutex.Lock();
+    ++m_stats.packetsReceived;
+    m_stats.bytesReceived += nbytes;
+    m_mutex.Unlock();
+
     Header header;
     size_t bytesRead = header.Deserialize(buffer, nbytes);
     if (bytesRead != nbytes) {
@@ -3097,9 +3676,10 @@ void NameService::HandleProtocolMessage(uint8_t const* buffer, uint32_t nbytes,
     }
 
     //
-    // We only understand version zero packets for now.
+    // We understand version zero (complete lists) and version one (sequenced
+    // deltas) packets.
     //
-    if (header.GetVersion() != 0) {
+    if (header.GetVersion() > NS_VERSION) {
         QCC_DbgPrintf(("NameService::HandleProtocolMessage(): Unknown version: Error\n"));
         return;
     }
@@ -3112,7 +3692,7 @@ void NameService::HandleProtocolMessage(uint8_t const* buffer, uint32_t nbytes,
     // to pass on this information to other interested bystanders.
     //
     for (uint8_t i = 0; i < header.GetNumberQuestions(); ++i) {
-        HandleProtocolQuestion(header.GetQuestion(i), address);
+        HandleProtocolQuestion(header.GetQuestion(i), header.GetVersion(), address);
     }
 
     //
@@ -3123,7 +3703,20 @@ void NameService::HandleProtocolMessage(uint8_t const* buffer, uint32_t nbytes,
     for (uint8_t i = 0; i < header.GetNumberAnswers(); ++i) {
         IsAt isAt = header.GetAnswer(i);
         if (m_loopback || (isAt.GetGuid() != m_guid)) {
-            HandleProtocolAnswer(isAt, header.GetTimer(), address);
+            NoteVersion(isAt.GetGuid(), header.GetVersion(), header.GetTimer());
+            if (header.GetVersion() == 0) {
+                //
+                // Version 1 daemons send version 0 copies of their answers
+                // for the benefit of version 0 daemons.  We already track the
+                // names of the ones we have heard in version 1.
+                //
+                if (m_peers.find(isAt.GetGuid()) != m_peers.end()) {
+                    continue;
+                }
+                HandleProtocolAnswer(isAt, header.GetTimer(), address);
+            } else {
+                HandleProtocolUpdate(isAt, header.GetTimer(), address);
+            }
         }
     }
 }
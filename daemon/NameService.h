@@ -28,6 +28,8 @@
 
 #include <vector>
 #include <list>
+#include <map>
+#include <set>
 
 #include <qcc/String.h>
 #include <qcc/Thread.h>
@@ -171,6 +173,23 @@ class NameService : public qcc::Thread {
      */
     static const uint32_t RETRY_INTERVAL = 5;
 
+    /**
+     * @internal
+     * @brief The minimum number of seconds between two requests for a name
+     * list snapshot from the same remote daemon.
+     */
+    static const uint32_t SNAPSHOT_REQUEST_INTERVAL = RETRY_INTERVAL;
+
+    /**
+     * @internal
+     * @brief The version of the name service protocol we send.  Version 1 adds
+     * name list sequence numbers so advertisements can be sent as deltas.  We
+     * still understand version 0 messages and ask questions in version 0.  We
+     * send version 0 copies of our advertisements only while we are hearing
+     * answers from a daemon that only speaks version 0.
+     */
+    static const uint8_t NS_VERSION = 1;
+
     /**
      * The modulus indicating the minimum time between interface lazy updates.
      * Units are seconds.
@@ -216,6 +235,20 @@ class NameService : public qcc::Thread {
      */
     static const size_t NS_MESSAGE_MAX = (1454);
 
+    /**
+     * @brief The number of octets an answer grows by when the IPv4 and IPv6
+     * addresses of the interface it goes out on are written into it.  Answers
+     * are split and messages are packed before we know the interface, so this
+     * much room is left for every answer in a packet.
+     */
+    static const size_t NS_ADDRESS_RESERVE = (4 + 16);
+
+    /**
+     * @brief Interfaces reporting an MTU below the minimum every IPv4 host must
+     * accept are assumed to be misreporting and do not limit the packet size.
+     */
+    static const uint32_t NS_MTU_MIN = (576);
+
     /**
      * @brief Which protocol is of interest.  When making discovery calls, the
      * client must choose whether it is interested in IPv4 or IPv6 addresses.
@@ -679,6 +712,26 @@ class NameService : public qcc::Thread {
      */
     size_t NumAdvertisements() { return m_advertised.size(); }
 
+    /**
+     * @brief Name service protocol traffic counters.
+     */
+    struct Stats {
+        uint32_t packetsSent;       /**< Protocol messages sent (one per live interface) */
+        uint32_t bytesSent;         /**< Bytes in the protocol messages sent */
+        uint32_t packetsReceived;   /**< Protocol messages received */
+        uint32_t bytesReceived;     /**< Bytes in the protocol messages received */
+        uint32_t snapshotsSent;     /**< Complete name lists queued for transmission */
+        uint32_t snapshotRequests;  /**< Requests for complete name lists sent */
+        uint32_t v0AnswersQueued;   /**< Version 0 answers queued for daemons that only speak version 0 */
+    };
+
+    /**
+     * @brief Get the protocol traffic counters of this name service.
+     *
+     * @param[out] stats  The counters.
+     */
+    void GetStats(Stats& stats);
+
   private:
     /**
      * @brief The IPv4 multicast address for the  multicast name service.
@@ -819,14 +872,124 @@ class NameService : public qcc::Thread {
      * @internal
      * @brief Do something with a received protocol question.
      */
-    void HandleProtocolQuestion(WhoHas whoHas, qcc::IPAddress address);
+    void HandleProtocolQuestion(WhoHas whoHas, uint8_t version, qcc::IPAddress address);
 
     /**
      * @internal
-     * @brief Do something with a received protocol answer.
+     * @brief Do something with a received version 0 protocol answer.
      */
     void HandleProtocolAnswer(IsAt isAt, uint32_t timer, qcc::IPAddress address);
 
+    /**
+     * @internal
+     * @brief Do something with a received version 1 protocol answer (a
+     * snapshot, delta or keepalive of a remote daemon's name list).
+     */
+    void HandleProtocolUpdate(IsAt isAt, uint32_t timer, qcc::IPAddress address);
+
+    /**
+     * @internal
+     * @brief Call back with names from an answer once for every address the
+     * answering daemon can be reached at.
+     */
+    void ReportNames(const IsAt& isAt, std::vector<qcc::String>& wkn, uint32_t timer, const qcc::IPAddress& address);
+
+    /**
+     * @internal
+     * @brief Queue an answer about our advertised names carrying the current
+     * sequence number.  Names that do not fit in one packet are split over
+     * several answers; each further part of a delta takes the next sequence
+     * number and the parts of a snapshot are numbered.
+     *
+     * @param version   The protocol version of the message.
+     * @param complete  True if names is the complete list of advertised names.
+     * @param timer     The timer value for the answer.
+     * @param names     The names to put in the answer.
+     */
+    void QueueAnswer(uint8_t version, bool complete, uint32_t timer, const std::vector<qcc::String>& names);
+
+    /**
+     * @internal
+     * @brief Get the largest name service message that goes out all of the
+     * live interfaces without IP fragmentation, and never more than
+     * NS_MESSAGE_MAX.
+     */
+    size_t GetPacketMax(void);
+
+    /**
+     * @internal
+     * @brief Queue the complete list of advertised names.  Version 1 snapshots
+     * are sent at most once per second however many daemons ask for them.
+     */
+    void QueueSnapshot(uint8_t version);
+
+    /**
+     * @internal
+     * @brief Ask the daemon with the given GUID for a snapshot of its names.
+     */
+    void RequestSnapshot(const qcc::String& guid);
+
+    /**
+     * @internal
+     * @brief Forget about remote daemons whose names have timed out.
+     */
+    void ExpirePeers(void);
+
+    /**
+     * @internal
+     * @brief Remember the protocol version of an answer heard from a remote
+     * daemon for as long as the answer's timer says.
+     */
+    void NoteVersion(const qcc::String& guid, uint8_t version, uint32_t timer);
+
+    /**
+     * @internal
+     * @brief Returns true if we have recently heard from a daemon that only
+     * speaks version 0 of the protocol, in which case our answers are also
+     * sent in version 0.
+     */
+    bool HeardVersionZero(void);
+
+    /**
+     * @internal
+     * @brief The highest protocol version heard from a remote daemon.
+     */
+    struct SenderVersion {
+        uint8_t version;                /**< Highest protocol version heard */
+        uint32_t expireTick;            /**< m_tick at which we forget the daemon unless we hear from it */
+    };
+
+    /**
+     * @internal
+     * @brief Protocol versions of remote daemons by daemon GUID.  Protected by
+     * m_mutex.
+     */
+    std::map<qcc::String, SenderVersion> m_senderVersions;
+
+    /**
+     * @internal
+     * @brief What we know about the names advertised by a remote daemon that
+     * speaks version 1 of the protocol.  Only used by the main thread.
+     */
+    struct PeerState {
+        uint32_t sequence;              /**< Sequence number of names */
+        std::set<qcc::String> names;    /**< The daemon's advertised names at sequence */
+        bool synced;                    /**< False if we missed changes and need a snapshot */
+        uint32_t nextRequestTick;       /**< Earliest m_tick at which we may ask for another snapshot */
+        uint32_t expireTick;            /**< m_tick at which we forget the daemon unless we hear from it */
+        uint32_t pendingSequence;       /**< Sequence number of the snapshot whose parts we are collecting */
+        std::vector<bool> pendingParts; /**< Which parts of the pending snapshot we have heard, empty if none */
+        std::set<qcc::String> pendingNames; /**< Names in the parts of the pending snapshot heard so far */
+
+        PeerState() : sequence(0), synced(true), nextRequestTick(0), expireTick(0), pendingSequence(0) { }
+    };
+
+    /**
+     * @internal
+     * @brief Name lists of remote daemons by daemon GUID.
+     */
+    std::map<qcc::String, PeerState> m_peers;
+
     Callback<void, const qcc::String&, const qcc::String&, std::vector<qcc::String>&, uint8_t>* m_callback;
 
     /**
@@ -835,6 +998,32 @@ class NameService : public qcc::Thread {
      */
     std::list<qcc::String> m_advertised;
 
+    /**
+     * @internal
+     * @brief The sequence number of m_advertised.  Incremented each time names
+     * are added or removed.
+     */
+    uint32_t m_sequence;
+
+    /**
+     * @internal
+     * @brief Seconds of periodic maintenance since the name service started.
+     */
+    uint32_t m_tick;
+
+    /**
+     * @internal
+     * @brief The earliest value of m_tick at which we queue another version 1
+     * snapshot.
+     */
+    uint32_t m_snapshotTick;
+
+    /**
+     * @internal
+     * @brief Protocol traffic counters.  Protected by m_mutex.
+     */
+    Stats m_stats;
+
     /**
      * @internal
      * @brief The daemon GUID string of the daemon assoicated with this instance
@@ -880,7 +1069,7 @@ class NameService : public qcc::Thread {
 
     /**
      * @internal
-     * @brief Retransmit exported advertisements.
+     * @brief Refresh exported advertisements with a keepalive.
      */
     void Retransmit(void);
 
@@ -983,12 +1172,30 @@ class NameService : public qcc::Thread {
      */
     void ClearLiveInterfaces(void);
 
+    /**
+     * @internal
+     * @brief Leave the multicast group on a live interface and close its
+     * socket.
+     */
+    void CloseLiveInterface(LiveInterface& live);
+
+    /**
+     * @internal
+     * @brief Decide whether an interface found by IfConfig() is one we want to
+     * send and receive name service messages over.
+     */
+    bool UseInterface(const IfConfigEntry& entry);
+
     /**
      * @internal
      * @brief Make sure that we have socket open to talk and listen to as many
      * of our desired interfaces as possible.
+     *
+     * @param rebuild If true, close all live interfaces and open them again.
+     *     If false, only close the live interfaces that went away or changed
+     *     and open the ones that appeared.
      */
-    void LazyUpdateInterfaces(void);
+    void LazyUpdateInterfaces(bool rebuild);
 };
 
 } // namespace ajn
@@ -62,6 +62,7 @@ void NameTable::AddUniqueName(BusEndpoint& endpoint)
     QCC_DbgPrintf(("Add unique name %s", uniqueName.c_str()));
     lock.Lock();
     uniqueNames[uniqueName] = &endpoint;
+    UpdateRoute(uniqueName);
     lock.Unlock();
 
     /* Notify listeners */
@@ -116,7 +117,7 @@ void NameTable::RemoveUniqueName(const qcc::String& uniqueName)
 
         QCC_DbgPrintf(("Removing ep=%s from name table", uniqueName.c_str()));
         uniqueNames.erase(it);
-
+        UpdateRoute(uniqueName);
     }
     lock.Unlock();
 }
@@ -172,6 +173,9 @@ QStatus NameTable::AddAlias(const qcc::String& aliasName,
                 origOwner = &vit->second->GetUniqueName();
             }
         }
+        if (newOwner) {
+            UpdateRoute(aliasName);
+        }
         lock.Unlock();
 
         if (listener) {
@@ -231,6 +235,9 @@ void NameTable::RemoveAlias(const qcc::String& aliasName,
         disposition = DBUS_RELEASE_NAME_REPLY_NON_EXISTENT;
     }
 
+    if (oldOwner) {
+        UpdateRoute(aliasNameCopy);
+    }
     lock.Unlock();
 
     if (listener) {
@@ -269,6 +276,38 @@ BusEndpoint* NameTable::FindEndpoint(const qcc::String& busName) const
     return ret;
 }
 
+BusEndpoint* NameTable::AcquireEndpoint(const char* busName) const
+{
+    BusEndpoint* ret = NULL;
+
+    /*
+     * The routing reference is taken while the routes lock is held. A writer that removes an
+     * endpoint updates the routes under this lock before waiting for the endpoint's routing
+     * references to drain, so no reader can find the endpoint after that wait starts.
+     */
+    routesLock.Lock();
+    EndpointMap::const_iterator it = routes.find(StringMapKey(busName));
+    if (it != routes.end()) {
+        ret = it->second;
+        ret->IncrementRouteRef();
+    }
+    routesLock.Unlock();
+    return ret;
+}
+
+void NameTable::UpdateRoute(const qcc::String& busName)
+{
+    BusEndpoint* ep = FindEndpoint(busName);
+
+    routesLock.Lock();
+    if (ep) {
+        routes[busName] = ep;
+    } else {
+        routes.erase(StringMapKey(busName));
+    }
+    routesLock.Unlock();
+}
+
 void NameTable::GetBusNames(vector<qcc::String>& names) const
 {
     lock.Lock();
@@ -363,6 +402,7 @@ void NameTable::RemoveVirtualAliases(VirtualEndpoint& ep)
                 CallListeners(alias, &ep.GetUniqueName(), NULL);
             }
             virtualAliasNames.erase(vit++);
+            UpdateRoute(alias);
         } else {
             ++vit;
         }
@@ -404,6 +444,9 @@ bool NameTable::SetVirtualAlias(const qcc::String& alias,
     } else {
         virtualAliasNames.erase(StringMapKey(alias));
     }
+    if (madeChange) {
+        UpdateRoute(alias);
+    }
     lock.Unlock();
 
     /* Virtual aliases cannot override locally requested aliases */
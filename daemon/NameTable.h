@@ -183,6 +183,18 @@ class NameTable {
      */
     BusEndpoint* FindEndpoint(const qcc::String& busName) const;
 
+    /**
+     * Find an endpoint for a given unique or alias bus name and take a routing reference on it.
+     * This method does not acquire the name table lock. The lookup is done in a map of resolved
+     * routes that is updated for each name that is added or removed, so it is never blocked by a
+     * thread that holds the name table lock.
+     * The caller must call DecrementRouteRef() on the returned endpoint when it is done with it.
+     *
+     * @param busName   Name of bus.
+     * @return  Endpoint for busName (with a routing reference held) or NULL if none is found.
+     */
+    BusEndpoint* AcquireEndpoint(const char* busName) const;
+
     /**
      * Get all bus names from name table.
      *
@@ -233,6 +245,9 @@ class NameTable {
         }
     };
 
+    /** Resolved bus name to endpoint map used by AcquireEndpoint */
+    typedef std::hash_map<qcc::StringMapKey, BusEndpoint*> EndpointMap;
+
     mutable qcc::Mutex lock;                                             /**< Lock protecting name tables */
     std::hash_map<qcc::String, BusEndpoint*, Hash, Equal> uniqueNames;   /**< Unique name table */
     std::hash_map<qcc::String, std::deque<NameQueueEntry>, Hash, Equal> aliasNames;  /**< Alias name table */
@@ -240,6 +255,16 @@ class NameTable {
     qcc::String uniquePrefix;
     std::vector<NameListener*> listeners;                              /**< Listeners regsitered with name table */
     std::map<qcc::StringMapKey, VirtualEndpoint*> virtualAliasNames;   /**< map of virtual aliases to virtual endpts */
+    EndpointMap routes;                                                /**< Endpoint each bus name currently resolves to */
+    mutable qcc::Mutex routesLock;                                     /**< Lock protecting routes */
+
+    /**
+     * Update the route used by AcquireEndpoint for a single bus name from the current name tables.
+     * Must be called with the name table lock held after any change that affects how busName resolves.
+     *
+     * @param busName   The unique or alias name that changed.
+     */
+    void UpdateRoute(const qcc::String& busName);
 
     /**
      * Helper used to call the listners
@@ -111,7 +111,8 @@ size_t StringData::Deserialize(uint8_t const* buffer, uint32_t bufsize)
 }
 
 IsAt::IsAt()
-    : m_flagG(false), m_flagC(false), m_flagT(false), m_flagU(false), m_flagS(false), m_flagF(false), m_port(0)
+    : m_version(0), m_flagG(false), m_flagC(false), m_flagT(false), m_flagU(false), m_flagS(false), m_flagF(false), m_port(0),
+    m_sequence(0), m_part(0), m_parts(1)
 {
 }
 
@@ -141,6 +142,13 @@ uint16_t IsAt::GetPort(void) const
     return m_port;
 }
 
+void IsAt::SetPart(uint8_t part, uint8_t parts)
+{
+    assert(part < parts);
+    m_part = part;
+    m_parts = parts;
+}
+
 void IsAt::ClearIPv4(void)
 {
     m_ipv4 = "";
@@ -191,6 +199,47 @@ qcc::String IsAt::GetName(uint32_t index) const
     return m_names[index];
 }
 
+bool IsAt::Split(size_t maxSize, std::vector<IsAt>& parts) const
+{
+    IsAt part = *this;
+    part.m_names.clear();
+    size_t base = part.GetSerializedSize();
+    if (base > maxSize) {
+        return false;
+    }
+
+    //
+    // Fill each part with as many names as fit, and no more than the count
+    // octet can describe.
+    //
+    std::vector<IsAt> result;
+    size_t size = base;
+    for (uint32_t i = 0; i < m_names.size(); ++i) {
+        size_t nameSize = 1 + m_names[i].size();
+        if (base + nameSize > maxSize) {
+            return false;
+        }
+        if (!part.m_names.empty() && ((size + nameSize > maxSize) || (part.m_names.size() == 255))) {
+            result.push_back(part);
+            part.m_names.clear();
+            size = base;
+        }
+        part.m_names.push_back(m_names[i]);
+        size += nameSize;
+    }
+    result.push_back(part);
+
+    if (result.size() > 255) {
+        return false;
+    }
+    for (uint32_t i = 0; i < result.size(); ++i) {
+        result[i].SetPart(static_cast<uint8_t>(i), static_cast<uint8_t>(result.size()));
+    }
+
+    parts.insert(parts.end(), result.begin(), result.end());
+    return true;
+}
+
 size_t IsAt::GetSerializedSize(void) const
 {
     //
@@ -226,10 +275,20 @@ size_t IsAt::GetSerializedSize(void) const
         size += s.GetSerializedSize();
     }
 
+    //
+    // Version one answers carry a 32-bit sequence number and two octets
+    // numbering the parts of a snapshot.
+    //
+    if (m_version >= 1) {
+        size += 6;
+    }
+
+    //
+    // Each name is serialized as StringData: a length octet followed by the
+    // characters of the name.
+    //
     for (uint32_t i = 0; i < m_names.size(); ++i) {
-        StringData s;
-        s.Set(m_names[i]);
-        size += s.GetSerializedSize();
+        size += 1 + m_names[i].size();
     }
 
     return size;
@@ -333,6 +392,22 @@ size_t IsAt::Serialize(uint8_t* buffer) const
         p += stringSize;
     }
 
+    //
+    // Version one answers carry the sequence number of the advertised name
+    // list in network byte order.
+    //
+    if (m_version >= 1) {
+        p[0] = static_cast<uint8_t>(m_sequence >> 24);
+        p[1] = static_cast<uint8_t>(m_sequence >> 16);
+        p[2] = static_cast<uint8_t>(m_sequence >> 8);
+        p[3] = static_cast<uint8_t>(m_sequence);
+        QCC_DbgPrintf(("IsAt::Serialize(): Sequence %u", m_sequence));
+        p[4] = m_part;
+        p[5] = m_parts;
+        QCC_DbgPrintf(("IsAt::Serialize(): Part %d of %d", m_part, m_parts));
+        p += 6;
+        size += 6;
+    }
 
     for (uint32_t i = 0; i < m_names.size(); ++i) {
         StringData stringData;
@@ -478,6 +553,30 @@ size_t IsAt::Deserialize(uint8_t const* buffer, uint32_t bufsize)
         bufsize -= stringSize;
     }
 
+    //
+    // Version one answers carry a sequence number and part numbers; and we'd
+    // better have enough buffer to read them out of.
+    //
+    if (m_version >= 1) {
+        if (bufsize < 6) {
+            QCC_DbgPrintf(("IsAt::Deserialize(): Insufficient bufsize %d", bufsize));
+            return 0;
+        }
+        m_sequence = (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+                     (static_cast<uint32_t>(p[2]) << 8) | static_cast<uint32_t>(p[3]);
+        QCC_DbgPrintf(("IsAt::Deserialize(): Sequence %u", m_sequence));
+        m_part = p[4];
+        m_parts = p[5];
+        QCC_DbgPrintf(("IsAt::Deserialize(): Part %d of %d", m_part, m_parts));
+        if (m_part >= m_parts) {
+            QCC_DbgPrintf(("IsAt::Deserialize(): Bad part number"));
+            return 0;
+        }
+        p += 6;
+        size += 6;
+        bufsize -= 6;
+    }
+
     //
     // Now we need to read out <numberNames> names that the packet has told us
     // will be there.
@@ -505,7 +604,7 @@ size_t IsAt::Deserialize(uint8_t const* buffer, uint32_t bufsize)
 }
 
 WhoHas::WhoHas()
-    : m_flagT(false), m_flagU(false), m_flagS(false), m_flagF(false)
+    : m_flagC(false), m_flagT(false), m_flagU(false), m_flagS(false), m_flagF(false)
 {
 }
 
@@ -538,13 +637,11 @@ size_t WhoHas::GetSerializedSize(void) const
     size_t size = 2;
 
     //
-    // Let the string data decide for themselves how long the rest
-    // of the message will be.
+    // Each name is serialized as StringData: a length octet followed by the
+    // characters of the name.
     //
     for (uint32_t i = 0; i < m_names.size(); ++i) {
-        StringData s;
-        s.Set(m_names[i]);
-        size += s.GetSerializedSize();
+        size += 1 + m_names[i].size();
     }
 
     return size;
@@ -564,6 +661,10 @@ size_t WhoHas::Serialize(uint8_t* buffer) const
     //
     uint8_t typeAndFlags = 2 << 6;
 
+    if (m_flagC) {
+        QCC_DbgPrintf(("WhoHas::Serialize(): C flag"));
+        typeAndFlags |= 0x10;
+    }
     if (m_flagT) {
         QCC_DbgPrintf(("WhoHas::Serialize(): T flag"));
         typeAndFlags |= 0x8;
@@ -646,6 +747,9 @@ size_t WhoHas::Deserialize(uint8_t const* buffer, uint32_t bufsize)
         return 0;
     }
 
+    m_flagC = (typeAndFlags & 0x10) != 0;
+    QCC_DbgPrintf(("WhoHas::Deserialize(): C flag %d", m_flagC));
+
     m_flagT = (typeAndFlags & 0x8) != 0;
     QCC_DbgPrintf(("WhoHas::Deserialize(): T flag %d", m_flagT));
 
@@ -710,6 +814,13 @@ Header::~Header()
 void Header::SetVersion(uint8_t version)
 {
     m_version = version;
+
+    //
+    // The layout of an answer depends on the version of the message it is in.
+    //
+    for (uint32_t i = 0; i < m_answers.size(); ++i) {
+        m_answers[i].SetVersion(version);
+    }
 }
 
 uint8_t Header::GetVersion(void) const
@@ -751,6 +862,7 @@ void Header::GetQuestion(uint32_t index, WhoHas** question)
 
 void Header::AddAnswer(IsAt answer)
 {
+    answer.SetVersion(m_version);
     m_answers.push_back(answer);
 }
 
@@ -771,6 +883,35 @@ void Header::GetAnswer(uint32_t index, IsAt** answer)
     *answer = &m_answers[index];
 }
 
+bool Header::Merge(const Header& other, size_t maxSize)
+{
+    if (other.m_version != m_version) {
+        return false;
+    }
+
+    if (!m_answers.empty() && !other.m_answers.empty() && (other.m_timer != m_timer)) {
+        return false;
+    }
+
+    if ((m_questions.size() + other.m_questions.size() > 255) || (m_answers.size() + other.m_answers.size() > 255)) {
+        return false;
+    }
+
+    //
+    // The merged message has one four octet fixed part, not two.
+    //
+    if (GetSerializedSize() + other.GetSerializedSize() - 4 > maxSize) {
+        return false;
+    }
+
+    if (m_answers.empty()) {
+        m_timer = other.m_timer;
+    }
+    m_questions.insert(m_questions.end(), other.m_questions.begin(), other.m_questions.end());
+    m_answers.insert(m_answers.end(), other.m_answers.begin(), other.m_answers.end());
+    return true;
+}
+
 size_t Header::GetSerializedSize(void) const
 {
     //
@@ -784,8 +925,7 @@ size_t Header::GetSerializedSize(void) const
     // of the message will be.
     //
     for (uint32_t i = 0; i < m_questions.size(); ++i) {
-        WhoHas whoHas = m_questions[i];
-        size += whoHas.GetSerializedSize();
+        size += m_questions[i].GetSerializedSize();
     }
 
     //
@@ -793,8 +933,7 @@ size_t Header::GetSerializedSize(void) const
     // of the message will be.
     //
     for (uint32_t i = 0; i < m_answers.size(); ++i) {
-        IsAt isAt = m_answers[i];
-        size += isAt.GetSerializedSize();
+        size += m_answers[i].GetSerializedSize();
     }
 
     return size;
@@ -847,8 +986,7 @@ size_t Header::Serialize(uint8_t* buffer) const
     //
     for (uint32_t i = 0; i < m_questions.size(); ++i) {
         QCC_DbgPrintf(("Header::Serialize(): WhoHas::Serialize() question %d", i));
-        WhoHas whoHas = m_questions[i];
-        size_t questionSize = whoHas.Serialize(p);
+        size_t questionSize = m_questions[i].Serialize(p);
         size += questionSize;
         p += questionSize;
     }
@@ -858,8 +996,7 @@ size_t Header::Serialize(uint8_t* buffer) const
     //
     for (uint32_t i = 0; i < m_answers.size(); ++i) {
         QCC_DbgPrintf(("Header::Serialize(): IsAt::Serialize() answer %d", i));
-        IsAt isAt = m_answers[i];
-        size_t answerSize = isAt.Serialize(p);
+        size_t answerSize = m_answers[i].Serialize(p);
         size += answerSize;
         p += answerSize;
     }
@@ -945,6 +1082,7 @@ size_t Header::Deserialize(uint8_t const* buffer, uint32_t bufsize)
     for (uint8_t i = 0; i < aCount; ++i) {
         QCC_DbgPrintf(("Header::Deserialize(): IsAt::Deserialize() answer %d", i));
         IsAt isAt;
+        isAt.SetVersion(m_version);
 
         //
         // Tell the answer to read itself out.  If there's not enough buffer
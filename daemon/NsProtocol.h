@@ -120,6 +120,10 @@ namespace ajn {
  *     ~       Daemon GUID StringData present if 'G' bit is set        ~
  *     |                                                               |
  *     +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+ *     |          Sequence present if the header Version is 1          |
+ *     +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+ *     |     Part      |     Parts     |
+ *     +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
  *     |                                                               |
  *     ~            Variable Number of StringData Records              ~
  *     |                                                               |
@@ -145,6 +149,28 @@ namespace ajn {
  *     Present if the 'F' bit is set to '1'.
  * @li @c IPv6Address The IPv6 address on which the responding daemon is listening.
  *     Present if the 'S' bit is set to '1'.
+ * @li @c Sequence The sequence number of the responding daemon's list of
+ *     well-known names in network byte order.  The daemon increments it each
+ *     time it adds or removes names.  Present if the header Version is 1.
+ * @li @c Part The index of this IS-AT message among the messages a snapshot
+ *     was split into.  Present if the header Version is 1.
+ * @li @c Parts The number of messages a snapshot was split into (at least
+ *     one).  Present if the header Version is 1.
+ *
+ * In version 1 of the protocol an IS-AT message with the 'C' bit set is a
+ * snapshot of all of the names of the responding daemon at the given
+ * Sequence.  An IS-AT message with the 'C' bit clear is a delta that moves the
+ * list from Sequence - 1 to Sequence: the names are added if the header Timer
+ * is non-zero and removed if it is zero.  A delta without names is a keepalive
+ * that refreshes the list at Sequence.  A receiver that sees a Sequence it does
+ * not expect asks for a snapshot.
+ *
+ * Names that do not fit in one packet are split over several IS-AT messages.
+ * Each part of a delta takes its own Sequence and is sent as Part 0 of 1.  All
+ * parts of a snapshot carry the same Sequence and are numbered 0 to Parts - 1;
+ * a receiver only replaces its list once it has heard all of them.  A receiver
+ * that is already in sync at that Sequence adds the names of any part to its
+ * list.
  *
  * <b>WHO-HAS Message</b>
  *
@@ -155,7 +181,7 @@ namespace ajn {
  *      0                   1                   2                   3
  *      0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
  *     +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
- *     |F S U T R R| M |     Count     |                               |
+ *     |F S U T C R| M |     Count     |                               |
  *     +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+                               |
  *     |                                                               |
  *     ~              Variable Number of StringData Records            ~
@@ -165,6 +191,10 @@ namespace ajn {
  *
  * @li @c M The message type of the WHO-HAS message.  Defined to be '10' (2)
  * @li @c R Reserved bit.
+ * @li @c C If '1' indicates that the StringData records are daemon GUIDs
+ *     rather than bus names, and that the requesting daemon wants a snapshot
+ *     of all of the names of the daemons with those GUIDs.  Only used in
+ *     version 1 of the protocol.
  * @li @c T If '1' indicates that the requesting daemon wants to connect using
  *     TCP.
  * @li @c U If '1' indicates that the requesting daemon wants to connect using
@@ -193,7 +223,7 @@ namespace ajn {
  *     +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
  * @endverbatim
  *
- * @li @c Version The version of the protocol.
+ * @li @c Version The version of the protocol (0 or 1).
  * @li @c QCount The number of question messages that follow the header.
  * @li @c ACount The number of question messages that follow the question
  *     messages.
@@ -480,6 +510,71 @@ class IsAt : public ProtocolElement {
      */
     bool GetCompleteFlag(void) const { return m_flagC; }
 
+    /**
+     * @internal
+     * @brief Set the version of the protocol message carrying this answer.
+     *
+     * The version is not part of the answer on the wire but decides whether
+     * the sequence number is.  The header sets it when it serializes or
+     * deserializes its answers.
+     *
+     * @param version The version (0 .. 255) of the protocol.
+     */
+    void SetVersion(uint8_t version) { m_version = version; }
+
+    /**
+     * @internal
+     * @brief Get the version of the protocol message carrying this answer.
+     *
+     * @return The version (0 .. 255) of the protocol.
+     */
+    uint8_t GetVersion(void) const { return m_version; }
+
+    /**
+     * @internal
+     * @brief Set the sequence number of the list of well-known names of the
+     * daemon generating this answer.  Only sent in version 1 messages.
+     *
+     * @param sequence The sequence number of the name list.
+     */
+    void SetSequence(uint32_t sequence) { m_sequence = sequence; }
+
+    /**
+     * @internal
+     * @brief Get the sequence number of the list of well-known names of the
+     * daemon generating this answer.
+     *
+     * @return The sequence number of the name list.
+     */
+    uint32_t GetSequence(void) const { return m_sequence; }
+
+    /**
+     * @internal
+     * @brief Set the index of this answer among the answers a snapshot was
+     * split into, and their number.  Only sent in version 1 messages.
+     *
+     * @param part The index of this answer (less than parts).
+     * @param parts The number of answers (1 .. 255).
+     */
+    void SetPart(uint8_t part, uint8_t parts);
+
+    /**
+     * @internal
+     * @brief Get the index of this answer among the answers a snapshot was
+     * split into.
+     *
+     * @return The index of this answer.
+     */
+    uint8_t GetPart(void) const { return m_part; }
+
+    /**
+     * @internal
+     * @brief Get the number of answers a snapshot was split into.
+     *
+     * @return The number of answers.
+     */
+    uint8_t GetParts(void) const { return m_parts; }
+
     /**
      * @internal
      * @brief Set the protocol flag indicating that the daemon generating
@@ -716,6 +811,23 @@ class IsAt : public ProtocolElement {
      */
     qcc::String GetName(uint32_t index) const;
 
+    /**
+     * @internal
+     * @brief Split the names of this answer over answers that each serialize
+     * to no more than a given number of octets.
+     *
+     * Every part is a copy of this answer that carries a consecutive run of
+     * its names, in order, and is numbered with SetPart().  An answer without
+     * names yields one part.
+     *
+     * @param maxSize The largest serialized size of a part.
+     * @param parts [OUT] Appended with the parts.
+     *
+     * @return False if a single name does not fit in maxSize or the names
+     *     need more than 255 parts, in which case parts is left alone.
+     */
+    bool Split(size_t maxSize, std::vector<IsAt>& parts) const;
+
     /**
      * @internal
      * @brief Get the size of a buffer that will allow the answer object and
@@ -752,6 +864,7 @@ class IsAt : public ProtocolElement {
     size_t Deserialize(uint8_t const* buffer, uint32_t bufsize);
 
   private:
+    uint8_t m_version;
     bool m_flagG;
     bool m_flagC;
     bool m_flagT;
@@ -759,6 +872,9 @@ class IsAt : public ProtocolElement {
     bool m_flagS;
     bool m_flagF;
     uint16_t m_port;
+    uint32_t m_sequence;
+    uint8_t m_part;
+    uint8_t m_parts;
     qcc::String m_guid;
     qcc::String m_ipv4;
     qcc::String m_ipv6;
@@ -790,6 +906,24 @@ class WhoHas : public ProtocolElement {
      */
     ~WhoHas();
 
+    /**
+     * @internal
+     * @brief Set the protocol flag indicating that the names in this question
+     * are daemon GUIDs whose complete well-known name lists are requested.
+     *
+     * @param flag True if this question requests name list snapshots.
+     */
+    void SetCompleteFlag(bool flag) { m_flagC = flag; }
+
+    /**
+     * @internal
+     * @brief Get the protocol flag indicating that the names in this question
+     * are daemon GUIDs whose complete well-known name lists are requested.
+     *
+     * @return True if this question requests name list snapshots.
+     */
+    bool GetCompleteFlag(void) const { return m_flagC; }
+
     /**
      * @internal
      * @brief Set the protocol flag indicating that the daemon generating
@@ -952,6 +1086,7 @@ class WhoHas : public ProtocolElement {
     size_t Deserialize(uint8_t const* buffer, uint32_t bufsize);
 
   private:
+    bool m_flagC;
     bool m_flagT;
     bool m_flagU;
     bool m_flagS;
@@ -1204,6 +1339,22 @@ class Header : public ProtocolElement {
      */
     void GetAnswer(uint32_t index, IsAt** answer);
 
+    /**
+     * @internal
+     * @brief Append the questions and answers of another header to this one
+     * if the result serializes to no more than a given number of octets.
+     *
+     * Headers are only merged if they have the same version and, when both
+     * carry answers, the same timer since the timer applies to every answer
+     * in a message.
+     *
+     * @param other The header to merge into this one.
+     * @param maxSize The largest serialized size of the merged header.
+     *
+     * @return True if other was merged into this header.
+     */
+    bool Merge(const Header& other, size_t maxSize);
+
     /**
      * @internal
      * @brief Get the size of a buffer that will allow the header object and
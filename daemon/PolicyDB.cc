@@ -122,7 +122,10 @@ bool _PolicyDB::TrueFalseStrToBool(const qcc::String& str, bool& b)
 }
 
 
-_PolicyDB::_PolicyDB() : eavesdrop(false)
+_PolicyDB::_PolicyDB() :
+    eavesdrop(false),
+    nextUniqueNameKey(FIRST_UNIQUE_NAME_KEY),
+    generation(1)
 {
     stringIDs[""] = WILDCARD;
     stringIDs["*"] = WILDCARD;
@@ -327,6 +330,10 @@ bool _PolicyDB::AddRule(policydb::PolicyCategory cat,
         }
         break;
     }
+
+    if (success) {
+        InvalidateDecisions();
+    }
     return success;
 }
 
@@ -337,26 +344,113 @@ void _PolicyDB::NameOwnerChanged(const qcc::String& alias,
 {
     StringIDMap::const_iterator bnit(busNameMap.find(alias));
 
+    /* Only names that appear in rules affect policy decisions */
     if (bnit != busNameMap.end()) {
+        bnLock.Lock();
         if (oldOwner) {
             UniqueNameIDMap::iterator unit = uniqueNameMap.find(*oldOwner);
             if (unit != uniqueNameMap.end()) {
-                bnLock.Lock();
-                unit->second.erase(bnit->second);
-                if (unit->second.empty()) {
+                unit->second.busNames.erase(bnit->second);
+                if (unit->second.busNames.empty()) {
                     uniqueNameMap.erase(unit);
                 }
-                bnLock.Unlock();
             }
         }
         if (newOwner) {
-            if (bnit != busNameMap.end()) {
-                bnLock.Lock();
-                uniqueNameMap[*newOwner].insert(bnit->second);
-                bnLock.Unlock();
+            UniqueNameInfo& info = uniqueNameMap[*newOwner];
+            if (info.busNames.empty()) {
+                /* Entries are removed once empty so this is a new entry */
+                info.key = nextUniqueNameKey++;
             }
+            info.busNames.insert(bnit->second);
+        }
+        /*
+         * Invalidate while bnLock is still held so a header normalized against the old names
+         * can never see the new generation.
+         */
+        InvalidateDecisions();
+        bnLock.Unlock();
+    }
+}
+
+
+_PolicyDB::DecisionKey _PolicyDB::GetDecisionKey(const NormalizedMsgHdr& nmh, bool send, uint32_t uid, uint32_t gid)
+{
+    DecisionKey key;
+    key.ifcID = nmh.ifcID;
+    key.memberID = nmh.memberID;
+    key.errorID = nmh.errorID;
+    key.pathID = nmh.pathID;
+    key.busNameKey = send ? nmh.destKey : nmh.senderKey;
+    key.uid = uid;
+    key.gid = gid;
+    key.type = nmh.type;
+    key.send = send;
+    return key;
+}
+
+
+size_t _PolicyDB::DecisionKey::Slot() const
+{
+    uint32_t h = 2166136261U;
+    const uint32_t fields[] = { ifcID, memberID, errorID, pathID, busNameKey, uid, gid,
+                                static_cast<uint32_t>(type) | (send ? 0x100 : 0) };
+    for (size_t i = 0; i < ArraySize(fields); ++i) {
+        h = (h ^ fields[i]) * 16777619U;
+    }
+    return (h ^ (h >> 16)) & (DECISION_CACHE_SIZE - 1);
+}
+
+
+uint32_t _PolicyDB::GetGeneration() const
+{
+    cacheLock.Lock();
+    uint32_t gen = generation;
+    cacheLock.Unlock();
+    return gen;
+}
+
+
+bool _PolicyDB::LookupDecision(const DecisionKey& key, uint32_t gen, bool& allow) const
+{
+    bool hit;
+    const Decision& d(decisions[key.Slot()]);
+
+    cacheLock.Lock();
+    hit = (gen == generation) && (d.generation == gen) && (d.key == key);
+    if (hit) {
+        allow = d.allow;
+    }
+    cacheLock.Unlock();
+    return hit;
+}
+
+
+void _PolicyDB::StoreDecision(const DecisionKey& key, bool allow, uint32_t gen) const
+{
+    Decision& d(decisions[key.Slot()]);
+
+    cacheLock.Lock();
+    if (gen == generation) {
+        d.key = key;
+        d.allow = allow;
+        d.generation = gen;
+    }
+    cacheLock.Unlock();
+}
+
+
+void _PolicyDB::InvalidateDecisions()
+{
+    cacheLock.Lock();
+    if (++generation == 0) {
+        /* Generation wrapped so old entries could look valid again */
+        for (size_t i = 0; i < DECISION_CACHE_SIZE; ++i) {
+            decisions[i].generation = 0;
         }
+        generation = 1;
     }
+    cacheLock.Unlock();
 }
 
 
@@ -526,6 +620,23 @@ bool _PolicyDB::OKToOwn(uint32_t busNameID,
 bool _PolicyDB::OKToReceive(const NormalizedMsgHdr& nmh,
                             uint32_t uid,
                             uint32_t gid) const
+{
+    DecisionKey key(GetDecisionKey(nmh, false, uid, gid));
+    bool allow;
+
+    if (LookupDecision(key, nmh.generation, allow)) {
+        ALLJOYN_POLICY_DEBUG(Log(LOG_DEBUG, "    using cached receive decision\n"));
+    } else {
+        allow = EvaluateReceive(nmh, uid, gid);
+        StoreDecision(key, allow, nmh.generation);
+    }
+    return allow;
+}
+
+
+bool _PolicyDB::EvaluateReceive(const NormalizedMsgHdr& nmh,
+                                uint32_t uid,
+                                uint32_t gid) const
 {
     bool allow(false);
     bool ruleMatch(false);
@@ -533,19 +644,19 @@ bool _PolicyDB::OKToReceive(const NormalizedMsgHdr& nmh,
 
     if (!receiveRS.mandatoryRules.empty()) {
         ALLJOYN_POLICY_DEBUG(Log(LOG_DEBUG, "    checking mandatory rules\n"));
-        ruleMatch = CheckMessage(allow, receiveRS.mandatoryRules, nmh, nmh.senderIDList, false);
+        ruleMatch = CheckMessage(allow, receiveRS.mandatoryRules, nmh, nmh.GetSenderIDList(), false);
     }
 
 #if defined(CONSOLE_CHECK_SUPPORT)
     if (atConsole) {
         if (!ruleMatch && !receiveRS.atConsoleRules.empty()) {
             ALLJOYN_POLICY_DEBUG(Log(LOG_DEBUG, "    checking atconsole=true rules\n"));
-            ruleMatch = CheckMessage(allow, receiveRS.atConsoleRules, nmh, nmh.senderIDList, false);
+            ruleMatch = CheckMessage(allow, receiveRS.atConsoleRules, nmh, nmh.GetSenderIDList(), false);
         }
     } else {
         if (!ruleMatch && !receiveRS.notAtConsoleRules.empty()) {
             ALLJOYN_POLICY_DEBUG(Log(LOG_DEBUG, "    checking atconsole=false rules\n"));
-            ruleMatch = CheckMessage(allow, receiveRS.notAtConsoleRules, nmh, nmh.senderIDList, false);
+            ruleMatch = CheckMessage(allow, receiveRS.notAtConsoleRules, nmh, nmh.GetSenderIDList(), false);
         }
     }
 #endif
@@ -554,7 +665,7 @@ bool _PolicyDB::OKToReceive(const NormalizedMsgHdr& nmh,
         it = receiveRS.userRules.find(uid);
         if (it != receiveRS.userRules.end()) {
             ALLJOYN_POLICY_DEBUG(Log(LOG_DEBUG, "    checking user=%u rules\n", uid));
-            ruleMatch = CheckMessage(allow, it->second, nmh, nmh.senderIDList, false);
+            ruleMatch = CheckMessage(allow, it->second, nmh, nmh.GetSenderIDList(), false);
         }
     }
 
@@ -562,13 +673,13 @@ bool _PolicyDB::OKToReceive(const NormalizedMsgHdr& nmh,
         it = receiveRS.groupRules.find(gid);
         if (it != receiveRS.groupRules.end()) {
             ALLJOYN_POLICY_DEBUG(Log(LOG_DEBUG, "    checking group=%u rules\n", gid));
-            ruleMatch = CheckMessage(allow, it->second, nmh, nmh.senderIDList, false);
+            ruleMatch = CheckMessage(allow, it->second, nmh, nmh.GetSenderIDList(), false);
         }
     }
 
     if (!ruleMatch) {
         ALLJOYN_POLICY_DEBUG(Log(LOG_DEBUG, "    checking default rules\n"));
-        ruleMatch = CheckMessage(allow, receiveRS.defaultRules, nmh, nmh.senderIDList, false);
+        ruleMatch = CheckMessage(allow, receiveRS.defaultRules, nmh, nmh.GetSenderIDList(), false);
     }
 
     return allow;
@@ -578,6 +689,23 @@ bool _PolicyDB::OKToReceive(const NormalizedMsgHdr& nmh,
 bool _PolicyDB::OKToSend(const NormalizedMsgHdr& nmh,
                          uint32_t uid,
                          uint32_t gid) const
+{
+    DecisionKey key(GetDecisionKey(nmh, true, uid, gid));
+    bool allow;
+
+    if (LookupDecision(key, nmh.generation, allow)) {
+        ALLJOYN_POLICY_DEBUG(Log(LOG_DEBUG, "    using cached send decision\n"));
+    } else {
+        allow = EvaluateSend(nmh, uid, gid);
+        StoreDecision(key, allow, nmh.generation);
+    }
+    return allow;
+}
+
+
+bool _PolicyDB::EvaluateSend(const NormalizedMsgHdr& nmh,
+                             uint32_t uid,
+                             uint32_t gid) const
 {
     bool allow(((nmh.type != ajn::MESSAGE_INVALID) &&
                 (nmh.type != ajn::MESSAGE_METHOD_CALL)));
@@ -586,19 +714,19 @@ bool _PolicyDB::OKToSend(const NormalizedMsgHdr& nmh,
 
     if (!sendRS.mandatoryRules.empty()) {
         ALLJOYN_POLICY_DEBUG(Log(LOG_DEBUG, "    checking mandatory rules\n"));
-        ruleMatch = CheckMessage(allow, sendRS.mandatoryRules, nmh, nmh.destIDList, false);
+        ruleMatch = CheckMessage(allow, sendRS.mandatoryRules, nmh, nmh.GetDestIDList(), false);
     }
 
 #if defined(CONSOLE_CHECK_SUPPORT)
     if (atConsole) {
         if (!ruleMatch && !sendRS.atConsoleRules.empty()) {
             ALLJOYN_POLICY_DEBUG(Log(LOG_DEBUG, "    checking atconsole=true rules\n"));
-            ruleMatch = CheckMessage(allow, sendRS.atConsoleRules, nmh, nmh.destIDList, false);
+            ruleMatch = CheckMessage(allow, sendRS.atConsoleRules, nmh, nmh.GetDestIDList(), false);
         }
     } else {
         if (!ruleMatch && !sendRS.notAtConsoleRules.empty()) {
             ALLJOYN_POLICY_DEBUG(Log(LOG_DEBUG, "    checking atconsole=false rules\n"));
-            ruleMatch = CheckMessage(allow, sendRS.notAtConsoleRules, nmh, nmh.destIDList, false);
+            ruleMatch = CheckMessage(allow, sendRS.notAtConsoleRules, nmh, nmh.GetDestIDList(), false);
         }
     }
 #endif
@@ -607,7 +735,7 @@ bool _PolicyDB::OKToSend(const NormalizedMsgHdr& nmh,
         it = sendRS.userRules.find(uid);
         if (it != sendRS.userRules.end()) {
             ALLJOYN_POLICY_DEBUG(Log(LOG_DEBUG, "    checking user=%u rules\n", uid));
-            ruleMatch = CheckMessage(allow, it->second, nmh, nmh.destIDList, false);
+            ruleMatch = CheckMessage(allow, it->second, nmh, nmh.GetDestIDList(), false);
         }
     }
 
@@ -615,13 +743,13 @@ bool _PolicyDB::OKToSend(const NormalizedMsgHdr& nmh,
         it = sendRS.groupRules.find(gid);
         if (it != sendRS.groupRules.end()) {
             ALLJOYN_POLICY_DEBUG(Log(LOG_DEBUG, "    checking group=%u rules\n", gid));
-            ruleMatch = CheckMessage(allow, it->second, nmh, nmh.destIDList, false);
+            ruleMatch = CheckMessage(allow, it->second, nmh, nmh.GetDestIDList(), false);
         }
     }
 
     if (!ruleMatch) {
         ALLJOYN_POLICY_DEBUG(Log(LOG_DEBUG, "    checking default rules\n"));
-        ruleMatch = CheckMessage(allow, sendRS.defaultRules, nmh, nmh.destIDList, false);
+        ruleMatch = CheckMessage(allow, sendRS.defaultRules, nmh, nmh.GetDestIDList(), false);
     }
 
     return allow;
@@ -640,31 +768,31 @@ bool _PolicyDB::OKToEavesdrop(const NormalizedMsgHdr& nmh,
 
     if (!sendRS.mandatoryRules.empty()) {
         ALLJOYN_POLICY_DEBUG(Log(LOG_DEBUG, "    checking mandatory eavesdrop send rules\n"));
-        ruleMatch = CheckMessage(allow, sendRS.mandatoryRules, nmh, nmh.destIDList, true);
+        ruleMatch = CheckMessage(allow, sendRS.mandatoryRules, nmh, nmh.GetDestIDList(), true);
     }
     if (!receiveRS.mandatoryRules.empty()) {
         ALLJOYN_POLICY_DEBUG(Log(LOG_DEBUG, "    checking mandatory eavesdrop receive rules\n"));
-        ruleMatch = CheckMessage(allow, receiveRS.mandatoryRules, nmh, nmh.senderIDList, true);
+        ruleMatch = CheckMessage(allow, receiveRS.mandatoryRules, nmh, nmh.GetSenderIDList(), true);
     }
 
 #if defined(CONSOLE_CHECK_SUPPORT)
     if (atConsole) {
         if (!ruleMatch && !sendRS.atConsoleRules.empty()) {
             ALLJOYN_POLICY_DEBUG(Log(LOG_DEBUG, "    checking atconsole=true eavesdrop send rules\n"));
-            ruleMatch = CheckMessage(allow, sendRS.atConsoleRules, nmh, nmh.destIDList, true);
+            ruleMatch = CheckMessage(allow, sendRS.atConsoleRules, nmh, nmh.GetDestIDList(), true);
         }
         if (!ruleMatch && !receiveRS.atConsoleRules.empty()) {
             ALLJOYN_POLICY_DEBUG(Log(LOG_DEBUG, "    checking atconsole=true eavesdrop receive rules\n"));
-            ruleMatch = CheckMessage(allow, receiveRS.atConsoleRules, nmh, nmh.senderIDList, true);
+            ruleMatch = CheckMessage(allow, receiveRS.atConsoleRules, nmh, nmh.GetSenderIDList(), true);
         }
     } else {
         if (!ruleMatch && !sendRS.notAtConsoleRules.empty()) {
             ALLJOYN_POLICY_DEBUG(Log(LOG_DEBUG, "    checking atconsole=false eavesdrop send rules\n"));
-            ruleMatch = CheckMessage(allow, sendRS.notAtConsoleRules, nmh, nmh.destIDList, true);
+            ruleMatch = CheckMessage(allow, sendRS.notAtConsoleRules, nmh, nmh.GetDestIDList(), true);
         }
         if (!ruleMatch && !receiveRS.notAtConsoleRules.empty()) {
             ALLJOYN_POLICY_DEBUG(Log(LOG_DEBUG, "    checking atconsole=false eavesdrop receive rules\n"));
-            ruleMatch = CheckMessage(allow, receiveRS.notAtConsoleRules, nmh, nmh.senderIDList, true);
+            ruleMatch = CheckMessage(allow, receiveRS.notAtConsoleRules, nmh, nmh.GetSenderIDList(), true);
         }
     }
 #endif
@@ -673,14 +801,14 @@ bool _PolicyDB::OKToEavesdrop(const NormalizedMsgHdr& nmh,
         it = sendRS.userRules.find(suid);
         if (it != sendRS.userRules.end()) {
             ALLJOYN_POLICY_DEBUG(Log(LOG_DEBUG, "    checking user=%u eavesdrop send rules\n", suid));
-            ruleMatch = CheckMessage(allow, it->second, nmh, nmh.destIDList, true);
+            ruleMatch = CheckMessage(allow, it->second, nmh, nmh.GetDestIDList(), true);
         }
     }
     if (!ruleMatch && !receiveRS.userRules.empty()) {
         it = receiveRS.userRules.find(duid);
         if (it != receiveRS.userRules.end()) {
             ALLJOYN_POLICY_DEBUG(Log(LOG_DEBUG, "    checking user=%u eavesdrop receive rules\n", duid));
-            ruleMatch = CheckMessage(allow, it->second, nmh, nmh.senderIDList, true);
+            ruleMatch = CheckMessage(allow, it->second, nmh, nmh.GetSenderIDList(), true);
         }
     }
 
@@ -688,24 +816,24 @@ bool _PolicyDB::OKToEavesdrop(const NormalizedMsgHdr& nmh,
         it = sendRS.groupRules.find(sgid);
         if (it != sendRS.groupRules.end()) {
             ALLJOYN_POLICY_DEBUG(Log(LOG_DEBUG, "    checking group=%u eavesdrop send rules\n", sgid));
-            ruleMatch = CheckMessage(allow, it->second, nmh, nmh.destIDList, true);
+            ruleMatch = CheckMessage(allow, it->second, nmh, nmh.GetDestIDList(), true);
         }
     }
     if (!ruleMatch && !receiveRS.groupRules.empty()) {
         it = receiveRS.groupRules.find(dgid);
         if (it != receiveRS.groupRules.end()) {
             ALLJOYN_POLICY_DEBUG(Log(LOG_DEBUG, "    checking group=%u eavesdrop receive rules\n", dgid));
-            ruleMatch = CheckMessage(allow, it->second, nmh, nmh.senderIDList, true);
+            ruleMatch = CheckMessage(allow, it->second, nmh, nmh.GetSenderIDList(), true);
         }
     }
 
     if (!ruleMatch) {
         ALLJOYN_POLICY_DEBUG(Log(LOG_DEBUG, "    checking default eavesdrop send rules\n"));
-        ruleMatch = CheckMessage(allow, sendRS.defaultRules, nmh, nmh.destIDList, true);
+        ruleMatch = CheckMessage(allow, sendRS.defaultRules, nmh, nmh.GetDestIDList(), true);
     }
     if (!ruleMatch) {
         ALLJOYN_POLICY_DEBUG(Log(LOG_DEBUG, "    checking default eavesdrop receive rules\n"));
-        ruleMatch = CheckMessage(allow, receiveRS.defaultRules, nmh, nmh.senderIDList, true);
+        ruleMatch = CheckMessage(allow, receiveRS.defaultRules, nmh, nmh.GetSenderIDList(), true);
     }
 
     return allow;
@@ -22,7 +22,11 @@
 #define _POLICYDB_H
 
 #include <qcc/platform.h>
+
+#include <vector>
+
 #include <qcc/ManagedObj.h>
+#include <qcc/Mutex.h>
 #include <qcc/String.h>
 #include <qcc/StringMapKey.h>
 
@@ -218,6 +222,9 @@ class _PolicyDB {
     static const uint32_t ID_NOT_FOUND = 0xffffffff;    /**< constant for string not found */
     static const uint32_t NIL_MATCH = 0xfffffffe;       /**< unmatchable string id */
     static const uint32_t WILDCARD = 0x0;               /**< match everything string id */
+    static const uint32_t NO_BUS_NAMES = 0xfffffffd;    /**< bus name key for unique names that own no names used in rules */
+    static const uint32_t FIRST_UNIQUE_NAME_KEY = 0x80000000; /**< first bus name key assigned to unique names */
+    static const size_t DECISION_CACHE_SIZE = 1024;     /**< number of entries in the decision cache (must be a power of 2) */
 
 
     typedef std::hash_set<uint32_t> BusNameIDSet;
@@ -406,7 +413,11 @@ class _PolicyDB {
         }
     };
 
-    typedef std::list<PolicyRule> PolicyRuleList;   /**< Policy rule list typedef */
+    /**
+     * Policy rules are kept in arrays rather than linked lists so rule checks walk contiguous
+     * memory.
+     */
+    typedef std::vector<PolicyRule> PolicyRuleList;   /**< Policy rule list typedef */
 
     /**
      * Collection of policy rules for each category.
@@ -423,8 +434,65 @@ class _PolicyDB {
     /** typedef for mapping a string to a numerical value for normalization */
     typedef std::hash_map<qcc::StringMapKey, uint32_t> StringIDMap;
 
+    /**
+     * Well known bus names owned by a unique bus name.
+     */
+    struct UniqueNameInfo {
+        uint32_t key;               /**< bus name key used for this unique name in the decision cache */
+        BusNameIDSet busNames;      /**< normalized well known bus names that are used in rules */
+
+        UniqueNameInfo() : key(NO_BUS_NAMES) { }
+    };
+
     /** typedef for mapping a unique bus name to a set of normalized well known bus names */
-    typedef std::hash_map<qcc::StringMapKey, BusNameIDSet> UniqueNameIDMap;
+    typedef std::hash_map<qcc::StringMapKey, UniqueNameInfo> UniqueNameIDMap;
+
+    /**
+     * Everything a send or receive decision depends on. The bus name key stands in for the set of
+     * bus names the rules are matched against: it is the normalized name for well known names and
+     * a per unique name key (or NO_BUS_NAMES) for unique names.
+     */
+    struct DecisionKey {
+        uint32_t ifcID;             /**< normalized interface name */
+        uint32_t memberID;          /**< normalized member name */
+        uint32_t errorID;           /**< normalized error name */
+        uint32_t pathID;            /**< normalized object path */
+        uint32_t busNameKey;        /**< destination (send) or sender (receive) bus name key */
+        uint32_t uid;               /**< numeric user id */
+        uint32_t gid;               /**< numeric group id */
+        ajn::AllJoynMessageType type; /**< message type */
+        bool send;                  /**< true for send decisions, false for receive decisions */
+
+        DecisionKey() :
+            ifcID(ID_NOT_FOUND), memberID(ID_NOT_FOUND), errorID(ID_NOT_FOUND), pathID(ID_NOT_FOUND),
+            busNameKey(ID_NOT_FOUND), uid(-1), gid(-1), type(ajn::MESSAGE_INVALID), send(false)
+        { }
+
+        bool operator==(const DecisionKey& other) const
+        {
+            return ((ifcID == other.ifcID) && (memberID == other.memberID) && (errorID == other.errorID) &&
+                    (pathID == other.pathID) && (busNameKey == other.busNameKey) && (uid == other.uid) &&
+                    (gid == other.gid) && (type == other.type) && (send == other.send));
+        }
+
+        /**
+         * Get the decision cache slot for this key.
+         *
+         * @return  Index into the decision cache.
+         */
+        size_t Slot() const;
+    };
+
+    /**
+     * Decision cache entry. Entries are only valid for the cache generation they were stored in.
+     */
+    struct Decision {
+        DecisionKey key;            /**< what was decided */
+        uint32_t generation;        /**< cache generation the decision was made in (0 = never) */
+        bool allow;                 /**< the decision */
+
+        Decision() : generation(0), allow(false) { }
+    };
 
     /**
      * Adds rules to specific rule sets.  Called by public AddRule to add
@@ -517,6 +585,75 @@ class _PolicyDB {
                       const BusNameIDSet& bnIDSet,
                       bool eavesdrop) const;
 
+    /**
+     * Evaluate the receive rules for a message (i.e. OKToReceive() without the decision cache).
+     *
+     * @param nmh   Normalized message header
+     * @param uid   Numeric user id
+     * @param gid   Numeric group id
+     *
+     * @return true = receive allowed, false = receive denied.
+     */
+    bool EvaluateReceive(const ajn::NormalizedMsgHdr& nmh, uint32_t uid, uint32_t gid) const;
+
+    /**
+     * Evaluate the send rules for a message (i.e. OKToSend() without the decision cache).
+     *
+     * @param nmh   Normalized message header
+     * @param uid   Numeric user id
+     * @param gid   Numeric group id
+     *
+     * @return true = send allowed, false = send denied.
+     */
+    bool EvaluateSend(const ajn::NormalizedMsgHdr& nmh, uint32_t uid, uint32_t gid) const;
+
+    /**
+     * Get the decision cache key for sending or receiving a message.
+     *
+     * @param nmh   Normalized message header
+     * @param send  true for a send decision, false for a receive decision
+     * @param uid   Numeric user id
+     * @param gid   Numeric group id
+     *
+     * @return  The decision cache key.
+     */
+    static DecisionKey GetDecisionKey(const ajn::NormalizedMsgHdr& nmh, bool send, uint32_t uid, uint32_t gid);
+
+    /**
+     * Get the current decision cache generation. Must be called with bnLock held so the
+     * generation matches the bus name keys read under the same lock.
+     *
+     * @return  The cache generation.
+     */
+    uint32_t GetGeneration() const;
+
+    /**
+     * Look up a decision in the decision cache.
+     *
+     * @param key           What is being decided
+     * @param generation    Cache generation the message header was normalized in
+     * @param allow         [OUT] the cached decision
+     *
+     * @return  true if the decision was cached, false otherwise
+     */
+    bool LookupDecision(const DecisionKey& key, uint32_t generation, bool& allow) const;
+
+    /**
+     * Store a decision in the decision cache. The decision is discarded if the cache has been
+     * invalidated since the message header was normalized.
+     *
+     * @param key           What was decided
+     * @param allow         The decision
+     * @param generation    Cache generation the message header was normalized in
+     */
+    void StoreDecision(const DecisionKey& key, bool allow, uint32_t generation) const;
+
+    /**
+     * Invalidate all cached decisions. Called whenever rules are added or the well known names
+     * owned by a unique name change.
+     */
+    void InvalidateDecisions();
+
     bool eavesdrop;     /**< indicated if there is a rule specifying eavesdropping */
 
     PolicyRuleListSet ownRS;        /**< bus name ownership policy rule sets */
@@ -528,6 +665,11 @@ class _PolicyDB {
     UniqueNameIDMap uniqueNameMap;  /**< mapping of unique bus names to normalized well known bus names */
     StringIDMap busNameMap;         /**< mapping of well known bus names to normalization IDs */
     mutable qcc::Mutex bnLock;      /**< mutex protecting access to uniqueNameMap and busNameMap when normalizing unique names to list of normalized well known bus names. */
+    uint32_t nextUniqueNameKey;     /**< next bus name key to assign to a unique name */
+
+    mutable Decision decisions[DECISION_CACHE_SIZE]; /**< direct mapped cache of send and receive decisions */
+    uint32_t generation;            /**< current decision cache generation */
+    mutable qcc::Mutex cacheLock;   /**< mutex protecting decisions and generation */
 
     friend class ajn::NormalizedMsgHdr;
 };
@@ -536,7 +678,9 @@ class _PolicyDB {
 
 /**
  * This class converts and stores a message's header information in a form
- * that allows for very fast lookup in hash_map<>'s.
+ * that allows for very fast lookup in hash_map<>'s.  The sets of well known
+ * bus names behind the sender and destination are only built if a policy
+ * decision is not already cached.
  */
 class NormalizedMsgHdr {
   public:
@@ -548,21 +692,43 @@ class NormalizedMsgHdr {
      * @param policy    Pointer to the PolicyDB
      */
     NormalizedMsgHdr(const ajn::Message& msg, const PolicyDB& policy) :
+        msg(msg),
+        policy(policy),
         ifcID(policy->LookupStringID(msg->GetInterface())),
         memberID(policy->LookupStringID(msg->GetMemberName())),
         errorID(policy->LookupStringID(msg->GetErrorName())),
         pathID(policy->LookupStringID(msg->GetObjectPath())),
-        type(msg->GetType())
+        type(msg->GetType()),
+        busNamesSet(false)
     {
         policy->bnLock.Lock();
-        InitBusNameID(policy, msg->GetSender(), senderIDList);
-        InitBusNameID(policy, msg->GetDestination(), destIDList);
+        senderKey = GetBusNameKey(policy, msg->GetSender());
+        destKey = GetBusNameKey(policy, msg->GetDestination());
+        generation = policy->GetGeneration();
         policy->bnLock.Unlock();
     }
 
   private:
     friend class _PolicyDB;  /**< Give PolicyDB access to the internals */
 
+    /**
+     * Helper function to get the decision cache key for a bus name.
+     *
+     * @param policy    Pointer to the PolicyDB
+     * @param bnStr     String with either the well known or unique bus name
+     *
+     * @return  The bus name key.
+     */
+    static inline uint32_t GetBusNameKey(const PolicyDB& policy, const char* bnStr)
+    {
+        if (bnStr && (bnStr[0] == ':')) {
+            _PolicyDB::UniqueNameIDMap::const_iterator unit(policy->uniqueNameMap.find(bnStr));
+            return (unit == policy->uniqueNameMap.end()) ? _PolicyDB::NO_BUS_NAMES : unit->second.key;
+        } else {
+            return policy->LookupStringID(bnStr);
+        }
+    }
+
     /**
      * Helper function generate a set of normalized well known bus names
      * for given bus name string.  If the given bus name is already a well
@@ -581,20 +747,62 @@ class NormalizedMsgHdr {
         if (bnStr && (bnStr[0] == ':')) {
             _PolicyDB::UniqueNameIDMap::const_iterator unit(policy->uniqueNameMap.find(bnStr));
             if (unit != policy->uniqueNameMap.end()) {
-                bnIDSet.insert(unit->second.begin(), unit->second.end());
+                bnIDSet.insert(unit->second.busNames.begin(), unit->second.busNames.end());
             }
         } else {
             bnIDSet.insert(policy->LookupStringID(bnStr));
         }
     }
 
+    /**
+     * Build the sets of normalized well known bus names the first time they are needed.
+     */
+    void InitBusNames() const
+    {
+        if (!busNamesSet) {
+            policy->bnLock.Lock();
+            InitBusNameID(policy, msg->GetSender(), senderIDList);
+            InitBusNameID(policy, msg->GetDestination(), destIDList);
+            policy->bnLock.Unlock();
+            busNamesSet = true;
+        }
+    }
+
+    /**
+     * Get the set of normalized well known bus name destinations.
+     *
+     * @return  The destination bus name set.
+     */
+    const _PolicyDB::BusNameIDSet& GetDestIDList() const
+    {
+        InitBusNames();
+        return destIDList;
+    }
+
+    /**
+     * Get the set of normalized well known bus name senders.
+     *
+     * @return  The sender bus name set.
+     */
+    const _PolicyDB::BusNameIDSet& GetSenderIDList() const
+    {
+        InitBusNames();
+        return senderIDList;
+    }
+
+    ajn::Message msg;           /**< the message (needed to build the bus name sets) */
+    PolicyDB policy;            /**< the policy database the header was normalized against */
     uint32_t ifcID;             /**< normalized interface name */
     uint32_t memberID;          /**< normalized member name */
     uint32_t errorID;           /**< normalized error name */
     uint32_t pathID;            /**< normalized object path */
     ajn::AllJoynMessageType type; /**< message type */
-    _PolicyDB::BusNameIDSet destIDList;    /**< set of normalized well known bus name destinations */
-    _PolicyDB::BusNameIDSet senderIDList;  /**< set of normalized well known bus name senders */
+    uint32_t destKey;           /**< destination bus name key for the decision cache */
+    uint32_t senderKey;         /**< sender bus name key for the decision cache */
+    uint32_t generation;        /**< decision cache generation the bus name keys were read in */
+    mutable bool busNamesSet;   /**< true once destIDList and senderIDList have been built */
+    mutable _PolicyDB::BusNameIDSet destIDList;    /**< set of normalized well known bus name destinations */
+    mutable _PolicyDB::BusNameIDSet senderIDList;  /**< set of normalized well known bus name senders */
 };
 
 
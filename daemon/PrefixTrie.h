@@ -0,0 +1,301 @@
+/**
+ * @file
+ * PrefixTrie maps name prefixes to values and finds all prefixes of a name.
+ */
+
+/******************************************************************************
+ * Copyright 2011, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+#ifndef _ALLJOYN_PREFIXTRIE_H
+#define _ALLJOYN_PREFIXTRIE_H
+
+#include <qcc/platform.h>
+
+#include <algorithm>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include <qcc/String.h>
+
+namespace ajn {
+
+/**
+ * PrefixTrie is a multimap from name prefixes to values, stored as a compressed
+ * (radix) trie. Finding every prefix of a name, and the values stored under
+ * them, walks the name once no matter how many prefixes are stored.
+ *
+ * PrefixTrie is not thread-safe.
+ */
+template <typename T>
+class PrefixTrie {
+  public:
+
+    /** A prefix and a value stored under it */
+    typedef std::pair<qcc::String, T> Entry;
+
+    PrefixTrie() : root(new Node()), size(0) { }
+
+    ~PrefixTrie() { delete root; }
+
+    /**
+     * Store a value under a prefix. A prefix may have several values, and a
+     * value may be stored more than once.
+     *
+     * @param prefix  The prefix.
+     * @param value   The value.
+     */
+    void Insert(const qcc::String& prefix, const T& value)
+    {
+        Node* node = root;
+        size_t pos = 0;
+        while (pos < prefix.size()) {
+            typename std::map<char, Node*>::iterator it = node->children.find(prefix[pos]);
+            if (it == node->children.end()) {
+                Node* leaf = new Node();
+                leaf->label = prefix.substr(pos);
+                node->children[prefix[pos]] = leaf;
+                node = leaf;
+                break;
+            }
+
+            Node* child = it->second;
+            size_t common = 0;
+            while ((common < child->label.size()) && (pos + common < prefix.size()) && (child->label[common] == prefix[pos + common])) {
+                ++common;
+            }
+
+            /* Split the edge where the prefix leaves it */
+            if (common < child->label.size()) {
+                Node* split = new Node();
+                split->label = child->label.substr(0, common);
+                child->label = child->label.substr(common);
+                split->children[child->label[0]] = child;
+                it->second = split;
+                child = split;
+            }
+            pos += common;
+            node = child;
+        }
+        node->values.push_back(value);
+        ++size;
+    }
+
+    /**
+     * Remove one copy of a value stored under a prefix.
+     *
+     * @param prefix  The prefix.
+     * @param value   The value.
+     *
+     * @return  true if the value was found and removed.
+     */
+    bool Erase(const qcc::String& prefix, const T& value)
+    {
+        bool erased = Erase(root, prefix, 0, value);
+        if (erased) {
+            --size;
+        }
+        return erased;
+    }
+
+    /**
+     * Get the values stored under exactly this prefix.
+     *
+     * @param prefix  The prefix.
+     * @param values  [OUT] Appended with the values stored under prefix.
+     */
+    void Get(const qcc::String& prefix, std::vector<T>& values) const
+    {
+        const Node* node = Find(prefix);
+        if (node) {
+            values.insert(values.end(), node->values.begin(), node->values.end());
+        }
+    }
+
+    /**
+     * Get the number of values stored under exactly this prefix.
+     *
+     * @param prefix  The prefix.
+     *
+     * @return  The number of values.
+     */
+    size_t Count(const qcc::String& prefix) const
+    {
+        const Node* node = Find(prefix);
+        return node ? node->values.size() : 0;
+    }
+
+    /**
+     * Test whether a value is stored under exactly this prefix.
+     *
+     * @param prefix  The prefix.
+     * @param value   The value.
+     *
+     * @return  true if value is stored under prefix.
+     */
+    bool Contains(const qcc::String& prefix, const T& value) const
+    {
+        const Node* node = Find(prefix);
+        return node && (std::find(node->values.begin(), node->values.end(), value) != node->values.end());
+    }
+
+    /**
+     * Find the values stored under every non-empty prefix of a name,
+     * including the name itself. Matches are returned shortest prefix first.
+     *
+     * @param name     The name.
+     * @param matches  [OUT] Appended with the prefixes of name and their values.
+     */
+    void Match(const qcc::String& name, std::vector<Entry>& matches) const
+    {
+        size_t pos = 0;
+        const Node* node = Next(root, name, pos);
+        while (node) {
+            if (!node->values.empty()) {
+                qcc::String prefix = name.substr(0, pos);
+                for (size_t i = 0; i < node->values.size(); ++i) {
+                    matches.push_back(Entry(prefix, node->values[i]));
+                }
+            }
+            node = Next(node, name, pos);
+        }
+    }
+
+    /**
+     * Get every prefix and value in the trie, in prefix order.
+     *
+     * @param entries  [OUT] Appended with all entries.
+     */
+    void GetAll(std::vector<Entry>& entries) const
+    {
+        GetAll(root, qcc::String(), entries);
+    }
+
+    /**
+     * Get the number of values in the trie.
+     *
+     * @return  The number of values.
+     */
+    size_t Size() const { return size; }
+
+    /**
+     * Test whether the trie is empty.
+     *
+     * @return  true if no values are stored.
+     */
+    bool Empty() const { return size == 0; }
+
+  private:
+
+    /**
+     * A node is reached from its parent over an edge labeled with one or more
+     * characters. The prefix of a node is the concatenation of the labels
+     * from the root.
+     */
+    struct Node {
+        qcc::String label;                  /**< Label of the edge from the parent */
+        std::vector<T> values;              /**< Values stored under the prefix of this node */
+        std::map<char, Node*> children;     /**< Children by the first character of their label */
+
+        ~Node()
+        {
+            for (typename std::map<char, Node*>::iterator it = children.begin(); it != children.end(); ++it) {
+                delete it->second;
+            }
+        }
+    };
+
+    /* Not copyable */
+    PrefixTrie(const PrefixTrie& other);
+    PrefixTrie& operator=(const PrefixTrie& other);
+
+    /* Follow the edge from node that name continues on at pos, or return NULL */
+    static const Node* Next(const Node* node, const qcc::String& name, size_t& pos)
+    {
+        if (pos == name.size()) {
+            return NULL;
+        }
+        typename std::map<char, Node*>::const_iterator it = node->children.find(name[pos]);
+        if ((it == node->children.end()) || (name.compare(pos, it->second->label.size(), it->second->label) != 0)) {
+            return NULL;
+        }
+        pos += it->second->label.size();
+        return it->second;
+    }
+
+    /* Find the node of exactly this prefix */
+    const Node* Find(const qcc::String& prefix) const
+    {
+        const Node* node = root;
+        size_t pos = 0;
+        while (node && (pos < prefix.size())) {
+            node = Next(node, prefix, pos);
+        }
+        return node;
+    }
+
+    bool Erase(Node* node, const qcc::String& prefix, size_t pos, const T& value)
+    {
+        if (pos == prefix.size()) {
+            typename std::vector<T>::iterator vit = std::find(node->values.begin(), node->values.end(), value);
+            if (vit == node->values.end()) {
+                return false;
+            }
+            node->values.erase(vit);
+            return true;
+        }
+
+        typename std::map<char, Node*>::iterator it = node->children.find(prefix[pos]);
+        if ((it == node->children.end()) || (prefix.compare(pos, it->second->label.size(), it->second->label) != 0)) {
+            return false;
+        }
+        Node* child = it->second;
+        if (!Erase(child, prefix, pos + child->label.size(), value)) {
+            return false;
+        }
+
+        /* Keep the trie compressed: drop empty leaves and merge pass-through nodes into their child */
+        if (child->values.empty()) {
+            if (child->children.empty()) {
+                node->children.erase(it);
+                delete child;
+            } else if (child->children.size() == 1) {
+                Node* grandchild = child->children.begin()->second;
+                grandchild->label = child->label + grandchild->label;
+                child->children.clear();
+                it->second = grandchild;
+                delete child;
+            }
+        }
+        return true;
+    }
+
+    static void GetAll(const Node* node, const qcc::String& prefix, std::vector<Entry>& entries)
+    {
+        for (size_t i = 0; i < node->values.size(); ++i) {
+            entries.push_back(Entry(prefix, node->values[i]));
+        }
+        for (typename std::map<char, Node*>::const_iterator it = node->children.begin(); it != node->children.end(); ++it) {
+            GetAll(it->second, prefix + it->second->label, entries);
+        }
+    }
+
+    Node* root;                             /**< Root node, the empty prefix */
+    size_t size;                            /**< Number of values in the trie */
+};
+
+}
+
+#endif
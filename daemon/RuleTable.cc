@@ -21,12 +21,15 @@
  ******************************************************************************/
 #include <qcc/platform.h>
 
+#include <algorithm>
 #include <cstring>
+#include <vector>
 
 #include "RuleTable.h"
 
 #include <qcc/Debug.h>
 #include <qcc/String.h>
+#include <qcc/StringMapKey.h>
 #include <alljoyn/Message.h>
 
 #define QCC_MODULE "ALLJOYN"
@@ -104,29 +107,224 @@ Rule::Rule(const char* ruleSpec, QStatus* outStatus) : type(MESSAGE_INVALID)
     }
 }
 
-bool Rule::IsMatch(const Message& msg)
+bool Rule::IsMatch(AllJoynMessageType msgType,
+                   const char* msgSender,
+                   const char* msgIface,
+                   const char* msgMember,
+                   const char* msgPath,
+                   const char* msgDest)
 {
     /* The fields of a rule (if specified) are logically anded together */
-    if ((type != MESSAGE_INVALID) && (type != msg->GetType())) {
+    if ((type != MESSAGE_INVALID) && (type != msgType)) {
         return false;
     }
-    if (!sender.empty() && (0 != strcmp(sender.c_str(), msg->GetSender()))) {
+    if (!sender.empty() && (0 != strcmp(sender.c_str(), msgSender))) {
         return false;
     }
-    if (!iface.empty() && (0 != strcmp(iface.c_str(), msg->GetInterface()))) {
+    if (!iface.empty() && (0 != strcmp(iface.c_str(), msgIface))) {
         return false;
     }
-    if (!member.empty() && (0 != strcmp(member.c_str(), msg->GetMemberName()))) {
+    if (!member.empty() && (0 != strcmp(member.c_str(), msgMember))) {
         return false;
     }
-    if (!path.empty() && (0 != strcmp(path.c_str(), msg->GetObjectPath()))) {
+    if (!path.empty() && (0 != strcmp(path.c_str(), msgPath))) {
         return false;
     }
-    if (!destination.empty() && (0 != strcmp(destination.c_str(), msg->GetDestination()))) {
+    if (!destination.empty() && (0 != strcmp(destination.c_str(), msgDest))) {
         return false;
     }
     // @@ TODO Arg matches are not handled
     return true;
 }
 
+QStatus RuleTable::AddRule(BusEndpoint& endpoint, const Rule& rule)
+{
+    Lock();
+    RuleIterator it = rules.insert(std::pair<BusEndpoint*, Rule>(&endpoint, rule));
+    AddToIndex(endpoint, it->second);
+    Unlock();
+    return ER_OK;
+}
+
+QStatus RuleTable::RemoveRule(BusEndpoint& endpoint, Rule& rule)
+{
+    Lock();
+    std::pair<RuleIterator, RuleIterator> range = rules.equal_range(&endpoint);
+    while (range.first != range.second) {
+        if (range.first->second == rule) {
+            RemoveFromIndex(range.first->second);
+            rules.erase(range.first);
+            break;
+        }
+        range.first++;
+    }
+    Unlock();
+    return ER_OK;
+}
+
+QStatus RuleTable::RemoveAllRules(BusEndpoint& endpoint)
+{
+    Lock();
+    std::pair<RuleIterator, RuleIterator> range = rules.equal_range(&endpoint);
+    for (RuleIterator it = range.first; it != range.second; ++it) {
+        RemoveFromIndex(it->second);
+    }
+    if (range.first != rules.end()) {
+        rules.erase(range.first, range.second);
+    }
+    Unlock();
+    return ER_OK;
+}
+
+void RuleTable::FindMatchingEndpoints(AllJoynMessageType type,
+                                      const char* sender,
+                                      const char* iface,
+                                      const char* member,
+                                      const char* path,
+                                      const char* destination,
+                                      vector<BusEndpoint*>& endpoints)
+{
+    /* Map the message fields onto interned ids. Strings not used by any rule never match a rule field. */
+    uint32_t senderId = LookupId(sender);
+    uint32_t ifaceId = LookupId(iface);
+    uint32_t memberId = LookupId(member);
+    uint32_t pathId = LookupId(path);
+    uint32_t destId = LookupId(destination);
+
+    /* Every rule lives in exactly one bucket so each candidate is examined once */
+    uint32_t keys[5];
+    size_t numKeys = 0;
+    if (memberId != NO_STRING_ID) {
+        keys[numKeys++] = IndexKey(INDEX_MEMBER, memberId);
+    }
+    if (ifaceId != NO_STRING_ID) {
+        keys[numKeys++] = IndexKey(INDEX_IFACE, ifaceId);
+    }
+    if (pathId != NO_STRING_ID) {
+        keys[numKeys++] = IndexKey(INDEX_PATH, pathId);
+    }
+    if (senderId != NO_STRING_ID) {
+        keys[numKeys++] = IndexKey(INDEX_SENDER, senderId);
+    }
+    keys[numKeys++] = IndexKey(INDEX_WILDCARD, 0);
+
+    endpoints.clear();
+    for (size_t i = 0; i < numKeys; ++i) {
+        hash_map<uint32_t, vector<IndexEntry> >::const_iterator bit = index.find(keys[i]);
+        if (bit == index.end()) {
+            continue;
+        }
+        vector<IndexEntry>::const_iterator eit = bit->second.begin();
+        while (eit != bit->second.end()) {
+            if (eit->IsMatch(type, senderId, ifaceId, memberId, pathId, destId)) {
+                endpoints.push_back(eit->endpoint);
+            }
+            ++eit;
+        }
+    }
+
+    /* An endpoint only receives a message once no matter how many of its rules match */
+    if (endpoints.size() > 1) {
+        sort(endpoints.begin(), endpoints.end());
+        endpoints.erase(unique(endpoints.begin(), endpoints.end()), endpoints.end());
+    }
+}
+
+uint32_t RuleTable::Intern(const qcc::String& str)
+{
+    if (str.empty()) {
+        return 0;
+    }
+    hash_map<StringMapKey, InternEntry>::iterator it = stringIds.find(StringMapKey(str.c_str()));
+    if (it == stringIds.end()) {
+        it = stringIds.insert(pair<StringMapKey, InternEntry>(StringMapKey(str), InternEntry(nextStringId++))).first;
+    }
+    ++it->second.refs;
+    return it->second.id;
+}
+
+void RuleTable::Release(const qcc::String& str)
+{
+    if (!str.empty()) {
+        hash_map<StringMapKey, InternEntry>::iterator it = stringIds.find(StringMapKey(str.c_str()));
+        if ((it != stringIds.end()) && (--it->second.refs == 0)) {
+            stringIds.erase(it);
+        }
+    }
+}
+
+uint32_t RuleTable::LookupId(const char* str) const
+{
+    if (!str || !*str) {
+        return NO_STRING_ID;
+    }
+    hash_map<StringMapKey, InternEntry>::const_iterator it = stringIds.find(StringMapKey(str));
+    return (it == stringIds.end()) ? NO_STRING_ID : it->second.id;
+}
+
+void RuleTable::AddToIndex(BusEndpoint& endpoint, const Rule& rule)
+{
+    IndexEntry entry;
+    entry.endpoint = &endpoint;
+    entry.rule = &rule;
+    entry.type = rule.type;
+    entry.sender = Intern(rule.sender);
+    entry.iface = Intern(rule.iface);
+    entry.member = Intern(rule.member);
+    entry.path = Intern(rule.path);
+    entry.destination = Intern(rule.destination);
+
+    /* Index by the most selective field that the rule specifies */
+    uint32_t key;
+    if (entry.member) {
+        key = IndexKey(INDEX_MEMBER, entry.member);
+    } else if (entry.iface) {
+        key = IndexKey(INDEX_IFACE, entry.iface);
+    } else if (entry.path) {
+        key = IndexKey(INDEX_PATH, entry.path);
+    } else if (entry.sender) {
+        key = IndexKey(INDEX_SENDER, entry.sender);
+    } else {
+        key = IndexKey(INDEX_WILDCARD, 0);
+    }
+    index[key].push_back(entry);
+}
+
+void RuleTable::RemoveFromIndex(const Rule& rule)
+{
+    uint32_t key;
+    if (!rule.member.empty()) {
+        key = IndexKey(INDEX_MEMBER, LookupId(rule.member.c_str()));
+    } else if (!rule.iface.empty()) {
+        key = IndexKey(INDEX_IFACE, LookupId(rule.iface.c_str()));
+    } else if (!rule.path.empty()) {
+        key = IndexKey(INDEX_PATH, LookupId(rule.path.c_str()));
+    } else if (!rule.sender.empty()) {
+        key = IndexKey(INDEX_SENDER, LookupId(rule.sender.c_str()));
+    } else {
+        key = IndexKey(INDEX_WILDCARD, 0);
+    }
+
+    hash_map<uint32_t, vector<IndexEntry> >::iterator bit = index.find(key);
+    if (bit != index.end()) {
+        vector<IndexEntry>& bucket = bit->second;
+        for (size_t i = 0; i < bucket.size(); ++i) {
+            if (bucket[i].rule == &rule) {
+                bucket[i] = bucket.back();
+                bucket.pop_back();
+                break;
+            }
+        }
+        if (bucket.empty()) {
+            index.erase(bit);
+        }
+    }
+
+    Release(rule.sender);
+    Release(rule.iface);
+    Release(rule.member);
+    Release(rule.path);
+    Release(rule.destination);
+}
+
 }
@@ -27,8 +27,10 @@
 #include <qcc/platform.h>
 
 #include <map>
+#include <vector>
 
 #include <qcc/String.h>
+#include <qcc/StringMapKey.h>
 #include <qcc/Mutex.h>
 
 #include <alljoyn/Message.h>
@@ -37,6 +39,15 @@
 
 #include <Status.h>
 
+#if defined(__GNUC__) && !defined(ANDROID)
+#include <ext/hash_map>
+namespace std {
+using namespace __gnu_cxx;
+}
+#else
+#include <hash_map>
+#endif
+
 namespace ajn {
 
 /**
@@ -88,7 +99,28 @@ struct Rule {
      * @param msg   Message to compare with rule.
      * @return  true if this rule matches the message.
      */
-    bool IsMatch(const Message& msg);
+    bool IsMatch(const Message& msg) {
+        return IsMatch(msg->GetType(), msg->GetSender(), msg->GetInterface(), msg->GetMemberName(),
+                       msg->GetObjectPath(), msg->GetDestination());
+    }
+
+    /**
+     * Return true if a set of message header fields matches rule.
+     *
+     * @param msgType      Message type.
+     * @param msgSender    Sender of the message.
+     * @param msgIface     Interface of the message.
+     * @param msgMember    Member name of the message.
+     * @param msgPath      Object path of the message.
+     * @param msgDest      Destination of the message.
+     * @return  true if this rule matches the header fields.
+     */
+    bool IsMatch(AllJoynMessageType msgType,
+                 const char* msgSender,
+                 const char* msgIface,
+                 const char* msgMember,
+                 const char* msgPath,
+                 const char* msgDest);
 };
 
 
@@ -102,6 +134,11 @@ typedef std::multimap<BusEndpoint*, Rule>::iterator RuleIterator;
 class RuleTable {
   public:
 
+    /**
+     * Constructor
+     */
+    RuleTable() : nextStringId(1) { }
+
     /**
      * Add a rule for an endpoint.
      *
@@ -109,13 +146,7 @@ class RuleTable {
      * @param rule       Rule for endpoint
      * @return ER_OK if successful;
      */
-    QStatus AddRule(BusEndpoint& endpoint, const Rule& rule)
-    {
-        Lock();
-        rules.insert(std::pair<BusEndpoint*, Rule>(&endpoint, rule));
-        Unlock();
-        return ER_OK;
-    }
+    QStatus AddRule(BusEndpoint& endpoint, const Rule& rule);
 
     /**
      * Remove a rule for an endpoint.
@@ -124,20 +155,7 @@ class RuleTable {
      * @param rule       Rule to remove.
      * @return ER_OK if successful;
      */
-    QStatus RemoveRule(BusEndpoint& endpoint, Rule& rule)
-    {
-        Lock();
-        std::pair<RuleIterator, RuleIterator> range = rules.equal_range(&endpoint);
-        while (range.first != range.second) {
-            if (range.first->second == rule) {
-                rules.erase(range.first);
-                break;
-            }
-            range.first++;
-        }
-        Unlock();
-        return ER_OK;
-    }
+    QStatus RemoveRule(BusEndpoint& endpoint, Rule& rule);
 
     /**
      * Remove all rules for a given endpoint.
@@ -145,17 +163,44 @@ class RuleTable {
      * @param endpoint    Endpoint whose rules will be removed.
      * @return ER_OK if successful;
      */
-    QStatus RemoveAllRules(BusEndpoint& endpoint)
+    QStatus RemoveAllRules(BusEndpoint& endpoint);
+
+    /**
+     * Find the endpoints that have at least one rule matching a message.
+     * Only the rules indexed under the message's member, interface, path or sender (plus
+     * the rules that specify none of these) are examined.
+     * Caller should obtain lock before calling this method.
+     *
+     * @param msg        Message to be matched.
+     * @param endpoints  [OUT] Matching endpoints, each listed once, in the same order as
+     *                   a walk from Begin() to End() would visit them.
+     */
+    void FindMatchingEndpoints(const Message& msg, std::vector<BusEndpoint*>& endpoints)
     {
-        Lock();
-        std::pair<RuleIterator, RuleIterator> range = rules.equal_range(&endpoint);
-        if (range.first != rules.end()) {
-            rules.erase(range.first, range.second);
-        }
-        Unlock();
-        return ER_OK;
+        FindMatchingEndpoints(msg->GetType(), msg->GetSender(), msg->GetInterface(), msg->GetMemberName(),
+                              msg->GetObjectPath(), msg->GetDestination(), endpoints);
     }
 
+    /**
+     * Find the endpoints that have at least one rule matching a set of message header fields.
+     * Caller should obtain lock before calling this method.
+     *
+     * @param type         Message type.
+     * @param sender       Sender of the message.
+     * @param iface        Interface of the message.
+     * @param member       Member name of the message.
+     * @param path         Object path of the message.
+     * @param destination  Destination of the message.
+     * @param endpoints    [OUT] Matching endpoints, each listed once, in endpoint order.
+     */
+    void FindMatchingEndpoints(AllJoynMessageType type,
+                               const char* sender,
+                               const char* iface,
+                               const char* member,
+                               const char* path,
+                               const char* destination,
+                               std::vector<BusEndpoint*>& endpoints);
+
     /**
      * Obtain exclusive access to rule table.
      * This method only needs to be called before using methods that return or use
@@ -207,9 +252,63 @@ class RuleTable {
     }
 
   private:
+
+    /** Header field a rule is indexed under */
+    enum IndexField {
+        INDEX_MEMBER = 0,    /**< Rule is indexed by its member */
+        INDEX_IFACE = 1,     /**< Rule is indexed by its interface */
+        INDEX_PATH = 2,      /**< Rule is indexed by its object path */
+        INDEX_SENDER = 3,    /**< Rule is indexed by its sender */
+        INDEX_WILDCARD = 4   /**< Rule specifies none of the indexed fields */
+    };
+
+    /** Interned id used for strings that are not referenced by any rule */
+    static const uint32_t NO_STRING_ID = 0xFFFFFFFF;
+
+    /** Interned form of a rule stored in the index */
+    struct IndexEntry {
+        BusEndpoint* endpoint;     /**< Endpoint that owns the rule */
+        const Rule* rule;          /**< The rule (owned by rules) */
+        AllJoynMessageType type;   /**< Message type or MESSAGE_INVALID for any */
+        uint32_t sender;           /**< Interned sender or 0 for any */
+        uint32_t iface;            /**< Interned interface or 0 for any */
+        uint32_t member;           /**< Interned member or 0 for any */
+        uint32_t path;             /**< Interned object path or 0 for any */
+        uint32_t destination;      /**< Interned destination or 0 for any */
+
+        /** Return true if the interned message fields satisfy this entry */
+        bool IsMatch(AllJoynMessageType t, uint32_t s, uint32_t i, uint32_t m, uint32_t p, uint32_t d) const {
+            return ((type == MESSAGE_INVALID) || (type == t)) &&
+                   ((sender == 0) || (sender == s)) &&
+                   ((iface == 0) || (iface == i)) &&
+                   ((member == 0) || (member == m)) &&
+                   ((path == 0) || (path == p)) &&
+                   ((destination == 0) || (destination == d));
+        }
+    };
+
+    /** Interned string id and number of rule fields referencing it */
+    struct InternEntry {
+        uint32_t id;
+        uint32_t refs;
+        InternEntry(uint32_t id) : id(id), refs(0) { }
+    };
+
+    /** Compute the index bucket key for a field/string id pair */
+    static uint32_t IndexKey(IndexField field, uint32_t id) { return (id << 3) | field; }
+
+    uint32_t Intern(const qcc::String& str);
+    void Release(const qcc::String& str);
+    uint32_t LookupId(const char* str) const;
+    void AddToIndex(BusEndpoint& endpoint, const Rule& rule);
+    void RemoveFromIndex(const Rule& rule);
+
     qcc::Mutex lock;                                /**< Lock protecting rule table */
     std::multimap<BusEndpoint*, Rule> rules;    /**< Rule table */
 
+    std::hash_map<qcc::StringMapKey, InternEntry> stringIds;       /**< Interned rule strings */
+    std::hash_map<uint32_t, std::vector<IndexEntry> > index;      /**< Rules bucketed by IndexKey */
+    uint32_t nextStringId;                                         /**< Next interned string id */
 };
 
 }
@@ -0,0 +1,319 @@
+/**
+ * @file
+ * SessionCastTable is a thread-safe store of the destinations of session multicast messages.
+ */
+
+/******************************************************************************
+ * Copyright 2011, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+#include <qcc/platform.h>
+
+#include <assert.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "SessionCastTable.h"
+
+#include <qcc/Debug.h>
+#include <qcc/String.h>
+
+#define QCC_MODULE "ALLJOYN"
+
+using namespace std;
+using namespace qcc;
+
+namespace ajn {
+
+void SessionCastTable::Add(SessionId id, const qcc::String& src, BusEndpoint* b2bEp, BusEndpoint* destEp)
+{
+    Shard& shard = GetShard(id);
+    shard.lock.Lock();
+    SessionRoutes& session = shard.sessions[id];
+    SourceName& name = shard.srcNames[StringMapKey(src)];
+    if (name.id == 0) {
+        name.id = shard.nextSrcId++;
+    }
+    SessionRoutes::iterator sit = lower_bound(session.begin(), session.end(), name.id, SourceLess);
+    if ((sit == session.end()) || (sit->srcId != name.id)) {
+        sit = session.insert(sit, SourceRoutes());
+        sit->srcId = name.id;
+        sit->src = src;
+        ++name.refs;
+    }
+
+    Route route(b2bEp, destEp);
+    vector<Route>::iterator rit = lower_bound(sit->routes.begin(), sit->routes.end(), route);
+    if ((rit == sit->routes.end()) || !(*rit == route)) {
+        sit->routes.insert(rit, route);
+    }
+
+    indexLock.Lock();
+    nameIndex[src].insert(id);
+    nameIndex[destEp->GetUniqueName()].insert(id);
+    if (b2bEp) {
+        b2bIndex[b2bEp].insert(id);
+    }
+    indexLock.Unlock();
+    shard.lock.Unlock();
+}
+
+void SessionCastTable::Remove(SessionId id, const qcc::String& src, BusEndpoint* b2bEp, BusEndpoint* destEp)
+{
+    Shard& shard = GetShard(id);
+    shard.lock.Lock();
+    std::hash_map<SessionId, SessionRoutes>::iterator it = shard.sessions.find(id);
+    if (it != shard.sessions.end()) {
+        SessionRoutes& session = it->second;
+        SessionRoutes::iterator sit = FindSourceRoutes(session, FindSource(shard, src.c_str()));
+        if (sit != session.end()) {
+            Route route(b2bEp, destEp);
+            vector<Route>::iterator rit = lower_bound(sit->routes.begin(), sit->routes.end(), route);
+            if ((rit != sit->routes.end()) && (*rit == route)) {
+                sit->routes.erase(rit);
+            }
+            if (sit->routes.empty()) {
+                EraseSource(shard, session, sit);
+            }
+        }
+        if (session.empty()) {
+            shard.sessions.erase(it);
+        }
+
+        vector<String> names;
+        names.push_back(src);
+        names.push_back(destEp->GetUniqueName());
+        vector<BusEndpoint*> b2bEps;
+        if (b2bEp) {
+            b2bEps.push_back(b2bEp);
+        }
+        PruneIndexes(id, shard, names, b2bEps);
+    }
+    shard.lock.Unlock();
+}
+
+void SessionCastTable::GetDestinations(SessionId id, const char* src, std::vector<BusEndpoint*>& dests)
+{
+    Shard& shard = GetShard(id);
+    shard.lock.Lock();
+    uint32_t srcId = FindSource(shard, src);
+    std::hash_map<SessionId, SessionRoutes>::iterator it = srcId ? shard.sessions.find(id) : shard.sessions.end();
+    if (it != shard.sessions.end()) {
+        SessionRoutes::iterator sit = FindSourceRoutes(it->second, srcId);
+        if (sit != it->second.end()) {
+            BusEndpoint* lastB2b = NULL;
+            for (vector<Route>::iterator rit = sit->routes.begin(); rit != sit->routes.end(); ++rit) {
+                if (!rit->b2bEp || (rit->b2bEp != lastB2b)) {
+                    rit->destEp->IncrementRouteRef();
+                    dests.push_back(rit->destEp);
+                    lastB2b = rit->b2bEp;
+                }
+            }
+        }
+    }
+    shard.lock.Unlock();
+}
+
+void SessionCastTable::RemoveB2bEndpoint(BusEndpoint* b2bEp)
+{
+    set<SessionId> ids;
+    indexLock.Lock();
+    map<BusEndpoint*, set<SessionId> >::iterator bit = b2bIndex.find(b2bEp);
+    if (bit != b2bIndex.end()) {
+        ids.swap(bit->second);
+        b2bIndex.erase(bit);
+    }
+    indexLock.Unlock();
+
+    /*
+     * Names that only appeared behind b2bEp are left in the name index. They are removed from it
+     * when their own endpoint goes away.
+     */
+    for (set<SessionId>::iterator idit = ids.begin(); idit != ids.end(); ++idit) {
+        Shard& shard = GetShard(*idit);
+        shard.lock.Lock();
+        std::hash_map<SessionId, SessionRoutes>::iterator it = shard.sessions.find(*idit);
+        if (it != shard.sessions.end()) {
+            SessionRoutes& session = it->second;
+            SessionRoutes::iterator sit = session.begin();
+            while (sit != session.end()) {
+                vector<Route>::iterator rit = sit->routes.begin();
+                while (rit != sit->routes.end()) {
+                    if (rit->b2bEp == b2bEp) {
+                        rit = sit->routes.erase(rit);
+                    } else {
+                        ++rit;
+                    }
+                }
+                if (sit->routes.empty()) {
+                    sit = EraseSource(shard, session, sit);
+                } else {
+                    ++sit;
+                }
+            }
+            if (session.empty()) {
+                shard.sessions.erase(it);
+            }
+        }
+        shard.lock.Unlock();
+    }
+}
+
+void SessionCastTable::RemoveRoutes(const qcc::String& src, BusEndpoint* ep, SessionId id, std::vector<RemovedRoute>& removed)
+{
+    set<SessionId> ids;
+    if (id == 0) {
+        indexLock.Lock();
+        map<String, set<SessionId> >::iterator nit = nameIndex.find(src);
+        if (nit != nameIndex.end()) {
+            ids.swap(nit->second);
+            nameIndex.erase(nit);
+        }
+        indexLock.Unlock();
+    } else {
+        ids.insert(id);
+    }
+
+    for (set<SessionId>::iterator idit = ids.begin(); idit != ids.end(); ++idit) {
+        Shard& shard = GetShard(*idit);
+        shard.lock.Lock();
+        std::hash_map<SessionId, SessionRoutes>::iterator it = shard.sessions.find(*idit);
+        if (it != shard.sessions.end()) {
+            SessionRoutes& session = it->second;
+            vector<BusEndpoint*> b2bEps;
+            uint32_t srcId = FindSource(shard, src.c_str());
+            SessionRoutes::iterator sit = session.begin();
+            while (sit != session.end()) {
+                bool isSrc = (sit->srcId == srcId);
+                vector<Route>::iterator rit = sit->routes.begin();
+                while (rit != sit->routes.end()) {
+                    if (isSrc || (rit->destEp == ep)) {
+                        removed.push_back(RemovedRoute(*idit, rit->destEp));
+                        if (rit->b2bEp) {
+                            b2bEps.push_back(rit->b2bEp);
+                        }
+                        rit = sit->routes.erase(rit);
+                    } else {
+                        ++rit;
+                    }
+                }
+                if (sit->routes.empty()) {
+                    sit = EraseSource(shard, session, sit);
+                } else {
+                    ++sit;
+                }
+            }
+            if (session.empty()) {
+                shard.sessions.erase(it);
+            }
+
+            vector<String> names;
+            if (id != 0) {
+                names.push_back(src);
+            }
+            PruneIndexes(*idit, shard, names, b2bEps);
+        }
+        shard.lock.Unlock();
+    }
+}
+
+uint32_t SessionCastTable::FindSource(const Shard& shard, const char* src)
+{
+    std::hash_map<StringMapKey, SourceName>::const_iterator it = shard.srcNames.find(StringMapKey(src));
+    return (it == shard.srcNames.end()) ? 0 : it->second.id;
+}
+
+SessionCastTable::SessionRoutes::iterator SessionCastTable::FindSourceRoutes(SessionRoutes& session, uint32_t srcId)
+{
+    SessionRoutes::iterator sit = lower_bound(session.begin(), session.end(), srcId, SourceLess);
+    return ((sit != session.end()) && (sit->srcId == srcId)) ? sit : session.end();
+}
+
+SessionCastTable::SessionRoutes::iterator SessionCastTable::EraseSource(Shard& shard, SessionRoutes& session, SessionRoutes::iterator sit)
+{
+    std::hash_map<StringMapKey, SourceName>::iterator nit = shard.srcNames.find(StringMapKey(sit->src));
+    assert(nit != shard.srcNames.end());
+    if (--nit->second.refs == 0) {
+        shard.srcNames.erase(nit);
+    }
+    return session.erase(sit);
+}
+
+size_t SessionCastTable::Size()
+{
+    size_t size = 0;
+    for (size_t i = 0; i < NUM_SHARDS; ++i) {
+        shards[i].lock.Lock();
+        std::hash_map<SessionId, SessionRoutes>::const_iterator it = shards[i].sessions.begin();
+        while (it != shards[i].sessions.end()) {
+            for (SessionRoutes::const_iterator sit = it->second.begin(); sit != it->second.end(); ++sit) {
+                size += sit->routes.size();
+            }
+            ++it;
+        }
+        shards[i].lock.Unlock();
+    }
+    return size;
+}
+
+void SessionCastTable::PruneIndexes(SessionId id, Shard& shard, const std::vector<qcc::String>& names, const std::vector<BusEndpoint*>& b2bEps)
+{
+    std::hash_map<SessionId, SessionRoutes>::const_iterator it = shard.sessions.find(id);
+    bool found = (it != shard.sessions.end());
+
+    indexLock.Lock();
+    for (vector<String>::const_iterator nit = names.begin(); nit != names.end(); ++nit) {
+        bool inUse = false;
+        if (found) {
+            for (SessionRoutes::const_iterator sit = it->second.begin(); !inUse && (sit != it->second.end()); ++sit) {
+                inUse = (sit->src == *nit);
+                for (vector<Route>::const_iterator rit = sit->routes.begin(); !inUse && (rit != sit->routes.end()); ++rit) {
+                    inUse = (rit->destEp->GetUniqueName() == *nit);
+                }
+            }
+        }
+        if (!inUse) {
+            map<String, set<SessionId> >::iterator iit = nameIndex.find(*nit);
+            if (iit != nameIndex.end()) {
+                iit->second.erase(id);
+                if (iit->second.empty()) {
+                    nameIndex.erase(iit);
+                }
+            }
+        }
+    }
+    for (vector<BusEndpoint*>::const_iterator bit = b2bEps.begin(); bit != b2bEps.end(); ++bit) {
+        bool inUse = false;
+        if (found) {
+            for (SessionRoutes::const_iterator sit = it->second.begin(); !inUse && (sit != it->second.end()); ++sit) {
+                for (vector<Route>::const_iterator rit = sit->routes.begin(); !inUse && (rit != sit->routes.end()); ++rit) {
+                    inUse = (rit->b2bEp == *bit);
+                }
+            }
+        }
+        if (!inUse) {
+            map<BusEndpoint*, set<SessionId> >::iterator iit = b2bIndex.find(*bit);
+            if (iit != b2bIndex.end()) {
+                iit->second.erase(id);
+                if (iit->second.empty()) {
+                    b2bIndex.erase(iit);
+                }
+            }
+        }
+    }
+    indexLock.Unlock();
+}
+
+}
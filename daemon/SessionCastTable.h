@@ -0,0 +1,244 @@
+/**
+ * @file
+ * SessionCastTable is a thread-safe store of the destinations of session multicast messages.
+ */
+
+/******************************************************************************
+ * Copyright 2011, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+#ifndef _ALLJOYN_SESSIONCASTTABLE_H
+#define _ALLJOYN_SESSIONCASTTABLE_H
+
+#include <qcc/platform.h>
+
+#include <map>
+#include <set>
+#include <vector>
+
+#include <qcc/String.h>
+#include <qcc/StringMapKey.h>
+#include <qcc/Mutex.h>
+
+#include <alljoyn/Session.h>
+
+#include "BusEndpoint.h"
+
+#if defined(__GNUC__) && !defined(ANDROID)
+#include <ext/hash_map>
+namespace std {
+using namespace __gnu_cxx;
+}
+#else
+#include <hash_map>
+#endif
+
+namespace ajn {
+
+/**
+ * SessionCastTable maps a session id and the unique name of a sender to the endpoints that
+ * receive the sender's session multicast messages. Each destination is reached either directly
+ * or through a bus-to-bus endpoint.
+ *
+ * Sessions are spread over shards that each have their own lock so sends in different sessions
+ * do not contend. Sender names are interned per shard so sends look up their routes by integer
+ * id rather than by comparing names. Secondary indexes from bus-to-bus endpoints and from unique names to the
+ * sessions they appear in keep endpoint teardown proportional to that endpoint's routes.
+ */
+class SessionCastTable {
+  public:
+
+    /**
+     * Destination of a session multicast message.
+     */
+    struct Route {
+        BusEndpoint* b2bEp;       /**< Bus-to-bus endpoint used to reach destEp or NULL */
+        BusEndpoint* destEp;      /**< Destination endpoint */
+
+        Route(BusEndpoint* b2bEp, BusEndpoint* destEp) : b2bEp(b2bEp), destEp(destEp) { }
+
+        bool operator<(const Route& other) const
+        {
+            return (b2bEp < other.b2bEp) || ((b2bEp == other.b2bEp) && (destEp < other.destEp));
+        }
+
+        bool operator==(const Route& other) const
+        {
+            return (b2bEp == other.b2bEp) && (destEp == other.destEp);
+        }
+    };
+
+    /**
+     * A route that was removed from the table.
+     */
+    struct RemovedRoute {
+        SessionId id;             /**< Session the route belonged to */
+        BusEndpoint* destEp;      /**< Destination endpoint of the route */
+
+        RemovedRoute(SessionId id, BusEndpoint* destEp) : id(id), destEp(destEp) { }
+    };
+
+    /**
+     * Add a route.
+     *
+     * @param id      Session id.
+     * @param src     Unique name of the sender.
+     * @param b2bEp   Bus-to-bus endpoint used to reach destEp or NULL.
+     * @param destEp  Destination endpoint.
+     */
+    void Add(SessionId id, const qcc::String& src, BusEndpoint* b2bEp, BusEndpoint* destEp);
+
+    /**
+     * Remove a route.
+     *
+     * @param id      Session id.
+     * @param src     Unique name of the sender.
+     * @param b2bEp   Bus-to-bus endpoint used to reach destEp or NULL.
+     * @param destEp  Destination endpoint.
+     */
+    void Remove(SessionId id, const qcc::String& src, BusEndpoint* b2bEp, BusEndpoint* destEp);
+
+    /**
+     * Get the endpoints a session multicast message must be pushed to. Destinations that are
+     * reached through the same bus-to-bus endpoint are only returned once. A routing reference
+     * is taken on every returned endpoint; the caller must release each with
+     * BusEndpoint::DecrementRouteRef().
+     *
+     * @param id      Session id.
+     * @param src     Unique name of the sender.
+     * @param dests   [OUT] Endpoints to push the message to.
+     */
+    void GetDestinations(SessionId id, const char* src, std::vector<BusEndpoint*>& dests);
+
+    /**
+     * Remove all routes that go through a bus-to-bus endpoint.
+     *
+     * @param b2bEp   The bus-to-bus endpoint.
+     */
+    void RemoveB2bEndpoint(BusEndpoint* b2bEp);
+
+    /**
+     * Remove the routes from a sender and the routes to its endpoint.
+     *
+     * @param src      Unique name of the sender.
+     * @param ep       Endpoint of the sender.
+     * @param id       Session id or 0 to remove the routes of all sessions.
+     * @param removed  [OUT] Appended with the routes that were removed.
+     */
+    void RemoveRoutes(const qcc::String& src, BusEndpoint* ep, SessionId id, std::vector<RemovedRoute>& removed);
+
+    /**
+     * Get the number of routes in the table.
+     *
+     * @return  The number of routes.
+     */
+    size_t Size();
+
+  private:
+
+    /** Number of shards (must be a power of 2) */
+    static const size_t NUM_SHARDS = 16;
+
+    /**
+     * Routes of one sender in a session. Routes are sorted so routes through the same
+     * bus-to-bus endpoint are adjacent.
+     */
+    struct SourceRoutes {
+        uint32_t srcId;                                       /**< Interned id of the sender */
+        qcc::String src;                                      /**< Unique name of the sender */
+        std::vector<Route> routes;
+    };
+
+    /** Senders of a session sorted by interned id */
+    typedef std::vector<SourceRoutes> SessionRoutes;
+
+    /**
+     * Interned id of a sender name and the number of sessions of the shard the sender has
+     * routes in.
+     */
+    struct SourceName {
+        uint32_t id;
+        uint32_t refs;
+
+        SourceName() : id(0), refs(0) { }
+    };
+
+    struct Shard {
+        qcc::Mutex lock;                                      /**< Protects sessions and srcNames */
+        std::hash_map<SessionId, SessionRoutes> sessions;     /**< Routes by session id */
+        std::hash_map<qcc::StringMapKey, SourceName> srcNames; /**< Interned sender names */
+        uint32_t nextSrcId;                                   /**< Next interned id, 0 is never used */
+
+        Shard() : nextSrcId(1) { }
+    };
+
+    Shard& GetShard(SessionId id) { return shards[id & (NUM_SHARDS - 1)]; }
+
+    /**
+     * Get the interned id of a sender name. Must be called with the shard locked.
+     *
+     * @param shard   The shard.
+     * @param src     Unique name of the sender.
+     *
+     * @return  The interned id or 0 if the sender has no routes in the shard.
+     */
+    static uint32_t FindSource(const Shard& shard, const char* src);
+
+    /**
+     * Find the routes of a sender in a session. Must be called with the shard locked.
+     *
+     * @param session  The session's senders.
+     * @param srcId    Interned id of the sender.
+     *
+     * @return  The sender's routes or session.end().
+     */
+    static SessionRoutes::iterator FindSourceRoutes(SessionRoutes& session, uint32_t srcId);
+
+    /** Orders a session's senders by interned id */
+    static bool SourceLess(const SourceRoutes& routes, uint32_t srcId) { return routes.srcId < srcId; }
+
+    /**
+     * Erase the routes of a sender from a session and release the sender's interned name. Must
+     * be called with the shard locked.
+     *
+     * @param shard    The shard.
+     * @param session  The session's senders.
+     * @param sit      The sender's routes.
+     *
+     * @return  Iterator following the erased sender.
+     */
+    static SessionRoutes::iterator EraseSource(Shard& shard, SessionRoutes& session, SessionRoutes::iterator sit);
+
+    /**
+     * Remove a session from the index entries of names and bus-to-bus endpoints that no longer
+     * have routes in it. The indexes may list sessions a name or endpoint no longer appears in
+     * but never miss one it does appear in. Must be called with the session's shard locked.
+     *
+     * @param id        Session id.
+     * @param shard     The session's shard.
+     * @param names     Names that may no longer appear in the session.
+     * @param b2bEps    Bus-to-bus endpoints that may no longer appear in the session.
+     */
+    void PruneIndexes(SessionId id, Shard& shard, const std::vector<qcc::String>& names, const std::vector<BusEndpoint*>& b2bEps);
+
+    Shard shards[NUM_SHARDS];                                 /**< Sharded session routes */
+
+    qcc::Mutex indexLock;                                     /**< Protects the secondary indexes */
+    std::map<BusEndpoint*, std::set<SessionId> > b2bIndex;    /**< Sessions with routes through a bus-to-bus endpoint */
+    std::map<qcc::String, std::set<SessionId> > nameIndex;    /**< Sessions a unique name sends or receives in */
+};
+
+}
+
+#endif
@@ -31,6 +31,8 @@
 #include <stdio.h>
 #include <time.h>
 
+#include <qcc/Mutex.h>
+#include <qcc/StringUtil.h>
 #include <qcc/Thread.h>  // For qcc::Sleep()
 
 #include <Status.h>
@@ -165,6 +167,156 @@ static void PrintFlags(uint32_t flags)
 
 #define ERROR_EXIT exit(1)
 
+/*
+ * Counts what the name services of the load test report to the daemon.
+ */
+class Counter {
+  public:
+
+    Counter() : m_callbacks(0), m_names(0) { }
+
+    void Callback(const qcc::String& busAddr, const qcc::String& guid, std::vector<qcc::String>& wkn, uint8_t timer)
+    {
+        m_mutex.Lock();
+        ++m_callbacks;
+        m_names += wkn.size();
+        m_mutex.Unlock();
+    }
+
+    void Get(uint32_t& callbacks, uint32_t& names)
+    {
+        m_mutex.Lock();
+        callbacks = m_callbacks;
+        names = m_names;
+        m_mutex.Unlock();
+    }
+
+  private:
+    qcc::Mutex m_mutex;
+    uint32_t m_callbacks;
+    uint32_t m_names;
+};
+
+static qcc::String LoadName(uint32_t daemon, uint32_t name)
+{
+    return qcc::String("org.nsload.d") + qcc::U32ToString(daemon) + ".n" + qcc::U32ToString(name);
+}
+
+static void SumStats(std::vector<NameService*>& daemons, NameService::Stats& sum)
+{
+    memset(&sum, 0, sizeof(sum));
+    for (uint32_t i = 0; i < daemons.size(); ++i) {
+        NameService::Stats stats;
+        daemons[i]->GetStats(stats);
+        sum.packetsSent += stats.packetsSent;
+        sum.bytesSent += stats.bytesSent;
+        sum.packetsReceived += stats.packetsReceived;
+        sum.bytesReceived += stats.bytesReceived;
+        sum.snapshotsSent += stats.snapshotsSent;
+        sum.snapshotRequests += stats.snapshotRequests;
+        sum.v0AnswersQueued += stats.v0AnswersQueued;
+    }
+}
+
+/*
+ * Run a number of name services in this process that talk to each other over
+ * multicast on one interface (loopback by default).  Every daemon advertises
+ * numNames names.  In each discovery round every daemon withdraws one of its
+ * names and advertises a new one, and one daemon asks for all names.  Print
+ * the packets, bytes, reported names and CPU time each round costs.
+ */
+static int LoadTest(const qcc::String& iface, uint32_t numDaemons, uint32_t numNames, uint32_t numRounds, uint32_t roundMs)
+{
+    QStatus status = ER_OK;
+    std::vector<NameService*> daemons;
+    Counter counter;
+
+    for (uint32_t d = 0; (d < numDaemons) && (status == ER_OK); ++d) {
+        NameService* ns = new NameService();
+        daemons.push_back(ns);
+        status = ns->Init(qcc::GUID128().ToString(), true, false,
+#if NS_BROADCAST
+                          false,
+#endif
+                          false);
+        if (status == ER_OK) {
+            status = ns->OpenInterface(iface);
+        }
+        if (status == ER_OK) {
+            status = ns->SetEndpoints("", "", 9955 + d);
+        }
+        if (status == ER_OK) {
+            ns->SetCallback(new CallbackImpl<Counter, void, const qcc::String&, const qcc::String&,
+                                             std::vector<qcc::String>&, uint8_t>(&counter, &Counter::Callback));
+        }
+    }
+
+    for (uint32_t d = 0; (d < numDaemons) && (status == ER_OK); ++d) {
+        std::vector<qcc::String> names;
+        for (uint32_t n = 0; n < numNames; ++n) {
+            names.push_back(LoadName(d, n));
+        }
+        status = daemons[d]->Advertise(names);
+    }
+
+    if (status != ER_OK) {
+        QCC_LogError(status, ("Load test setup failed"));
+    } else {
+        printf("Load test: %u daemons advertising %u names each over %s, %u rounds of %u ms\n",
+               numDaemons, numNames, iface.c_str(), numRounds, roundMs);
+        qcc::Sleep(roundMs);
+
+        NameService::Stats first, before, after;
+        uint32_t firstCallbacks, firstNames, callbacksBefore, namesBefore, callbacksAfter, namesAfter;
+        SumStats(daemons, first);
+        counter.Get(firstCallbacks, firstNames);
+        clock_t firstClock = clock();
+
+        for (uint32_t r = 0; r < numRounds; ++r) {
+            SumStats(daemons, before);
+            counter.Get(callbacksBefore, namesBefore);
+            clock_t start = clock();
+
+            for (uint32_t d = 0; d < numDaemons; ++d) {
+                daemons[d]->Cancel(LoadName(d, r));
+                daemons[d]->Advertise(LoadName(d, numNames + r));
+            }
+            daemons[r % numDaemons]->Locate("org.nsload.*");
+            qcc::Sleep(roundMs);
+
+            SumStats(daemons, after);
+            counter.Get(callbacksAfter, namesAfter);
+            double cpuMs = (1000.0 * (clock() - start)) / CLOCKS_PER_SEC;
+
+            printf("Round %3u: %5u packets sent %7u bytes sent %6u packets received %4u snapshots %4u snapshot requests "
+                   "%4u version 0 answers %6u names reported %8.1f ms CPU\n",
+                   r,
+                   after.packetsSent - before.packetsSent,
+                   after.bytesSent - before.bytesSent,
+                   after.packetsReceived - before.packetsReceived,
+                   after.snapshotsSent - before.snapshotsSent,
+                   after.snapshotRequests - before.snapshotRequests,
+                   after.v0AnswersQueued - before.v0AnswersQueued,
+                   namesAfter - namesBefore,
+                   cpuMs);
+        }
+
+        double rounds = numRounds ? numRounds : 1;
+        double cpuMs = (1000.0 * (clock() - firstClock)) / CLOCKS_PER_SEC;
+        printf("Per round: %.1f packets sent %.0f bytes sent %.1f packets received %.1f names reported %.1f ms CPU\n",
+               (after.packetsSent - first.packetsSent) / rounds,
+               (after.bytesSent - first.bytesSent) / rounds,
+               (after.packetsReceived - first.packetsReceived) / rounds,
+               (namesAfter - firstNames) / rounds,
+               cpuMs / rounds);
+    }
+
+    for (uint32_t d = 0; d < daemons.size(); ++d) {
+        delete daemons[d];
+    }
+    return (status == ER_OK) ? 0 : 1;
+}
+
 int main(int argc, char** argv)
 {
     QStatus status;
@@ -174,9 +326,36 @@ int main(int argc, char** argv)
     bool useEth0 = false;
     bool runtests = false;
     bool wildcard = false;
+    bool load = false;
+    qcc::String loadInterface = "lo";
+    uint32_t loadDaemons = 8;
+    uint32_t loadNames = 20;
+    uint32_t loadRounds = 10;
+    uint32_t loadRoundMs = 2000;
 
     for (int i = 1; i < argc; ++i) {
-        if (strcmp("-a", argv[i]) == 0) {
+        if ((strcmp("-d", argv[i]) == 0) || (strcmp("-n", argv[i]) == 0) || (strcmp("-r", argv[i]) == 0) ||
+            (strcmp("-p", argv[i]) == 0) || (strcmp("-i", argv[i]) == 0)) {
+            if ((i + 1) == argc) {
+                printf("option %s requires a parameter\n", argv[i]);
+                ERROR_EXIT;
+            }
+            uint32_t val = strtoul(argv[i + 1], NULL, 10);
+            switch (argv[i][1]) {
+            case 'd': loadDaemons = val ? val : 1; break;
+
+            case 'n': loadNames = val ? val : 1; break;
+
+            case 'r': loadRounds = val; break;
+
+            case 'p': loadRoundMs = val; break;
+
+            case 'i': loadInterface = argv[i + 1]; break;
+            }
+            ++i;
+        } else if (strcmp("-l", argv[i]) == 0) {
+            load = true;
+        } else if (strcmp("-a", argv[i]) == 0) {
             advertise = true;
         } else if (strcmp("-e", argv[i]) == 0) {
             useEth0 = true;
@@ -194,6 +373,10 @@ int main(int argc, char** argv)
         exit(0);
     }
 
+    if (load) {
+        return LoadTest(loadInterface, loadDaemons, loadNames, loadRounds, loadRoundMs);
+    }
+
     NameService ns;
 
     //
@@ -0,0 +1,362 @@
+/**
+ * @file
+ *
+ * Round trip tests and serialization benchmark for the name service protocol.
+ */
+
+/******************************************************************************
+ * Copyright 2011, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+
+#include <qcc/platform.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include <qcc/String.h>
+#include <qcc/StringUtil.h>
+#include <qcc/time.h>
+
+#include <Status.h>
+
+#include "NsProtocol.h"
+
+using namespace std;
+using namespace qcc;
+using namespace ajn;
+
+static unsigned long failures = 0;
+
+#define CHECK(cond) \
+    do { \
+        if (!(cond)) { \
+            printf("%s:%d: Check failed: %s\n", __FILE__, __LINE__, # cond); \
+            ++failures; \
+        } \
+    } while (0)
+
+static qcc::String TestName(uint32_t i)
+{
+    return qcc::String("org.alljoyn.nsprotocol.test.name") + U32ToString(i);
+}
+
+static IsAt TestAnswer(uint32_t sequence, uint32_t numNames)
+{
+    IsAt isAt;
+    isAt.SetTcpFlag(true);
+    isAt.SetGuid("0123456789abcdef0123456789abcdef");
+    isAt.SetCompleteFlag(true);
+    isAt.SetPort(9955);
+    isAt.SetIPv4("192.168.1.10");
+    isAt.SetIPv6("fe80::1");
+    isAt.SetSequence(sequence);
+    for (uint32_t i = 0; i < numNames; ++i) {
+        isAt.AddName(TestName(i));
+    }
+    return isAt;
+}
+
+static WhoHas TestQuestion(uint32_t numNames)
+{
+    WhoHas whoHas;
+    whoHas.SetTcpFlag(true);
+    whoHas.SetIPv4Flag(true);
+    for (uint32_t i = 0; i < numNames; ++i) {
+        whoHas.AddName(TestName(i) + "*");
+    }
+    return whoHas;
+}
+
+/* Serialize a header, read it back and check that the copy matches */
+static void RoundTrip(Header& header)
+{
+    size_t size = header.GetSerializedSize();
+    vector<uint8_t> buffer(size + 1);
+    CHECK(header.Serialize(&buffer[0]) == size);
+
+    Header copy;
+    CHECK(copy.Deserialize(&buffer[0], size) == size);
+    CHECK(copy.GetVersion() == header.GetVersion());
+    CHECK(copy.GetTimer() == header.GetTimer());
+    CHECK(copy.GetSerializedSize() == size);
+    CHECK(copy.GetNumberQuestions() == header.GetNumberQuestions());
+    CHECK(copy.GetNumberAnswers() == header.GetNumberAnswers());
+
+    for (uint32_t i = 0; (i < copy.GetNumberQuestions()) && (i < header.GetNumberQuestions()); ++i) {
+        WhoHas a = header.GetQuestion(i);
+        WhoHas b = copy.GetQuestion(i);
+        CHECK(a.GetCompleteFlag() == b.GetCompleteFlag());
+        CHECK(a.GetTcpFlag() == b.GetTcpFlag());
+        CHECK(a.GetIPv4Flag() == b.GetIPv4Flag());
+        CHECK(a.GetNumberNames() == b.GetNumberNames());
+        for (uint32_t j = 0; (j < a.GetNumberNames()) && (j < b.GetNumberNames()); ++j) {
+            CHECK(a.GetName(j) == b.GetName(j));
+        }
+    }
+
+    for (uint32_t i = 0; (i < copy.GetNumberAnswers()) && (i < header.GetNumberAnswers()); ++i) {
+        IsAt a = header.GetAnswer(i);
+        IsAt b = copy.GetAnswer(i);
+        CHECK(a.GetCompleteFlag() == b.GetCompleteFlag());
+        CHECK(a.GetGuid() == b.GetGuid());
+        CHECK(a.GetPort() == b.GetPort());
+        CHECK(a.GetIPv4() == b.GetIPv4());
+        CHECK(a.GetIPv6() == b.GetIPv6());
+        if (header.GetVersion() >= 1) {
+            CHECK(a.GetSequence() == b.GetSequence());
+            CHECK(a.GetPart() == b.GetPart());
+            CHECK(a.GetParts() == b.GetParts());
+        }
+        CHECK(a.GetNumberNames() == b.GetNumberNames());
+        for (uint32_t j = 0; (j < a.GetNumberNames()) && (j < b.GetNumberNames()); ++j) {
+            CHECK(a.GetName(j) == b.GetName(j));
+        }
+    }
+
+    /* A truncated packet must be rejected */
+    Header truncated;
+    CHECK(truncated.Deserialize(&buffer[0], size - 1) == 0);
+}
+
+static void TestRoundTrip(void)
+{
+    for (uint8_t version = 0; version <= 1; ++version) {
+        Header header;
+        header.SetVersion(version);
+        header.SetTimer(120);
+        header.AddQuestion(TestQuestion(3));
+        header.AddAnswer(TestAnswer(0x01020304, 5));
+        header.AddAnswer(TestAnswer(0xfffffffe, 0));
+        RoundTrip(header);
+
+        /* The sequence number is only on the wire in version 1 */
+        Header empty;
+        empty.SetVersion(version);
+        empty.AddAnswer(TestAnswer(7, 0));
+        Header empty0;
+        empty0.AddAnswer(TestAnswer(7, 0));
+        CHECK(empty.GetSerializedSize() == empty0.GetSerializedSize() + (version ? 6 : 0));
+    }
+}
+
+static void TestSplit(void)
+{
+    const size_t maxSize = 1000;
+    IsAt isAt = TestAnswer(42, 600);
+    isAt.SetVersion(1);
+
+    vector<IsAt> parts;
+    CHECK(isAt.Split(maxSize, parts));
+    CHECK(parts.size() > 1);
+
+    uint32_t next = 0;
+    for (uint32_t i = 0; i < parts.size(); ++i) {
+        CHECK(parts[i].GetSerializedSize() <= maxSize);
+        CHECK(parts[i].GetNumberNames() > 0);
+        CHECK(parts[i].GetNumberNames() < 256);
+        CHECK(parts[i].GetSequence() == 42);
+        CHECK(parts[i].GetPart() == i);
+        CHECK(parts[i].GetParts() == parts.size());
+        CHECK(parts[i].GetGuid() == isAt.GetGuid());
+        for (uint32_t j = 0; j < parts[i].GetNumberNames(); ++j, ++next) {
+            CHECK(parts[i].GetName(j) == TestName(next));
+        }
+
+        Header header;
+        header.SetVersion(1);
+        header.SetTimer(120);
+        header.AddAnswer(parts[i]);
+        RoundTrip(header);
+    }
+    CHECK(next == 600);
+
+    /* Short names are bounded by the count octet rather than the size */
+    IsAt shortNames;
+    shortNames.SetPort(9955);
+    for (uint32_t i = 0; i < 600; ++i) {
+        shortNames.AddName("a");
+    }
+    parts.clear();
+    CHECK(shortNames.Split(65535, parts));
+    CHECK(parts.size() == 3);
+    if (parts.size() == 3) {
+        CHECK(parts[0].GetNumberNames() == 255);
+        CHECK(parts[2].GetNumberNames() == 600 - 2 * 255);
+    }
+
+    /* An answer without names is passed through (a version 1 keepalive) */
+    parts.clear();
+    CHECK(TestAnswer(1, 0).Split(maxSize, parts));
+    CHECK(parts.size() == 1);
+
+    /* A name that can never fit is refused and nothing is produced */
+    IsAt tooLong = TestAnswer(1, 1);
+    qcc::String longName = "org";
+    while (longName.size() < 200) {
+        longName += ".x";
+    }
+    tooLong.AddName(longName);
+    parts.clear();
+    CHECK(!tooLong.Split(100, parts));
+    CHECK(parts.empty());
+}
+
+static void TestMerge(void)
+{
+    const size_t maxSize = 1454;
+
+    Header question;
+    question.SetVersion(1);
+    question.SetTimer(0);
+    question.AddQuestion(TestQuestion(2));
+
+    Header add;
+    add.SetVersion(1);
+    add.SetTimer(120);
+    add.AddAnswer(TestAnswer(1, 3));
+
+    Header remove;
+    remove.SetVersion(1);
+    remove.SetTimer(0);
+    remove.AddAnswer(TestAnswer(2, 1));
+
+    Header add2;
+    add2.SetVersion(1);
+    add2.SetTimer(120);
+    add2.AddAnswer(TestAnswer(3, 2));
+
+    /* A question takes the timer of the answers it is packed with */
+    Header packet = question;
+    CHECK(packet.Merge(add, maxSize));
+    CHECK(packet.GetTimer() == 120);
+    CHECK(packet.GetNumberQuestions() == 1);
+    CHECK(packet.GetNumberAnswers() == 1);
+
+    /* Answers with different timers mean different things */
+    CHECK(!packet.Merge(remove, maxSize));
+    CHECK(packet.GetNumberAnswers() == 1);
+
+    /* Answers with the same timer keep their order */
+    size_t before = packet.GetSerializedSize();
+    CHECK(packet.Merge(add2, maxSize));
+    CHECK(packet.GetSerializedSize() == before + add2.GetSerializedSize() - 4);
+    CHECK(packet.GetNumberAnswers() == 2);
+    if (packet.GetNumberAnswers() == 2) {
+        CHECK(packet.GetAnswer(0).GetSequence() == 1);
+        CHECK(packet.GetAnswer(1).GetSequence() == 3);
+    }
+    RoundTrip(packet);
+
+    /* Versions are never mixed */
+    Header old;
+    old.SetVersion(0);
+    old.SetTimer(120);
+    old.AddAnswer(TestAnswer(0, 1));
+    CHECK(!packet.Merge(old, maxSize));
+
+    /* Nothing is merged past the size limit */
+    Header big;
+    big.SetVersion(1);
+    big.SetTimer(120);
+    big.AddAnswer(TestAnswer(4, 30));
+    Header small = add;
+    size_t limit = small.GetSerializedSize() + big.GetSerializedSize() - 4;
+    CHECK(!small.Merge(big, limit - 1));
+    CHECK(small.GetNumberAnswers() == 1);
+    CHECK(small.Merge(big, limit));
+    CHECK(small.GetSerializedSize() == limit);
+}
+
+/* Serialize and deserialize a message with numNames names numIterations times */
+static void Benchmark(unsigned long numIterations, unsigned long numNames)
+{
+    Header header;
+    header.SetVersion(1);
+    header.SetTimer(120);
+    header.AddAnswer(TestAnswer(1, numNames));
+
+    size_t size = header.GetSerializedSize();
+    vector<uint8_t> buffer(size);
+
+    uint32_t start = GetTimestamp();
+    for (unsigned long i = 0; i < numIterations; ++i) {
+        size = header.GetSerializedSize();
+        header.Serialize(&buffer[0]);
+    }
+    uint32_t serializeTime = GetTimestamp() - start;
+
+    start = GetTimestamp();
+    for (unsigned long i = 0; i < numIterations; ++i) {
+        Header copy;
+        if (copy.Deserialize(&buffer[0], size) != size) {
+            ++failures;
+        }
+    }
+    uint32_t deserializeTime = GetTimestamp() - start;
+
+    double ops = numIterations ? numIterations : 1;
+    printf("%lu names, %u bytes\n", numNames, (uint32_t)size);
+    printf("Serialize:    %u ms (%.2f us per message)\n", serializeTime, (1000.0 * serializeTime) / ops);
+    printf("Deserialize:  %u ms (%.2f us per message)\n", deserializeTime, (1000.0 * deserializeTime) / ops);
+}
+
+static void usage(void)
+{
+    printf("Usage: nsprotocol [-h] [-c #] [-n #]\n\n");
+    printf("Options:\n");
+    printf("   -h    = Print this help message\n");
+    printf("   -c #  = Number of benchmark iterations (default = 100000)\n");
+    printf("   -n #  = Number of names in the benchmark message (default = 32)\n");
+}
+
+int main(int argc, char** argv)
+{
+    unsigned long numIterations = 100000;
+    unsigned long numNames = 32;
+
+    for (int i = 1; i < argc; ++i) {
+        if (0 == strcmp("-h", argv[i])) {
+            usage();
+            exit(0);
+        } else if ((0 == strcmp("-c", argv[i])) || (0 == strcmp("-n", argv[i]))) {
+            if ((i + 1) == argc) {
+                printf("option %s requires a parameter\n", argv[i]);
+                usage();
+                exit(1);
+            }
+            unsigned long val = strtoul(argv[i + 1], NULL, 10);
+            if (argv[i][1] == 'c') {
+                numIterations = val;
+            } else {
+                numNames = (val < 256) ? val : 255;
+            }
+            ++i;
+        } else {
+            printf("Unknown option %s\n", argv[i]);
+            usage();
+            exit(1);
+        }
+    }
+
+    TestRoundTrip();
+    TestSplit();
+    TestMerge();
+    Benchmark(numIterations, numNames);
+
+    printf("Failures:     %lu\n", failures);
+    return failures ? 1 : 0;
+}
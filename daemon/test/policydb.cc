@@ -0,0 +1,268 @@
+/**
+ * @file
+ *
+ * Checks that cached PolicyDB send and receive decisions match freshly evaluated ones and that
+ * rule and name ownership changes invalidate the decision cache.
+ */
+
+/******************************************************************************
+ * Copyright 2011, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+
+#include <qcc/platform.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <map>
+#include <vector>
+
+#include <qcc/String.h>
+#include <qcc/StringUtil.h>
+
+#include <alljoyn/BusAttachment.h>
+#include <alljoyn/Message.h>
+
+#include <Status.h>
+
+#include "PolicyDB.h"
+
+using namespace std;
+using namespace qcc;
+using namespace ajn;
+
+/* Gives the test access to the message builders */
+class TestMessage : public _Message {
+  public:
+    TestMessage(BusAttachment& bus) : _Message(bus) { }
+
+    QStatus Call(const char* destination, const char* objPath, const char* iface, const char* member)
+    {
+        uint32_t serial;
+        return CallMsg("", destination, 0, objPath, iface, member, serial, NULL, 0, 0);
+    }
+
+    QStatus Signal(const char* destination, const char* objPath, const char* iface, const char* member)
+    {
+        return SignalMsg("", destination, 0, objPath, iface, member, NULL, 0, 0, 0);
+    }
+};
+
+struct Query {
+    Message msg;
+    uint32_t uid;
+    uint32_t gid;
+
+    Query(const Message& msg, uint32_t uid, uint32_t gid) : msg(msg), uid(uid), gid(gid) { }
+};
+
+static uint32_t Rand(uint32_t& seed, uint32_t range)
+{
+    seed = seed * 1103515245 + 12345;
+    return (seed >> 8) % range;
+}
+
+static bool AddRule(PolicyDB& policy, const char* context, policydb::PolicyPermission permission,
+                    const map<qcc::String, qcc::String>& attrs)
+{
+    qcc::String catValue(context);
+    return policy->AddRule(policydb::POLICY_CONTEXT, catValue, permission, attrs);
+}
+
+/*
+ * Method calls are denied unless a rule allows them so start with a rule that allows them all,
+ * then add allow and deny rules that each select an interface and optionally a member,
+ * destination, sender, or type.
+ */
+static void BuildPolicy(PolicyDB& policy, unsigned long numRules, unsigned long numIfaces)
+{
+    map<qcc::String, qcc::String> attrs;
+    attrs["send_type"] = "method_call";
+    AddRule(policy, "default", policydb::POLICY_ALLOW, attrs);
+
+    uint32_t seed = 7;
+    for (unsigned long r = 0; r < numRules; ++r) {
+        bool send = Rand(seed, 2) == 0;
+        const char* prefix = send ? "send_" : "receive_";
+        attrs.clear();
+        attrs[qcc::String(prefix) + "interface"] = qcc::String("org.test.Iface") + U32ToString(Rand(seed, numIfaces));
+        if (Rand(seed, 2)) {
+            attrs[qcc::String(prefix) + "member"] = qcc::String("Member") + U32ToString(Rand(seed, 4));
+        }
+        if (Rand(seed, 3) == 0) {
+            attrs[send ? "send_destination" : "receive_sender"] = qcc::String("org.test.Svc") + U32ToString(Rand(seed, 4));
+        }
+        if (Rand(seed, 4) == 0) {
+            attrs[qcc::String(prefix) + "type"] = Rand(seed, 2) ? "signal" : "method_call";
+        }
+        AddRule(policy, "default", Rand(seed, 2) ? policydb::POLICY_ALLOW : policydb::POLICY_DENY, attrs);
+    }
+
+    /* Unique names :1.0 and :1.1 own some of the well known names used in the rules */
+    qcc::String owner0(":1.0");
+    qcc::String owner1(":1.1");
+    policy->NameOwnerChanged("org.test.Svc0", NULL, &owner0);
+    policy->NameOwnerChanged("org.test.Svc1", NULL, &owner0);
+    policy->NameOwnerChanged("org.test.Svc2", NULL, &owner1);
+}
+
+static void usage(void)
+{
+    printf("Usage: policydb [-h] [-r #] [-i #] [-q #]\n\n");
+    printf("Options:\n");
+    printf("   -h    = Print this help message\n");
+    printf("   -r #  = Number of policy rules (default = 200)\n");
+    printf("   -i #  = Number of distinct interfaces (default = 16)\n");
+    printf("   -q #  = Number of policy queries (default = 2000)\n");
+}
+
+int main(int argc, char** argv)
+{
+    unsigned long numRules = 200;
+    unsigned long numIfaces = 16;
+    unsigned long numQueries = 2000;
+
+    for (int i = 1; i < argc; ++i) {
+        if (0 == strcmp("-h", argv[i])) {
+            usage();
+            exit(0);
+        } else if ((0 == strcmp("-r", argv[i])) || (0 == strcmp("-i", argv[i])) || (0 == strcmp("-q", argv[i]))) {
+            if ((i + 1) == argc) {
+                printf("option %s requires a parameter\n", argv[i]);
+                usage();
+                exit(1);
+            }
+            unsigned long val = strtoul(argv[i + 1], NULL, 10);
+            switch (argv[i][1]) {
+            case 'r': numRules = val; break;
+
+            case 'i': numIfaces = val ? val : 1; break;
+
+            case 'q': numQueries = val; break;
+            }
+            ++i;
+        } else {
+            printf("Unknown option %s\n", argv[i]);
+            usage();
+            exit(1);
+        }
+    }
+
+    BusAttachment bus("policydb");
+    PolicyDB cached;
+    BuildPolicy(cached, numRules, numIfaces);
+
+    /*
+     * A small pool of interfaces, members, and bus names so most queries repeat an earlier one and
+     * are answered from the decision cache.
+     */
+    vector<Query> queries;
+    uint32_t seed = 1;
+    for (unsigned long q = 0; q < numQueries; ++q) {
+        TestMessage tmsg(bus);
+        qcc::String iface = qcc::String("org.test.Iface") + U32ToString(Rand(seed, numIfaces));
+        qcc::String member = qcc::String("Member") + U32ToString(Rand(seed, 4));
+        uint32_t n = Rand(seed, 4);
+        qcc::String dest = Rand(seed, 2) ? (qcc::String("org.test.Svc") + U32ToString(n)) : (qcc::String(":1.") + U32ToString(n));
+        QStatus status;
+        if (Rand(seed, 2)) {
+            status = tmsg.Call(dest.c_str(), "/org/test", iface.c_str(), member.c_str());
+        } else {
+            status = tmsg.Signal(dest.c_str(), "/org/test", iface.c_str(), member.c_str());
+        }
+        if (status != ER_OK) {
+            printf("Failed to build message %s\n", QCC_StatusText(status));
+            return 1;
+        }
+        queries.push_back(Query(Message(tmsg), 1000 + Rand(seed, 2), 100));
+    }
+
+    /*
+     * Each decision is made twice against the cached policy, the second time normally from the
+     * cache, and compared with a decision from a new policy that has never cached anything.
+     */
+    unsigned long allowed = 0;
+    unsigned long mismatches = 0;
+    for (size_t q = 0; q < queries.size(); ++q) {
+        PolicyDB uncached;
+        BuildPolicy(uncached, numRules, numIfaces);
+        NormalizedMsgHdr refNmh(queries[q].msg, uncached);
+        bool refSend = uncached->OKToSend(refNmh, queries[q].uid, queries[q].gid);
+        bool refReceive = uncached->OKToReceive(refNmh, queries[q].uid, queries[q].gid);
+
+        for (int pass = 0; pass < 2; ++pass) {
+            NormalizedMsgHdr nmh(queries[q].msg, cached);
+            if ((cached->OKToSend(nmh, queries[q].uid, queries[q].gid) != refSend) ||
+                (cached->OKToReceive(nmh, queries[q].uid, queries[q].gid) != refReceive)) {
+                ++mismatches;
+            }
+        }
+        allowed += refSend ? 1 : 0;
+    }
+    printf("%lu rules, %lu interfaces, %lu queries (%lu sends allowed)\n", numRules, numIfaces, numQueries, allowed);
+    printf("Cached/uncached mismatches: %lu\n", mismatches);
+
+    unsigned long failures = 0;
+    map<qcc::String, qcc::String> attrs;
+
+    /* Adding a rule must invalidate a cached allow decision */
+    TestMessage rmsg(bus);
+    rmsg.Signal(NULL, "/org/test", "org.test.Reload", "Ping");
+    Message reloadMsg(rmsg);
+    for (int pass = 0; pass < 2; ++pass) {
+        NormalizedMsgHdr nmh(reloadMsg, cached);
+        if (!cached->OKToSend(nmh, 1000, 100)) {
+            printf("FAILED: signal denied before rule was added\n");
+            ++failures;
+        }
+    }
+    attrs["send_interface"] = "org.test.Reload";
+    AddRule(cached, "mandatory", policydb::POLICY_DENY, attrs);
+    {
+        NormalizedMsgHdr nmh(reloadMsg, cached);
+        if (cached->OKToSend(nmh, 1000, 100)) {
+            printf("FAILED: cached decision used after rule was added\n");
+            ++failures;
+        }
+    }
+
+    /* A unique name taking or losing a well known name must invalidate cached decisions */
+    TestMessage omsg(bus);
+    omsg.Call(":1.9", "/org/test", "org.test.Owner", "Open");
+    Message ownerMsg(omsg);
+    attrs.clear();
+    attrs["send_destination"] = "org.test.Locked";
+    AddRule(cached, "mandatory", policydb::POLICY_DENY, attrs);
+    qcc::String owner(":1.9");
+    for (int step = 0; step < 3; ++step) {
+        if (step == 1) {
+            cached->NameOwnerChanged("org.test.Locked", NULL, &owner);
+        } else if (step == 2) {
+            cached->NameOwnerChanged("org.test.Locked", &owner, NULL);
+        }
+        bool expect = (step != 1);
+        for (int pass = 0; pass < 2; ++pass) {
+            NormalizedMsgHdr nmh(ownerMsg, cached);
+            if (cached->OKToSend(nmh, 1000, 100) != expect) {
+                printf("FAILED: stale decision for :1.9 after name owner change %d\n", step);
+                ++failures;
+            }
+        }
+    }
+
+    failures += mismatches;
+    printf("%s\n", failures ? "FAILED" : "PASSED");
+    return failures ? 1 : 0;
+}
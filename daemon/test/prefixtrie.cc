@@ -0,0 +1,233 @@
+/**
+ * @file
+ *
+ * Test and benchmark for matching discovered names against find name prefixes.
+ */
+
+/******************************************************************************
+ * Copyright 2011, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+
+#include <qcc/platform.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include <qcc/String.h>
+#include <qcc/StringUtil.h>
+#include <qcc/time.h>
+
+#include "PrefixTrie.h"
+
+using namespace std;
+using namespace qcc;
+using namespace ajn;
+
+typedef PrefixTrie<String>::Entry Entry;
+
+static void usage(void)
+{
+    printf("Usage: prefixtrie [-h] [-p #] [-n #] [-r #]\n\n");
+    printf("Options:\n");
+    printf("   -h    = Print this help message\n");
+    printf("   -p #  = Number of find name prefixes (default = 500)\n");
+    printf("   -n #  = Number of found names (default = 5000)\n");
+    printf("   -r #  = Number of rounds of found names (default = 10)\n");
+}
+
+/* Match a name the way AllJoynObj::FoundNames did before the trie: scan the sorted multimap */
+static void MultimapMatch(const multimap<String, String>& discoverMap, const String& name, vector<Entry>& matches)
+{
+    multimap<String, String>::const_iterator dit = discoverMap.lower_bound(name.substr(0, 1));
+    while ((dit != discoverMap.end()) && (dit->first.compare(name) <= 0)) {
+        if (name.compare(0, dit->first.size(), dit->first) == 0) {
+            matches.push_back(*dit);
+        }
+        ++dit;
+    }
+}
+
+/* Well-known names with a common reverse domain so prefixes share long runs */
+static String MakeName(unsigned long i)
+{
+    return String("org.alljoyn.test.app") + U32ToString(i % 97) + ".svc" + U32ToString(i % 13) + ".inst" + U32ToString(i);
+}
+
+int main(int argc, char** argv)
+{
+    unsigned long numPrefixes = 500;
+    unsigned long numNames = 5000;
+    unsigned long numRounds = 10;
+    unsigned long failures = 0;
+
+    for (int i = 1; i < argc; ++i) {
+        if (0 == strcmp("-h", argv[i])) {
+            usage();
+            exit(0);
+        } else if ((0 == strcmp("-p", argv[i])) || (0 == strcmp("-n", argv[i])) || (0 == strcmp("-r", argv[i]))) {
+            if ((i + 1) == argc) {
+                printf("option %s requires a parameter\n", argv[i]);
+                usage();
+                exit(1);
+            }
+            unsigned long val = strtoul(argv[i + 1], NULL, 10);
+            switch (argv[i][1]) {
+            case 'p': numPrefixes = val ? val : 1; break;
+
+            case 'n': numNames = val ? val : 1; break;
+
+            case 'r': numRounds = val ? val : 1; break;
+            }
+            ++i;
+        } else {
+            printf("Unknown option %s\n", argv[i]);
+            usage();
+            exit(1);
+        }
+    }
+
+    /* Basic operations */
+    {
+        PrefixTrie<String> trie;
+        trie.Insert("org.alljoyn", ":1.1");
+        trie.Insert("org.alljoyn.test", ":1.2");
+        trie.Insert("org.alljoyn.test", ":1.3");
+        trie.Insert("org.alljoin", ":1.4");
+        trie.Insert("com", ":1.5");
+
+        vector<Entry> matches;
+        trie.Match("org.alljoyn.test.foo", matches);
+        if ((matches.size() != 3) || (matches[0].first != "org.alljoyn") || (matches[2].first != "org.alljoyn.test")) {
+            printf("Match returned %u entries\n", (uint32_t)matches.size());
+            ++failures;
+        }
+        if (!trie.Contains("org.alljoyn.test", ":1.3") || trie.Contains("org.alljoyn.tes", ":1.3") || (trie.Count("org.all") != 0)) {
+            printf("Contains or Count failed\n");
+            ++failures;
+        }
+        if (trie.Erase("org.alljoyn", ":1.2") || !trie.Erase("org.alljoyn", ":1.1") || (trie.Size() != 4)) {
+            printf("Erase failed\n");
+            ++failures;
+        }
+        matches.clear();
+        trie.Match("org.alljoin", matches);
+        if ((matches.size() != 1) || (matches[0].second != ":1.4")) {
+            printf("Match after erase returned %u entries\n", (uint32_t)matches.size());
+            ++failures;
+        }
+        trie.Erase("org.alljoyn.test", ":1.2");
+        trie.Erase("org.alljoyn.test", ":1.3");
+        trie.Erase("org.alljoin", ":1.4");
+        trie.Erase("com", ":1.5");
+        vector<Entry> all;
+        trie.GetAll(all);
+        if (!trie.Empty() || !all.empty()) {
+            printf("Trie not empty after erasing all entries\n");
+            ++failures;
+        }
+    }
+
+    /* Prefixes are truncations of the names the discoverers are looking for */
+    vector<String> names;
+    for (unsigned long n = 0; n < numNames; ++n) {
+        names.push_back(MakeName(n));
+    }
+    PrefixTrie<String> trie;
+    multimap<String, String> discoverMap;
+    vector<pair<String, String> > finds;
+    for (unsigned long p = 0; p < numPrefixes; ++p) {
+        const String& name = names[(p * 7919) % numNames];
+        String prefix = name.substr(0, 21 + (p % (name.size() - 20)));
+        String sender = String(":1.") + U32ToString(p);
+        finds.push_back(pair<String, String>(prefix, sender));
+    }
+
+    uint32_t start = GetTimestamp();
+    for (size_t f = 0; f < finds.size(); ++f) {
+        trie.Insert(finds[f].first, finds[f].second);
+    }
+    uint32_t trieAddTime = GetTimestamp() - start;
+    for (size_t f = 0; f < finds.size(); ++f) {
+        discoverMap.insert(finds[f]);
+    }
+
+    /* Both must produce the same matches for every found name */
+    vector<Entry> trieMatches;
+    vector<Entry> mapMatches;
+    for (unsigned long n = 0; n < numNames; ++n) {
+        trieMatches.clear();
+        mapMatches.clear();
+        trie.Match(names[n], trieMatches);
+        MultimapMatch(discoverMap, names[n], mapMatches);
+        sort(trieMatches.begin(), trieMatches.end());
+        sort(mapMatches.begin(), mapMatches.end());
+        if (trieMatches != mapMatches) {
+            if (failures < 10) {
+                printf("Mismatch for %s: trie found %u, multimap found %u\n", names[n].c_str(), (uint32_t)trieMatches.size(), (uint32_t)mapMatches.size());
+            }
+            ++failures;
+        }
+    }
+
+    /* Synthetic FoundNames calls */
+    unsigned long trieFound = 0;
+    start = GetTimestamp();
+    for (unsigned long r = 0; r < numRounds; ++r) {
+        for (unsigned long n = 0; n < numNames; ++n) {
+            trieMatches.clear();
+            trie.Match(names[n], trieMatches);
+            trieFound += trieMatches.size();
+        }
+    }
+    uint32_t trieTime = GetTimestamp() - start;
+
+    unsigned long mapFound = 0;
+    start = GetTimestamp();
+    for (unsigned long r = 0; r < numRounds; ++r) {
+        for (unsigned long n = 0; n < numNames; ++n) {
+            mapMatches.clear();
+            MultimapMatch(discoverMap, names[n], mapMatches);
+            mapFound += mapMatches.size();
+        }
+    }
+    uint32_t mapTime = GetTimestamp() - start;
+
+    /* Cancel every find */
+    start = GetTimestamp();
+    for (size_t f = 0; f < finds.size(); ++f) {
+        if (!trie.Erase(finds[f].first, finds[f].second)) {
+            ++failures;
+        }
+    }
+    uint32_t trieRemoveTime = GetTimestamp() - start;
+    if (!trie.Empty()) {
+        printf("Expected empty trie after cancel, found %u entries\n", (uint32_t)trie.Size());
+        ++failures;
+    }
+
+    printf("%lu prefixes, %lu names, %lu rounds\n", numPrefixes, numNames, numRounds);
+    printf("Trie add:             %u ms\n", trieAddTime);
+    printf("Trie match:           %u ms (%lu matches)\n", trieTime, trieFound);
+    printf("Multimap match:       %u ms (%lu matches)\n", mapTime, mapFound);
+    printf("Trie remove:          %u ms\n", trieRemoveTime);
+    printf("Failures:             %lu\n", failures);
+
+    return failures ? 1 : 0;
+}
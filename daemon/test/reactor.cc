@@ -0,0 +1,360 @@
+/**
+ * @file
+ *
+ * Scaling benchmark for daemon endpoints serviced by per-endpoint rx/tx threads or by the
+ * EndpointReactor.
+ */
+
+/******************************************************************************
+ * Copyright 2011, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+
+#include <qcc/platform.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include <sys/resource.h>
+#include <sys/socket.h>
+
+#include <qcc/Environ.h>
+#include <qcc/Socket.h>
+#include <qcc/SocketStream.h>
+#include <qcc/String.h>
+#include <qcc/StringSource.h>
+#include <qcc/StringUtil.h>
+#include <qcc/Thread.h>
+#include <qcc/time.h>
+#include <qcc/Util.h>
+
+#include <alljoyn/BusAttachment.h>
+#include <alljoyn/Message.h>
+
+#include <Status.h>
+
+#include "Bus.h"
+#include "BusController.h"
+#include "ConfigDB.h"
+#include "DaemonRouter.h"
+#include "DaemonUnixTransport.h"
+#include "RemoteEndpoint.h"
+#include "TransportList.h"
+
+#define QCC_MODULE "ALLJOYN"
+
+using namespace std;
+using namespace qcc;
+using namespace ajn;
+
+static const char benchAddr[] = "unix:abstract=alljoyn-reactor-bench";
+static const char benchSpec[] = "@alljoyn-reactor-bench";
+
+/* Client side of a connection; only authenticated, its rx and tx threads are never started */
+class BenchEndpoint : public RemoteEndpoint {
+  public:
+    BenchEndpoint(BusAttachment& bus, SocketFd sock) :
+        RemoteEndpoint(bus, false, benchAddr, stream, "bench"),
+        stream(sock)
+    {
+    }
+
+  private:
+    SocketStream stream;
+};
+
+class BenchMessage : public _Message {
+  public:
+    BenchMessage(BusAttachment& bus) : _Message(bus) { }
+
+    QStatus Ping(uint32_t& serial)
+    {
+        return CallMsg("", "org.freedesktop.DBus", 0, "/", "org.freedesktop.DBus.Peer", "Ping", serial, NULL, 0, 0);
+    }
+
+    QStatus Unmarshal(RemoteEndpoint& ep)
+    {
+        return _Message::Unmarshal(ep, false);
+    }
+
+    QStatus Deliver(RemoteEndpoint& ep)
+    {
+        return _Message::Deliver(ep);
+    }
+};
+
+/* Same credentials handshake as UnixTransport::Connect() */
+static QStatus SendCreds(SocketFd sock)
+{
+    char nulbuf = 0;
+    struct iovec iov[] = { { &nulbuf, sizeof(nulbuf) } };
+    char cbuf[CMSG_SPACE(sizeof(struct ucred))];
+    ::memset(cbuf, 0, sizeof(cbuf));
+    struct msghdr msg;
+    msg.msg_name = NULL;
+    msg.msg_namelen = 0;
+    msg.msg_iov = iov;
+    msg.msg_iovlen = ArraySize(iov);
+    msg.msg_control = cbuf;
+    msg.msg_controllen = ArraySize(cbuf);
+    msg.msg_flags = 0;
+
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_CREDENTIALS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(struct ucred));
+    struct ucred* cred = reinterpret_cast<struct ucred*>(CMSG_DATA(cmsg));
+    cred->uid = GetUid();
+    cred->gid = GetGid();
+    cred->pid = GetPid();
+
+    return (sendmsg(sock, &msg, 0) == 1) ? ER_OK : ER_OS_ERROR;
+}
+
+/* Read a "Name: value" line from /proc/self/status */
+static unsigned long ProcStatus(const char* name)
+{
+    unsigned long val = 0;
+    char line[256];
+    size_t len = strlen(name);
+    FILE* fp = fopen("/proc/self/status", "r");
+    if (fp) {
+        while (fgets(line, sizeof(line), fp)) {
+            if ((strncmp(line, name, len) == 0) && (line[len] == ':')) {
+                val = strtoul(line + len + 1, NULL, 10);
+                break;
+            }
+        }
+        fclose(fp);
+    }
+    return val;
+}
+
+static size_t NumBusNames(Bus& bus)
+{
+    vector<qcc::String> names;
+    reinterpret_cast<DaemonRouter&>(bus.GetInternal().GetRouter()).GetBusNames(names);
+    return names.size();
+}
+
+static void RunBenchmark(Bus& bus, BusAttachment& clientBus, unsigned long numConns, unsigned long numCalls, unsigned long numRounds)
+{
+    vector<BenchEndpoint*> eps;
+    unsigned long baseThreads = ProcStatus("Threads");
+    unsigned long baseRss = ProcStatus("VmRSS");
+    size_t baseNames = NumBusNames(bus);
+    QStatus status = ER_OK;
+
+    /* Connect and authenticate */
+    uint32_t start = GetTimestamp();
+    for (unsigned long i = 0; (status == ER_OK) && (i < numConns); ++i) {
+        SocketFd sock;
+        status = Socket(QCC_AF_UNIX, QCC_SOCK_STREAM, sock);
+        if (status == ER_OK) {
+            status = qcc::Connect(sock, benchSpec);
+            if (status == ER_OK) {
+                status = SendCreds(sock);
+            }
+            if (status != ER_OK) {
+                qcc::Close(sock);
+            }
+        }
+        if (status == ER_OK) {
+            BenchEndpoint* ep = new BenchEndpoint(clientBus, sock);
+            ep->GetFeatures().isBusToBus = false;
+            ep->GetFeatures().allowRemote = false;
+            ep->GetFeatures().handlePassing = true;
+            qcc::String authName;
+            status = ep->Establish("EXTERNAL", authName);
+            if (status == ER_OK) {
+                eps.push_back(ep);
+            } else {
+                delete ep;
+            }
+        }
+        if (status != ER_OK) {
+            printf("Connection %lu failed: %s\n", i, QCC_StatusText(status));
+        }
+    }
+    uint32_t connectTime = GetTimestamp() - start;
+
+    /* Give the daemon a moment to settle before sampling */
+    qcc::Sleep(500);
+    unsigned long idleThreads = ProcStatus("Threads") - baseThreads;
+    unsigned long idleRss = ProcStatus("VmRSS") - baseRss;
+
+    /* Active: every connection pings the daemon, all connections in flight at once */
+    unsigned long calls = 0;
+    unsigned long failures = 0;
+    start = GetTimestamp();
+    for (unsigned long r = 0; r < numRounds; ++r) {
+        for (size_t i = 0; i < eps.size(); ++i) {
+            for (unsigned long c = 0; c < numCalls; ++c) {
+                BenchMessage call(clientBus);
+                uint32_t serial;
+                status = call.Ping(serial);
+                if (status == ER_OK) {
+                    status = call.Deliver(*eps[i]);
+                }
+                if (status != ER_OK) {
+                    ++failures;
+                }
+            }
+        }
+        for (size_t i = 0; i < eps.size(); ++i) {
+            for (unsigned long c = 0; c < numCalls; ++c) {
+                BenchMessage reply(clientBus);
+                status = reply.Unmarshal(*eps[i]);
+                if ((status == ER_OK) && (reply.GetType() == MESSAGE_METHOD_RET)) {
+                    ++calls;
+                } else {
+                    ++failures;
+                }
+            }
+        }
+    }
+    uint32_t activeTime = GetTimestamp() - start;
+    unsigned long activeThreads = ProcStatus("Threads") - baseThreads;
+
+    printf("%6lu connections: connect %6u ms, idle %5lu threads %7lu kB, active %5lu threads %8lu calls/s (%lu failures)\n",
+           (unsigned long)eps.size(), connectTime, idleThreads, idleRss, activeThreads,
+           activeTime ? (calls * 1000) / activeTime : calls, failures);
+
+    /* Disconnect and wait for the daemon to tear down its side */
+    for (size_t i = 0; i < eps.size(); ++i) {
+        delete eps[i];
+    }
+    uint32_t deadline = GetTimestamp() + 30000;
+    while ((NumBusNames(bus) > baseNames) && (GetTimestamp() < deadline)) {
+        qcc::Sleep(50);
+    }
+}
+
+static void usage(void)
+{
+    printf("Usage: reactor [-h] [-n] [-t #] [-c #] [-m #] [-r #]\n\n");
+    printf("Options:\n");
+    printf("   -h    = Print this help message\n");
+    printf("   -n    = Use per-endpoint rx and tx threads instead of the reactor\n");
+    printf("   -t #  = Number of reactor threads (default = 0, one per processor)\n");
+    printf("   -c #  = Number of connections (default = run 100, 1000 and 10000)\n");
+    printf("   -m #  = Method calls per connection per round (default = 10)\n");
+    printf("   -r #  = Number of rounds (default = 5)\n");
+}
+
+int main(int argc, char** argv)
+{
+    bool useReactor = true;
+    unsigned long reactorThreads = 0;
+    unsigned long numCalls = 10;
+    unsigned long numRounds = 5;
+    vector<unsigned long> numConns;
+
+    for (int i = 1; i < argc; ++i) {
+        if (0 == strcmp("-h", argv[i])) {
+            usage();
+            exit(0);
+        } else if (0 == strcmp("-n", argv[i])) {
+            useReactor = false;
+        } else if ((0 == strcmp("-t", argv[i])) || (0 == strcmp("-c", argv[i])) ||
+                   (0 == strcmp("-m", argv[i])) || (0 == strcmp("-r", argv[i]))) {
+            if ((i + 1) == argc) {
+                printf("option %s requires a parameter\n", argv[i]);
+                usage();
+                exit(1);
+            }
+            unsigned long val = strtoul(argv[i + 1], NULL, 10);
+            switch (argv[i][1]) {
+            case 't': reactorThreads = val; break;
+
+            case 'c': numConns.push_back(val); break;
+
+            case 'm': numCalls = val; break;
+
+            case 'r': numRounds = val; break;
+            }
+            ++i;
+        } else {
+            printf("Unknown option %s\n", argv[i]);
+            usage();
+            exit(1);
+        }
+    }
+    if (numConns.empty()) {
+        numConns.push_back(100);
+        numConns.push_back(1000);
+        numConns.push_back(10000);
+    }
+
+    /* Each connection needs a client socket, a daemon socket and (with the reactor) a duplicate */
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0) {
+        rl.rlim_cur = rl.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &rl);
+        printf("File descriptor limit %lu\n", (unsigned long)rl.rlim_cur);
+    }
+
+    qcc::String config = "<busconfig>"
+                         "  <type>alljoyn</type>"
+                         "  <policy context=\"default\">"
+                         "    <allow send_interface=\"*\"/>"
+                         "    <allow receive_interface=\"*\"/>"
+                         "    <allow own=\"*\"/>"
+                         "    <allow user=\"*\"/>"
+                         "    <allow send_requested_reply=\"true\"/>"
+                         "    <allow receive_requested_reply=\"true\"/>"
+                         "  </policy>"
+                         "  <limit name=\"auth_timeout\">32768</limit>";
+    if (useReactor) {
+        config += qcc::String("  <limit name=\"reactor_threads\">") + U32ToString(reactorThreads) + "</limit>";
+    }
+    config += "</busconfig>";
+    StringSource src(config);
+    ConfigDB::GetConfigDB()->LoadSource(src);
+
+    TransportFactoryContainer cntr;
+    cntr.Add(new TransportFactory<DaemonUnixTransport>("unix", false));
+
+    QStatus status = ER_OK;
+    Bus bus("reactor", cntr, benchAddr);
+    BusController controller(bus, status);
+    if (status == ER_OK) {
+        status = bus.Start();
+    }
+    if (status == ER_OK) {
+        status = bus.StartListen(benchAddr);
+    }
+    BusAttachment clientBus("reactorclient");
+    if (status == ER_OK) {
+        status = clientBus.Start();
+    }
+    if (status != ER_OK) {
+        printf("Failed to start daemon: %s\n", QCC_StatusText(status));
+        exit(1);
+    }
+
+    printf("%s mode, %lu calls per connection per round, %lu rounds\n",
+           useReactor ? "Reactor" : "Thread-per-endpoint", numCalls, numRounds);
+    for (size_t i = 0; i < numConns.size(); ++i) {
+        RunBenchmark(bus, clientBus, numConns[i], numCalls, numRounds);
+    }
+
+    clientBus.Stop();
+    bus.StopListen(benchAddr);
+    bus.Stop();
+
+    return 0;
+}
@@ -0,0 +1,215 @@
+/**
+ * @file
+ *
+ * Benchmark comparing indexed RuleTable matching against a linear scan of all rules.
+ */
+
+/******************************************************************************
+ * Copyright 2011, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+
+#include <qcc/platform.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include <qcc/String.h>
+#include <qcc/StringUtil.h>
+#include <qcc/time.h>
+
+#include <Status.h>
+
+#include "BusEndpoint.h"
+#include "RuleTable.h"
+
+using namespace std;
+using namespace qcc;
+using namespace ajn;
+
+/* Endpoint stand-in; the rule table only uses endpoints as keys */
+class BenchEndpoint : public BusEndpoint {
+  public:
+    BenchEndpoint(const qcc::String& name) : BusEndpoint(ENDPOINT_TYPE_REMOTE), name(name) { }
+    QStatus PushMessage(Message& msg) { return ER_OK; }
+    const qcc::String& GetUniqueName() const { return name; }
+    uint32_t GetUserId() const { return 0; }
+    uint32_t GetGroupId() const { return 0; }
+    uint32_t GetProcessId() const { return 0; }
+    bool SupportsUnixIDs() const { return false; }
+    bool AllowRemoteMessages() { return true; }
+  private:
+    qcc::String name;
+};
+
+/* Linear scan equivalent to the pre-index DaemonRouter broadcast loop */
+static void LinearScan(RuleTable& table, AllJoynMessageType type, const char* sender, const char* iface,
+                       const char* member, const char* path, vector<BusEndpoint*>& eps)
+{
+    eps.clear();
+    RuleIterator it = table.Begin();
+    while (it != table.End()) {
+        if (it->second.IsMatch(type, sender, iface, member, path, "")) {
+            eps.push_back(it->first);
+            table.AdvanceToNextEndpoint(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+static void usage(void)
+{
+    printf("Usage: ruletable [-h] [-e #] [-r #] [-i #] [-s #]\n\n");
+    printf("Options:\n");
+    printf("   -h    = Print this help message\n");
+    printf("   -e #  = Number of endpoints (default = 2000)\n");
+    printf("   -r #  = Number of rules per endpoint (default = 15)\n");
+    printf("   -i #  = Number of distinct interfaces (default = 200)\n");
+    printf("   -s #  = Number of signals to route (default = 2000)\n");
+}
+
+int main(int argc, char** argv)
+{
+    unsigned long numEndpoints = 2000;
+    unsigned long rulesPerEndpoint = 15;
+    unsigned long numIfaces = 200;
+    unsigned long numSignals = 2000;
+
+    for (int i = 1; i < argc; ++i) {
+        if (0 == strcmp("-h", argv[i])) {
+            usage();
+            exit(0);
+        } else if ((0 == strcmp("-e", argv[i])) || (0 == strcmp("-r", argv[i])) ||
+                   (0 == strcmp("-i", argv[i])) || (0 == strcmp("-s", argv[i]))) {
+            if ((i + 1) == argc) {
+                printf("option %s requires a parameter\n", argv[i]);
+                usage();
+                exit(1);
+            }
+            unsigned long val = strtoul(argv[i + 1], NULL, 10);
+            switch (argv[i][1]) {
+            case 'e': numEndpoints = val; break;
+
+            case 'r': rulesPerEndpoint = val; break;
+
+            case 'i': numIfaces = val ? val : 1; break;
+
+            case 's': numSignals = val; break;
+            }
+            ++i;
+        } else {
+            printf("Unknown option %s\n", argv[i]);
+            usage();
+            exit(1);
+        }
+    }
+
+    RuleTable table;
+    vector<BenchEndpoint*> endpoints;
+    uint32_t seed = 1;
+
+    /*
+     * Most rules select an interface and member; some also select a sender and a few are broad
+     * (interface-only or type-only) which is roughly what we see from real applications.
+     */
+    for (unsigned long e = 0; e < numEndpoints; ++e) {
+        BenchEndpoint* ep = new BenchEndpoint(qcc::String(":1.") + U32ToString(e));
+        endpoints.push_back(ep);
+        for (unsigned long r = 0; r < rulesPerEndpoint; ++r) {
+            seed = seed * 1103515245 + 12345;
+            uint32_t ifc = (seed >> 8) % numIfaces;
+            qcc::String spec = qcc::String("type='signal',interface='org.test.Iface") + U32ToString(ifc) + "'";
+            switch ((seed >> 4) % 8) {
+            case 0:
+                break;
+
+            case 1:
+                spec = "type='signal'";
+                break;
+
+            case 2:
+                spec += qcc::String(",sender=':1.") + U32ToString((seed >> 12) % numEndpoints) + "'";
+
+            /* Fall through */
+            default:
+                spec += qcc::String(",member='Signal") + U32ToString((seed >> 16) % 16) + "'";
+                break;
+            }
+            QStatus status;
+            Rule rule(spec.c_str(), &status);
+            if (status == ER_OK) {
+                table.AddRule(*ep, rule);
+            }
+        }
+    }
+
+    vector<qcc::String> senders;
+    vector<qcc::String> ifaces;
+    vector<qcc::String> members;
+    for (unsigned long s = 0; s < numSignals; ++s) {
+        seed = seed * 1103515245 + 12345;
+        senders.push_back(qcc::String(":1.") + U32ToString((seed >> 4) % numEndpoints));
+        ifaces.push_back(qcc::String("org.test.Iface") + U32ToString((seed >> 8) % numIfaces));
+        members.push_back(qcc::String("Signal") + U32ToString((seed >> 16) % 16));
+    }
+
+    vector<BusEndpoint*> linearEps;
+    vector<BusEndpoint*> indexedEps;
+    unsigned long linearMatches = 0;
+    unsigned long indexedMatches = 0;
+    unsigned long mismatches = 0;
+
+    table.Lock();
+
+    uint32_t start = GetTimestamp();
+    for (unsigned long s = 0; s < numSignals; ++s) {
+        LinearScan(table, MESSAGE_SIGNAL, senders[s].c_str(), ifaces[s].c_str(), members[s].c_str(), "/org/test", linearEps);
+        linearMatches += linearEps.size();
+    }
+    uint32_t linearTime = GetTimestamp() - start;
+
+    start = GetTimestamp();
+    for (unsigned long s = 0; s < numSignals; ++s) {
+        table.FindMatchingEndpoints(MESSAGE_SIGNAL, senders[s].c_str(), ifaces[s].c_str(), members[s].c_str(), "/org/test", "", indexedEps);
+        indexedMatches += indexedEps.size();
+    }
+    uint32_t indexedTime = GetTimestamp() - start;
+
+    /* Both strategies must select exactly the same endpoints */
+    for (unsigned long s = 0; s < numSignals; ++s) {
+        LinearScan(table, MESSAGE_SIGNAL, senders[s].c_str(), ifaces[s].c_str(), members[s].c_str(), "/org/test", linearEps);
+        table.FindMatchingEndpoints(MESSAGE_SIGNAL, senders[s].c_str(), ifaces[s].c_str(), members[s].c_str(), "/org/test", "", indexedEps);
+        if (linearEps != indexedEps) {
+            ++mismatches;
+        }
+    }
+
+    table.Unlock();
+
+    printf("%lu endpoints, %lu rules per endpoint, %lu interfaces, %lu signals\n",
+           numEndpoints, rulesPerEndpoint, numIfaces, numSignals);
+    printf("Linear scan:  %u ms (%lu deliveries)\n", linearTime, linearMatches);
+    printf("Indexed:      %u ms (%lu deliveries)\n", indexedTime, indexedMatches);
+    printf("Mismatches:   %lu\n", mismatches);
+
+    for (size_t e = 0; e < endpoints.size(); ++e) {
+        table.RemoveAllRules(*endpoints[e]);
+        delete endpoints[e];
+    }
+
+    return mismatches ? 1 : 0;
+}
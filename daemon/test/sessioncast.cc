@@ -0,0 +1,205 @@
+/**
+ * @file
+ *
+ * Test and benchmark for the session multicast routing table.
+ */
+
+/******************************************************************************
+ * Copyright 2011, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+
+#include <qcc/platform.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include <qcc/String.h>
+#include <qcc/StringUtil.h>
+#include <qcc/time.h>
+
+#include <Status.h>
+
+#include "BusEndpoint.h"
+#include "SessionCastTable.h"
+
+using namespace std;
+using namespace qcc;
+using namespace ajn;
+
+/* Endpoint stand-in; the session cast table only uses endpoints as keys */
+class BenchEndpoint : public BusEndpoint {
+  public:
+    BenchEndpoint(const qcc::String& name) : BusEndpoint(ENDPOINT_TYPE_REMOTE), name(name) { }
+    QStatus PushMessage(Message& msg) { return ER_OK; }
+    const qcc::String& GetUniqueName() const { return name; }
+    uint32_t GetUserId() const { return 0; }
+    uint32_t GetGroupId() const { return 0; }
+    uint32_t GetProcessId() const { return 0; }
+    bool SupportsUnixIDs() const { return false; }
+    bool AllowRemoteMessages() { return true; }
+  private:
+    qcc::String name;
+};
+
+static void usage(void)
+{
+    printf("Usage: sessioncast [-h] [-s #] [-m #] [-b #]\n\n");
+    printf("Options:\n");
+    printf("   -h    = Print this help message\n");
+    printf("   -s #  = Number of sessions (default = 5000)\n");
+    printf("   -m #  = Number of members per session (default = 8)\n");
+    printf("   -b #  = Number of bus-to-bus endpoints (default = 64)\n");
+}
+
+int main(int argc, char** argv)
+{
+    unsigned long numSessions = 5000;
+    unsigned long numMembers = 8;
+    unsigned long numB2bEps = 64;
+    unsigned long failures = 0;
+
+    for (int i = 1; i < argc; ++i) {
+        if (0 == strcmp("-h", argv[i])) {
+            usage();
+            exit(0);
+        } else if ((0 == strcmp("-s", argv[i])) || (0 == strcmp("-m", argv[i])) || (0 == strcmp("-b", argv[i]))) {
+            if ((i + 1) == argc) {
+                printf("option %s requires a parameter\n", argv[i]);
+                usage();
+                exit(1);
+            }
+            unsigned long val = strtoul(argv[i + 1], NULL, 10);
+            switch (argv[i][1]) {
+            case 's': numSessions = val ? val : 1; break;
+
+            case 'm': numMembers = (val > 1) ? val : 2; break;
+
+            case 'b': numB2bEps = val ? val : 1; break;
+            }
+            ++i;
+        } else {
+            printf("Unknown option %s\n", argv[i]);
+            usage();
+            exit(1);
+        }
+    }
+
+    SessionCastTable table;
+    vector<BenchEndpoint*> b2bEps;
+    vector<BenchEndpoint*> members;
+
+    for (unsigned long b = 0; b < numB2bEps; ++b) {
+        b2bEps.push_back(new BenchEndpoint(qcc::String(":b2b.") + U32ToString(b)));
+    }
+
+    /*
+     * Member 0 of every session is local, the others are remote and reached through one of the
+     * bus-to-bus endpoints. Routes are added in both directions like DaemonRouter::AddSessionRoute.
+     */
+    uint32_t start = GetTimestamp();
+    for (unsigned long s = 0; s < numSessions; ++s) {
+        SessionId id = s + 1;
+        size_t first = members.size();
+        for (unsigned long m = 0; m < numMembers; ++m) {
+            members.push_back(new BenchEndpoint(qcc::String(":1.") + U32ToString(s) + "." + U32ToString(m)));
+        }
+        BenchEndpoint* host = members[first];
+        for (unsigned long m = 1; m < numMembers; ++m) {
+            BusEndpoint* b2bEp = b2bEps[(s + m) % numB2bEps];
+            table.Add(id, host->GetUniqueName(), b2bEp, members[first + m]);
+            table.Add(id, members[first + m]->GetUniqueName(), NULL, host);
+        }
+    }
+    uint32_t addTime = GetTimestamp() - start;
+
+    size_t expected = numSessions * (numMembers - 1) * 2;
+    if (table.Size() != expected) {
+        printf("Expected %u routes after add, found %u\n", (uint32_t)expected, (uint32_t)table.Size());
+        ++failures;
+    }
+
+    /* The host must reach each distinct bus-to-bus endpoint exactly once */
+    unsigned long numSends = 0;
+    vector<BusEndpoint*> dests;
+    start = GetTimestamp();
+    for (unsigned long s = 0; s < numSessions; ++s) {
+        dests.clear();
+        table.GetDestinations(s + 1, members[s * numMembers]->GetUniqueName().c_str(), dests);
+        size_t distinct = (numMembers - 1 < numB2bEps) ? (numMembers - 1) : numB2bEps;
+        if (dests.size() != distinct) {
+            ++failures;
+        }
+        for (size_t d = 0; d < dests.size(); ++d) {
+            dests[d]->DecrementRouteRef();
+        }
+        numSends += dests.size();
+    }
+    uint32_t sendTime = GetTimestamp() - start;
+
+    /* Tear down one bus-to-bus endpoint */
+    start = GetTimestamp();
+    table.RemoveB2bEndpoint(b2bEps[0]);
+    uint32_t b2bTime = GetTimestamp() - start;
+
+    size_t viaB2b0 = 0;
+    for (unsigned long s = 0; s < numSessions; ++s) {
+        for (unsigned long m = 1; m < numMembers; ++m) {
+            if (((s + m) % numB2bEps) == 0) {
+                ++viaB2b0;
+            }
+        }
+    }
+    expected -= viaB2b0;
+    if (table.Size() != expected) {
+        printf("Expected %u routes after bus-to-bus teardown, found %u\n", (uint32_t)expected, (uint32_t)table.Size());
+        ++failures;
+    }
+
+    /* Tear down the hosts of every session */
+    vector<SessionCastTable::RemovedRoute> removed;
+    start = GetTimestamp();
+    for (unsigned long s = 0; s < numSessions; ++s) {
+        BenchEndpoint* host = members[s * numMembers];
+        table.RemoveRoutes(host->GetUniqueName(), host, 0, removed);
+    }
+    uint32_t hostTime = GetTimestamp() - start;
+
+    if (table.Size() != 0) {
+        printf("Expected no routes after host teardown, found %u\n", (uint32_t)table.Size());
+        ++failures;
+    }
+    if (removed.size() != (numSessions * (numMembers - 1) * 2) - viaB2b0) {
+        printf("Expected %u removed routes, found %u\n", (uint32_t)((numSessions * (numMembers - 1) * 2) - viaB2b0), (uint32_t)removed.size());
+        ++failures;
+    }
+
+    printf("%lu sessions, %lu members per session, %lu bus-to-bus endpoints\n", numSessions, numMembers, numB2bEps);
+    printf("Add:                  %u ms\n", addTime);
+    printf("Lookup:               %u ms (%lu sends)\n", sendTime, numSends);
+    printf("Bus-to-bus teardown:  %u ms (%u routes)\n", b2bTime, (uint32_t)viaB2b0);
+    printf("Host teardown:        %u ms\n", hostTime);
+    printf("Failures:             %lu\n", failures);
+
+    for (size_t m = 0; m < members.size(); ++m) {
+        delete members[m];
+    }
+    for (size_t b = 0; b < b2bEps.size(); ++b) {
+        delete b2bEps[b];
+    }
+
+    return failures ? 1 : 0;
+}
@@ -48,6 +48,8 @@ static const uint8_t PROP_ACCESS_RW    = 3; /**< Read-Write Access type */
 // @{
 static const uint8_t MEMBER_ANNOTATE_NO_REPLY   = 1; /**< No reply annotate flag */
 static const uint8_t MEMBER_ANNOTATE_DEPRECATED = 2; /**< Deprecated annotate flag */
+static const uint8_t MEMBER_ANNOTATE_LAZY_ARGS  = 4; /**< Local handlers read the args with a MsgCursor, not included in introspection. The args
+                                                            are unmarshaled under the message lock the first time GetArgs() is called. */
 // @}
 
 /**
@@ -88,7 +90,7 @@ class InterfaceDescription {
         qcc::String signature;               /**< Method call IN arguments (NULL for signals) */
         qcc::String returnSignature;         /**< Signal or method call OUT arguments */
         qcc::String argNames;                /**< Comma separated list of argument names - can be NULL */
-        uint8_t annotation;                  /**< Exclusive OR of flags MEMBER_ANNOTATE_NO_REPLY and MEMBER_ANNOTATE_DEPRECATED */
+        uint8_t annotation;                  /**< Exclusive OR of flags MEMBER_ANNOTATE_NO_REPLY, MEMBER_ANNOTATE_DEPRECATED and MEMBER_ANNOTATE_LAZY_ARGS */
         qcc::String accessPerms;              /**< Required permissions to invoke this call */
 
         /** %Member constructor */
@@ -109,8 +111,10 @@ class InterfaceDescription {
          * @return    true iff o == this member.
          */
         bool operator==(const Member& o) const {
+            /* MEMBER_ANNOTATE_LAZY_ARGS only affects local dispatch so is ignored */
             return ((memberType == o.memberType) && (name == o.name) && (signature == o.signature)
-                    && (returnSignature == o.returnSignature) && (annotation == o.annotation));
+                    && (returnSignature == o.returnSignature)
+                    && ((annotation & ~MEMBER_ANNOTATE_LAZY_ARGS) == (o.annotation & ~MEMBER_ANNOTATE_LAZY_ARGS)));
         }
     };
 
@@ -28,11 +28,17 @@
 #include <qcc/platform.h>
 #include <qcc/String.h>
 #include <qcc/ManagedObj.h>
+#include <qcc/Mutex.h>
 
 #include <alljoyn/MsgArg.h>
 #include <alljoyn/Session.h>
 #include <Status.h>
 
+namespace qcc {
+/** @internal Forward references */
+class Sink;
+}
+
 namespace ajn {
 
 static const size_t ALLJOYN_MAX_NAME_LEN   =     255;  /*!<  The maximum length of certain bus names */
@@ -152,6 +158,8 @@ class HeaderFields {
  */
 class _Message;
 class BusAttachment;
+class MsgCursor;
+class SignaturePlan;
 
 /**
  * Message is a reference counted (managed) version of _Message
@@ -167,6 +175,7 @@ class _Message {
 
     friend class BusObject;
     friend class ProxyBusObject;
+    friend class MethodCallBatch;
     friend class RemoteEndpoint;
     friend class EndpointAuth;
     friend class LocalEndpoint;
@@ -258,8 +267,23 @@ class _Message {
      *
      * @param[out] args  Returns the arguments
      * @param[out] numArgs The number of arguments
-     */
-    void GetArgs(size_t& numArgs, const MsgArg*& args) { args = msgArgs; numArgs = numMsgArgs; }
+     *
+     * @return
+     *      - #ER_OK if the arguments were unmarshaled.
+     *      - An error status if the arguments of a lazily unmarshaled message could not be
+     *        unmarshaled, no arguments are returned in this case.
+     */
+    QStatus GetArgs(size_t& numArgs, const MsgArg*& args) {
+        QStatus status = ParseLazyArgs();
+        if (status == ER_OK) {
+            args = msgArgs;
+            numArgs = numMsgArgs;
+        } else {
+            args = NULL;
+            numArgs = 0;
+        }
+        return status;
+    }
 
     /**
      * Return a specific argument.
@@ -270,7 +294,10 @@ class _Message {
      *      - The argument
      *      - NULL if unmarshal failed or there is not such argument.
      */
-    const MsgArg* GetArg(size_t argN = 0) { return (argN < numMsgArgs) ? &msgArgs[argN] : NULL; }
+    const MsgArg* GetArg(size_t argN = 0) {
+        QStatus status = ParseLazyArgs();
+        return ((status == ER_OK) && (argN < numMsgArgs)) ? &msgArgs[argN] : NULL;
+    }
 
     /**
      * Unpack and return the arguments for this message. This method uses the functionality from
@@ -282,6 +309,29 @@ class _Message {
      */
     QStatus GetArgs(const char* signature, ...);
 
+    /**
+     * Get a cursor for reading the arguments for this message directly from the message buffer.
+     * Unlike GetArgs() this does not allocate anything, so a handler that only needs a few of the
+     * values in a large message can read just those. See MsgCursor.h for details.
+     *
+     * Method and signal handlers for members annotated with #MEMBER_ANNOTATE_LAZY_ARGS are called
+     * before the arguments have been unmarshaled. For these messages the arguments are only
+     * unmarshaled into MsgArgs if GetArgs() or GetArg() is called. A body that is not in native
+     * byte order is unmarshaled before the first cursor is returned so the body is never changed
+     * under a cursor by a later call to GetArgs() or GetArg().
+     *
+     * A cursor is invalidated if the message is re-marshaled, encrypted or sent because the body
+     * may be moved.
+     *
+     * @param[out] cursor  Returns a cursor positioned at the first argument.
+     *
+     * @return
+     *      - #ER_OK if the cursor was initialized.
+     *      - #ER_FAIL if this is not a received message or UnmarshalArgs() has not been called.
+     *      - An error status if the arguments could not be unmarshaled.
+     */
+    QStatus GetBodyCursor(MsgCursor& cursor);
+
     /**
      * Accessor function to get serial number for the message. Usually only important for
      * #MESSAGE_METHOD_CALL for matching up the reply to the call.
@@ -613,13 +663,16 @@ class _Message {
      * @param expectedSignature       The expected signature for this message.
      * @param expectedReplySignature  The expected reply signature for this message if it is a
      *                                method call message or NULL otherwise.
+     * @param lazy                    If true the signature is checked and the body decrypted but
+     *                                the arguments are not unmarshaled until they are asked for.
      *
      * @return
      *         - #ER_OK if the message was unmarshaled
      *         - Error status indicating why the unmarshal failed.
      */
     QStatus UnmarshalArgs(const qcc::String& expectedSignature,
-                          const char* expectedReplySignature = NULL);
+                          const char* expectedReplySignature = NULL,
+                          bool lazy = false);
 
     /**
      * @internal
@@ -647,6 +700,19 @@ class _Message {
      */
     QStatus Deliver(RemoteEndpoint& endpoint);
 
+    /**
+     * @internal
+     * Deliver a marshaled message for an endpoint to a specific sink rather than the endpoint's
+     * own sink. This is used to coalesce several messages into a single write.
+     *
+     * @param endpoint   Endpoint the marshaled message is for.
+     * @param sink       Sink to receive the marshaled message.
+     * @return
+     *      - #ER_OK if successful
+     *      - An error status otherwise
+     */
+    QStatus Deliver(RemoteEndpoint& endpoint, qcc::Sink& sink);
+
     /**
      * @internal
      */
@@ -738,12 +804,20 @@ class _Message {
     uint64_t* msgBuf;            ///< Pointer to the current msg buffer (uint64_t to ensure 8 byte alignment).
     MsgArg* msgArgs;             ///< Pointer to the unmarshaled arguments.
     uint8_t numMsgArgs;          ///< Number of message args (signature cannot be longer than 255 chars).
+    bool lazyArgs;               ///< True if the body has been validated but the args not yet unmarshaled.
+    QStatus parseStatus;         ///< Status from unmarshaling the args.
 
     size_t bufSize;              ///< The current allocated size of the msg buffer.
     uint8_t* bufEOD;             ///< End of data currently in buffer.
     uint8_t* bufPos;             ///< Pointer to the position in buffer.
     uint8_t* bodyPtr;            ///< Pointer to start of message body.
 
+    struct BodyBuf;
+    BodyBuf* bodyBuf;            ///< Shared buffer holding the body if it is not in msgBuf (see ReMarshal).
+
+    const SignaturePlan* sigPlan; ///< Compiled plan for the signature being unmarshaled (can be NULL).
+    const char* sigPlanBase;     ///< The signature string the plan is being applied to.
+
     uint16_t ttl;                ///< Time to live
     uint32_t timestamp;          ///< Timestamp (local time) for messages with a ttl.
 
@@ -756,6 +830,7 @@ class _Message {
     qcc::SocketFd* handles;      ///< Array of file/socket descriptors.
     size_t numHandles;           ///< Number of handles in the handles array
     bool encrypt;                ///< True if the message is to be encrypted
+    qcc::Mutex bufLock;          ///< Serializes in place changes: encryption of a message queued to several endpoints and lazy unmarshaling of the args
 
     /**
      * The header fields for this message. Which header fields are present depends on the message
@@ -766,6 +841,15 @@ class _Message {
     /* Internal methods unmarshal side */
 
     void ClearHeader();
+    QStatus ParseArgs();
+
+    /**
+     * Unmarshal the args of a lazily unmarshaled message if that has not been done yet. Several
+     * threads holding the same message can call this at the same time.
+     *
+     * @return  The status from unmarshaling the args.
+     */
+    QStatus ParseLazyArgs();
     QStatus ParseValue(MsgArg* arg, const char*& sigPtr);
     QStatus ParseStruct(MsgArg* arg, const char*& sigPtr);
     QStatus ParseDictEntry(MsgArg* arg, const char*& sigPtr);
@@ -801,6 +885,29 @@ class _Message {
     void MarshalHeaderFields();
     size_t ComputeHeaderLen();
 
+    /**
+     * Marshal the header into a new message buffer. Unless joinBody is true the body is not
+     * copied, instead it is left in (or moved into) a reference counted buffer that is shared with
+     * any copies of this message.
+     *
+     * @param joinBody  If true the body is copied into the new buffer after the header.
+     */
+    void MarshalHeader(bool joinBody);
+
+    /**
+     * Copy a shared body back into the message buffer so the header and body are contiguous as
+     * required to encrypt, decrypt or endian swap the body in place. Unmarshaled message args and
+     * body cursors must not be held when this is called because they may point into the shared body.
+     */
+    void JoinBody() { if (bodyBuf) { MarshalHeader(true); } }
+
+    /**
+     * Release a reference to a shared body buffer.
+     *
+     * @param body  The body buffer, can be NULL.
+     */
+    static void ReleaseBody(BodyBuf* body);
+
     /**
      * Get string representation of the message
      * @return string representation of the message
@@ -0,0 +1,213 @@
+#ifndef _ALLJOYN_METHODCALLBATCH_H
+#define _ALLJOYN_METHODCALLBATCH_H
+/**
+ * @file
+ * This file defines the class MethodCallBatch.
+ * A MethodCallBatch pipelines method calls on one or more ProxyBusObjects and collects the
+ * replies when the whole batch has completed.
+ */
+
+/******************************************************************************
+ * Copyright 2011, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+
+#include <qcc/platform.h>
+#include <alljoyn/InterfaceDescription.h>
+#include <alljoyn/Message.h>
+#include <alljoyn/MsgArg.h>
+#include <alljoyn/ProxyBusObject.h>
+
+#include <Status.h>
+
+namespace ajn {
+
+/** @internal Forward references */
+class BusAttachment;
+
+/**
+ * A %MethodCallBatch issues method calls back to back without waiting for each reply. The replies
+ * are collected by the batch and can be retrieved by index once they arrive. The caller is woken
+ * up once when all outstanding calls in the batch have completed rather than once per reply.
+ *
+ * Typical usage:
+ *
+ * @code
+ * MethodCallBatch batch(bus);
+ * for (size_t i = 0; i < n; ++i) {
+ *     batch.MethodCall(proxy, *method, &args[i], 1);
+ * }
+ * batch.Wait();
+ * for (size_t i = 0; i < batch.GetCallCount(); ++i) {
+ *     Message reply(bus);
+ *     QStatus status = batch.GetReply(i, reply);
+ * }
+ * @endcode
+ */
+class MethodCallBatch {
+  public:
+
+    /**
+     * Pure virtual base class implemented by classes that wish to be told when all outstanding
+     * calls in a batch have completed instead of blocking in Wait().
+     */
+    class Listener {
+      public:
+        /**
+         * Destructor
+         */
+        virtual ~Listener() { }
+
+        /**
+         * Called when the last outstanding method call in the batch has completed. This is called
+         * on the thread that delivered the final reply so must not block. The batch may be
+         * cleared but must not be destroyed from within this callback.
+         *
+         * @param batch  The batch whose calls have all completed.
+         */
+        virtual void BatchComplete(MethodCallBatch& batch) = 0;
+    };
+
+    /**
+     * Constructor
+     *
+     * @param bus       The bus the method calls are made on.
+     * @param listener  Optional listener to be called each time all outstanding calls have completed.
+     */
+    MethodCallBatch(BusAttachment& bus, Listener* listener = NULL);
+
+    /**
+     * Destructor. Any calls that are still outstanding are cancelled. Waits for a listener
+     * callback that is already running to return.
+     */
+    ~MethodCallBatch();
+
+    /**
+     * Add a method call to the batch. The method call is sent immediately without waiting for the
+     * replies to the calls that precede it.
+     *
+     * @param obj       The remote object to call.
+     * @param method    The method being invoked.
+     * @param args      The arguments for the method call (can be NULL)
+     * @param numArgs   The number of arguments
+     * @param timeout   Timeout specified in milliseconds to wait for a reply
+     * @param flags     Logical OR of the message flags for this method call as for ProxyBusObject::MethodCall().
+     * @param index     [out] Optional returns the index of the call in the batch.
+     *
+     * @return
+     *      - ER_OK if the method call was sent. The reply will be available from GetReply().
+     *      - An error status otherwise. The call is still added to the batch with an error reply.
+     */
+    QStatus MethodCall(const ProxyBusObject& obj,
+                       const InterfaceDescription::Member& method,
+                       const MsgArg* args = NULL,
+                       size_t numArgs = 0,
+                       uint32_t timeout = ProxyBusObject::DefaultCallTimeout,
+                       uint8_t flags = 0,
+                       size_t* index = NULL);
+
+    /**
+     * Add a method call to the batch.
+     *
+     * @param obj         The remote object to call.
+     * @param ifaceName   Name of interface.
+     * @param methodName  Name of method.
+     * @param args        The arguments for the method call (can be NULL)
+     * @param numArgs     The number of arguments
+     * @param timeout     Timeout specified in milliseconds to wait for a reply
+     * @param flags       Logical OR of the message flags for this method call as for ProxyBusObject::MethodCall().
+     * @param index       [out] Optional returns the index of the call in the batch.
+     *
+     * @return
+     *      - ER_OK if the method call was sent.
+     *      - ER_BUS_NO_SUCH_INTERFACE or ER_BUS_INTERFACE_NO_SUCH_MEMBER if the method is not known.
+     *      - An error status otherwise.
+     */
+    QStatus MethodCall(const ProxyBusObject& obj,
+                       const char* ifaceName,
+                       const char* methodName,
+                       const MsgArg* args = NULL,
+                       size_t numArgs = 0,
+                       uint32_t timeout = ProxyBusObject::DefaultCallTimeout,
+                       uint8_t flags = 0,
+                       size_t* index = NULL);
+
+    /**
+     * Wait until all calls added to the batch so far have completed. This must not be called from
+     * within a message handler for the same bus.
+     *
+     * @param timeout   Maximum time to wait in milliseconds.
+     *
+     * @return
+     *      - ER_OK if all calls have completed.
+     *      - ER_TIMEOUT if the timeout expired first.
+     *      - An error status otherwise
+     */
+    QStatus Wait(uint32_t timeout = WAIT_FOREVER);
+
+    /**
+     * Get the reply for a call in the batch.
+     *
+     * @param index   The index of the call in the batch, calls are numbered in the order they were added.
+     * @param reply   [out] Returns the method reply or error message.
+     *
+     * @return
+     *      - ER_OK if the call completed with a method reply.
+     *      - ER_BUS_REPLY_IS_ERROR_MESSAGE if the reply was an error message.
+     *      - ER_WOULDBLOCK if the call has not completed yet.
+     *      - ER_BAD_ARG_1 if there is no call with this index.
+     */
+    QStatus GetReply(size_t index, Message& reply) const;
+
+    /**
+     * Get the number of calls that have been added to the batch.
+     *
+     * @return  The number of calls.
+     */
+    size_t GetCallCount() const;
+
+    /**
+     * Get the number of calls in the batch that have not completed yet.
+     *
+     * @return  The number of outstanding calls.
+     */
+    size_t GetPendingCount() const;
+
+    /**
+     * Cancel any outstanding calls and remove all calls from the batch so it can be reused.
+     * Replies that arrive later for the cancelled calls are discarded.
+     */
+    void Clear();
+
+    /**
+     * Value for Wait() timeout to wait until all calls have completed.
+     */
+    static const uint32_t WAIT_FOREVER = static_cast<uint32_t>(-1);
+
+  private:
+
+    /* Not copyable */
+    MethodCallBatch(const MethodCallBatch& other);
+    MethodCallBatch& operator=(const MethodCallBatch& other);
+
+    struct Calls;
+
+    BusAttachment& bus;   /**< The bus the calls are made on */
+    Listener* listener;   /**< Optional listener for batch completion */
+    Calls* calls;         /**< Replies and synchronization for the calls in the batch */
+};
+
+}
+
+#endif
@@ -0,0 +1,236 @@
+#ifndef _ALLJOYN_MSGCURSOR_H
+#define _ALLJOYN_MSGCURSOR_H
+/**
+ * @file
+ * This file defines the MsgCursor class for reading message arguments in place.
+ */
+
+/******************************************************************************
+ * Copyright 2011, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+
+#ifndef __cplusplus
+#error Only include MsgCursor.h in C++ code.
+#endif
+
+#include <qcc/platform.h>
+
+#include <alljoyn/MsgArg.h>
+
+#include <Status.h>
+
+namespace ajn {
+
+/** @internal Forward references */
+class _Message;
+class SignaturePlan;
+
+/**
+ * A %MsgCursor reads the arguments of a received message directly from the message buffer. Nothing
+ * is allocated: strings, object paths and signatures are returned as pointers into the message
+ * buffer, and containers are read through a sub-cursor. Values that are not needed can be skipped
+ * over without being unmarshaled.
+ *
+ * A cursor is obtained from Message::GetBodyCursor() and is only valid while the message body is
+ * unchanged: re-marshaling, encrypting or sending the message may move the body and invalidates any
+ * cursors. Calling Message::GetArgs() or Message::GetArg() does not invalidate a cursor.
+ * Values are read in signature order. If a read fails the cursor should not be used again.
+ *
+ * For example a method handler that only needs the "Volume" entry of an a{sv} argument:
+ *
+ * @code
+ * MsgCursor args;
+ * MsgCursor val;
+ * MsgCursor var;
+ * uint32_t volume;
+ * QStatus status = msg->GetBodyCursor(args);
+ * if (status == ER_OK) {
+ *     status = args.FindEntry("Volume", val);
+ * }
+ * if (status == ER_OK) {
+ *     status = val.Recurse(var);
+ * }
+ * if (status == ER_OK) {
+ *     status = var.Get(volume);
+ * }
+ * @endcode
+ */
+class MsgCursor {
+    friend class _Message;
+
+  public:
+
+    /**
+     * Construct an empty cursor.
+     */
+    MsgCursor();
+
+    /**
+     * Check if there are any more values to read.
+     *
+     * @return  true if all values have been read.
+     */
+    bool AtEnd() const { return elemSig ? (pos >= end) : (sig >= sigEnd); }
+
+    /**
+     * Get the type of the next value.
+     *
+     * @return  The type id of the next value or ALLJOYN_INVALID if there are no more values.
+     *          Structs and dictionary entries are reported as ALLJOYN_STRUCT and ALLJOYN_DICT_ENTRY.
+     */
+    AllJoynTypeId GetTypeId() const;
+
+    /**
+     * Read the next value. Each of these methods returns ER_BUS_SIGNATURE_MISMATCH if the next
+     * value is not of the matching type.
+     *
+     * @param val  Returns the value.
+     *
+     * @return
+     *      - #ER_OK if the value was read.
+     *      - #ER_BUS_ELEMENT_NOT_FOUND if there are no more values.
+     *      - #ER_BUS_SIGNATURE_MISMATCH if the next value has a different type.
+     *      - An error status if the message data is not valid.
+     */
+    QStatus Get(uint8_t& val);
+    QStatus Get(bool& val);       /**< @copydoc Get(uint8_t&) */
+    QStatus Get(int16_t& val);    /**< @copydoc Get(uint8_t&) */
+    QStatus Get(uint16_t& val);   /**< @copydoc Get(uint8_t&) */
+    QStatus Get(int32_t& val);    /**< @copydoc Get(uint8_t&) */
+    QStatus Get(uint32_t& val);   /**< @copydoc Get(uint8_t&) */
+    QStatus Get(int64_t& val);    /**< @copydoc Get(uint8_t&) */
+    QStatus Get(uint64_t& val);   /**< @copydoc Get(uint8_t&) */
+    QStatus Get(double& val);     /**< @copydoc Get(uint8_t&) */
+
+    /**
+     * Read a string value.
+     *
+     * @param str  Returns a pointer to the NUL terminated string in the message buffer.
+     * @param len  Returns the length of the string.
+     *
+     * @return #ER_OK if the value was read or an error status as for Get().
+     */
+    QStatus GetString(const char*& str, size_t& len) { return GetStr(ALLJOYN_STRING, str, len); }
+
+    /**
+     * Read an object path value.
+     *
+     * @param path  Returns a pointer to the NUL terminated object path in the message buffer.
+     * @param len   Returns the length of the object path.
+     *
+     * @return #ER_OK if the value was read or an error status as for Get().
+     */
+    QStatus GetObjectPath(const char*& path, size_t& len) { return GetStr(ALLJOYN_OBJECT_PATH, path, len); }
+
+    /**
+     * Read a signature value.
+     *
+     * @param signature  Returns a pointer to the NUL terminated signature in the message buffer.
+     * @param len        Returns the length of the signature.
+     *
+     * @return #ER_OK if the value was read or an error status as for Get().
+     */
+    QStatus GetSignature(const char*& signature, size_t& len);
+
+    /**
+     * Read a handle value.
+     *
+     * @param fd  Returns the socket or file descriptor. This is owned by the message.
+     *
+     * @return #ER_OK if the value was read or an error status as for Get().
+     */
+    QStatus GetHandle(qcc::SocketFd& fd);
+
+    /**
+     * Read an array of bytes.
+     *
+     * @param bytes  Returns a pointer to the bytes in the message buffer.
+     * @param len    Returns the number of bytes.
+     *
+     * @return #ER_OK if the value was read or an error status as for Get().
+     */
+    QStatus GetBytes(const uint8_t*& bytes, size_t& len);
+
+    /**
+     * Get a cursor for reading the contents of the next value, which must be an array, struct,
+     * dictionary entry or variant. This cursor moves past the container.
+     *
+     * @param sub  Returns a cursor over the array elements, struct members, dictionary entry key
+     *             and value, or the value of a variant.
+     *
+     * @return #ER_OK if the container was entered or an error status as for Get().
+     */
+    QStatus Recurse(MsgCursor& sub);
+
+    /**
+     * Skip the next value without reading it.
+     *
+     * @return #ER_OK if the value was skipped or an error status as for Get().
+     */
+    QStatus Skip();
+
+    /**
+     * Look up an entry in the next value, which must be a dictionary with string or object path
+     * keys. This cursor moves past the dictionary.
+     *
+     * @param key  The key to look for.
+     * @param val  Returns a cursor positioned at the value of the matching entry.
+     *
+     * @return
+     *      - #ER_OK if the key was found.
+     *      - #ER_BUS_NOT_A_DICTIONARY if the next value is not a dictionary with string keys.
+     *      - #ER_BUS_ELEMENT_NOT_FOUND if the key was not found.
+     *      - An error status if the message data is not valid.
+     */
+    QStatus FindEntry(const char* key, MsgCursor& val);
+
+  private:
+
+    /**
+     * Constructor used by _Message and for sub-cursors.
+     */
+    MsgCursor(const char* sig, const char* sigEnd, const uint8_t* pos, const uint8_t* end, bool endianSwap,
+              const qcc::SocketFd* handles, size_t numHandles, const SignaturePlan* plan);
+
+    /* Check the next value has a fixed size type and move past it */
+    QStatus Fixed(AllJoynTypeId typeId, size_t size, const uint8_t*& val);
+
+    /* Read a string or object path */
+    QStatus GetStr(AllJoynTypeId typeId, const char*& str, size_t& len);
+
+    /* Move to the next value after one with a signature of length n */
+    void Next(size_t n);
+
+    /* Length of the complete type starting at s or 0 if the signature is not valid */
+    size_t TypeLen(const char* s) const;
+
+    /* Read a 4 byte length */
+    uint32_t Len32(const uint8_t* p) const;
+
+    const char* sig;                /**< Signature of the next value */
+    const char* sigEnd;             /**< End of the signature for this cursor */
+    const char* elemSig;            /**< Element signature if this cursor is reading array elements */
+    const uint8_t* pos;             /**< Current position in the message buffer */
+    const uint8_t* end;             /**< End of the data for this cursor */
+    bool endianSwap;                /**< True if the message data is not in native endianess */
+    const qcc::SocketFd* handles;   /**< Handles passed with the message */
+    size_t numHandles;              /**< Number of handles */
+    const SignaturePlan* plan;      /**< Compiled plan for the signature or NULL */
+    const char* planBase;           /**< The signature the plan is being applied to */
+};
+
+}
+
+#endif
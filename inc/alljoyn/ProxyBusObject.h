@@ -503,7 +503,8 @@ class ProxyBusObject : public MessageReceiver {
      *                     - If #ALLJOYN_FLAG_AUTO_START is set the bus will attempt to start a service if it is not running.
      * @return
      *      - ER_OK if successful
-     *      - An error status otherwise
+     *      - An error status otherwise. The reply handler will not be called so the caller must
+     *        release anything that context refers to.
      */
     QStatus MethodCallAsync(const InterfaceDescription::Member& method,
                             MessageReceiver* receiver,
@@ -531,7 +532,8 @@ class ProxyBusObject : public MessageReceiver {
      *                     - If #ALLJOYN_FLAG_AUTO_START is set the bus will attempt to start a service if it is not running.
      * @return
      *      - ER_OK if successful
-     *      - An error status otherwise
+     *      - An error status otherwise. The reply handler will not be called so the caller must
+     *        release anything that context refers to.
      */
     QStatus MethodCallAsync(const char* ifaceName,
                             const char* methodName,
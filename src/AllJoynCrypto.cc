@@ -41,54 +41,134 @@ namespace ajn {
 
 const size_t Crypto::ExpansionBytes = 8;
 
-static qcc::String ConcatenateCompressedFields(uint8_t* hdr, size_t hdrLen, const HeaderFields& hdrFields)
+/*
+ * Compressed messages authenticate a concatenation of the header and the compressible header
+ * fields. Concatenations up to this size are built on the stack.
+ */
+static const size_t EXT_HDR_STACK_SIZE = 512;
+
+_MessageCipher::_MessageCipher(const KeyBlob& key) : key(key), aes(NULL)
+{
+    if (key.IsValid() && (key.GetType() == KeyBlob::AES)) {
+        aes = new Crypto_AES(key, Crypto_AES::CCM);
+    }
+}
+
+/*
+ * Crypto_AES in CCM mode only reads the key schedule it expanded when it was constructed and keeps
+ * the counter and MAC blocks of each call in locals, so calls need not be serialized.
+ */
+QStatus _MessageCipher::Encrypt_CCM(const void* in, void* out, size_t& len, const KeyBlob& nonce, const void* addData, size_t addLen) const
+{
+    if (!aes) {
+        return ER_BUS_KEYBLOB_OP_INVALID;
+    }
+    return aes->Encrypt_CCM(in, out, len, nonce, addData, addLen);
+}
+
+QStatus _MessageCipher::Decrypt_CCM(const void* in, void* out, size_t& len, const KeyBlob& nonce, const void* addData, size_t addLen) const
 {
-    qcc::String result((char*)hdr, hdrLen, 256);
+    if (!aes) {
+        return ER_BUS_KEYBLOB_OP_INVALID;
+    }
+    return aes->Decrypt_CCM(in, out, len, nonce, addData, addLen);
+}
+
+/*
+ * Write the header followed by the compressible header fields to buf and return the number of
+ * bytes written. If buf is NULL only the size is returned.
+ */
+static size_t ConcatenateCompressedFields(uint8_t* buf, const uint8_t* hdr, size_t hdrLen, const HeaderFields& hdrFields)
+{
+    size_t len = hdrLen;
+    if (buf) {
+        memcpy(buf, hdr, hdrLen);
+    }
 
     for (uint32_t fieldId = ALLJOYN_HDR_FIELD_PATH; fieldId < ArraySize(hdrFields.field); fieldId++) {
         if (!HeaderFields::Compressible[fieldId]) {
             continue;
         }
         const MsgArg* field = &hdrFields.field[fieldId];
-        char buf[8];
+        uint8_t fieldHdr[6];
         size_t pos = 0;
-        buf[pos++] = (char)fieldId;
-        buf[pos++] = (char)field->typeId;
+        const void* val = NULL;
+        size_t valLen = 0;
+        fieldHdr[pos++] = (uint8_t)fieldId;
+        fieldHdr[pos++] = (uint8_t)field->typeId;
         switch (field->typeId) {
         case ALLJOYN_SIGNATURE:
-            result.append(buf, pos);
-            result.append(field->v_signature.sig, field->v_signature.len);
+            val = field->v_signature.sig;
+            valLen = field->v_signature.len;
             break;
 
         case ALLJOYN_OBJECT_PATH:
         case ALLJOYN_STRING:
-            result.append(buf, pos);
-            result.append(field->v_string.str, field->v_string.len);
+            val = field->v_string.str;
+            valLen = field->v_string.len;
             break;
 
         case ALLJOYN_UINT32:
             /* Write integer as little endian */
-            buf[pos++] = (char)(field->v_uint32 >> 0);
-            buf[pos++] = (char)(field->v_uint32 >> 8);
-            buf[pos++] = (char)(field->v_uint32 >> 16);
-            buf[pos++] = (char)(field->v_uint32 >> 24);
-            result.append(buf, pos);
+            fieldHdr[pos++] = (uint8_t)(field->v_uint32 >> 0);
+            fieldHdr[pos++] = (uint8_t)(field->v_uint32 >> 8);
+            fieldHdr[pos++] = (uint8_t)(field->v_uint32 >> 16);
+            fieldHdr[pos++] = (uint8_t)(field->v_uint32 >> 24);
             break;
 
         default:
-            break;
+            continue;
+        }
+        if (buf) {
+            memcpy(buf + len, fieldHdr, pos);
+            if (valLen) {
+                memcpy(buf + len + pos, val, valLen);
+            }
+        }
+        len += pos + valLen;
+    }
+    return len;
+}
+
+/*
+ * Encrypt or decrypt the body of a message in place. To prevent an attack where the attacker sends
+ * a bogus expansion rule we authenticate the compressed headers of a compressed message even
+ * though they are not sent.
+ */
+static QStatus MessageCCM(const _MessageCipher& cipher, bool encrypt, const _Message& message, uint8_t* msgBuf, size_t hdrLen, size_t& bodyLen, const KeyBlob& nonce)
+{
+    uint8_t* body = msgBuf + hdrLen;
+    if (!(message.GetFlags() & ALLJOYN_FLAG_COMPRESSED)) {
+        if (encrypt) {
+            return cipher.Encrypt_CCM(body, body, bodyLen, nonce, msgBuf, hdrLen);
+        } else {
+            return cipher.Decrypt_CCM(body, body, bodyLen, nonce, msgBuf, hdrLen);
         }
     }
-    return result;
+
+    uint8_t stackBuf[EXT_HDR_STACK_SIZE];
+    size_t extLen = ConcatenateCompressedFields(NULL, msgBuf, hdrLen, message.GetHeaderFields());
+    uint8_t* extHdr = (extLen <= sizeof(stackBuf)) ? stackBuf : new uint8_t[extLen];
+    ConcatenateCompressedFields(extHdr, msgBuf, hdrLen, message.GetHeaderFields());
+    QStatus status;
+    if (encrypt) {
+        status = cipher.Encrypt_CCM(body, body, bodyLen, nonce, extHdr, extLen);
+    } else {
+        status = cipher.Decrypt_CCM(body, body, bodyLen, nonce, extHdr, extLen);
+    }
+    if (extHdr != stackBuf) {
+        delete [] extHdr;
+    }
+    return status;
 }
 
-QStatus Crypto::Encrypt(const _Message& message, const KeyBlob& keyBlob, uint8_t* msgBuf, size_t hdrLen, size_t& bodyLen)
+QStatus Crypto::Encrypt(const _Message& message, _MessageCipher& cipher, uint8_t* msgBuf, size_t hdrLen, size_t& bodyLen)
 {
     QStatus status;
+    const KeyBlob& keyBlob = cipher.GetKey();
     switch (keyBlob.GetType()) {
     case KeyBlob::AES:
     {
-        uint8_t* body = msgBuf + hdrLen;
         uint8_t nd[5];
         uint32_t serial = message.GetCallSerial();
 
@@ -102,17 +182,7 @@ QStatus Crypto::Encrypt(const _Message& message, const KeyBlob& keyBlob, uint8_t
         QCC_DbgHLPrintf(("Encrypt key:   %s", BytesToHexString(keyBlob.GetData(), keyBlob.GetSize()).c_str()));
         QCC_DbgHLPrintf(("        nonce: %s", BytesToHexString(nonce.GetData(), nonce.GetSize()).c_str()));
 
-        Crypto_AES aes(keyBlob, Crypto_AES::CCM);
-        if (message.GetFlags() & ALLJOYN_FLAG_COMPRESSED) {
-            /*
-             * To prevent an attack where the attacker sends a bogus expansion rule we
-             * authenticate the compressed headers even though we won't be sending them.
-             */
-            qcc::String extHdr = ConcatenateCompressedFields(msgBuf, hdrLen, message.GetHeaderFields());
-            status = aes.Encrypt_CCM(body, body, bodyLen, nonce, extHdr.data(), extHdr.size());
-        } else {
-            status = aes.Encrypt_CCM(body, body, bodyLen, nonce, msgBuf, hdrLen);
-        }
+        status = MessageCCM(cipher, true, message, msgBuf, hdrLen, bodyLen, nonce);
     }
     break;
 
@@ -124,13 +194,13 @@ QStatus Crypto::Encrypt(const _Message& message, const KeyBlob& keyBlob, uint8_t
     return status;
 }
 
-QStatus Crypto::Decrypt(const _Message& message, const KeyBlob& keyBlob, uint8_t* msgBuf, size_t hdrLen, size_t& bodyLen)
+QStatus Crypto::Decrypt(const _Message& message, _MessageCipher& cipher, uint8_t* msgBuf, size_t hdrLen, size_t& bodyLen)
 {
     QStatus status;
+    const KeyBlob& keyBlob = cipher.GetKey();
     switch (keyBlob.GetType()) {
     case KeyBlob::AES:
     {
-        uint8_t* body = msgBuf + hdrLen;
         uint8_t nd[5];
         uint32_t serial = message.GetCallSerial();
 
@@ -144,17 +214,7 @@ QStatus Crypto::Decrypt(const _Message& message, const KeyBlob& keyBlob, uint8_t
         QCC_DbgHLPrintf(("Decrypt key:   %s", BytesToHexString(keyBlob.GetData(), keyBlob.GetSize()).c_str()));
         QCC_DbgHLPrintf(("        nonce: %s", BytesToHexString(nonce.GetData(), nonce.GetSize()).c_str()));
 
-        Crypto_AES aes(keyBlob, Crypto_AES::CCM);
-        if (message.GetFlags() & ALLJOYN_FLAG_COMPRESSED) {
-            /*
-             * To prevent an attack where the attacker sends a bogus expansion rule we
-             * authenticate the compressed headers even though we won't be sending them.
-             */
-            qcc::String extHdr = ConcatenateCompressedFields(msgBuf, hdrLen, message.GetHeaderFields());
-            status = aes.Decrypt_CCM(body, body, bodyLen, nonce, extHdr.data(), extHdr.size());
-        } else {
-            status = aes.Decrypt_CCM(body, body, bodyLen, nonce, msgBuf, hdrLen);
-        }
+        status = MessageCCM(cipher, false, message, msgBuf, hdrLen, bodyLen, nonce);
     }
     break;
 
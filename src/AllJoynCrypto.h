@@ -26,7 +26,9 @@
 #endif
 
 #include <qcc/platform.h>
+#include <qcc/Crypto.h>
 #include <qcc/KeyBlob.h>
+#include <qcc/ManagedObj.h>
 
 #include <alljoyn/Message.h>
 
@@ -35,6 +37,87 @@
 
 namespace ajn {
 
+/**
+ * A message encryption key together with its expanded AES-CCM key schedule. The key schedule is
+ * computed once when the key is set instead of once per message. It is only read after that and
+ * the CCM state of each call lives on the caller's stack, so any number of threads can encrypt and
+ * decrypt with the same cipher at once.
+ */
+class _MessageCipher {
+
+  public:
+
+    /**
+     * Construct an empty cipher with no key.
+     */
+    _MessageCipher() : aes(NULL) { }
+
+    /**
+     * Construct a cipher and expand the key schedule if the key is an AES key.
+     *
+     * @param key   The message encryption key.
+     */
+    _MessageCipher(const qcc::KeyBlob& key);
+
+    /**
+     * Destructor
+     */
+    ~_MessageCipher() { delete aes; }
+
+    /**
+     * Get the key this cipher was constructed with.
+     *
+     * @return  The key blob.
+     */
+    const qcc::KeyBlob& GetKey() const { return key; }
+
+    /**
+     * Encrypt and authenticate data with AES-CCM using the cached key schedule.
+     *
+     * @param in       The data to encrypt.
+     * @param out      The encrypted data, may be the same as in.
+     * @param len      [in/out] The length of the data, on output the length of the encrypted data.
+     * @param nonce    The nonce.
+     * @param addData  Additional data that is authenticated but not encrypted.
+     * @param addLen   The length of the additional data.
+     *
+     * @return - ER_OK if the data was encrypted.
+     *         - ER_BUS_KEYBLOB_OP_INVALID if this cipher does not have an AES key.
+     */
+    QStatus Encrypt_CCM(const void* in, void* out, size_t& len, const qcc::KeyBlob& nonce, const void* addData, size_t addLen) const;
+
+    /**
+     * Decrypt and authenticate data with AES-CCM using the cached key schedule.
+     *
+     * @param in       The data to decrypt.
+     * @param out      The decrypted data, may be the same as in.
+     * @param len      [in/out] The length of the data, on output the length of the decrypted data.
+     * @param nonce    The nonce.
+     * @param addData  Additional data that is authenticated but not encrypted.
+     * @param addLen   The length of the additional data.
+     *
+     * @return - ER_OK if the data was decrypted and authenticated.
+     *         - ER_BUS_KEYBLOB_OP_INVALID if this cipher does not have an AES key.
+     *         - Other errors if authentication failed.
+     */
+    QStatus Decrypt_CCM(const void* in, void* out, size_t& len, const qcc::KeyBlob& nonce, const void* addData, size_t addLen) const;
+
+  private:
+
+    /* Not copyable, share the key schedule through MessageCipher instead */
+    _MessageCipher(const _MessageCipher& other);
+    _MessageCipher& operator=(const _MessageCipher& other);
+
+    qcc::KeyBlob key;        /**< The message encryption key */
+    qcc::Crypto_AES* aes;    /**< Expanded key schedule or NULL if key is not an AES key, never modified */
+};
+
+/**
+ * MessageCipher is a reference counted (managed) _MessageCipher. A peer can be re-keyed while a
+ * message is being encrypted or decrypted with its previous key.
+ */
+typedef qcc::ManagedObj<_MessageCipher> MessageCipher;
+
 /**
  * Class for encapsulating AllJoyn message encryption and decryption operations.
  */
@@ -43,11 +126,11 @@ class Crypto {
   public:
 
     /**
-     * Encrypt a marshaled message inplace using the key blob provided and the encryption algorithm
-     * and key stored in the key blob.
+     * Encrypt a marshaled message inplace using the cipher provided and the encryption algorithm
+     * and key stored in the cipher's key blob.
      *
      * @param message         The message being encrypted
-     * @param keyBlob         The key blob containing the key for the encryption operation.
+     * @param cipher          The cipher holding the key for the encryption operation.
      * @param msgBuf          The message data to be encrypted. The data buffer must be large enough to handle
      *                        the expansion specified in the ExpansionBytes member variable.
      * @param hdrLen          The length of the header part of the message that will not be encrypted.
@@ -58,14 +141,14 @@ class Crypto {
      *         - ER_BUS_KEYBLOB_OP_INVALID if the key blob cannot be used for encryption.
      *         - Other errors if the arguments are invalid.
      */
-    static QStatus Encrypt(const _Message& message, const qcc::KeyBlob& keyBlob, uint8_t* msgBuf, size_t hdrLen, size_t& bodyLen);
+    static QStatus Encrypt(const _Message& message, _MessageCipher& cipher, uint8_t* msgBuf, size_t hdrLen, size_t& bodyLen);
 
     /**
-     * Decrypt and authenticate marshaled message inplace using the key blob provided and the
-     * decryption algorithm and key stored in the key blob.
+     * Decrypt and authenticate marshaled message inplace using the cipher provided and the
+     * decryption algorithm and key stored in the cipher's key blob.
      *
      * @param message         The message being decrypted
-     * @param keyBlob         The key blob containing the key for the decryption operation.
+     * @param cipher          The cipher holding the key for the decryption operation.
      * @param msgBuf          The message data to be decrypted.
      * @param hdrLen          The length of the non-encrypted header part of the message.
      * @param bodyLen[in/out] On input the size of the crypttext body, on output the size of the
@@ -75,7 +158,7 @@ class Crypto {
      *         - ER_BUS_KEYBLOB_OP_INVALID if the key blob cannot be used for decryption.
      *         - Other errors if the arguments are invalid.
      */
-    static QStatus Decrypt(const _Message& message, const qcc::KeyBlob& keyBlob, uint8_t* msgBuf, size_t hdrLen, size_t& bodyLen);
+    static QStatus Decrypt(const _Message& message, _MessageCipher& cipher, uint8_t* msgBuf, size_t hdrLen, size_t& bodyLen);
 
     /**
      * Compute a SHA1 hash over the header fields and return the result in a key blob.
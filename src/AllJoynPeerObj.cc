@@ -170,8 +170,8 @@ void AllJoynPeerObj::ExpandHeader(Message& msg, const qcc::String& receivedFrom)
 {
     QStatus status = ER_OK;
     uint32_t token = msg->GetCompressionToken();
-    const HeaderFields* expFields = bus.GetInternal().GetCompressionRules().GetExpansion(token);
-    if (!expFields) {
+    HeaderFields expFields;
+    if (!bus.GetInternal().GetCompressionRules().GetExpansion(token, expFields)) {
         Message replyMsg(bus);
         MsgArg arg("u", token);
         /*
@@ -189,8 +189,7 @@ void AllJoynPeerObj::ExpandHeader(Message& msg, const qcc::String& receivedFrom)
         if (status == ER_OK) {
             status = replyMsg->AddExpansionRule(token, replyMsg->GetArg(0));
             if (status == ER_OK) {
-                expFields = bus.GetInternal().GetCompressionRules().GetExpansion(token);
-                if (!expFields) {
+                if (!bus.GetInternal().GetCompressionRules().GetExpansion(token, expFields)) {
                     status = ER_BUS_HDR_EXPANSION_INVALID;
                 }
             }
@@ -208,7 +207,7 @@ void AllJoynPeerObj::ExpandHeader(Message& msg, const qcc::String& receivedFrom)
              */
             for (size_t id = 0; id < ArraySize(msg->hdrFields.field); id++) {
                 if (HeaderFields::Compressible[id] && (msg->hdrFields.field[id].typeId == ALLJOYN_INVALID)) {
-                    msg->hdrFields.field[id] = expFields->field[id];
+                    msg->hdrFields.field[id] = expFields.field[id];
                 }
             }
             /*
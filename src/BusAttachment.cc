@@ -565,7 +565,7 @@ void BusAttachment::WaitStop()
             busInternal->peerStateTable.Clear();
 
             /* Persist keystore */
-            busInternal->keyStore.Store();
+            busInternal->keyStore.Flush();
 
             isStarted = false;
             isStopping = false;
@@ -1261,12 +1261,17 @@ QStatus BusAttachment::JoinSessionAsync(const char* sessionHost, SessionPort ses
     SetSessionOpts(opts, args[2]);
 
     const ProxyBusObject& alljoynObj = this->GetAllJoynProxyObj();
+    _JoinSessionMethodCBContext* cbCtx = new _JoinSessionMethodCBContext(callback, sessionListener, context);
     QStatus status = alljoynObj.MethodCallAsync(org::alljoyn::Bus::InterfaceName,
                                                 "JoinSession",
                                                 busInternal,
                                                 static_cast<MessageReceiver::ReplyHandler>(&BusAttachment::Internal::JoinSessionMethodCB),
                                                 args, ArraySize(args),
-                                                reinterpret_cast<void*>(new _JoinSessionMethodCBContext(callback, sessionListener, context)));
+                                                reinterpret_cast<void*>(cbCtx));
+    if (status != ER_OK) {
+        /* The reply handler is not called so the context is ours to free */
+        delete cbCtx;
+    }
     return status;
 }
 
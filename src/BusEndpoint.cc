@@ -20,6 +20,9 @@
  ******************************************************************************/
 
 #include <qcc/platform.h>
+
+#include <assert.h>
+
 #include <qcc/GUID.h>
 
 #include <BusEndpoint.h>
@@ -35,3 +38,27 @@ String BusEndpoint::GetControllerUniqueName() const {
     ret.resize(qcc::GUID128::SHORT_SIZE + 3);
     return ret;
 }
+
+void BusEndpoint::IncrementRouteRef()
+{
+    routeRefsLock.Lock();
+    if (routeRefs++ == 0) {
+        routeRefsDrained.ResetEvent();
+    }
+    routeRefsLock.Unlock();
+}
+
+void BusEndpoint::DecrementRouteRef()
+{
+    routeRefsLock.Lock();
+    assert(routeRefs > 0);
+    if (--routeRefs == 0) {
+        routeRefsDrained.SetEvent();
+    }
+    routeRefsLock.Unlock();
+}
+
+void BusEndpoint::WaitForRouteRefs()
+{
+    Event::Wait(routeRefsDrained);
+}
@@ -23,7 +23,9 @@
 
 #include <qcc/platform.h>
 
+#include <qcc/Event.h>
 #include <qcc/GUID.h>
+#include <qcc/Mutex.h>
 #include <qcc/String.h>
 
 #include <alljoyn/Message.h>
@@ -54,7 +56,7 @@ class BusEndpoint : public MessageSink {
      *
      * @param type    BusEndpoint type.
      */
-    BusEndpoint(EndpointType type) : endpointType(type), disconnectStatus(ER_OK) { }
+    BusEndpoint(EndpointType type) : endpointType(type), disconnectStatus(ER_OK), routeRefs(0) { routeRefsDrained.SetEvent(); }
 
     /**
      * Virtual destructor for derivable class.
@@ -131,10 +133,36 @@ class BusEndpoint : public MessageSink {
      */
     bool SurpriseDisconnect() { return disconnectStatus != ER_OK; }
 
+    /**
+     * Take a routing reference on this endpoint.
+     * The router holds a routing reference while it delivers a message to an endpoint that
+     * it looked up without keeping its name or rule table locked.
+     */
+    void IncrementRouteRef();
+
+    /**
+     * Release a routing reference taken with IncrementRouteRef().
+     */
+    void DecrementRouteRef();
+
+    /**
+     * Block until no routing references are held on this endpoint.
+     * This must be called before the endpoint is destroyed so it is not destroyed
+     * while a message is still being delivered to it. It must not be called with the name
+     * table or AllJoynObj locks held because a delivery in progress may need those locks.
+     */
+    void WaitForRouteRefs();
+
   protected:
 
     EndpointType endpointType;   /**< Type of endpoint */
     QStatus disconnectStatus;    /**< Reason for the disconnect */
+
+  private:
+
+    int32_t routeRefs;           /**< Number of in-progress deliveries by the router */
+    qcc::Mutex routeRefsLock;    /**< Protects routeRefs and routeRefsDrained */
+    qcc::Event routeRefsDrained; /**< Set while routeRefs is zero */
 };
 
 }
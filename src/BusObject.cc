@@ -42,6 +42,7 @@
 #include "AllJoynPeerObj.h"
 #include "MethodTable.h"
 #include "BusInternal.h"
+#include "SignaturePlan.h"
 
 
 #define QCC_MODULE "ALLJOYN"
@@ -308,6 +309,10 @@ QStatus BusObject::AddMethodHandler(const InterfaceDescription::Member* member,
     } else if (ImplementsInterface(member->iface->GetName())) {
         MethodContext ctx = { member, handler };
         components->methodContexts.push_back(ctx);
+        /*
+         * Compile the method signature now, received method calls only use plans that are already cached.
+         */
+        SignaturePlan::Get(member->signature.c_str());
     } else {
         status = ER_BUS_NO_SUCH_INTERFACE;
         QCC_LogError(status, ("Cannot add method handler for unknown interface"));
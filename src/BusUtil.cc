@@ -24,12 +24,15 @@
 
 #include <qcc/platform.h>
 
-#include <ctype.h>
-
 #include <qcc/String.h>
 #include <qcc/StringUtil.h>
 #include <qcc/Util.h>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#include <emmintrin.h>
+#define NAME_CHECK_SSE2
+#endif
+
 #include "BusUtil.h"
 
 
@@ -43,29 +46,157 @@ using namespace std;
 
 namespace ajn {
 
-bool IsLegalUniqueName(const char* str)
+static bool useVector = true;
+
+/*
+ * Character classes for names are ASCII only and do not depend on the locale.
+ */
+static inline bool IsAlpha(char c)
+{
+    return ((c | 0x20) >= 'a') && ((c | 0x20) <= 'z');
+}
+
+static inline bool IsDigit(char c)
+{
+    return (c >= '0') && (c <= '9');
+}
+
+static inline bool IsAlnum(char c)
+{
+    return IsAlpha(c) || IsDigit(c);
+}
+
+/*
+ * Check the rest of a name starting at str. Every character must be alphanumeric, an underscore,
+ * a hyphen if hyphens are allowed, or a separator. A separator cannot be followed by another
+ * separator, by the end of the name or, if noDigitAfterSep is true, by a digit. A separator of 0
+ * means the name cannot have separators.
+ *
+ * Returns true if the name is legal, with whether there were any separators and a pointer to the
+ * terminating nul. These are not set if false is returned.
+ */
+static bool ScanNameScalar(const char* str, char sep, bool hyphens, bool noDigitAfterSep, bool& hasSep, const char*& end)
 {
-    if (!str) {
-        return false;
-    }
     const char* p = str;
+    bool seps = false;
+    char c;
+    while ((c = *p++) != 0) {
+        if (!IsAlnum(c) && (c != '_') && (!hyphens || (c != '-'))) {
+            if ((c != sep) || (*p == sep) || (*p == 0) || (noDigitAfterSep && IsDigit(*p))) {
+                return false;
+            }
+            seps = true;
+        }
+    }
+    hasSep = seps;
+    end = p - 1;
+    return true;
+}
 
-    char c = *p++;
-    if (c != ':' || !(isalnum(*p) || (*p == '-') || (*p == '_'))) {
-        return false;
+#ifdef NAME_CHECK_SSE2
+/* Position of the lowest set bit of a non-zero mask */
+static inline size_t LowestBit(uint32_t m)
+{
+#if defined(__GNUC__)
+    return (size_t)__builtin_ctz(m);
+#else
+    size_t n = 0;
+    while (!(m & 1)) {
+        m >>= 1;
+        ++n;
     }
-    p++;
+    return n;
+#endif
+}
+#endif
 
-    size_t periods = 0;
-    while ((c = *p++)) {
-        if (!isalnum(c) && (c != '-') && (c != '_')) {
-            if ((c != '.') || (*p == '.') || (*p == 0)) {
+static bool ScanName(const char* str, char sep, bool hyphens, bool noDigitAfterSep, bool& hasSep, const char*& end)
+{
+#ifdef NAME_CHECK_SSE2
+    /*
+     * Classify 16 characters at a time into bit masks and apply the separator rules to the masks.
+     * The loads are aligned and an aligned 16 byte load never crosses a page boundary so reading
+     * past the terminating nul is safe, bytes before the start of the name are masked out.
+     */
+    if (useVector) {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i lowerCase = _mm_set1_epi8(0x20);
+        const __m128i belowA = _mm_set1_epi8('a' - 1);
+        const __m128i aboveZ = _mm_set1_epi8('z' + 1);
+        const __m128i below0 = _mm_set1_epi8('0' - 1);
+        const __m128i above9 = _mm_set1_epi8('9' + 1);
+        const __m128i underscore = _mm_set1_epi8('_');
+        const __m128i hyphen = _mm_set1_epi8(hyphens ? '-' : '_');
+        const __m128i separator = _mm_set1_epi8(sep);
+        size_t misalign = (size_t)((uintptr_t)str & 15);
+        const char* block = str - misalign;
+        uint32_t valid = (0xFFFF << misalign) & 0xFFFF;
+        uint32_t carry = 0;
+        uint32_t seps = 0;
+
+        for (;;) {
+            __m128i v = _mm_load_si128((const __m128i*)block);
+            __m128i lower = _mm_or_si128(v, lowerCase);
+            __m128i alpha = _mm_and_si128(_mm_cmpgt_epi8(lower, belowA), _mm_cmplt_epi8(lower, aboveZ));
+            __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(v, below0), _mm_cmplt_epi8(v, above9));
+            __m128i other = _mm_or_si128(_mm_cmpeq_epi8(v, underscore), _mm_cmpeq_epi8(v, hyphen));
+            uint32_t plainMask = (uint32_t)_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(alpha, digit), other));
+            uint32_t digitMask = (uint32_t)_mm_movemask_epi8(digit);
+            uint32_t nulMask = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, zero)) & valid;
+            uint32_t sepMask = sep ? (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, separator)) : 0;
+            /*
+             * Only characters before the first nul are part of the name
+             */
+            uint32_t inName = valid;
+            if (nulMask) {
+                inName &= (nulMask & (0 - nulMask)) - 1;
+            }
+            if (inName & ~(plainMask | sepMask)) {
                 return false;
             }
-            periods++;
+            sepMask &= inName;
+            /*
+             * Characters that cannot follow a separator, the first character of this block must
+             * also be checked if the last character of the previous block was a separator.
+             */
+            uint32_t notAfterSep = sepMask | nulMask | (noDigitAfterSep ? digitMask : 0);
+            if ((sepMask & (notAfterSep >> 1)) || (carry & notAfterSep)) {
+                return false;
+            }
+            carry = (sepMask >> 15) & 1;
+            seps |= sepMask;
+            if (nulMask) {
+                hasSep = (seps != 0);
+                end = block + LowestBit(nulMask);
+                return true;
+            }
+            block += 16;
+            valid = 0xFFFF;
         }
     }
-    return (periods > 0) && ((p - str) <= MAX_NAME_LEN);
+#endif
+    return ScanNameScalar(str, sep, hyphens, noDigitAfterSep, hasSep, end);
+}
+
+void EnableVectorNameChecks(bool enable)
+{
+    useVector = enable;
+}
+
+bool IsLegalUniqueName(const char* str)
+{
+    if (!str) {
+        return false;
+    }
+    if ((str[0] != ':') || !(IsAlnum(str[1]) || (str[1] == '-') || (str[1] == '_'))) {
+        return false;
+    }
+    bool periods;
+    const char* end;
+    if (!ScanName(str + 2, '.', true, false, periods, end)) {
+        return false;
+    }
+    return periods && ((end - str) < MAX_NAME_LEN);
 }
 
 
@@ -77,22 +208,18 @@ bool IsLegalBusName(const char* str)
     if (*str == ':') {
         return IsLegalUniqueName(str);
     }
-    const char* p = str;
-    size_t periods = 0;
-    char c = *p++;
     /* Must begin with an alpha character, underscore, or hyphen */
-    if (!isalpha(c) && (c != '_') && (c != '-')) {
+    char c = *str;
+    if (!IsAlpha(c) && (c != '_') && (c != '-')) {
         return false;
     }
-    while ((c = *p++) != 0) {
-        if (!isalnum(c) && (c != '_') && (c != '-')) {
-            if ((c != '.') || (*p == '.') || (*p == 0) || isdigit(*p)) {
-                return false;
-            }
-            periods++;
-        }
+    /* A period cannot be followed by a digit */
+    bool periods;
+    const char* end;
+    if (!ScanName(str + 1, '.', true, true, periods, end)) {
+        return false;
     }
-    return (periods > 0) && ((p - str) <= MAX_NAME_LEN);
+    return periods && ((end - str) < MAX_NAME_LEN);
 }
 
 
@@ -102,18 +229,12 @@ bool IsLegalObjectPath(const char* str)
         return false;
     }
     /* Must begin with slash */
-    char c = *str++;
-    if (c != '/') {
+    if (*str != '/') {
         return false;
     }
-    while ((c = *str++) != 0) {
-        if (!isalnum(c) && (c != '_')) {
-            if ((c != '/') || (*str == '/') || (*str == 0)) {
-                return false;
-            }
-        }
-    }
-    return true;
+    bool slashes;
+    const char* end;
+    return ScanName(str + 1, '/', false, false, slashes, end);
 }
 
 
@@ -122,23 +243,17 @@ bool IsLegalInterfaceName(const char* str)
     if (!str) {
         return false;
     }
-    const char* p = str;
-
     /* Must begin with an alpha character or underscore */
-    char c = *p++;
-    if (!isalpha(c) && (c != '_')) {
+    char c = *str;
+    if (!IsAlpha(c) && (c != '_')) {
         return false;
     }
-    size_t periods = 0;
-    while ((c = *p++) != 0) {
-        if (!isalnum(c) && (c != '_')) {
-            if ((c != '.') || (*p == '.') || (*p == 0)) {
-                return false;
-            }
-            periods++;
-        }
+    bool periods;
+    const char* end;
+    if (!ScanName(str + 1, '.', false, false, periods, end)) {
+        return false;
     }
-    return (periods > 0) && ((p - str) <= MAX_NAME_LEN);
+    return periods && ((end - str) < MAX_NAME_LEN);
 }
 
 
@@ -153,18 +268,20 @@ bool IsLegalMemberName(const char* str)
     if (!str) {
         return false;
     }
-    const char* p = str;
-    char c = *p++;
-
-    if (!isalpha(c) && (c != '_')) {
+    char c = *str;
+    if (!IsAlpha(c) && (c != '_')) {
         return false;
     }
-    while ((c = *p++) != 0) {
-        if (!isalnum(c) && (c != '_')) {
-            return false;
-        }
+    /*
+     * Member names are short and have no separators, the byte at a time check is faster than the
+     * vector check for these.
+     */
+    bool none;
+    const char* end;
+    if (!ScanNameScalar(str + 1, 0, false, false, none, end)) {
+        return false;
     }
-    return (p - str) <= MAX_NAME_LEN;
+    return (end - str) < MAX_NAME_LEN;
 }
 
 
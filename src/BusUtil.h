@@ -115,6 +115,14 @@ bool IsLegalErrorName(const char* str);
  */
 bool IsLegalMemberName(const char* str);
 
+/**
+ * Enable or disable the vector code used by the name checks. While disabled names are checked one
+ * character at a time. This is intended for testing and measuring the vector code.
+ *
+ * @param enable  true to enable the vector code (the default).
+ */
+void EnableVectorNameChecks(bool enable);
+
 /**
  * Generate a well-known bus name from an object path.
  *
@@ -39,75 +39,195 @@ using namespace std;
 
 namespace ajn {
 
-void CompressionRules::Add(const HeaderFields& hdrFields, uint32_t token)
+CompressionRules::CompressionRules(size_t maxRules) : maxPerShard(maxRules / NUM_SHARDS)
 {
-    HeaderFields* expFields = new HeaderFields;
+    if (maxPerShard == 0) {
+        maxPerShard = 1;
+    }
+    /*
+     * Start each shard's token counter at a random value so tokens from different runs and different
+     * shards are unlikely to collide with tokens a peer may have cached.
+     */
+    for (size_t i = 0; i < NUM_SHARDS; i++) {
+        shards[i].nextToken = Rand32();
+    }
+}
+
+void CompressionRules::Add(Shard& shard, const HeaderFields& hdrFields, uint32_t token, bool local)
+{
+    Rule* rule = new Rule;
     /*
      * Copy compressible fields.
      */
-    for (size_t i = 0; i < ArraySize(expFields->field); i++) {
+    for (size_t i = 0; i < ArraySize(rule->fields.field); i++) {
         if (HeaderFields::Compressible[i]) {
-            expFields->field[i] = hdrFields.field[i];
+            rule->fields.field[i] = hdrFields.field[i];
         }
     }
+    rule->token = token;
+    rule->local = local;
+    /*
+     * Add reverse mapping and forward mapping for locally allocated tokens.
+     */
+    shard.tokenMap[token] = rule;
+    if (local) {
+        shard.fieldMap[&rule->fields] = rule;
+        shard.localLru.push_front(rule);
+        rule->lru = shard.localLru.begin();
+        ++shard.numCompressions;
+    } else {
+        shard.lru.push_front(rule);
+        rule->lru = shard.lru.begin();
+        ++shard.numExpansions;
+    }
+    QCC_DbgHLPrintf(("Added %s rule %u <-->\n%s", local ? "compression" : "expansion", token, rule->fields.ToString().c_str()));
     /*
-     * Add forward and reverse mapping.
+     * Evict least recently used expansion rules, we can re-request an evicted expansion from the
+     * peer. An evicted compression rule's token is retired, the header fields get a new token the
+     * next time they are compressed.
      */
-    tokenMap[token] = expFields;
-    fieldMap[expFields] = token;
-    QCC_DbgHLPrintf(("Added compression/expansion rule %u <-->\n%s", token, expFields->ToString().c_str()));
+    while (shard.numExpansions > maxPerShard) {
+        Rule* lru = shard.lru.back();
+        QCC_DbgHLPrintf(("Evicting expansion rule %u", lru->token));
+        Remove(shard, lru);
+    }
+    while (shard.numCompressions > maxPerShard) {
+        Rule* lru = shard.localLru.back();
+        QCC_DbgHLPrintf(("Retiring compression rule %u", lru->token));
+        Remove(shard, lru);
+    }
+}
+
+CompressionRules::Rule* CompressionRules::Find(Shard& shard, uint32_t token)
+{
+    hash_map<uint32_t, Rule*>::iterator iter = shard.tokenMap.find(token);
+    if (iter == shard.tokenMap.end()) {
+        return NULL;
+    }
+    Rule* rule = iter->second;
+    Touch(shard, rule);
+    return rule;
+}
+
+void CompressionRules::Touch(Shard& shard, Rule* rule)
+{
+    RuleList& lru = rule->local ? shard.localLru : shard.lru;
+    lru.splice(lru.begin(), lru, rule->lru);
+}
+
+void CompressionRules::Remove(Shard& shard, Rule* rule)
+{
+    if (rule->local) {
+        shard.fieldMap.erase(&rule->fields);
+        shard.localLru.erase(rule->lru);
+        --shard.numCompressions;
+    } else {
+        shard.lru.erase(rule->lru);
+        --shard.numExpansions;
+    }
+    shard.tokenMap.erase(rule->token);
+    delete rule;
 }
 
 void CompressionRules::AddExpansion(const HeaderFields& hdrFields, uint32_t token)
 {
     if (token) {
-        lock.Lock();
-        if (fieldMap.count(&hdrFields) == 0) {
-            Add(hdrFields, token);
-        } else {
+        Shard& shard = GetShard(token);
+        shard.lock.Lock();
+        Rule* rule = Find(shard, token);
+        if (rule && rule->local) {
             QCC_LogError(ER_FAIL, ("Compression token collision %u", token));
+        } else {
+            if (rule) {
+                Remove(shard, rule);
+            }
+            Add(shard, hdrFields, token, false);
         }
-        pending.erase(token);
-        lock.Unlock();
+        shard.lock.Unlock();
     }
 }
 
 uint32_t CompressionRules::GetToken(const HeaderFields& hdrFields)
 {
     uint32_t token;
-    lock.Lock();
-    hash_map<const HeaderFields*, uint32_t, HdrFieldHash, HdrFieldsEq>::iterator iter = fieldMap.find(&hdrFields);
-    if (iter != fieldMap.end()) {
-        token = iter->second;
+    uint32_t shardIdx = HdrFieldHash()(&hdrFields) & (NUM_SHARDS - 1);
+    Shard& shard = shards[shardIdx];
+    shard.lock.Lock();
+    hash_map<const HeaderFields*, Rule*, HdrFieldHash, HdrFieldsEq>::iterator iter = shard.fieldMap.find(&hdrFields);
+    if (iter != shard.fieldMap.end()) {
+        token = iter->second->token;
+        Touch(shard, iter->second);
     } else {
         /*
-         * Allocate a random token (check it isn't zero and not in use)
+         * Allocate the next token for this shard (check it isn't zero and not in use). The counter
+         * only moves forward so the token of an evicted rule is not handed out again.
          */
-        do { token = Rand32(); } while (token && GetExpansion(token));
-        Add(hdrFields, token);
+        do {
+            token = (shard.nextToken++ << SHARD_BITS) | shardIdx;
+        } while ((token == 0) || (shard.tokenMap.find(token) != shard.tokenMap.end()));
+        Add(shard, hdrFields, token, true);
     }
-    lock.Unlock();
+    shard.lock.Unlock();
     return token;
 }
 
-const HeaderFields* CompressionRules::GetExpansion(uint32_t token)
+bool CompressionRules::GetExpansion(uint32_t token, HeaderFields& expansion)
 {
-    const HeaderFields* expansion = NULL;
+    Rule* rule = NULL;
     if (token) {
-        lock.Lock();
-        map<uint32_t, const HeaderFields*>::iterator iter = tokenMap.find(token);
-        expansion = (iter != tokenMap.end()) ? iter->second : NULL;
-        lock.Unlock();
+        Shard& shard = GetShard(token);
+        shard.lock.Lock();
+        rule = Find(shard, token);
+        if (rule) {
+            for (size_t i = 0; i < ArraySize(expansion.field); i++) {
+                if (HeaderFields::Compressible[i]) {
+                    expansion.field[i] = rule->fields.field[i];
+                }
+            }
+        }
+        shard.lock.Unlock();
     }
-    return expansion;
+    return rule != NULL;
+}
+
+bool CompressionRules::Expand(uint32_t token, HeaderFields& hdrFields)
+{
+    Rule* rule = NULL;
+    if (token) {
+        Shard& shard = GetShard(token);
+        shard.lock.Lock();
+        rule = Find(shard, token);
+        if (rule) {
+            for (size_t i = 0; i < ArraySize(hdrFields.field); i++) {
+                if (HeaderFields::Compressible[i] && (hdrFields.field[i].typeId == ALLJOYN_INVALID)) {
+                    hdrFields.field[i] = rule->fields.field[i];
+                }
+            }
+        }
+        shard.lock.Unlock();
+    }
+    return rule != NULL;
+}
+
+size_t CompressionRules::Size()
+{
+    size_t size = 0;
+    for (size_t i = 0; i < NUM_SHARDS; i++) {
+        shards[i].lock.Lock();
+        size += shards[i].tokenMap.size();
+        shards[i].lock.Unlock();
+    }
+    return size;
 }
 
 CompressionRules::~CompressionRules()
 {
-    map<uint32_t, const ajn::HeaderFields*>::iterator iter = tokenMap.begin();
-    while (iter != tokenMap.end()) {
-        delete iter->second;
-        iter++;
+    for (size_t i = 0; i < NUM_SHARDS; i++) {
+        hash_map<uint32_t, Rule*>::iterator iter = shards[i].tokenMap.begin();
+        while (iter != shards[i].tokenMap.end()) {
+            delete iter->second;
+            iter++;
+        }
     }
 }
 
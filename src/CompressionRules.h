@@ -34,8 +34,7 @@
 
 #include <Status.h>
 
-#include <map>
-#include <set>
+#include <list>
 
 #if defined(__GNUC__) && !defined(ANDROID)
 #include <ext/hash_map>
@@ -55,19 +54,40 @@ namespace ajn {
  * This class maintains a list of header compression rules for header field compression and provides
  * methods that map from a expanded header to a compression token and back. This class is used by
  * the marshaling code to compress a header before sending it.
+ *
+ * The number of rules is bounded; when it is exceeded the least recently used rules are evicted.
+ * Rules are spread over shards with their own locks so concurrent message generation does not
+ * contend on a single lock. Tokens allocated locally are retired when their rule is evicted and
+ * are never reallocated for different header fields (until a per-shard 28 bit counter wraps), so
+ * an expansion cached by a peer stays valid after the local rule is evicted. Header fields whose
+ * rule was evicted get a new token the next time they are compressed and the peer asks for the new
+ * expansion through AllJoynPeerObj::RequestHeaderExpansion, as it does for an expansion rule of
+ * its own that was evicted.
  */
 class CompressionRules {
 
   public:
 
+    /**
+     * Default maximum number of expansion rules.
+     */
+    static const size_t DEFAULT_MAX_RULES = 4096;
+
+    /**
+     * Constructor
+     *
+     * @param maxRules  Maximum number of compression rules allocated locally, and separately the
+     *                  maximum number of expansion rules received from remote peers, that are held
+     *                  before the least recently used rules of that kind are evicted.
+     */
+    CompressionRules(size_t maxRules = DEFAULT_MAX_RULES);
+
     /**
      * Add a new expansion rule to the expansion table. This is an expansion that was received from
      * a remote peer. Note that 0 is an invalid token value.
      *
      * @param hdrFields  The header fields to add.
      * @param token      The compression token for the header fields.
-     *
-     * @return ER_OK if the expansion rule was added.
      */
     void AddExpansion(const HeaderFields& hdrFields, uint32_t token);
 
@@ -81,14 +101,32 @@ class CompressionRules {
     uint32_t GetToken(const HeaderFields& hdrFields);
 
     /**
-     * Perform the lookup of the expansion given a compression token. Note that token must
-     * be non-zero.
+     * Get a copy of the expansion for a compression token. Note that token must be non-zero.
      *
-     * @param token  The compression token to lookup.
+     * @param token      The compression token to lookup.
+     * @param expansion  [out] Returns the compressible header fields of the expansion.
+     *
+     * @return  true if there is an expansion for the compression token.
+     */
+    bool GetExpansion(uint32_t token, HeaderFields& expansion);
+
+    /**
+     * Expand compressed header fields in place. Fields that are already set are not overwritten.
+     * Note that token must be non-zero.
+     *
+     * @param token      The compression token to lookup.
+     * @param hdrFields  The header fields to expand.
+     *
+     * @return  true if there is an expansion for the compression token.
+     */
+    bool Expand(uint32_t token, HeaderFields& hdrFields);
+
+    /**
+     * Get the number of rules currently held.
      *
-     * @return  The expansion for the compression token or NULL if there is no such expansion.
+     * @return  The number of compression and expansion rules.
      */
-    const HeaderFields* GetExpansion(uint32_t token);
+    size_t Size();
 
     /**
      * Destructor
@@ -97,15 +135,30 @@ class CompressionRules {
 
   private:
 
-    /**
-     * Add a compression/expansion rule.
-     */
-    void Add(const HeaderFields& hdrFields, uint32_t token);
+    /** Number of shards (must be a power of 2) */
+    static const uint32_t NUM_SHARDS = 16;
+
+    /** Number of low token bits that select the shard */
+    static const uint32_t SHARD_BITS = 4;
+
+    struct Rule;
+
+    /** Expansion rules ordered from most to least recently used */
+    typedef std::list<Rule*> RuleList;
 
     /**
-     * Mutex to protect compression rules
+     * A compression rule allocated locally or an expansion rule received from a remote peer.
      */
-    qcc::Mutex lock;
+    struct Rule {
+        HeaderFields fields;      /**< Compressible header fields */
+        uint32_t token;           /**< Compression token */
+        bool local;               /**< True if the token was allocated by GetToken() */
+        RuleList::iterator lru;   /**< Position in the shard's LRU list for rules of its kind */
+    };
+
+    /* Not copyable */
+    CompressionRules(const CompressionRules& other);
+    CompressionRules& operator=(const CompressionRules& other);
 
     /**
      * Hash funcion for header compression. Hash value is computed over member and interface only.
@@ -176,19 +229,48 @@ class CompressionRules {
     };
 
     /**
-     * The header compression mapping from header fields to compression token
+     * A shard holds the rules whose token selects it. Locally allocated tokens are chosen so the
+     * token and the hash of the header fields select the same shard.
+     */
+    struct Shard {
+        qcc::Mutex lock;                                                                     /**< Protects the shard */
+        std::hash_map<const ajn::HeaderFields*, Rule*, HdrFieldHash, HdrFieldsEq> fieldMap;  /**< Local rules by header fields */
+        std::hash_map<uint32_t, Rule*> tokenMap;                                             /**< All rules by token */
+        RuleList lru;                                                                        /**< Expansion rules from most to least recently used */
+        RuleList localLru;                                                                   /**< Compression rules from most to least recently used */
+        size_t numExpansions;                                                                /**< Number of expansion rules in lru */
+        size_t numCompressions;                                                              /**< Number of compression rules in localLru */
+        uint32_t nextToken;                                                                  /**< Counter for allocating local tokens */
+
+        Shard() : numExpansions(0), numCompressions(0), nextToken(0) { }
+    };
+
+    Shard& GetShard(uint32_t token) { return shards[token & (NUM_SHARDS - 1)]; }
+
+    /**
+     * Add a rule to a shard evicting the least recently used rule of the same kind if the shard
+     * holds too many. Must be called with the shard locked.
      */
-    std::hash_map<const ajn::HeaderFields*, uint32_t, HdrFieldHash, HdrFieldsEq> fieldMap;
+    void Add(Shard& shard, const HeaderFields& hdrFields, uint32_t token, bool local);
 
-    /*
-     * The header expansion mapping from compression token to header fields
+    /**
+     * Find a rule by token and mark it as most recently used. Must be called with the shard locked.
      */
-    std::map<uint32_t, const ajn::HeaderFields*> tokenMap;
+    Rule* Find(Shard& shard, uint32_t token);
 
     /**
-     * Set to track when a token expansion has been requested.
+     * Mark a rule as most recently used. Must be called with the shard locked.
      */
-    std::set<uint32_t> pending;
+    void Touch(Shard& shard, Rule* rule);
+
+    /**
+     * Remove a rule from a shard and delete it. Must be called with the shard locked.
+     */
+    void Remove(Shard& shard, Rule* rule);
+
+    size_t maxPerShard;          /**< Maximum number of compression and of expansion rules per shard */
+
+    Shard shards[NUM_SHARDS];    /**< The sharded rules */
 
 };
 
@@ -0,0 +1,719 @@
+/**
+ * @file
+ * EndpointReactor multiplexes the sockets of many RemoteEndpoints over a small
+ * fixed pool of threads.
+ */
+
+/******************************************************************************
+ * Copyright 2011, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+
+#include <qcc/platform.h>
+
+#include <assert.h>
+#include <string.h>
+#include <algorithm>
+
+#if defined(QCC_OS_LINUX) || defined(QCC_OS_ANDROID)
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#endif
+
+#include <qcc/Debug.h>
+#include <qcc/Socket.h>
+#include <qcc/StringUtil.h>
+#include <qcc/Thread.h>
+
+#include <alljoyn/Message.h>
+
+#include "EndpointReactor.h"
+#include "RemoteEndpoint.h"
+
+#define QCC_MODULE "ALLJOYN"
+
+using namespace std;
+using namespace qcc;
+
+namespace ajn {
+
+/*
+ * Number of bytes read from a socket in one go
+ */
+static const size_t RX_CHUNK = 16 * 1024;
+
+/*
+ * Maximum number of readiness events returned by one epoll_wait
+ */
+static const int MAX_EVENTS = 64;
+
+/*
+ * The reactor threads that are currently running
+ */
+static qcc::Mutex reactorThreadsLock;
+static set<const Thread*> reactorThreads;
+
+/*
+ * Read a 32 bit value from a message header in the header's byte order
+ */
+static inline uint32_t ReadHeaderU32(const uint8_t* p, bool littleEndian)
+{
+    if (littleEndian) {
+        return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+    } else {
+        return (uint32_t)p[3] | ((uint32_t)p[2] << 8) | ((uint32_t)p[1] << 16) | ((uint32_t)p[0] << 24);
+    }
+}
+
+ReactorStream::ReactorStream(SocketFd sock) : sock(-1), rxPos(0), txPos(0), txBase(0), numWrites(0)
+{
+    /*
+     * The endpoint's own SocketStream closes its socket before the RemoteEndpoint destructor
+     * runs so we keep a duplicate. This keeps the epoll registration valid until the endpoint has
+     * been removed from the reactor.
+     */
+    QStatus status = SocketDup(sock, this->sock);
+    if (status != ER_OK) {
+        QCC_LogError(status, ("Failed to duplicate endpoint socket"));
+        this->sock = -1;
+    }
+}
+
+ReactorStream::~ReactorStream()
+{
+    while (!rxFds.empty()) {
+        qcc::Close(rxFds.front());
+        rxFds.pop_front();
+    }
+    while (!txFds.empty()) {
+        qcc::Close(txFds.front().fd);
+        txFds.pop_front();
+    }
+    if (sock != -1) {
+        qcc::Close(sock);
+    }
+}
+
+QStatus ReactorStream::PullBytes(void* buf, size_t reqBytes, size_t& actualBytes, uint32_t timeout)
+{
+    size_t avail = rxBuf.size() - rxPos;
+    if (avail == 0) {
+        actualBytes = 0;
+        return ER_WOULDBLOCK;
+    }
+    actualBytes = (std::min)(reqBytes, avail);
+    memcpy(buf, &rxBuf[rxPos], actualBytes);
+    rxPos += actualBytes;
+    if (rxPos == rxBuf.size()) {
+        rxBuf.clear();
+        rxPos = 0;
+    }
+    return ER_OK;
+}
+
+QStatus ReactorStream::PullBytesAndFds(void* buf, size_t reqBytes, size_t& actualBytes, SocketFd* fdList, size_t& numFds, uint32_t timeout)
+{
+    numFds = 0;
+    return PullBytes(buf, reqBytes, actualBytes, timeout);
+}
+
+size_t ReactorStream::PullFds(SocketFd* fdList, size_t numFds)
+{
+    size_t count = 0;
+    while ((count < numFds) && !rxFds.empty()) {
+        fdList[count++] = rxFds.front();
+        rxFds.pop_front();
+    }
+    return count;
+}
+
+QStatus ReactorStream::PushBytes(const void* buf, size_t numBytes, size_t& numSent)
+{
+    if ((txPos > 0) && (txPos >= (txBuf.size() / 2))) {
+        txBuf.erase(txBuf.begin(), txBuf.begin() + txPos);
+        txBase += txPos;
+        txPos = 0;
+    }
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(buf);
+    txBuf.insert(txBuf.end(), bytes, bytes + numBytes);
+    numSent = numBytes;
+    return ER_OK;
+}
+
+QStatus ReactorStream::PushBytesAndFds(const void* buf, size_t numBytes, size_t& numSent, SocketFd* fdList, size_t numFds, uint32_t pid)
+{
+    QStatus status = ER_OK;
+    size_t offset = txBase + txBuf.size();
+    for (size_t i = 0; i < numFds; ++i) {
+        SocketFd fd;
+        status = SocketDup(fdList[i], fd);
+        if (status != ER_OK) {
+            QCC_LogError(status, ("Failed to duplicate handle"));
+            return status;
+        }
+        txFds.push_back(FdEntry(offset, fd));
+    }
+    return PushBytes(buf, numBytes, numSent);
+}
+
+bool ReactorStream::HasMessage() const
+{
+    size_t avail = rxBuf.size() - rxPos;
+    if (avail < 16) {
+        return false;
+    }
+    const uint8_t* hdr = &rxBuf[rxPos];
+    if ((hdr[0] != ALLJOYN_LITTLE_ENDIAN) && (hdr[0] != ALLJOYN_BIG_ENDIAN)) {
+        return true;
+    }
+    bool littleEndian = (hdr[0] == ALLJOYN_LITTLE_ENDIAN);
+    uint32_t bodyLen = ReadHeaderU32(hdr + 4, littleEndian);
+    uint32_t headerLen = ReadHeaderU32(hdr + 12, littleEndian);
+    if ((headerLen > ALLJOYN_MAX_PACKET_LEN) || (bodyLen > ALLJOYN_MAX_PACKET_LEN)) {
+        return true;
+    }
+    size_t pktSize = ((headerLen + 7) & ~7) + bodyLen;
+    if (pktSize > ALLJOYN_MAX_PACKET_LEN) {
+        return true;
+    }
+    return avail >= (16 + pktSize);
+}
+
+#if defined(QCC_OS_LINUX) || defined(QCC_OS_ANDROID)
+
+QStatus ReactorStream::Fill()
+{
+    uint8_t chunk[RX_CHUNK];
+    char cbuf[CMSG_SPACE(sizeof(int) * SOCKET_MAX_FILE_DESCRIPTORS)];
+
+    while ((rxBuf.size() - rxPos) < MAX_RX_BUFFER) {
+        struct iovec iov = { chunk, sizeof(chunk) };
+        struct msghdr msg;
+        msg.msg_name = NULL;
+        msg.msg_namelen = 0;
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = cbuf;
+        msg.msg_controllen = sizeof(cbuf);
+        msg.msg_flags = 0;
+
+        ssize_t ret = recvmsg(sock, &msg, MSG_DONTWAIT);
+        if (ret > 0) {
+            if ((rxPos > 0) && (rxPos >= (rxBuf.size() / 2))) {
+                rxBuf.erase(rxBuf.begin(), rxBuf.begin() + rxPos);
+                rxPos = 0;
+            }
+            for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+                if ((cmsg->cmsg_level == SOL_SOCKET) && (cmsg->cmsg_type == SCM_RIGHTS)) {
+                    size_t num = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+                    int* fds = reinterpret_cast<int*>(CMSG_DATA(cmsg));
+                    for (size_t i = 0; i < num; ++i) {
+                        rxFds.push_back(fds[i]);
+                    }
+                }
+            }
+            rxBuf.insert(rxBuf.end(), chunk, chunk + ret);
+        } else if (ret == 0) {
+            return ER_SOCK_OTHER_END_CLOSED;
+        } else if (errno == EINTR) {
+            continue;
+        } else if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
+            break;
+        } else if (errno == ECONNRESET) {
+            return ER_SOCK_OTHER_END_CLOSED;
+        } else {
+            QCC_LogError(ER_OS_ERROR, ("recvmsg failed: %d - %s", errno, strerror(errno)));
+            return ER_OS_ERROR;
+        }
+    }
+    return ER_OK;
+}
+
+QStatus ReactorStream::Flush()
+{
+    while (txPos < txBuf.size()) {
+        size_t offset = txBase + txPos;
+        size_t len = txBuf.size() - txPos;
+        size_t numFds = 0;
+        char cbuf[CMSG_SPACE(sizeof(int) * SOCKET_MAX_FILE_DESCRIPTORS)];
+
+        /*
+         * File descriptors must go out with the first byte of the message they belong to so the
+         * send is cut short at the next message that carries file descriptors.
+         */
+        for (deque<FdEntry>::const_iterator it = txFds.begin(); it != txFds.end(); ++it) {
+            if (it->offset > offset) {
+                len = (std::min)(len, it->offset - offset);
+                break;
+            }
+            ++numFds;
+        }
+        numFds = (std::min)(numFds, (size_t)SOCKET_MAX_FILE_DESCRIPTORS);
+
+        struct iovec iov = { &txBuf[txPos], len };
+        struct msghdr msg;
+        msg.msg_name = NULL;
+        msg.msg_namelen = 0;
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = NULL;
+        msg.msg_controllen = 0;
+        msg.msg_flags = 0;
+        if (numFds > 0) {
+            msg.msg_control = cbuf;
+            msg.msg_controllen = CMSG_SPACE(sizeof(int) * numFds);
+            struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+            cmsg->cmsg_level = SOL_SOCKET;
+            cmsg->cmsg_type = SCM_RIGHTS;
+            cmsg->cmsg_len = CMSG_LEN(sizeof(int) * numFds);
+            int* fds = reinterpret_cast<int*>(CMSG_DATA(cmsg));
+            for (size_t i = 0; i < numFds; ++i) {
+                fds[i] = txFds[i].fd;
+            }
+        }
+
+        ssize_t ret = sendmsg(sock, &msg, MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (ret > 0) {
+            while (numFds--) {
+                qcc::Close(txFds.front().fd);
+                txFds.pop_front();
+            }
+            txPos += ret;
+            ++numWrites;
+        } else if ((ret < 0) && (errno == EINTR)) {
+            continue;
+        } else if ((ret < 0) && ((errno == EAGAIN) || (errno == EWOULDBLOCK))) {
+            return ER_OK;
+        } else if ((ret < 0) && ((errno == EPIPE) || (errno == ECONNRESET))) {
+            return ER_SOCK_OTHER_END_CLOSED;
+        } else {
+            QCC_LogError(ER_OS_ERROR, ("sendmsg failed: %d - %s", errno, strerror(errno)));
+            return ER_OS_ERROR;
+        }
+    }
+    txBase += txBuf.size();
+    txBuf.clear();
+    txPos = 0;
+    return ER_OK;
+}
+
+EndpointReactor::EndpointReactor(uint32_t numThreads) : nextThread(0)
+{
+    if (numThreads == 0) {
+        long numCpus = sysconf(_SC_NPROCESSORS_ONLN);
+        numThreads = (numCpus > 0) ? numCpus : 1;
+    }
+    for (uint32_t i = 0; i < numThreads; ++i) {
+        threads.push_back(new ReactorThread(*this, (qcc::String("reactor-") + U32ToString(i)).c_str()));
+    }
+}
+
+bool EndpointReactor::IsSupported()
+{
+    return true;
+}
+
+EndpointReactor::ReactorThread::ReactorThread(EndpointReactor& reactor, const char* name) :
+    qcc::Thread(name), reactor(reactor), epollFd(-1), current(NULL)
+{
+    wakeFds[0] = -1;
+    wakeFds[1] = -1;
+    idle.SetEvent();
+}
+
+EndpointReactor::ReactorThread::~ReactorThread()
+{
+    if (epollFd != -1) {
+        close(epollFd);
+    }
+    if (wakeFds[0] != -1) {
+        close(wakeFds[0]);
+        close(wakeFds[1]);
+    }
+}
+
+QStatus EndpointReactor::ReactorThread::Init()
+{
+    epollFd = epoll_create(MAX_EVENTS);
+    if (epollFd == -1) {
+        QCC_LogError(ER_OS_ERROR, ("epoll_create failed: %d - %s", errno, strerror(errno)));
+        return ER_OS_ERROR;
+    }
+    if (pipe(wakeFds) == -1) {
+        QCC_LogError(ER_OS_ERROR, ("pipe failed: %d - %s", errno, strerror(errno)));
+        wakeFds[0] = wakeFds[1] = -1;
+        return ER_OS_ERROR;
+    }
+    fcntl(wakeFds[0], F_SETFL, fcntl(wakeFds[0], F_GETFL) | O_NONBLOCK);
+    fcntl(wakeFds[1], F_SETFL, fcntl(wakeFds[1], F_GETFL) | O_NONBLOCK);
+
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.ptr = NULL;
+    if (epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeFds[0], &ev) == -1) {
+        QCC_LogError(ER_OS_ERROR, ("epoll_ctl failed: %d - %s", errno, strerror(errno)));
+        return ER_OS_ERROR;
+    }
+    return ER_OK;
+}
+
+QStatus EndpointReactor::ReactorThread::Add(RemoteEndpoint& ep)
+{
+    QStatus status = ER_OK;
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.ptr = &ep;
+
+    lock.Lock();
+    if (epoll_ctl(epollFd, EPOLL_CTL_ADD, ep.GetReactorStream()->GetSocketFd(), &ev) == -1) {
+        status = ER_OS_ERROR;
+        QCC_LogError(status, ("epoll_ctl failed: %d - %s", errno, strerror(errno)));
+    } else {
+        endpoints.insert(&ep);
+    }
+    lock.Unlock();
+
+    /* Messages may have been queued for the endpoint before it was added */
+    if (status == ER_OK) {
+        status = Wake(&ep);
+    }
+    return status;
+}
+
+bool EndpointReactor::ReactorThread::Remove(RemoteEndpoint& ep)
+{
+    lock.Lock();
+    bool found = (endpoints.erase(&ep) > 0);
+    if (found) {
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        epoll_ctl(epollFd, EPOLL_CTL_DEL, ep.GetReactorStream()->GetSocketFd(), &ev);
+        writers.erase(&ep);
+        vector<RemoteEndpoint*>::iterator it = wakeList.begin();
+        while (it != wakeList.end()) {
+            if (*it == &ep) {
+                it = wakeList.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+    /*
+     * Wait for any dispatch that is already in progress unless we are the thread that is
+     * servicing the endpoint.
+     */
+    while ((current == &ep) && (Thread::GetThread() != this)) {
+        lock.Unlock();
+        Event::Wait(idle);
+        lock.Lock();
+    }
+    lock.Unlock();
+    return found;
+}
+
+QStatus EndpointReactor::ReactorThread::Wake(RemoteEndpoint* ep)
+{
+    lock.Lock();
+    if (ep && (endpoints.find(ep) == endpoints.end())) {
+        lock.Unlock();
+        return ER_BUS_ENDPOINT_CLOSING;
+    }
+    bool wasEmpty = wakeList.empty();
+    if (ep) {
+        wakeList.push_back(ep);
+    }
+    lock.Unlock();
+
+    if ((wasEmpty || !ep) && (wakeFds[1] != -1)) {
+        uint8_t b = 0;
+        if ((write(wakeFds[1], &b, 1) == -1) && (errno != EAGAIN)) {
+            QCC_LogError(ER_OS_ERROR, ("write failed: %d - %s", errno, strerror(errno)));
+            return ER_OS_ERROR;
+        }
+    }
+    return ER_OK;
+}
+
+void EndpointReactor::ReactorThread::Shutdown()
+{
+    Stop();
+    Wake(NULL);
+}
+
+bool EndpointReactor::ReactorThread::Claim(RemoteEndpoint* ep)
+{
+    lock.Lock();
+    bool claimed = (endpoints.find(ep) != endpoints.end());
+    if (claimed) {
+        current = ep;
+        idle.ResetEvent();
+    }
+    lock.Unlock();
+    return claimed;
+}
+
+void EndpointReactor::ReactorThread::Arm(RemoteEndpoint* ep, bool wantWrite)
+{
+    lock.Lock();
+    bool armed = (writers.find(ep) != writers.end());
+    if (armed != wantWrite) {
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = wantWrite ? (EPOLLIN | EPOLLOUT) : EPOLLIN;
+        ev.data.ptr = ep;
+        if (epoll_ctl(epollFd, EPOLL_CTL_MOD, ep->GetReactorStream()->GetSocketFd(), &ev) == -1) {
+            QCC_LogError(ER_OS_ERROR, ("epoll_ctl failed: %d - %s", errno, strerror(errno)));
+        } else if (wantWrite) {
+            writers.insert(ep);
+        } else {
+            writers.erase(ep);
+        }
+    }
+    lock.Unlock();
+}
+
+void EndpointReactor::ReactorThread::Service(RemoteEndpoint* ep, bool readable)
+{
+    if (!Claim(ep)) {
+        return;
+    }
+    QStatus status = ER_OK;
+    if (readable) {
+        status = ep->ReactorRead();
+    }
+    if (status == ER_OK) {
+        status = ep->ReactorWrite();
+    }
+    if (status == ER_OK) {
+        Arm(ep, ep->GetReactorStream()->HasPendingTx());
+    } else {
+        reactor.RemoveEndpoint(*ep);
+        /* The endpoint is typically deleted by this call */
+        ep->ReactorExit(status);
+    }
+    lock.Lock();
+    current = NULL;
+    idle.SetEvent();
+    lock.Unlock();
+}
+
+void* EndpointReactor::ReactorThread::Run(void* arg)
+{
+    struct epoll_event events[MAX_EVENTS];
+    vector<RemoteEndpoint*> woken;
+    QStatus status = ER_OK;
+
+    reactorThreadsLock.Lock();
+    reactorThreads.insert(this);
+    reactorThreadsLock.Unlock();
+
+    while (!IsStopping()) {
+        int n = epoll_wait(epollFd, events, MAX_EVENTS, -1);
+        if (n == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            status = ER_OS_ERROR;
+            QCC_LogError(status, ("epoll_wait failed: %d - %s", errno, strerror(errno)));
+            break;
+        }
+        bool wake = false;
+        for (int i = 0; i < n; ++i) {
+            RemoteEndpoint* ep = reinterpret_cast<RemoteEndpoint*>(events[i].data.ptr);
+            if (ep) {
+                Service(ep, (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) != 0);
+            } else {
+                uint8_t buf[64];
+                while (read(wakeFds[0], buf, sizeof(buf)) > 0) {
+                }
+                wake = true;
+            }
+        }
+        if (wake) {
+            lock.Lock();
+            woken.swap(wakeList);
+            lock.Unlock();
+            for (size_t i = 0; i < woken.size(); ++i) {
+                Service(woken[i], false);
+            }
+            woken.clear();
+        }
+    }
+
+    reactorThreadsLock.Lock();
+    reactorThreads.erase(this);
+    reactorThreadsLock.Unlock();
+    return (void*) status;
+}
+
+#else
+
+QStatus ReactorStream::Fill()
+{
+    return ER_NOT_IMPLEMENTED;
+}
+
+QStatus ReactorStream::Flush()
+{
+    return ER_NOT_IMPLEMENTED;
+}
+
+EndpointReactor::EndpointReactor(uint32_t numThreads) : nextThread(0)
+{
+}
+
+bool EndpointReactor::IsSupported()
+{
+    return false;
+}
+
+EndpointReactor::ReactorThread::ReactorThread(EndpointReactor& reactor, const char* name) :
+    qcc::Thread(name), reactor(reactor), epollFd(-1), current(NULL)
+{
+}
+
+EndpointReactor::ReactorThread::~ReactorThread()
+{
+}
+
+QStatus EndpointReactor::ReactorThread::Init()
+{
+    return ER_NOT_IMPLEMENTED;
+}
+
+QStatus EndpointReactor::ReactorThread::Add(RemoteEndpoint& ep)
+{
+    return ER_NOT_IMPLEMENTED;
+}
+
+bool EndpointReactor::ReactorThread::Remove(RemoteEndpoint& ep)
+{
+    return false;
+}
+
+QStatus EndpointReactor::ReactorThread::Wake(RemoteEndpoint* ep)
+{
+    return ER_BUS_ENDPOINT_CLOSING;
+}
+
+void EndpointReactor::ReactorThread::Shutdown()
+{
+}
+
+void* EndpointReactor::ReactorThread::Run(void* arg)
+{
+    return (void*) ER_NOT_IMPLEMENTED;
+}
+
+#endif
+
+EndpointReactor::~EndpointReactor()
+{
+    Stop();
+    Join();
+    for (size_t i = 0; i < threads.size(); ++i) {
+        delete threads[i];
+    }
+}
+
+QStatus EndpointReactor::Start()
+{
+    QStatus status = threads.empty() ? ER_NOT_IMPLEMENTED : ER_OK;
+    for (size_t i = 0; (status == ER_OK) && (i < threads.size()); ++i) {
+        status = threads[i]->Init();
+        if (status == ER_OK) {
+            status = threads[i]->Start();
+        }
+    }
+    if (status != ER_OK) {
+        QCC_LogError(status, ("EndpointReactor::Start failed"));
+        Stop();
+        Join();
+    }
+    return status;
+}
+
+QStatus EndpointReactor::Stop()
+{
+    for (size_t i = 0; i < threads.size(); ++i) {
+        threads[i]->Shutdown();
+    }
+    return ER_OK;
+}
+
+QStatus EndpointReactor::Join()
+{
+    for (size_t i = 0; i < threads.size(); ++i) {
+        threads[i]->Join();
+    }
+    return ER_OK;
+}
+
+QStatus EndpointReactor::AddEndpoint(RemoteEndpoint& ep)
+{
+    QStatus status = ER_NOT_IMPLEMENTED;
+    ownersLock.Lock();
+    if (!threads.empty()) {
+        ReactorThread* thread = threads[nextThread++ % threads.size()];
+        status = thread->Add(ep);
+        if (status == ER_OK) {
+            owners[&ep] = thread;
+        }
+    }
+    ownersLock.Unlock();
+    return status;
+}
+
+bool EndpointReactor::RemoveEndpoint(RemoteEndpoint& ep)
+{
+    ownersLock.Lock();
+    map<RemoteEndpoint*, ReactorThread*>::iterator it = owners.find(&ep);
+    if (it == owners.end()) {
+        ownersLock.Unlock();
+        return false;
+    }
+    ReactorThread* thread = it->second;
+    owners.erase(it);
+    ownersLock.Unlock();
+    return thread->Remove(ep);
+}
+
+QStatus EndpointReactor::WakeEndpoint(RemoteEndpoint& ep)
+{
+    QStatus status = ER_BUS_ENDPOINT_CLOSING;
+    ownersLock.Lock();
+    map<RemoteEndpoint*, ReactorThread*>::iterator it = owners.find(&ep);
+    if (it != owners.end()) {
+        status = it->second->Wake(&ep);
+    }
+    ownersLock.Unlock();
+    return status;
+}
+
+bool EndpointReactor::IsReactorThread()
+{
+    const Thread* self = Thread::GetThread();
+    reactorThreadsLock.Lock();
+    bool isReactor = (reactorThreads.find(self) != reactorThreads.end());
+    reactorThreadsLock.Unlock();
+    return isReactor;
+}
+
+}
@@ -0,0 +1,347 @@
+/**
+ * @file
+ * EndpointReactor multiplexes the sockets of many RemoteEndpoints over a small
+ * fixed pool of threads.
+ */
+
+/******************************************************************************
+ * Copyright 2011, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+#ifndef _ALLJOYN_ENDPOINTREACTOR_H
+#define _ALLJOYN_ENDPOINTREACTOR_H
+
+#include <qcc/platform.h>
+
+#include <deque>
+#include <map>
+#include <set>
+#include <vector>
+
+#include <qcc/Event.h>
+#include <qcc/Mutex.h>
+#include <qcc/Socket.h>
+#include <qcc/Stream.h>
+#include <qcc/Thread.h>
+
+#include <Status.h>
+
+namespace ajn {
+
+/** @internal Forward references */
+class RemoteEndpoint;
+
+/**
+ * Buffered, non-blocking stream used by a RemoteEndpoint while it is being serviced by an
+ * EndpointReactor. Received bytes are buffered until a complete message is available so
+ * _Message::Unmarshal never blocks, and marshaled messages are buffered until the socket
+ * accepts them.
+ */
+class ReactorStream : public qcc::Stream {
+  public:
+
+    /**
+     * Constructor
+     *
+     * @param sock   Connected, non-blocking socket. The stream does not take ownership.
+     */
+    ReactorStream(qcc::SocketFd sock);
+
+    /**
+     * Destructor
+     */
+    ~ReactorStream();
+
+    /**
+     * Pull bytes from the receive buffer.
+     *
+     * @param buf          Buffer to store pulled bytes
+     * @param reqBytes     Number of bytes requested to be pulled from source.
+     * @param actualBytes  Actual number of bytes retrieved from source.
+     * @param timeout      Ignored, the receive buffer never blocks.
+     * @return   ER_OK if successful, ER_WOULDBLOCK if the receive buffer is empty.
+     */
+    QStatus PullBytes(void* buf, size_t reqBytes, size_t& actualBytes, uint32_t timeout = qcc::Event::WAIT_FOREVER);
+
+    /**
+     * Pull bytes from the receive buffer. File descriptors are never returned here because a
+     * single read from the socket may span several messages, use PullFds() instead.
+     *
+     * @param buf          Buffer to store pulled bytes
+     * @param reqBytes     Number of bytes requested to be pulled from source.
+     * @param actualBytes  Actual number of bytes retrieved from source.
+     * @param fdList       Unused.
+     * @param numFds       [OUT] Always set to 0.
+     * @param timeout      Ignored, the receive buffer never blocks.
+     * @return   ER_OK if successful, ER_WOULDBLOCK if the receive buffer is empty.
+     */
+    QStatus PullBytesAndFds(void* buf, size_t reqBytes, size_t& actualBytes, qcc::SocketFd* fdList, size_t& numFds, uint32_t timeout = qcc::Event::WAIT_FOREVER);
+
+    /**
+     * Take file descriptors from the queue of received file descriptors in the order they
+     * arrived. The caller owns the returned file descriptors.
+     *
+     * @param fdList   Array to receive the file descriptors.
+     * @param numFds   Maximum number of file descriptors to take.
+     * @return  The number of file descriptors returned in fdList.
+     */
+    size_t PullFds(qcc::SocketFd* fdList, size_t numFds);
+
+    /**
+     * Append bytes to the transmit buffer.
+     *
+     * @param buf       Buffer to be pushed.
+     * @param numBytes  Number of bytes from buf to send to sink.
+     * @param numSent   Number of bytes actually consumed by sink.
+     * @return   ER_OK
+     */
+    QStatus PushBytes(const void* buf, size_t numBytes, size_t& numSent);
+
+    /**
+     * Append bytes and file descriptors to the transmit buffer. The file descriptors are
+     * duplicated and will be sent with the first of the pushed bytes.
+     *
+     * @param buf       Buffer to be pushed.
+     * @param numBytes  Number of bytes from buf to send to sink.
+     * @param numSent   Number of bytes actually consumed by sink.
+     * @param fdList    Array of file descriptors to send.
+     * @param numFds    Number of files descriptors to send.
+     * @param pid       Process id (unused).
+     * @return   ER_OK if successful.
+     */
+    QStatus PushBytesAndFds(const void* buf, size_t numBytes, size_t& numSent, qcc::SocketFd* fdList, size_t numFds, uint32_t pid = -1);
+
+    /**
+     * Read whatever the socket has available without blocking.
+     *
+     * @return
+     *      - ER_OK if the socket was drained or the receive buffer is full.
+     *      - ER_SOCK_OTHER_END_CLOSED if the peer closed the connection.
+     *      - An error status otherwise.
+     */
+    QStatus Fill();
+
+    /**
+     * Indicate whether the receive buffer holds at least one complete message. A malformed
+     * message header is reported as complete so that _Message::Unmarshal() can reject it.
+     *
+     * @return  true if a complete message can be unmarshaled without blocking.
+     */
+    bool HasMessage() const;
+
+    /**
+     * Write as much of the transmit buffer as the socket accepts without blocking.
+     *
+     * @return  ER_OK if successful (even if some bytes remain unsent).
+     */
+    QStatus Flush();
+
+    /**
+     * Indicate whether the transmit buffer still holds unsent bytes.
+     *
+     * @return  true if Flush() must be called again when the socket becomes writable.
+     */
+    bool HasPendingTx() const { return txPos < txBuf.size(); }
+
+    /**
+     * Get the number of bytes in the transmit buffer that have not been sent yet.
+     *
+     * @return  The number of unsent bytes.
+     */
+    size_t GetPendingTx() const { return txBuf.size() - txPos; }
+
+    /**
+     * Get the number of successful writes to the socket.
+     *
+     * @return  The number of sendmsg calls that sent data.
+     */
+    uint32_t GetNumWrites() const { return numWrites; }
+
+    /**
+     * Get the socket used by this stream.
+     *
+     * @return  The socket file descriptor.
+     */
+    qcc::SocketFd GetSocketFd() const { return sock; }
+
+  private:
+
+    /** Maximum number of received bytes buffered before reading is paused */
+    static const size_t MAX_RX_BUFFER = 256 * 1024;
+
+    /** File descriptors to be sent with the byte at a given stream offset */
+    struct FdEntry {
+        size_t offset;
+        qcc::SocketFd fd;
+        FdEntry(size_t offset, qcc::SocketFd fd) : offset(offset), fd(fd) { }
+    };
+
+    /**
+     * Assignment and copy are not allowed.
+     */
+    ReactorStream(const ReactorStream& other);
+    ReactorStream& operator=(const ReactorStream& other);
+
+    qcc::SocketFd sock;                /**< Socket being serviced */
+    std::vector<uint8_t> rxBuf;        /**< Received bytes */
+    size_t rxPos;                      /**< Offset of the first unconsumed byte in rxBuf */
+    std::deque<qcc::SocketFd> rxFds;   /**< Received file descriptors not yet pulled */
+    std::vector<uint8_t> txBuf;        /**< Bytes waiting to be sent */
+    size_t txPos;                      /**< Offset of the first unsent byte in txBuf */
+    size_t txBase;                     /**< Stream offset of txBuf[0] */
+    std::deque<FdEntry> txFds;         /**< Duplicated file descriptors waiting to be sent */
+    uint32_t numWrites;                /**< Number of sendmsg calls that sent data */
+};
+
+/**
+ * %EndpointReactor services the sockets of RemoteEndpoints with a small fixed pool of threads
+ * instead of a receive and a transmit thread per endpoint. It is only available on platforms
+ * with epoll; elsewhere IsSupported() returns false and endpoints fall back to their own
+ * threads.
+ */
+class EndpointReactor {
+  public:
+
+    /**
+     * Constructor
+     *
+     * @param numThreads  Number of reactor threads or 0 for one per online processor.
+     */
+    EndpointReactor(uint32_t numThreads = 0);
+
+    /**
+     * Destructor
+     */
+    ~EndpointReactor();
+
+    /**
+     * Indicate whether the reactor is implemented on this platform.
+     *
+     * @return  true if endpoints can be added to a reactor.
+     */
+    static bool IsSupported();
+
+    /**
+     * Start the reactor threads.
+     *
+     * @return ER_OK if successful.
+     */
+    QStatus Start();
+
+    /**
+     * Request the reactor threads to stop.
+     *
+     * @return ER_OK if successful.
+     */
+    QStatus Stop();
+
+    /**
+     * Wait for the reactor threads to exit.
+     *
+     * @return ER_OK if successful.
+     */
+    QStatus Join();
+
+    /**
+     * Start servicing an endpoint. The endpoint must already be in reactor mode (see
+     * RemoteEndpoint::Start()).
+     *
+     * @param ep   Endpoint to service.
+     * @return ER_OK if successful.
+     */
+    QStatus AddEndpoint(RemoteEndpoint& ep);
+
+    /**
+     * Stop servicing an endpoint. When this returns no reactor thread is (or will be) using the
+     * endpoint unless it was called from the reactor thread that is servicing the endpoint.
+     *
+     * @param ep   Endpoint to remove.
+     * @return  true if the endpoint was being serviced by this reactor.
+     */
+    bool RemoveEndpoint(RemoteEndpoint& ep);
+
+    /**
+     * Ask the reactor thread that services an endpoint to drain its transmit queue.
+     *
+     * @param ep   Endpoint with work to do.
+     * @return ER_OK if successful, ER_BUS_ENDPOINT_CLOSING if the endpoint is not being serviced.
+     */
+    QStatus WakeEndpoint(RemoteEndpoint& ep);
+
+    /**
+     * Indicate whether the calling thread is a thread of any reactor. A reactor thread must never
+     * block waiting for another endpoint because that endpoint may be serviced by the same thread,
+     * and all the endpoints the thread services would stall while it waits.
+     *
+     * @return  true if called from a reactor thread.
+     */
+    static bool IsReactorThread();
+
+    /**
+     * Get the number of reactor threads.
+     *
+     * @return  The number of reactor threads.
+     */
+    size_t GetNumThreads() const { return threads.size(); }
+
+  private:
+
+    /**
+     * Thread that waits for socket readiness on its own epoll set.
+     */
+    class ReactorThread : public qcc::Thread {
+      public:
+        ReactorThread(EndpointReactor& reactor, const char* name);
+        ~ReactorThread();
+
+        QStatus Init();
+        QStatus Add(RemoteEndpoint& ep);
+        bool Remove(RemoteEndpoint& ep);
+        QStatus Wake(RemoteEndpoint* ep);
+        void Shutdown();
+
+      protected:
+        qcc::ThreadReturn STDCALL Run(void* arg);
+
+      private:
+        void Service(RemoteEndpoint* ep, bool readable);
+        bool Claim(RemoteEndpoint* ep);
+        void Arm(RemoteEndpoint* ep, bool wantWrite);
+
+        EndpointReactor& reactor;                      /**< Reactor that owns this thread */
+        int epollFd;                                   /**< epoll set for this thread */
+        int wakeFds[2];                                /**< Pipe used to interrupt epoll_wait */
+        std::set<RemoteEndpoint*> endpoints;           /**< Endpoints serviced by this thread */
+        std::set<RemoteEndpoint*> writers;             /**< Endpoints currently armed for EPOLLOUT */
+        std::vector<RemoteEndpoint*> wakeList;         /**< Endpoints with queued transmit work */
+        RemoteEndpoint* current;                       /**< Endpoint being serviced right now */
+        qcc::Event idle;                               /**< Set while current is NULL */
+        mutable qcc::Mutex lock;                       /**< Protects endpoints, wakeList, current and idle */
+    };
+
+    /**
+     * Assignment and copy are not allowed.
+     */
+    EndpointReactor(const EndpointReactor& other);
+    EndpointReactor& operator=(const EndpointReactor& other);
+
+    std::vector<ReactorThread*> threads;                       /**< Reactor threads */
+    std::map<RemoteEndpoint*, ReactorThread*> owners;          /**< Thread servicing each endpoint */
+    uint32_t nextThread;                                       /**< Round-robin index for the next endpoint added */
+    qcc::Mutex ownersLock;                                     /**< Protects owners and nextThread */
+};
+
+}
+
+#endif
@@ -23,6 +23,14 @@
 #include <map>
 
 #include <qcc/platform.h>
+
+#include <stdio.h>
+#if !defined(QCC_OS_WINDOWS)
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 #include <qcc/Debug.h>
 #include <qcc/String.h>
 #include <qcc/Crypto.h>
@@ -50,6 +58,24 @@ namespace ajn {
 
 static const uint16_t KeyStoreVersion = 0x0102;
 
+static const uint16_t KeyStoreJournalVersion = 0x0001;
+
+/* Journal record operations */
+static const uint8_t JOURNAL_ADD_KEY = 1;
+static const uint8_t JOURNAL_DEL_KEY = 2;
+
+/*
+ * Nonce for a journal record. The sequence number is never zero so the nonce is always distinct
+ * from the nonce used to encrypt the key store itself.
+ */
+static KeyBlob JournalNonce(uint32_t revision, uint32_t seq)
+{
+    uint8_t nd[sizeof(revision) + sizeof(seq)];
+    memcpy(nd, &revision, sizeof(revision));
+    memcpy(nd + sizeof(revision), &seq, sizeof(seq));
+    return KeyBlob(nd, sizeof(nd), KeyBlob::GENERIC);
+}
+
 
 QStatus KeyStoreListener::PutKeys(KeyStore& keyStore, const qcc::String& source, const qcc::String& password)
 {
@@ -77,6 +103,7 @@ class DefaultKeyStoreListener : public KeyStoreListener {
         } else {
             fileName = GetHomeDir() + "/.alljoyn_keystore/" + application;
         }
+        journalName = fileName + ".journal";
     }
 
     QStatus LoadRequest(KeyStore& keyStore) {
@@ -89,6 +116,12 @@ class DefaultKeyStoreListener : public KeyStoreListener {
                 status = keyStore.Pull(source, fileName);
                 if (status == ER_OK) {
                     QCC_DbgHLPrintf(("Read key store from %s", fileName.c_str()));
+                    if (!keyStore.IsShared()) {
+                        FileSource journal(journalName);
+                        if (journal.IsValid()) {
+                            status = keyStore.PullJournal(journal);
+                        }
+                    }
                 }
                 source.Unlock();
                 return status;
@@ -124,12 +157,40 @@ class DefaultKeyStoreListener : public KeyStoreListener {
 
     QStatus StoreRequest(KeyStore& keyStore) {
         QStatus status;
+        /*
+         * Shared key stores are merged with changes from other applications so are always stored
+         * in full. Otherwise just append the changes to the journal.
+         */
+        if (!keyStore.IsShared() && !keyStore.JournalNeedsCompaction()) {
+            StringSink records;
+            status = keyStore.PushJournal(records);
+            if (status == ER_OK) {
+                status = AppendJournal(records.GetString());
+            }
+            if (status == ER_OK) {
+                QCC_DbgHLPrintf(("Appended %u bytes to key store journal %s", static_cast<uint32_t>(records.GetString().size()), journalName.c_str()));
+                return status;
+            }
+            QCC_LogError(status, ("Cannot append to key store journal %s", journalName.c_str()));
+            /*
+             * The changes are only in memory now so they stay pending until the key store is
+             * written in full, either below or on the next store request.
+             */
+            keyStore.JournalFailed();
+        }
         FileSink sink(fileName, FileSink::PRIVATE);
         if (sink.IsValid()) {
             sink.Lock(true);
             status = keyStore.Push(sink);
             if (status == ER_OK) {
                 QCC_DbgHLPrintf(("Wrote key store to %s", fileName.c_str()));
+                /*
+                 * All changes are in the key store so start a new journal.
+                 */
+                FileSink journal(journalName, FileSink::PRIVATE);
+                if (!journal.IsValid()) {
+                    QCC_LogError(ER_BUS_WRITE_ERROR, ("Cannot truncate key store journal %s", journalName.c_str()));
+                }
             }
             sink.Unlock();
         } else {
@@ -141,7 +202,37 @@ class DefaultKeyStoreListener : public KeyStoreListener {
 
   private:
 
+    QStatus AppendJournal(const qcc::String& records) {
+        QStatus status = ER_OK;
+        if (!records.empty()) {
+#if defined(QCC_OS_WINDOWS)
+            FILE* journal = fopen(journalName.c_str(), "ab");
+#else
+            /*
+             * A new journal must be created with the same private permissions as the key store.
+             */
+            FILE* journal = NULL;
+            int fd = open(journalName.c_str(), O_WRONLY | O_APPEND | O_CREAT, S_IRUSR | S_IWUSR);
+            if (fd >= 0) {
+                journal = fdopen(fd, "ab");
+                if (!journal) {
+                    close(fd);
+                }
+            }
+#endif
+            if (!journal) {
+                return ER_BUS_WRITE_ERROR;
+            }
+            if ((fwrite(records.data(), 1, records.size(), journal) != records.size()) || (fflush(journal) != 0)) {
+                status = ER_BUS_WRITE_ERROR;
+            }
+            fclose(journal);
+        }
+        return status;
+    }
+
     qcc::String fileName;
+    qcc::String journalName;
 
 };
 
@@ -149,6 +240,12 @@ KeyStore::KeyStore(const qcc::String& application) :
     application(application),
     storeState(UNAVAILABLE),
     keys(new KeyMap),
+    journalSeq(0),
+    journalLen(0),
+    storeLen(0),
+    compact(true),
+    flushPending(false),
+    flushThread(*this),
     defaultListener(NULL),
     listener(NULL),
     thisGuid(),
@@ -161,6 +258,14 @@ KeyStore::KeyStore(const qcc::String& application) :
 
 KeyStore::~KeyStore()
 {
+    /* Perform any store that was requested but not yet done */
+    if (flushThread.IsRunning()) {
+        flushThread.Stop();
+        flushThread.Join();
+    }
+    if (flushPending) {
+        Flush();
+    }
     /* Unblock thread that might be waiting for a store to complete */
     lock.Lock();
     if (stored) {
@@ -203,13 +308,63 @@ QStatus KeyStore::Init(const char* fileName, bool isShared)
             listener = defaultListener = new DefaultKeyStoreListener(application, fileName);
         }
         shared = isShared;
-        return Load();
+        QStatus status = Load();
+        flushThread.Start();
+        return status;
     } else {
         return ER_FAIL;
     }
 }
 
 QStatus KeyStore::Store()
+{
+    /* Cannot store if never loaded */
+    if (storeState == UNAVAILABLE) {
+        return ER_BUS_KEYSTORE_NOT_LOADED;
+    }
+    /* Don't store if not modified */
+    if (storeState == MODIFIED) {
+        lock.Lock();
+        flushPending = true;
+        lock.Unlock();
+        if (flushThread.IsRunning()) {
+            flushThread.Alert();
+        } else {
+            return Flush();
+        }
+    }
+    return ER_OK;
+}
+
+ThreadReturn STDCALL KeyStore::FlushThread::Run(void* arg)
+{
+    Event evt(Event::WAIT_FOREVER);
+    while (!IsStopping()) {
+        evt.ResetTime(Event::WAIT_FOREVER, 0);
+        QStatus status = Event::Wait(evt);
+        if (status == ER_ALERTED_THREAD) {
+            stopEvent.ResetEvent();
+        }
+        if (IsStopping()) {
+            break;
+        }
+        /*
+         * Give other threads that are modifying the key store a chance to do so before storing
+         * so a burst of changes results in a single store.
+         */
+        evt.ResetTime(FLUSH_DELAY, 0);
+        Event::Wait(evt);
+        keyStore.lock.Lock();
+        bool flush = keyStore.flushPending;
+        keyStore.lock.Unlock();
+        if (!IsStopping() && flush) {
+            keyStore.Flush();
+        }
+    }
+    return 0;
+}
+
+QStatus KeyStore::Flush()
 {
     QStatus status = ER_OK;
 
@@ -217,6 +372,10 @@ QStatus KeyStore::Store()
     if (storeState == UNAVAILABLE) {
         return ER_BUS_KEYSTORE_NOT_LOADED;
     }
+    flushLock.Lock();
+    lock.Lock();
+    flushPending = false;
+    lock.Unlock();
     /* Don't store if not modified */
     if (storeState == MODIFIED) {
 
@@ -244,6 +403,7 @@ QStatus KeyStore::Store()
         }
         lock.Unlock();
     }
+    flushLock.Unlock();
     return status;
 }
 
@@ -274,6 +434,7 @@ size_t KeyStore::EraseExpiredKeys()
         KeyMap::iterator current = it++;
         if (current->second.key.HasExpired()) {
             QCC_DbgPrintf(("Deleting expired key for GUID %s", current->first.ToString().c_str()));
+            journalPending.insert(current->first);
             keys->erase(current);
             ++count;
         }
@@ -297,6 +458,12 @@ QStatus KeyStore::Pull(Source& source, const qcc::String& password)
     size_t len = 0;
     uint16_t version;
 
+    /* The journal cannot be used until the keys have been pushed in full */
+    compact = true;
+    journalPending.clear();
+    journalSeq = 0;
+    journalLen = 0;
+
     /* Pull and check the key store version */
     QStatus status = source.PullBytes(&version, sizeof(version), pulled);
     if ((status == ER_OK) && (version != KeyStoreVersion)) {
@@ -383,6 +550,8 @@ QStatus KeyStore::Pull(Source& source, const qcc::String& password)
     if (status != ER_OK) {
         goto ExitPull;
     }
+    storeLen = len;
+    compact = false;
     if (EraseExpiredKeys()) {
         storeState = MODIFIED;
     } else {
@@ -412,8 +581,9 @@ QStatus KeyStore::Clear()
     storeState = MODIFIED;
     revision = 0;
     deletions.clear();
+    compact = true;
     lock.Unlock();
-    listener->StoreRequest(*this);
+    Flush();
     return ER_OK;
 }
 
@@ -569,6 +739,14 @@ QStatus KeyStore::Push(Sink& sink)
         goto ExitPush;
     }
     storeState = LOADED;
+    /*
+     * A new journal is started for the new revision
+     */
+    storeLen = keysLen;
+    compact = false;
+    journalPending.clear();
+    journalSeq = 0;
+    journalLen = 0;
 
 ExitPush:
 
@@ -579,6 +757,227 @@ ExitPush:
     return status;
 }
 
+QStatus KeyStore::PullJournal(Source& source)
+{
+    size_t pulled;
+    uint16_t version;
+    uint32_t rev;
+    size_t numRecords = 0;
+
+    QCC_DbgPrintf(("KeyStore::PullJournal"));
+
+    lock.Lock();
+
+    /* Pull and check the journal version */
+    QStatus status = source.PullBytes(&version, sizeof(version), pulled);
+    if (status == ER_NONE) {
+        /* Empty journal */
+        lock.Unlock();
+        return ER_OK;
+    }
+    if ((status == ER_OK) && (version != KeyStoreJournalVersion)) {
+        status = ER_BUS_KEYSTORE_VERSION_MISMATCH;
+        QCC_LogError(status, ("Keystore journal has wrong version expected %d got %d", KeyStoreJournalVersion, version));
+    }
+    /* Pull the revision of the key store the journal applies to */
+    if (status == ER_OK) {
+        status = source.PullBytes(&rev, sizeof(rev), pulled);
+    }
+    if ((status == ER_OK) && (rev != revision)) {
+        /*
+         * The key store was written in full after this journal was started so the journal is stale.
+         */
+        QCC_DbgHLPrintf(("KeyStore::PullJournal ignoring journal for revision %d", rev));
+        compact = true;
+        storeState = MODIFIED;
+        lock.Unlock();
+        return ER_OK;
+    }
+    if (status == ER_OK) {
+        journalLen = sizeof(version) + sizeof(rev);
+        Crypto_AES aes(*keyStoreKey, Crypto_AES::CCM);
+        while (status == ER_OK) {
+            uint32_t len;
+            uint32_t seq;
+            status = source.PullBytes(&len, sizeof(len), pulled);
+            if (status == ER_NONE) {
+                break;
+            }
+            if ((status == ER_OK) && (pulled != sizeof(len))) {
+                status = ER_BUS_CORRUPT_KEYSTORE;
+            }
+            if (status == ER_OK) {
+                status = source.PullBytes(&seq, sizeof(seq), pulled);
+                if ((status == ER_OK) && (pulled != sizeof(seq))) {
+                    status = ER_BUS_CORRUPT_KEYSTORE;
+                }
+            }
+            /* Sanity check on the length and sequence number */
+            if ((status == ER_OK) && ((len > 64000) || (seq != (journalSeq + 1)))) {
+                status = ER_BUS_CORRUPT_KEYSTORE;
+            }
+            if (status != ER_OK) {
+                break;
+            }
+            uint8_t* data = new uint8_t[len];
+            size_t recLen = len;
+            status = source.PullBytes(data, len, pulled);
+            if ((status == ER_OK) && (pulled != len)) {
+                status = ER_BUS_CORRUPT_KEYSTORE;
+            }
+            /*
+             * Decrypt and apply the journal record.
+             */
+            if (status == ER_OK) {
+                status = aes.Decrypt_CCM(data, data, recLen, JournalNonce(revision, seq), NULL, 0, 16);
+            }
+            if (status == ER_OK) {
+                StringSource recSource(data, recLen);
+                uint8_t op;
+                uint32_t keyRev;
+                uint8_t guidBuf[qcc::GUID128::SIZE];
+                status = recSource.PullBytes(&op, sizeof(op), pulled);
+                if (status == ER_OK) {
+                    status = recSource.PullBytes(&keyRev, sizeof(keyRev), pulled);
+                }
+                if (status == ER_OK) {
+                    status = recSource.PullBytes(guidBuf, qcc::GUID128::SIZE, pulled);
+                }
+                if (status == ER_OK) {
+                    qcc::GUID128 guid;
+                    guid.SetBytes(guidBuf);
+                    if (op == JOURNAL_ADD_KEY) {
+                        KeyRecord keyRec;
+                        keyRec.revision = keyRev;
+                        status = keyRec.key.Load(recSource);
+                        if (status == ER_OK) {
+                            (*keys)[guid] = keyRec;
+                        }
+                    } else if (op == JOURNAL_DEL_KEY) {
+                        keys->erase(guid);
+                    } else {
+                        status = ER_BUS_CORRUPT_KEYSTORE;
+                    }
+                    QCC_DbgPrintf(("KeyStore::PullJournal seq:%d op:%d GUID %s %s", seq, op, QCC_StatusText(status), guid.ToString().c_str()));
+                }
+            }
+            delete [] data;
+            if (status == ER_OK) {
+                journalSeq = seq;
+                journalLen += sizeof(len) + sizeof(seq) + len;
+                ++numRecords;
+            }
+        }
+        if (status == ER_NONE) {
+            status = ER_OK;
+        }
+    }
+    if (status != ER_OK) {
+        /*
+         * Keep the changes up to the bad record, typically a partial write, and rewrite the key
+         * store in full on the next store.
+         */
+        QCC_LogError(status, ("Key store journal is corrupt after %u records", static_cast<uint32_t>(numRecords)));
+        compact = true;
+        storeState = MODIFIED;
+        status = ER_OK;
+    }
+    if (EraseExpiredKeys()) {
+        storeState = MODIFIED;
+    }
+    lock.Unlock();
+    return status;
+}
+
+QStatus KeyStore::PushJournal(Sink& sink)
+{
+    size_t pushed;
+    QStatus status = ER_OK;
+
+    lock.Lock();
+
+    QCC_DbgHLPrintf(("KeyStore::PushJournal (%u changes)", static_cast<uint32_t>(journalPending.size())));
+
+    /*
+     * A journal starts with the version number and the key store revision it applies to.
+     */
+    if (journalLen == 0) {
+        status = sink.PushBytes(&KeyStoreJournalVersion, sizeof(KeyStoreJournalVersion), pushed);
+        if (status == ER_OK) {
+            status = sink.PushBytes(&revision, sizeof(revision), pushed);
+        }
+        if (status == ER_OK) {
+            journalLen = sizeof(KeyStoreJournalVersion) + sizeof(revision);
+        }
+    }
+    /*
+     * Each record is encrypted separately so records can be appended without rewriting the journal.
+     */
+    Crypto_AES aes(*keyStoreKey, Crypto_AES::CCM);
+    std::set<qcc::GUID128>::iterator it = journalPending.begin();
+    while ((status == ER_OK) && (it != journalPending.end())) {
+        StringSink recSink;
+        KeyMap::iterator kit = keys->find(*it);
+        uint8_t op = (kit == keys->end()) ? JOURNAL_DEL_KEY : JOURNAL_ADD_KEY;
+        uint32_t keyRev = (kit == keys->end()) ? revision : kit->second.revision;
+        recSink.PushBytes(&op, sizeof(op), pushed);
+        recSink.PushBytes(&keyRev, sizeof(keyRev), pushed);
+        recSink.PushBytes(it->GetBytes(), qcc::GUID128::SIZE, pushed);
+        if (op == JOURNAL_ADD_KEY) {
+            kit->second.key.Store(recSink);
+        }
+        size_t recLen = recSink.GetString().size();
+        uint32_t seq = journalSeq + 1;
+        uint8_t* data = new uint8_t[recLen + 16];
+        status = aes.Encrypt_CCM(recSink.GetString().data(), data, recLen, JournalNonce(revision, seq), NULL, 0, 16);
+        uint32_t len = static_cast<uint32_t>(recLen);
+        if (status == ER_OK) {
+            status = sink.PushBytes(&len, sizeof(len), pushed);
+        }
+        if (status == ER_OK) {
+            status = sink.PushBytes(&seq, sizeof(seq), pushed);
+        }
+        if (status == ER_OK) {
+            status = sink.PushBytes(data, len, pushed);
+        }
+        delete [] data;
+        if (status == ER_OK) {
+            QCC_DbgPrintf(("KeyStore::PushJournal seq:%d op:%d GUID %s", seq, op, it->ToString().c_str()));
+            journalSeq = seq;
+            journalLen += sizeof(len) + sizeof(seq) + len;
+            journalPending.erase(it++);
+        }
+    }
+    if (status == ER_OK) {
+        storeState = LOADED;
+    } else {
+        /* Records already counted above never reach the journal */
+        compact = true;
+        storeState = MODIFIED;
+    }
+    if (stored) {
+        stored->SetEvent();
+    }
+    lock.Unlock();
+    return status;
+}
+
+void KeyStore::JournalFailed()
+{
+    lock.Lock();
+    compact = true;
+    storeState = MODIFIED;
+    lock.Unlock();
+}
+
+bool KeyStore::JournalNeedsCompaction()
+{
+    lock.Lock();
+    bool needsCompaction = compact || ((journalLen > MIN_COMPACTION_LEN) && (journalLen > storeLen));
+    lock.Unlock();
+    return needsCompaction;
+}
+
 QStatus KeyStore::GetKey(const qcc::GUID128& guid, KeyBlob& key)
 {
     if (storeState == UNAVAILABLE) {
@@ -621,6 +1020,7 @@ QStatus KeyStore::AddKey(const qcc::GUID128& guid, const KeyBlob& key)
     keyRec.key = key;
     storeState = MODIFIED;
     deletions.erase(guid);
+    journalPending.insert(guid);
     lock.Unlock();
     return ER_OK;
 }
@@ -635,9 +1035,9 @@ QStatus KeyStore::DelKey(const qcc::GUID128& guid)
     keys->erase(guid);
     storeState = MODIFIED;
     deletions.insert(guid);
+    journalPending.insert(guid);
     lock.Unlock();
-    listener->StoreRequest(*this);
-    return ER_OK;
+    return Store();
 }
 
 QStatus KeyStore::SetKeyExpiration(const qcc::GUID128& guid, const Timespec& expiration)
@@ -651,12 +1051,13 @@ QStatus KeyStore::SetKeyExpiration(const qcc::GUID128& guid, const Timespec& exp
     if (keys->count(guid) != 0) {
         (*keys)[guid].key.SetExpiration(expiration);
         storeState = MODIFIED;
+        journalPending.insert(guid);
     } else {
         status = ER_BUS_KEY_UNAVAILABLE;
     }
     lock.Unlock();
     if (status == ER_OK) {
-        listener->StoreRequest(*this);
+        status = Store();
     }
     return status;
 }
@@ -36,6 +36,7 @@
 #include <qcc/Mutex.h>
 #include <qcc/Stream.h>
 #include <qcc/Event.h>
+#include <qcc/Thread.h>
 #include <qcc/time.h>
 
 #include <alljoyn/KeyStoreListener.h>
@@ -48,6 +49,11 @@ namespace ajn {
 /**
  * The %KeyStore class manages the storing and loading of key blobs from
  * external storage.
+ *
+ * Stores are write-behind: Store() hands the request to a flusher thread so callers such as the
+ * authentication code never wait for the key store to be written. The default key store listener
+ * also appends changes to a journal next to the key store file rather than rewriting the whole key
+ * store each time, the key store file is only rewritten when the journal needs to be compacted.
  */
 class KeyStore {
   public:
@@ -73,10 +79,25 @@ class KeyStore {
     QStatus Init(const char* fileName, bool isShared);
 
     /**
-     * Requests the key store listener to store the contents of the key store
+     * Requests the key store listener to store the contents of the key store. The store is done
+     * asynchronously by a flusher thread, call Flush() to wait for the store to complete.
+     *
+     * @return
+     *      - ER_OK if the store was requested
+     *      - ER_BUS_KEYSTORE_NOT_LOADED if the key store has not been loaded
      */
     QStatus Store();
 
+    /**
+     * Store the contents of the key store if it has been modified and wait for the store to
+     * complete.
+     *
+     * @return
+     *      - ER_OK if successful
+     *      - An error status otherwise
+     */
+    QStatus Flush();
+
     /**
      * Re-read keys from the key store. This is a no-op unless the key store is shared.
      * If the key store is shared the key store is reloaded merging any changes made by
@@ -214,6 +235,48 @@ class KeyStore {
      */
     QStatus Push(qcc::Sink& sink);
 
+    /**
+     * Pull changes recorded in a journal by PushJournal() and apply them to the keys that were
+     * pulled from the key store. This must be called after Pull() during the same load request. A
+     * journal that does not belong to the current key store revision is ignored and a journal that
+     * ends with a partial or corrupt record is applied up to that record. In both cases the journal
+     * is marked as needing compaction.
+     *
+     * @param source    The source to read the journal from.
+     *
+     * @return
+     *      - ER_OK if successful
+     *      - An error status otherwise
+     */
+    QStatus PullJournal(qcc::Source& source);
+
+    /**
+     * Push the keys that have been added, changed, or deleted since the last push as journal
+     * records to be appended to the journal for the current key store revision.
+     *
+     * @param sink The sink to write the journal records to.
+     *
+     * @return
+     *      - ER_OK if successful
+     *      - An error status otherwise
+     */
+    QStatus PushJournal(qcc::Sink& sink);
+
+    /**
+     * Report that the records from PushJournal() could not be appended to the journal. The
+     * journal no longer matches the keys so the key store is marked as modified and the next store
+     * writes it in full.
+     */
+    void JournalFailed();
+
+    /**
+     * Indicates if the key store must be pushed in full rather than appending to the journal. This
+     * is the case if the journal is invalid or has grown larger than the key store itself.
+     *
+     * @return  Returns true if the journal needs to be compacted.
+     */
+    bool JournalNeedsCompaction();
+
     /**
      * Indicates if this is a shared key store.
      *
@@ -248,6 +311,27 @@ class KeyStore {
      */
     QStatus Load();
 
+    /**
+     * Thread that performs store requests in the background
+     */
+    class FlushThread : public qcc::Thread {
+      public:
+        FlushThread(KeyStore& keyStore) : qcc::Thread("KeyStoreFlush"), keyStore(keyStore) { }
+
+        qcc::ThreadReturn STDCALL Run(void* arg);
+
+      private:
+        /** Time in milliseconds to wait for more changes before storing */
+        static const uint32_t FLUSH_DELAY = 100;
+
+        KeyStore& keyStore;
+    };
+
+    /**
+     * Minimum journal size in bytes before the journal is compacted
+     */
+    static const size_t MIN_COMPACTION_LEN = 16 * 1024;
+
     /**
      * The application that owns this key store. If the key store is shared this will be the name
      * of a suite of applications.
@@ -288,6 +372,46 @@ class KeyStore {
      */
     std::set<qcc::GUID128> deletions;
 
+    /**
+     * GUID for keys that have been added, changed, or deleted since the journal was last pushed
+     */
+    std::set<qcc::GUID128> journalPending;
+
+    /**
+     * Sequence number of the last journal record for the current key store revision
+     */
+    uint32_t journalSeq;
+
+    /**
+     * Number of bytes in the journal for the current key store revision
+     */
+    size_t journalLen;
+
+    /**
+     * Number of bytes of encrypted keys in the key store
+     */
+    size_t storeLen;
+
+    /**
+     * Set if the key store must be pushed in full on the next store
+     */
+    bool compact;
+
+    /**
+     * Set when a store has been requested but not yet performed
+     */
+    bool flushPending;
+
+    /**
+     * Mutex to serialize store requests
+     */
+    qcc::Mutex flushLock;
+
+    /**
+     * Thread for performing store requests in the background
+     */
+    FlushThread flushThread;
+
     /**
      * Default listener for handling load/store requests
      */
@@ -45,6 +45,7 @@
 #include "AllJoynPeerObj.h"
 #include "BusUtil.h"
 #include "BusInternal.h"
+#include "SignaturePlan.h"
 
 
 #define QCC_MODULE "ALLJOYN"
@@ -92,7 +93,6 @@ LocalEndpoint::LocalEndpoint(BusAttachment& bus) :
     refCount(1),
     bus(bus),
     objectsLock(),
-    replyMapLock(),
     dbusObj(NULL),
     alljoynObj(NULL),
     alljoynDebugObj(NULL),
@@ -469,10 +469,15 @@ QStatus LocalEndpoint::RegisterReplyHandler(MessageReceiver* receiver,
             context,
             Alarm(timeout, this, 0, (void*)serial)
         };
+        /*
+         * Compile the reply signature now, received replies only use plans that are already cached.
+         */
+        SignaturePlan::Get(method.returnSignature.c_str());
         QCC_DbgPrintf(("LocalEndpoint::RegisterReplyHandler - Adding serial=%u", serial));
-        replyMapLock.Lock();
-        replyMap.insert(pair<uint32_t, ReplyContext>(serial, reply));
-        replyMapLock.Unlock();
+        ReplyMapShard& shard = GetReplyMapShard(serial);
+        shard.lock.Lock();
+        shard.replies.insert(pair<uint32_t, ReplyContext>(serial, reply));
+        shard.lock.Unlock();
 
         /* Set a timeout */
         status = bus.GetInternal().GetTimer().AddAlarm(reply.alarm);
@@ -485,16 +490,17 @@ QStatus LocalEndpoint::RegisterReplyHandler(MessageReceiver* receiver,
 
 void LocalEndpoint::UnregisterReplyHandler(uint32_t serial)
 {
-    replyMapLock.Lock();
-    map<uint32_t, ReplyContext>::iterator iter = replyMap.find(serial);
-    if (iter != replyMap.end()) {
+    ReplyMapShard& shard = GetReplyMapShard(serial);
+    shard.lock.Lock();
+    hash_map<uint32_t, ReplyContext>::iterator iter = shard.replies.find(serial);
+    if (iter != shard.replies.end()) {
         QCC_DbgPrintf(("LocalEndpoint::UnregisterReplyHandler - Removing serial=%u", serial));
         ReplyContext rc = iter->second;
-        replyMap.erase(iter);
-        replyMapLock.Unlock();
+        shard.replies.erase(iter);
+        shard.lock.Unlock();
         bus.GetInternal().GetTimer().RemoveAlarm(rc.alarm);
     } else {
-        replyMapLock.Unlock();
+        shard.lock.Unlock();
     }
 }
 
@@ -512,6 +518,10 @@ QStatus LocalEndpoint::RegisterSignalHandler(MessageReceiver* receiver,
     if (!member) {
         return ER_BAD_ARG_3;
     }
+    /*
+     * Compile the signal signature now, received signals only use plans that are already cached.
+     */
+    SignaturePlan::Get(member->signature.c_str());
     signalTable.Add(receiver, signalHandler, member, srcPath ? srcPath : "");
     return ER_OK;
 }
@@ -543,20 +553,23 @@ QStatus LocalEndpoint::UnregisterAllHandlers(MessageReceiver* receiver)
     /*
      * Remove any reply handlers for this receiver
      */
-    replyMapLock.Lock();
-    bool removed;
-    do {
-        removed = false;
-        for (map<uint32_t, ReplyContext>::iterator iter = replyMap.begin(); iter != replyMap.end(); ++iter) {
-            if (iter->second.object == receiver) {
-                bus.GetInternal().GetTimer().RemoveAlarm(iter->second.alarm);
-                replyMap.erase(iter);
-                removed = true;
-                break;
+    for (uint32_t i = 0; i < REPLY_MAP_SHARDS; ++i) {
+        ReplyMapShard& shard = replyMap[i];
+        shard.lock.Lock();
+        bool removed;
+        do {
+            removed = false;
+            for (hash_map<uint32_t, ReplyContext>::iterator iter = shard.replies.begin(); iter != shard.replies.end(); ++iter) {
+                if (iter->second.object == receiver) {
+                    bus.GetInternal().GetTimer().RemoveAlarm(iter->second.alarm);
+                    shard.replies.erase(iter);
+                    removed = true;
+                    break;
+                }
             }
-        }
-    } while (removed);
-    replyMapLock.Unlock();
+        } while (removed);
+        shard.lock.Unlock();
+    }
     return ER_OK;
 }
 
@@ -632,7 +645,8 @@ QStatus LocalEndpoint::HandleMethodCall(Message& message)
         status = ER_BUS_MESSAGE_NOT_ENCRYPTED;
         QCC_LogError(status, ("Method call to secure interface was not encrypted"));
     } else {
-        status = message->UnmarshalArgs(entry->member->signature, entry->member->returnSignature.c_str());
+        bool lazy = (entry->member->annotation & MEMBER_ANNOTATE_LAZY_ARGS) != 0;
+        status = message->UnmarshalArgs(entry->member->signature, entry->member->returnSignature.c_str(), lazy);
     }
     if (status == ER_OK) {
         /* Call the method handler */
@@ -743,7 +757,7 @@ QStatus LocalEndpoint::HandleSignal(Message& message)
         status = ER_BUS_MESSAGE_NOT_ENCRYPTED;
         QCC_LogError(status, ("Signal from secure interface was not encrypted"));
     } else {
-        status = message->UnmarshalArgs(signal->signature);
+        status = message->UnmarshalArgs(signal->signature, NULL, (signal->annotation & MEMBER_ANNOTATE_LAZY_ARGS) != 0);
     }
     if (status != ER_OK) {
         if ((status == ER_BUS_MESSAGE_DECRYPTION_FAILED) || (status == ER_BUS_MESSAGE_NOT_ENCRYPTED)) {
@@ -788,12 +802,13 @@ QStatus LocalEndpoint::HandleMethodReply(Message& message)
 {
     QStatus status = ER_OK;
 
-    replyMapLock.Lock();
-    map<uint32_t, ReplyContext>::iterator iter = replyMap.find(message->GetReplySerial());
-    if (iter != replyMap.end()) {
+    ReplyMapShard& shard = GetReplyMapShard(message->GetReplySerial());
+    shard.lock.Lock();
+    hash_map<uint32_t, ReplyContext>::iterator iter = shard.replies.find(message->GetReplySerial());
+    if (iter != shard.replies.end()) {
         ReplyContext rc = iter->second;
-        replyMap.erase(iter);
-        replyMapLock.Unlock();
+        shard.replies.erase(iter);
+        shard.lock.Unlock();
         bus.GetInternal().GetTimer().RemoveAlarm(rc.alarm);
         if (rc.secure && !message->IsEncrypted()) {
             /*
@@ -829,7 +844,7 @@ QStatus LocalEndpoint::HandleMethodReply(Message& message)
         }
         ((rc.object)->*(rc.handler))(message, rc.context);
     } else {
-        replyMapLock.Unlock();
+        shard.lock.Unlock();
         status = ER_BUS_UNMATCHED_REPLY_SERIAL;
         QCC_DbgHLPrintf(("%s does not match any current method calls: %s", message->Description().c_str(), QCC_StatusText(status)));
     }
@@ -355,10 +355,30 @@ class LocalEndpoint : public BusEndpoint, public qcc::AlarmListener, public Mess
      */
     std::hash_map<const char*, BusObject*, std::hash<const char*>, PathEq> localObjects;
 
+    /**
+     * Number of shards the reply map is split into (must be a power of 2). Pipelined method calls
+     * register and match replies from several threads so a single map and lock would serialize them.
+     */
+    static const uint32_t REPLY_MAP_SHARDS = 16;
+
+    /**
+     * A shard of the map from serial numbers for outstanding method calls to response handlers.
+     */
+    struct ReplyMapShard {
+        qcc::Mutex lock;                                /**< Mutex protecting this shard */
+        std::hash_map<uint32_t, ReplyContext> replies;  /**< Reply contexts keyed by method call serial number */
+    };
+
+    /**
+     * Get the reply map shard for a method call serial number. Serial numbers are allocated
+     * sequentially so the low order bits spread outstanding calls evenly.
+     */
+    ReplyMapShard& GetReplyMapShard(uint32_t serial) { return replyMap[serial & (REPLY_MAP_SHARDS - 1)]; }
+
     /**
      * Map from serial numbers for outstanding method calls to response handelers.
      */
-    std::map<uint32_t, ReplyContext> replyMap;
+    ReplyMapShard replyMap[REPLY_MAP_SHARDS];
 
     /**
      * Type definition for a message pending for permission check.
@@ -412,7 +432,6 @@ class LocalEndpoint : public BusEndpoint, public qcc::AlarmListener, public Mess
     SignalTable signalTable;           /**< Hash table of BusObject signal handlers */
     BusAttachment& bus;                /**< Message bus */
     qcc::Mutex objectsLock;            /**< Mutex protecting Objects hash table */
-    qcc::Mutex replyMapLock;           /**< Mutex protecting replyMap */
     qcc::GUID128 guid;                    /**< GUID to uniquely identify a local endpoint */
     qcc::String uniqueName;            /**< Unique name for endpoint */
 
@@ -27,6 +27,7 @@
 #include <limits>
 
 #include <qcc/String.h>
+#include <qcc/atomic.h>
 #include <qcc/Mutex.h>
 #include <qcc/String.h>
 #include <qcc/StringUtil.h>
@@ -39,6 +40,7 @@
 
 #include "BusInternal.h"
 #include "BusUtil.h"
+#include "MsgBufPool.h"
 
 #define QCC_MODULE "ALLJOYN"
 
@@ -270,19 +272,64 @@ QStatus _Message::GetArgs(const char* signature, ...)
     if (sigLen == 0) {
         return ER_BAD_ARG_1;
     }
+    QStatus status = ParseLazyArgs();
+    if (status != ER_OK) {
+        return status;
+    }
     va_list argp;
     va_start(argp, signature);
-    QStatus status = MsgArg::VParseArgs(signature, sigLen, msgArgs, numMsgArgs, &argp);
+    status = MsgArg::VParseArgs(signature, sigLen, msgArgs, numMsgArgs, &argp);
     va_end(argp);
     return status;
 }
 
+QStatus _Message::ParseLazyArgs()
+{
+    bufLock.Lock();
+    if (lazyArgs) {
+        ParseArgs();
+    }
+    QStatus status = parseStatus;
+    bufLock.Unlock();
+    return status;
+}
+
+/*
+ * A message body that is shared between a message and copies of it that have had their header
+ * rewritten.
+ */
+struct _Message::BodyBuf {
+    int32_t refs;    ///< Number of messages referencing the body
+    uint64_t* buf;   ///< Message buffer the body is in
+};
+
+void _Message::ReleaseBody(BodyBuf* body)
+{
+    if (body && (DecrementAndFetch(&body->refs) == 0)) {
+        MsgBufPool::Free(body->buf);
+        delete body;
+    }
+}
+
+/*
+ * Move a pointer into one message buffer to the same offset in another
+ */
+static inline uint8_t* Rebase(const uint8_t* ptr, const uint64_t* from, uint64_t* to)
+{
+    return (from && ptr) ? ((uint8_t*)to) + (ptr - ((const uint8_t*)from)) : NULL;
+}
+
 _Message::_Message(BusAttachment& bus) :
     bus(bus),
     endianSwap(false),
     msgBuf(NULL),
     msgArgs(NULL),
     numMsgArgs(0),
+    lazyArgs(false),
+    parseStatus(ER_OK),
+    bodyBuf(NULL),
+    sigPlan(NULL),
+    sigPlanBase(NULL),
     ttl(0),
     handles(NULL),
     numHandles(0),
@@ -296,13 +343,18 @@ _Message::_Message(const _Message& other)
     : bus(other.bus),
     endianSwap(other.endianSwap),
     msgHeader(other.msgHeader),
-    msgBuf(other.msgBuf ? new uint64_t[other.bufSize / 8] : NULL),
+    msgBuf(other.msgBuf ? MsgBufPool::Alloc(other.bufSize) : NULL),
     msgArgs((other.numMsgArgs && other.msgArgs) ? new MsgArg[other.numMsgArgs] : NULL),
     numMsgArgs(other.numMsgArgs),
+    lazyArgs(other.lazyArgs),
+    parseStatus(other.parseStatus),
     bufSize(other.bufSize),
-    bufEOD((other.msgBuf && other.bufEOD) ? ((uint8_t*)msgBuf) + (other.bufEOD - ((uint8_t*)other.msgBuf)) : NULL),
-    bufPos((other.msgBuf && other.bufPos) ? ((uint8_t*)msgBuf) + (other.bufPos - ((uint8_t*)other.msgBuf)) : NULL),
-    bodyPtr((other.msgBuf && other.bodyPtr) ? ((uint8_t*)msgBuf) + (other.bodyPtr - ((uint8_t*)other.msgBuf)) : NULL),
+    bufEOD(other.bodyBuf ? other.bufEOD : Rebase(other.bufEOD, other.msgBuf, msgBuf)),
+    bufPos(other.bodyBuf ? other.bufPos : Rebase(other.bufPos, other.msgBuf, msgBuf)),
+    bodyPtr(other.bodyBuf ? other.bodyPtr : Rebase(other.bodyPtr, other.msgBuf, msgBuf)),
+    bodyBuf(other.bodyBuf),
+    sigPlan(NULL),
+    sigPlanBase(NULL),
     ttl(other.ttl),
     timestamp(other.timestamp),
     replySignature(other.replySignature),
@@ -313,10 +365,13 @@ _Message::_Message(const _Message& other)
     encrypt(other.encrypt),
     hdrFields(other.hdrFields)
 {
-    // Copy msgBuf
+    // Copy msgBuf, a shared body is not copied
     if (msgBuf) {
         ::memcpy(msgBuf, other.msgBuf, bufSize);
     }
+    if (bodyBuf) {
+        IncrementAndFetch(&bodyBuf->refs);
+    }
 
     // Copy msgArgs
     if (msgArgs) {
@@ -335,7 +390,8 @@ _Message::_Message(const _Message& other)
 
 _Message::~_Message(void)
 {
-    delete [] msgBuf;
+    MsgBufPool::Free(msgBuf);
+    ReleaseBody(bodyBuf);
     delete [] msgArgs;
     while (numHandles) {
         qcc::Close(handles[--numHandles]);
@@ -359,22 +415,50 @@ QStatus _Message::ReMarshal(const char* senderName, bool newSerial)
     delete [] msgArgs;
     msgArgs = NULL;
     numMsgArgs = 0;
+    lazyArgs = false;
+    parseStatus = ER_OK;
 
     /*
-     * We delete the current buffer after we have copied the body data
+     * Only the header changes so the body is left where it is.
+     */
+    MarshalHeader(false);
+    return ER_OK;
+}
+
+void _Message::MarshalHeader(bool joinBody)
+{
+    /*
+     * We delete the current buffers after we have copied the body data
      */
     uint64_t* savBuf = msgBuf;
+    BodyBuf* savBody = NULL;
+    bool split = !joinBody && (msgHeader.bodyLen != 0);
 
     /*
      * Compute the new header sizes
      */
-    ComputeHeaderLen();
+    size_t hdrLen = ComputeHeaderLen();
     /*
      * Padding the end of the buffer ensures we can unmarshal a few bytes beyond the end of the
      * message reducing the places where we need to check for bufEOD when unmarshaling the body.
      */
-    bufSize = sizeof(msgHeader) + ((((msgHeader.headerLen + 7) & ~7) + msgHeader.bodyLen + 7) & ~7) + 8;
-    msgBuf = new uint64_t[bufSize / 8];
+    if (split) {
+        if (!bodyBuf) {
+            /*
+             * The current buffer becomes the shared body buffer
+             */
+            bodyBuf = new BodyBuf;
+            bodyBuf->refs = 1;
+            bodyBuf->buf = msgBuf;
+            savBuf = NULL;
+        }
+        bufSize = hdrLen + 8;
+    } else {
+        savBody = bodyBuf;
+        bodyBuf = NULL;
+        bufSize = hdrLen + ((msgHeader.bodyLen + 7) & ~7) + 8;
+    }
+    msgBuf = MsgBufPool::Alloc(bufSize);
     bufPos = (uint8_t*)msgBuf;
     memcpy(bufPos, &msgHeader, sizeof(msgHeader));
     bufPos += sizeof(msgHeader);
@@ -392,22 +476,32 @@ QStatus _Message::ReMarshal(const char* senderName, bool newSerial)
      */
     MarshalHeaderFields();
     assert(((size_t)bufPos & 7) == 0);
-    /*
-     * Copy in the body if there was one
-     */
-    if (msgHeader.bodyLen != 0) {
-        memcpy(bufPos, bodyPtr, msgHeader.bodyLen);
+    assert((bufPos - (uint8_t*)msgBuf) == static_cast<ptrdiff_t>(hdrLen));
+    if (split) {
+        /*
+         * Zero fill the pad at the end of the header buffer, the body pointers are unchanged
+         */
+        memset(bufPos, 0, (uint8_t*)msgBuf + bufSize - bufPos);
+        bufPos = bodyPtr + msgHeader.bodyLen;
+        bufEOD = bufPos;
+    } else {
+        /*
+         * Copy in the body if there was one
+         */
+        if (msgHeader.bodyLen != 0) {
+            memcpy(bufPos, bodyPtr, msgHeader.bodyLen);
+        }
+        bodyPtr = bufPos;
+        bufPos += msgHeader.bodyLen;
+        bufEOD = bufPos;
+        /*
+         * Zero fill the pad at the end of the buffer
+         */
+        assert((size_t)(bufEOD - (uint8_t*)msgBuf) < bufSize);
+        memset(bufEOD, 0, (uint8_t*)msgBuf + bufSize - bufEOD);
     }
-    bodyPtr = bufPos;
-    bufPos += msgHeader.bodyLen;
-    bufEOD = bufPos;
-    /*
-     * Zero fill the pad at the end of the buffer
-     */
-    assert((size_t)(bufEOD - (uint8_t*)msgBuf) < bufSize);
-    memset(bufEOD, 0, (uint8_t*)msgBuf + bufSize - bufEOD);
-    delete [] savBuf;
-    return ER_OK;
+    MsgBufPool::Free(savBuf);
+    ReleaseBody(savBody);
 }
 
 bool _Message::IsExpired(uint32_t* tillExpireMS) const
@@ -447,6 +541,8 @@ void _Message::ClearHeader()
         delete [] msgArgs;
         msgArgs = NULL;
         numMsgArgs = 0;
+        lazyArgs = false;
+        parseStatus = ER_OK;
         ttl = 0;
         msgHeader.msgType = MESSAGE_INVALID;
         while (numHandles) {
@@ -39,9 +39,12 @@
 #include "KeyStore.h"
 #include "CompressionRules.h"
 #include "BusUtil.h"
+#include "MsgBufPool.h"
 #include "AllJoynCrypto.h"
 #include "AllJoynPeerObj.h"
 #include "SignatureUtils.h"
+#include "SignaturePlan.h"
+#include "ScalarArrays.h"
 #include "BusInternal.h"
 
 #define QCC_MODULE "ALLJOYN"
@@ -137,6 +140,7 @@ QStatus _Message::MarshalArgs(const MsgArg* arg, size_t numArgs)
     QStatus status = ER_OK;
     size_t alignment;
     uint32_t len;
+    const SignaturePlan* plan;
 
     while (numArgs--) {
         if (!arg) {
@@ -171,10 +175,17 @@ QStatus _Message::MarshalArgs(const MsgArg* arg, size_t numArgs)
                     break;
                 }
                 /*
-                 * Check elements conform to the expected signature type
+                 * Check elements conform to the expected signature type. The compiled plan for
+                 * the element signature lets us do this without building a signature per element.
+                 * The args may have come from a peer so the plan is only looked up.
                  */
+                plan = SignaturePlan::Lookup(arg->v_array.GetElemSig());
+                if (plan && (plan->GetNumCompleteTypes() != 1)) {
+                    plan = NULL;
+                }
                 for (size_t i = 0; i < arg->v_array.numElements; i++) {
-                    if (!arg->v_array.elements[i].HasSignature(arg->v_array.GetElemSig())) {
+                    bool matches = plan ? plan->Matches(arg->v_array.elements[i]) : arg->v_array.elements[i].HasSignature(arg->v_array.GetElemSig());
+                    if (!matches) {
                         status = ER_BUS_BAD_VALUE;
                         QCC_LogError(status, ("Array element[%d] does not have expected signature \"%s\"", i, arg->v_array.GetElemSig()));
                         break;
@@ -229,14 +240,8 @@ QStatus _Message::MarshalArgs(const MsgArg* arg, size_t numArgs)
             } else {
                 Marshal4(len);
             }
-            for (size_t i = 0; i < arg->v_scalarArray.numElements; i++) {
-                uint32_t b = arg->v_scalarArray.v_bool[i] ? 1 : 0;
-                if (endianSwap) {
-                    MarshalReversed(b, 4);
-                } else {
-                    Marshal4(b);
-                }
-            }
+            ScalarArrays::MarshalBools(arg->v_scalarArray.v_bool, arg->v_scalarArray.numElements, endianSwap, bufPos);
+            bufPos += len;
             break;
 
         case ALLJOYN_INT32_ARRAY:
@@ -252,9 +257,8 @@ QStatus _Message::MarshalArgs(const MsgArg* arg, size_t numArgs)
             MarshalPad4();
             if (endianSwap) {
                 MarshalReversed(&len, 4);
-                for (size_t i = 0; i < arg->v_scalarArray.numElements; i++) {
-                    MarshalReversed(arg->v_scalarArray.v_uint32[i], 4);
-                }
+                ScalarArrays::CopySwapped32(bufPos, arg->v_scalarArray.v_uint32, arg->v_scalarArray.numElements);
+                bufPos += len;
             } else {
                 Marshal4(len);
                 MarshalBytes(arg->v_scalarArray.v_uint32, len);
@@ -277,9 +281,8 @@ QStatus _Message::MarshalArgs(const MsgArg* arg, size_t numArgs)
                 if (endianSwap) {
                     MarshalReversed(&len, 4);
                     MarshalPad8();
-                    for (size_t i = 0; i < arg->v_scalarArray.numElements; i++) {
-                        MarshalReversed(arg->v_scalarArray.v_uint64[i], 8);
-                    }
+                    ScalarArrays::CopySwapped64(bufPos, arg->v_scalarArray.v_uint64, arg->v_scalarArray.numElements);
+                    bufPos += len;
                 } else {
                     Marshal4(len);
                     MarshalPad8();
@@ -305,9 +308,8 @@ QStatus _Message::MarshalArgs(const MsgArg* arg, size_t numArgs)
             MarshalPad4();
             if (endianSwap) {
                 MarshalReversed(&len, 4);
-                for (size_t i = 0; i < arg->v_scalarArray.numElements; i++) {
-                    MarshalReversed(arg->v_scalarArray.v_uint16[i], 2);
-                }
+                ScalarArrays::CopySwapped16(bufPos, arg->v_scalarArray.v_uint16, arg->v_scalarArray.numElements);
+                bufPos += len;
             } else {
                 Marshal4(len);
                 MarshalBytes(arg->v_scalarArray.v_uint16, len);
@@ -476,17 +478,36 @@ QStatus _Message::MarshalArgs(const MsgArg* arg, size_t numArgs)
     return status;
 }
 
-QStatus _Message::Deliver(RemoteEndpoint& endpoint)
+/*
+ * Push bytes to a sink until they have all been pushed
+ */
+static QStatus PushAll(Sink& sink, const uint8_t* buf, size_t len)
 {
     QStatus status = ER_OK;
-    Sink& sink = endpoint.GetSink();
-    uint8_t* buf = reinterpret_cast<uint8_t*>(msgBuf);
-    size_t len = bufEOD - buf;
     size_t pushed;
 
+    while ((status == ER_OK) && (len != 0)) {
+        status = sink.PushBytes(buf, len, pushed);
+        if (status == ER_OK) {
+            len -= pushed;
+            buf += pushed;
+        }
+    }
+    return status;
+}
+
+QStatus _Message::Deliver(RemoteEndpoint& endpoint)
+{
+    return Deliver(endpoint, endpoint.GetSink());
+}
+
+QStatus _Message::Deliver(RemoteEndpoint& endpoint, Sink& sink)
+{
+    QStatus status = ER_OK;
+
     QCC_DbgPrintf(("Deliver %s", this->Description().c_str()));
 
-    if (len == 0) {
+    if (!bodyBuf && (bufEOD == reinterpret_cast<uint8_t*>(msgBuf))) {
         status = ER_BUS_EMPTY_MESSAGE;
         QCC_LogError(status, ("Message is empty"));
         return status;
@@ -527,22 +548,27 @@ QStatus _Message::Deliver(RemoteEndpoint& endpoint)
         }
     }
     /*
-     * Push the message to the endpoint sink (only push handles in the first chunk)
+     * Push the message to the endpoint sink (only push handles in the first chunk). If the header
+     * was rewritten the body is in a separate shared buffer and is pushed after the header.
      */
     if (status == ER_OK) {
+        uint8_t* buf = reinterpret_cast<uint8_t*>(msgBuf);
+        size_t len = bodyBuf ? ROUNDUP8(sizeof(msgHeader) + msgHeader.headerLen) : (size_t)(bufEOD - buf);
+        size_t pushed;
         if (handles) {
             status = sink.PushBytesAndFds(buf, len, pushed, handles, numHandles, endpoint.GetProcessId());
         } else {
             status = sink.PushBytes(buf, len, pushed);
         }
-    }
-    /*
-     * Continue pushing until we are done
-     */
-    while ((status == ER_OK) && (pushed != len)) {
-        len -= pushed;
-        buf += pushed;
-        status = sink.PushBytes(buf, len, pushed);
+        /*
+         * Continue pushing until we are done
+         */
+        if (status == ER_OK) {
+            status = PushAll(sink, buf + pushed, len - pushed);
+        }
+        if ((status == ER_OK) && bodyBuf) {
+            status = PushAll(sink, bodyPtr, bufEOD - bodyPtr);
+        }
     }
     if (status == ER_OK) {
         QCC_DbgHLPrintf(("Deliver message %s to %s", Description().c_str(), endpoint.GetUniqueName().c_str()));
@@ -693,18 +719,34 @@ QStatus _Message::EncryptMessage()
 {
     QStatus status;
     PeerStateTable* peerStateTable = bus.GetInternal().GetPeerStateTable();
-    KeyBlob key;
-    status = peerStateTable->GetPeerState(GetDestination())->GetKey(key, PEER_SESSION_KEY);
+    MessageCipher cipher;
+
+    /*
+     * A message that is queued to several endpoints must be encrypted exactly once (in place) no
+     * matter how many threads deliver it.
+     */
+    bufLock.Lock();
+    if (!encrypt) {
+        /* Another thread encrypted the message while we were waiting */
+        bufLock.Unlock();
+        return ER_OK;
+    }
+    status = peerStateTable->GetPeerState(GetDestination())->GetCipher(cipher, PEER_SESSION_KEY);
     if (status == ER_OK) {
         size_t argsLen = msgHeader.bodyLen - ajn::Crypto::ExpansionBytes;
         size_t hdrLen = ROUNDUP8(sizeof(msgHeader) + msgHeader.headerLen);
-        status = ajn::Crypto::Encrypt(*this, key, (uint8_t*)msgBuf, hdrLen, argsLen);
+        /*
+         * The body is encrypted in place so it cannot be shared and must follow the header.
+         */
+        JoinBody();
+        status = ajn::Crypto::Encrypt(*this, *cipher, (uint8_t*)msgBuf, hdrLen, argsLen);
         if (status == ER_OK) {
-            authMechanism = key.GetTag();
+            authMechanism = cipher->GetKey().GetTag();
             assert(msgHeader.bodyLen == argsLen);
             encrypt = false;
         }
     }
+    bufLock.Unlock();
     return status;
 }
 
@@ -753,6 +795,7 @@ QStatus _Message::MarshalMessage(const qcc::String& expectedSignature,
      * marshaling may point into the old message.
      */
     uint64_t* oldMsgBuf = msgBuf;
+    BodyBuf* oldBodyBuf = bodyBuf;
     /*
      * Clear out stale message data
      */
@@ -760,6 +803,7 @@ QStatus _Message::MarshalMessage(const qcc::String& expectedSignature,
     bufPos = NULL;
     bufEOD = NULL;
     msgBuf = NULL;
+    bodyBuf = NULL;
     /*
      * There should be a mapping for every field type
      */
@@ -789,9 +833,18 @@ QStatus _Message::MarshalMessage(const qcc::String& expectedSignature,
     hdrFields.field[ALLJOYN_HDR_FIELD_SIGNATURE].Clear();
     if (numArgs > 0) {
         size_t sigLen = 0;
-        status = SignatureUtils::MakeSignature(args, numArgs, signature, sigLen);
-        if (status != ER_OK) {
-            goto ExitMarshalMessage;
+        /*
+         * If the args match the compiled plan for the expected signature we don't need to build it.
+         */
+        const SignaturePlan* plan = SignaturePlan::Get(expectedSignature.c_str());
+        if (plan && plan->Matches(args, numArgs)) {
+            sigLen = plan->GetLength();
+            memcpy(signature, plan->GetSignature(), sigLen + 1);
+        } else {
+            status = SignatureUtils::MakeSignature(args, numArgs, signature, sigLen);
+            if (status != ER_OK) {
+                goto ExitMarshalMessage;
+            }
         }
         if (sigLen > 0) {
             hdrFields.field[ALLJOYN_HDR_FIELD_SIGNATURE].typeId = ALLJOYN_SIGNATURE;
@@ -840,7 +893,7 @@ QStatus _Message::MarshalMessage(const qcc::String& expectedSignature,
      * Allocate buffer for entire message.
      */
     bufSize = (hdrLen + msgHeader.bodyLen + 7);
-    msgBuf = new uint64_t[bufSize / 8];
+    msgBuf = MsgBufPool::Alloc(bufSize);
     /*
      * Initialize the buffer and copy in the message header
      */
@@ -899,16 +952,19 @@ QStatus _Message::MarshalMessage(const qcc::String& expectedSignature,
 ExitMarshalMessage:
 
     /*
-     * Don't need the old message buffer any more
+     * Don't need the old message buffers any more
      */
-    delete [] oldMsgBuf;
+    MsgBufPool::Free(oldMsgBuf);
+    ReleaseBody(oldBodyBuf);
 
     if (status == ER_OK) {
         QCC_DbgHLPrintf(("MarshalMessage: %d+%d %s", hdrLen, msgHeader.bodyLen, Description().c_str()));
     } else {
         QCC_LogError(status, ("MarshalMessage: %s", Description().c_str()));
-        delete [] msgBuf;
+        MsgBufPool::Free(msgBuf);
         msgBuf = NULL;
+        ReleaseBody(bodyBuf);
+        bodyBuf = NULL;
         bodyPtr = NULL;
         bufPos = NULL;
         bufEOD = NULL;
@@ -1298,16 +1354,16 @@ void _Message::ErrorMsg(QStatus status,
 QStatus _Message::GetExpansion(uint32_t token, MsgArg& replyArg)
 {
     QStatus status = ER_OK;
-    const HeaderFields* expFields = bus.GetInternal().GetCompressionRules().GetExpansion(token);
-    if (expFields) {
+    HeaderFields expFields;
+    if (bus.GetInternal().GetCompressionRules().GetExpansion(token, expFields)) {
         MsgArg* hdrArray = new MsgArg[ALLJOYN_HDR_FIELD_UNKNOWN];
         size_t numElements = 0;
         /*
          * Reply arg is an array of structs with signature "(yv)"
          */
-        for (uint32_t fieldId = ALLJOYN_HDR_FIELD_PATH; fieldId < ArraySize(expFields->field); fieldId++) {
+        for (uint32_t fieldId = ALLJOYN_HDR_FIELD_PATH; fieldId < ArraySize(expFields.field); fieldId++) {
             MsgArg* val = NULL;
-            const MsgArg* exp = &expFields->field[fieldId];
+            const MsgArg* exp = &expFields.field[fieldId];
             switch (exp->typeId) {
             case ALLJOYN_OBJECT_PATH:
                 val = new MsgArg("o", exp->v_string.str);
@@ -1333,6 +1389,8 @@ QStatus _Message::GetExpansion(uint32_t token, MsgArg& replyArg)
                 break;
             }
             if (val) {
+                /* The expansion is a local copy so the value must own its data */
+                val->Stabilize();
                 uint8_t id = FieldTypeMapping[fieldId];
                 hdrArray[numElements].Set("(yv)", id, val);
                 hdrArray[numElements].SetOwnershipFlags(MsgArg::OwnsArgs);
@@ -31,6 +31,7 @@
 
 #include <alljoyn/BusAttachment.h>
 #include <alljoyn/Message.h>
+#include <alljoyn/MsgCursor.h>
 
 #include "Router.h"
 #include "KeyStore.h"
@@ -38,9 +39,12 @@
 #include "PeerState.h"
 #include "CompressionRules.h"
 #include "BusUtil.h"
+#include "MsgBufPool.h"
 #include "AllJoynCrypto.h"
 #include "AllJoynPeerObj.h"
 #include "SignatureUtils.h"
+#include "SignaturePlan.h"
+#include "ScalarArrays.h"
 #include "BusInternal.h"
 
 #define QCC_MODULE "ALLJOYN"
@@ -67,18 +71,24 @@ namespace ajn {
 QStatus _Message::ParseArray(MsgArg* arg,
                              const char*& sigPtr)
 {
-    QStatus status;
+    QStatus status = ER_OK;
     uint32_t len;
     const char* sigStart = sigPtr;
+    const SignaturePlan::Op* op = sigPlan ? sigPlan->Find(sigPlanBase, sigStart - 1) : NULL;
 
     /*
-     * First check that the array type signature is valid
+     * First check that the array type signature is valid, if we have a compiled plan this was
+     * done when the signature was compiled.
      */
     arg->typeId = ALLJOYN_ARRAY;
-    status = SignatureUtils::ParseContainerSignature(*arg, sigPtr);
-    if (status != ER_OK) {
-        arg->typeId = ALLJOYN_INVALID;
-        return status;
+    if (op) {
+        sigPtr = sigStart - 1 + op->sigLen;
+    } else {
+        status = SignatureUtils::ParseContainerSignature(*arg, sigPtr);
+        if (status != ER_OK) {
+            arg->typeId = ALLJOYN_INVALID;
+            return status;
+        }
     }
     /*
      * Length is aligned on a 4 byte boundary
@@ -118,11 +128,7 @@ QStatus _Message::ParseArray(MsgArg* arg,
             arg->v_scalarArray.numElements = (size_t)(len / 2);
             arg->v_scalarArray.v_uint16 = (uint16_t*)bufPos;
             if (endianSwap) {
-                uint16_t* n = (uint16_t*)bufPos;
-                for (size_t i = 0; i < arg->v_scalarArray.numElements; i++) {
-                    EndianSwap16(*n);
-                    n++;
-                }
+                ScalarArrays::Swap16((uint16_t*)bufPos, arg->v_scalarArray.numElements);
             }
             bufPos += len;
         } else {
@@ -134,28 +140,16 @@ QStatus _Message::ParseArray(MsgArg* arg,
         if ((len & 3) == 0) {
             size_t num = (size_t)(len / 4);
             bool* bools = new bool[num];
-            for (size_t i = 0; i < num; i++) {
-                if (endianSwap) {
-                    EndianSwap32(*((uint32_t*)bufPos));
-                }
-                uint32_t b = *bufPos;
-                if (b > 1) {
-                    delete [] bools;
-                    status = ER_BUS_BAD_VALUE;
-                    break;
-                }
-                bools[i] = (b == 1);
-                bufPos += 4;
-            }
             /*
-             * if status is set to ER_BUS_BAD_VALUE it means the for loop above
-             * found that the value was not an ALLJOYN_BOOLEAN type and deleted
-             * the array 'bools' then exited the for loop. Do not try and set
-             * the 'v_scalarArray.v_bool' to the now invalid 'bools'.
+             * Every value must be a 32 bit 0 or 1, the values are converted to native endianess as
+             * they are checked.
              */
-            if (status == ER_BUS_BAD_VALUE) {
+            if (!ScalarArrays::UnmarshalBools((uint32_t*)bufPos, num, endianSwap, bools)) {
+                delete [] bools;
+                status = ER_BUS_BAD_VALUE;
                 break;
             }
+            bufPos += len;
             arg->typeId = ALLJOYN_BOOLEAN_ARRAY;
             arg->v_scalarArray.numElements = num;
             arg->v_scalarArray.v_bool = bools;
@@ -172,11 +166,7 @@ QStatus _Message::ParseArray(MsgArg* arg,
             arg->v_scalarArray.numElements = (size_t)(len / 4);
             arg->v_scalarArray.v_uint32 = (uint32_t*)bufPos;
             if (endianSwap) {
-                uint32_t* n = (uint32_t*)bufPos;
-                for (size_t i = 0; i < arg->v_scalarArray.numElements; i++) {
-                    EndianSwap32(*n);
-                    n++;
-                }
+                ScalarArrays::Swap32((uint32_t*)bufPos, arg->v_scalarArray.numElements);
             }
             bufPos += len;
         } else {
@@ -193,11 +183,7 @@ QStatus _Message::ParseArray(MsgArg* arg,
             bufPos = AlignPtr(bufPos, 8);
             arg->v_scalarArray.v_uint64 = (uint64_t*)bufPos;
             if (endianSwap) {
-                uint64_t* n = (uint64_t*)bufPos;
-                for (size_t i = 0; i < arg->v_scalarArray.numElements; i++) {
-                    EndianSwap64(*n);
-                    n++;
-                }
+                ScalarArrays::Swap64((uint64_t*)bufPos, arg->v_scalarArray.numElements);
             }
             bufPos += len;
         } else {
@@ -227,6 +213,16 @@ QStatus _Message::ParseArray(MsgArg* arg,
             uint8_t* endOfArray = bufPos + len;
             size_t capacity = 8;
             numElements = 0;
+            /*
+             * If the elements have a fixed size the plan tells us exactly how many there are.
+             */
+            if (op && op[1].fixedSize) {
+                size_t stride = (op[1].fixedSize + op[1].alignment - 1) & ~(op[1].alignment - 1);
+                capacity = (len + stride - op[1].fixedSize) / stride;
+                if (capacity == 0) {
+                    capacity = 1;
+                }
+            }
             elements = new MsgArg[capacity];
             /*
              * Loop until we have consumed all of the data bytes
@@ -246,7 +242,7 @@ QStatus _Message::ParseArray(MsgArg* arg,
                     delete [] elements;
                     elements = bigger;
                 }
-                const char* esig = elemSig.c_str();
+                const char* esig = sigStart;
                 status = ParseValue(&elements[numElements++], esig);
                 if (status != ER_OK) {
                     break;
@@ -274,15 +270,22 @@ QStatus _Message::ParseArray(MsgArg* arg,
  */
 QStatus _Message::ParseStruct(MsgArg* arg, const char*& sigPtr)
 {
+    QStatus status = ER_OK;
     const char* memberSig = sigPtr;
+    const SignaturePlan::Op* op = sigPlan ? sigPlan->Find(sigPlanBase, memberSig - 1) : NULL;
     /*
      * First check that the struct type signature is valid
      */
     arg->typeId = ALLJOYN_STRUCT;
-    QStatus status = SignatureUtils::ParseContainerSignature(*arg, sigPtr);
-    if (status != ER_OK) {
-        QCC_LogError(status, ("ParseStruct error in signature\n"));
-        return status;
+    if (op) {
+        arg->v_struct.numMembers = op->numMembers;
+        sigPtr = memberSig - 1 + op->sigLen;
+    } else {
+        status = SignatureUtils::ParseContainerSignature(*arg, sigPtr);
+        if (status != ER_OK) {
+            QCC_LogError(status, ("ParseStruct error in signature\n"));
+            return status;
+        }
     }
     /*
      * Structs are aligned on an 8 byte boundary
@@ -310,12 +313,18 @@ QStatus _Message::ParseStruct(MsgArg* arg, const char*& sigPtr)
 QStatus _Message::ParseDictEntry(MsgArg* arg,
                                  const char*& sigPtr)
 {
+    QStatus status = ER_OK;
     const char* memberSig = sigPtr;
+    const SignaturePlan::Op* op = sigPlan ? sigPlan->Find(sigPlanBase, memberSig - 1) : NULL;
     /*
      * First check that the dict entry type signature is valid
      */
     arg->typeId = ALLJOYN_DICT_ENTRY;
-    QStatus status = SignatureUtils::ParseContainerSignature(*arg, sigPtr);
+    if (op) {
+        sigPtr = memberSig - 1 + op->sigLen;
+    } else {
+        status = SignatureUtils::ParseContainerSignature(*arg, sigPtr);
+    }
     if (status != ER_OK) {
         arg->typeId = ALLJOYN_INVALID;
     } else {
@@ -357,7 +366,17 @@ QStatus _Message::ParseVariant(MsgArg* arg)
     } else {
         arg->v_variant.val = new MsgArg();
         arg->flags |= MsgArg::OwnsArgs;
+        /*
+         * Variants carry their own signature. Only container types benefit from a compiled plan
+         * and the signature came from the peer so it is only looked up, never compiled.
+         */
+        const SignaturePlan* outerPlan = sigPlan;
+        const char* outerBase = sigPlanBase;
+        sigPlan = (len > 1) ? SignaturePlan::Lookup(sigPtr) : NULL;
+        sigPlanBase = sigPtr;
         status = ParseValue(arg->v_variant.val, sigPtr);
+        sigPlan = outerPlan;
+        sigPlanBase = outerBase;
         if ((status == ER_OK) && (*sigPtr != 0)) {
             status = ER_BUS_BAD_SIGNATURE;
         }
@@ -531,7 +550,7 @@ QStatus _Message::ParseValue(MsgArg* arg, const char*& sigPtr)
  */
 static const char* WildCardSignature = "*";
 
-QStatus _Message::UnmarshalArgs(const qcc::String& expectedSignature, const char* expectedReplySignature)
+QStatus _Message::UnmarshalArgs(const qcc::String& expectedSignature, const char* expectedReplySignature, bool lazy)
 {
     const char* sig = GetSignature();
     QStatus status = ER_OK;
@@ -556,10 +575,14 @@ QStatus _Message::UnmarshalArgs(const qcc::String& expectedSignature, const char
     }
     if (msgHeader.flags & ALLJOYN_FLAG_ENCRYPTED) {
         bool broadcast = (hdrFields.field[ALLJOYN_HDR_FIELD_DESTINATION].typeId == ALLJOYN_INVALID);
+        /*
+         * The body is decrypted in place so it cannot be shared and must follow the header.
+         */
+        JoinBody();
         size_t hdrLen = bodyPtr - (uint8_t*)msgBuf;
         PeerState peerState = bus.GetInternal().GetPeerStateTable()->GetPeerState(GetSender());
-        KeyBlob key;
-        status = peerState->GetKey(key, broadcast ? PEER_GROUP_KEY : PEER_SESSION_KEY);
+        MessageCipher cipher;
+        status = peerState->GetCipher(cipher, broadcast ? PEER_GROUP_KEY : PEER_SESSION_KEY);
         if (status != ER_OK) {
             QCC_LogError(status, ("Unable to decrypt message"));
             /*
@@ -574,17 +597,58 @@ QStatus _Message::UnmarshalArgs(const qcc::String& expectedSignature, const char
          * algorithm adds appends a MAC block to the end of the encrypted data.
          */
         size_t bodyLen = msgHeader.bodyLen;
-        status = ajn::Crypto::Decrypt(*this, key, (uint8_t*)msgBuf, hdrLen, bodyLen);
+        status = ajn::Crypto::Decrypt(*this, *cipher, (uint8_t*)msgBuf, hdrLen, bodyLen);
         if (status != ER_OK) {
             goto ExitUnmarshalArgs;
         }
         msgHeader.bodyLen = static_cast<uint32_t>(bodyLen);
-        authMechanism = key.GetTag();
+        authMechanism = cipher->GetKey().GetTag();
+    }
+    /*
+     * A lazy unmarshal leaves the body in the message buffer until the args are asked for, the
+     * body can be read in place with a MsgCursor in the meantime.
+     */
+    if (lazy) {
+        lazyArgs = true;
+    } else {
+        status = ParseArgs();
+    }
+
+ExitUnmarshalArgs:
+
+    if (status == ER_OK) {
+        /*
+         * Save the reply signature so we can check it when we marshall the reply.
+         */
+        if (expectedReplySignature) {
+            replySignature = expectedReplySignature;
+        }
+    } else {
+        QCC_LogError(status, ("UnmarshalArgs failed"));
+    }
+    return status;
+}
+
+QStatus _Message::ParseArgs()
+{
+    QStatus status = ER_OK;
+    const char* sig = GetSignature();
+
+    lazyArgs = false;
+    /*
+     * Endian swapping is done in place so a shared body must be copied first.
+     */
+    if (endianSwap) {
+        JoinBody();
     }
     /*
-     * Calculate how many arguments there are
+     * Calculate how many arguments there are, the compiled plan for the signature already knows.
+     * The signature came from the sender so it is only looked up, plans are compiled for the
+     * signatures of locally registered handlers.
      */
-    numMsgArgs = SignatureUtils::CountCompleteTypes(sig);
+    sigPlan = SignaturePlan::Lookup(sig);
+    sigPlanBase = sig;
+    numMsgArgs = sigPlan ? sigPlan->GetNumCompleteTypes() : SignatureUtils::CountCompleteTypes(sig);
     msgArgs = new MsgArg[numMsgArgs];
     /*
      * Unmarshal the body values
@@ -594,15 +658,16 @@ QStatus _Message::UnmarshalArgs(const qcc::String& expectedSignature, const char
         status = ParseValue(&msgArgs[i], sig);
         if (status != ER_OK) {
             numMsgArgs = i;
-            goto ExitUnmarshalArgs;
+            break;
         }
     }
-    if ((bufPos - bodyPtr) != static_cast<ptrdiff_t>(msgHeader.bodyLen)) {
+    if ((status == ER_OK) && ((bufPos - bodyPtr) != static_cast<ptrdiff_t>(msgHeader.bodyLen))) {
         QCC_DbgHLPrintf(("UnmarshalArgs expected argLen %d got %d", msgHeader.bodyLen, (bufPos - bodyPtr)));
         status = ER_BUS_BAD_SIGNATURE;
     }
-
-ExitUnmarshalArgs:
+    sigPlan = NULL;
+    sigPlanBase = NULL;
+    parseStatus = status;
 
     if (status == ER_OK) {
         QCC_DbgPrintf(("Unmarshaled\n%s", ToString().c_str()));
@@ -615,16 +680,39 @@ ExitUnmarshalArgs:
             endianSwap = false;
             msgHeader.endian = myEndian;
         }
+    }
+    return status;
+}
+
+QStatus _Message::GetBodyCursor(MsgCursor& cursor)
+{
+    if (msgHeader.msgType == MESSAGE_INVALID) {
+        return ER_FAIL;
+    }
+    bufLock.Lock();
+    if (lazyArgs) {
         /*
-         * Save the reply signature so we can check it when we marshall the reply.
+         * Unmarshaling the args converts the body to native byte order in place. Do that before
+         * handing out a cursor so a later GetArgs() cannot change the body under the cursor.
          */
-        if (expectedReplySignature) {
-            replySignature = expectedReplySignature;
+        if (endianSwap) {
+            ParseArgs();
         }
-    } else {
-        QCC_LogError(status, ("UnmarshalArgs failed"));
+    } else if (!msgArgs && msgHeader.bodyLen) {
+        bufLock.Unlock();
+        return ER_FAIL;
     }
-    return status;
+    QStatus status = parseStatus;
+    bool swap = endianSwap;
+    bufLock.Unlock();
+    if (status != ER_OK) {
+        return status;
+    }
+    const char* sig = GetSignature();
+    const uint8_t* body = bodyPtr;
+    size_t len = msgHeader.bodyLen;
+    cursor = MsgCursor(sig, sig + strlen(sig), body, body + len, swap, handles, numHandles, SignaturePlan::Lookup(sig));
+    return ER_OK;
 }
 
 
@@ -846,8 +934,10 @@ QStatus _Message::Unmarshal(RemoteEndpoint& endpoint, bool checkSender, bool ped
     /*
      * Clear out any stale message state
      */
-    delete [] msgBuf;
+    MsgBufPool::Free(msgBuf);
     msgBuf = NULL;
+    ReleaseBody(bodyBuf);
+    bodyBuf = NULL;
     ClearHeader();
     /*
      * Read the message header
@@ -917,7 +1007,7 @@ QStatus _Message::Unmarshal(RemoteEndpoint& endpoint, bool checkSender, bool ped
      * message reducing the places where we need to check for bufEOD when unmarshaling the body.
      */
     bufSize = sizeof(msgHeader) + ((pktSize + 7) & ~7) + sizeof(uint64_t);
-    msgBuf = new uint64_t[bufSize / 8];
+    msgBuf = MsgBufPool::Alloc(bufSize);
     /*
      * Copy header into the buffer
      */
@@ -989,6 +1079,17 @@ QStatus _Message::Unmarshal(RemoteEndpoint& endpoint, bool checkSender, bool ped
         QCC_LogError(status, ("Unmarshal bad header length %d != %d\n", bufPos - (uint8_t*)msgBuf, msgHeader.headerLen));
         goto ExitUnmarshal;
     }
+    /*
+     * A buffered source may have read this message together with others so it queues the handles
+     * it received instead of returning them with the message bytes. Take as many handles from the
+     * queue as the header says accompanied this message.
+     */
+    if ((hdrFields.field[ALLJOYN_HDR_FIELD_HANDLES].typeId != ALLJOYN_INVALID) && (numHandles < maxFds)) {
+        size_t expectFds = hdrFields.field[ALLJOYN_HDR_FIELD_HANDLES].v_uint32;
+        if (expectFds > numHandles) {
+            numHandles += endpoint.PullHandles(fdList + numHandles, (std::min)(expectFds, maxFds) - numHandles);
+        }
+    }
     /*
      * Header is always padded to end on an 8 byte boundary
      */
@@ -1004,19 +1105,13 @@ QStatus _Message::Unmarshal(RemoteEndpoint& endpoint, bool checkSender, bool ped
             status = ER_BUS_MISSING_COMPRESSION_TOKEN;
             goto ExitUnmarshal;
         }
-        const HeaderFields* expFields = bus.GetInternal().GetCompressionRules().GetExpansion(token);
-        if (!expFields) {
-            QCC_DbgPrintf(("No expansion for token %u", token));
-            status = ER_BUS_CANNOT_EXPAND_MESSAGE;
-            goto ExitUnmarshal;
-        }
         /*
          * Expand the compressed fields. Don't overwrite headers we received in the message.
          */
-        for (size_t id = 0; id < ArraySize(hdrFields.field); id++) {
-            if (HeaderFields::Compressible[id] && (hdrFields.field[id].typeId == ALLJOYN_INVALID)) {
-                hdrFields.field[id] = expFields->field[id];
-            }
+        if (!bus.GetInternal().GetCompressionRules().Expand(token, hdrFields)) {
+            QCC_DbgPrintf(("No expansion for token %u", token));
+            status = ER_BUS_CANNOT_EXPAND_MESSAGE;
+            goto ExitUnmarshal;
         }
         hdrFields.field[ALLJOYN_HDR_FIELD_COMPRESSION_TOKEN].typeId = ALLJOYN_INVALID;
     }
@@ -1146,8 +1241,10 @@ ExitUnmarshal:
         /*
          * There was an unrecoverable failure while unmarshaling the message, cleanup before we return.
          */
-        delete [] msgBuf;
+        MsgBufPool::Free(msgBuf);
         msgBuf = NULL;
+        ReleaseBody(bodyBuf);
+        bodyBuf = NULL;
         ClearHeader();
         QCC_LogError(status, ("Failed to unmarshal message received on %s", endpoint.GetUniqueName().c_str()));
     }
@@ -0,0 +1,287 @@
+/**
+ * @file
+ *
+ * This file implements the MethodCallBatch class.
+ */
+
+/******************************************************************************
+ * Copyright 2011, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+
+#include <qcc/platform.h>
+
+#include <vector>
+
+#include <qcc/Debug.h>
+#include <qcc/atomic.h>
+#include <qcc/Event.h>
+#include <qcc/Mutex.h>
+
+#include <alljoyn/BusAttachment.h>
+#include <alljoyn/MessageReceiver.h>
+#include <alljoyn/MethodCallBatch.h>
+
+#include <Status.h>
+
+#define QCC_MODULE "ALLJOYN"
+
+using namespace qcc;
+using namespace std;
+
+namespace ajn {
+
+/**
+ * The replies for the calls in a batch. A single event is set when the number of outstanding calls
+ * drops to zero so a caller waiting on the batch is only woken once.
+ *
+ * The calls are the receiver for the reply handlers rather than the batch itself. A reply handler
+ * that has already been taken out of the reply map by the local endpoint can still run after the
+ * batch has been cleared or destroyed so the calls are reference counted: the batch holds one
+ * reference and every call holds one until its reply handler has run.
+ */
+struct MethodCallBatch::Calls : public MessageReceiver {
+
+    /**
+     * Context passed to the reply handler for each call.
+     */
+    struct Context {
+        Context(uint32_t generation, size_t index) : generation(generation), index(index) { }
+        uint32_t generation;        /**< Generation of the batch the call was made in */
+        size_t index;               /**< Index of the call in the batch */
+    };
+
+    Calls(MethodCallBatch* batch) : batch(batch), generation(0), pending(0), callbacks(0), refCount(1)
+    {
+        completed.SetEvent();
+        idle.SetEvent();
+    }
+
+    /**
+     * Record the reply to a call. The reply is dropped if the call was already complete or
+     * belongs to a generation of the batch that has since been cleared.
+     */
+    void Complete(const Context& ctx, Message& reply);
+
+    void ReplyHandler(Message& reply, void* context);
+
+    void AddRef() { IncrementAndFetch(&refCount); }
+
+    void Release()
+    {
+        if (DecrementAndFetch(&refCount) == 0) {
+            delete this;
+        }
+    }
+
+    qcc::Mutex lock;                /**< Protects the call state */
+    qcc::Event completed;           /**< Set when there are no outstanding calls */
+    qcc::Event idle;                /**< Set when no thread is calling the batch listener */
+    MethodCallBatch* batch;         /**< The batch or NULL once the batch has been destroyed */
+    uint32_t generation;            /**< Incremented each time the batch is cleared */
+    std::vector<Message> replies;   /**< Reply message for each call */
+    std::vector<bool> done;         /**< True for each call that has completed */
+    size_t pending;                 /**< Number of outstanding calls */
+    size_t callbacks;               /**< Number of threads currently calling the batch listener */
+    int32_t refCount;               /**< Batch reference plus one for each reply handler yet to run */
+};
+
+void MethodCallBatch::Calls::Complete(const Context& ctx, Message& reply)
+{
+    MethodCallBatch* notify = NULL;
+
+    lock.Lock();
+    /*
+     * Late replies to calls made before the batch was cleared must not touch the current calls.
+     */
+    if ((ctx.generation == generation) && (ctx.index < replies.size()) && !done[ctx.index]) {
+        replies[ctx.index] = reply;
+        done[ctx.index] = true;
+        if (--pending == 0) {
+            completed.SetEvent();
+            if (batch && batch->listener) {
+                notify = batch;
+                if (callbacks++ == 0) {
+                    idle.ResetEvent();
+                }
+            }
+        }
+    }
+    lock.Unlock();
+    /*
+     * Listener is called without holding the lock so it can retrieve the replies. The batch
+     * destructor waits for the listener to return.
+     */
+    if (notify) {
+        notify->listener->BatchComplete(*notify);
+        lock.Lock();
+        if (--callbacks == 0) {
+            idle.SetEvent();
+        }
+        lock.Unlock();
+    }
+}
+
+void MethodCallBatch::Calls::ReplyHandler(Message& reply, void* context)
+{
+    Context* ctx = reinterpret_cast<Context*>(context);
+    Complete(*ctx, reply);
+    delete ctx;
+    Release();
+}
+
+MethodCallBatch::MethodCallBatch(BusAttachment& bus, Listener* listener) :
+    bus(bus),
+    listener(listener),
+    calls(new Calls(this))
+{
+}
+
+MethodCallBatch::~MethodCallBatch()
+{
+    calls->lock.Lock();
+    calls->batch = NULL;
+    calls->lock.Unlock();
+    Clear();
+    /*
+     * Wait for any listener call that is already running before the batch goes away. Reply
+     * handlers that run later only see the calls which live until the last of them has run.
+     */
+    Event::Wait(calls->idle, Event::WAIT_FOREVER);
+    calls->Release();
+}
+
+QStatus MethodCallBatch::MethodCall(const ProxyBusObject& obj,
+                                    const InterfaceDescription::Member& method,
+                                    const MsgArg* args,
+                                    size_t numArgs,
+                                    uint32_t timeout,
+                                    uint8_t flags,
+                                    size_t* index)
+{
+    calls->lock.Lock();
+    size_t idx = calls->replies.size();
+    calls->replies.push_back(Message(bus));
+    calls->done.push_back(false);
+    if (calls->pending++ == 0) {
+        calls->completed.ResetEvent();
+    }
+    Calls::Context* ctx = new Calls::Context(calls->generation, idx);
+    calls->lock.Unlock();
+    if (index) {
+        *index = idx;
+    }
+    /*
+     * Every call in a batch has a reply so the no reply expected flag doesn't apply.
+     */
+    flags &= ~ALLJOYN_FLAG_NO_REPLY_EXPECTED;
+    calls->AddRef();
+    QStatus status = obj.MethodCallAsync(method,
+                                         calls,
+                                         static_cast<MessageReceiver::ReplyHandler>(&Calls::ReplyHandler),
+                                         args,
+                                         numArgs,
+                                         ctx,
+                                         timeout,
+                                         flags);
+    if (status != ER_OK) {
+        /*
+         * Complete the call with an internally generated error reply. The reply handler is never
+         * called when MethodCallAsync fails so the context and reference are released here even if
+         * the batch was cleared in the meantime.
+         */
+        QCC_LogError(status, ("MethodCallAsync for %s.%s failed", method.iface->GetName(), method.name.c_str()));
+        Message reply(bus);
+        reply->ErrorMsg(status, 0);
+        calls->Complete(*ctx, reply);
+        delete ctx;
+        calls->Release();
+    }
+    return status;
+}
+
+QStatus MethodCallBatch::MethodCall(const ProxyBusObject& obj,
+                                    const char* ifaceName,
+                                    const char* methodName,
+                                    const MsgArg* args,
+                                    size_t numArgs,
+                                    uint32_t timeout,
+                                    uint8_t flags,
+                                    size_t* index)
+{
+    const InterfaceDescription* iface = obj.GetInterface(ifaceName);
+    if (!iface) {
+        return ER_BUS_NO_SUCH_INTERFACE;
+    }
+    const InterfaceDescription::Member* member = iface->GetMember(methodName);
+    if (!member) {
+        return ER_BUS_INTERFACE_NO_SUCH_MEMBER;
+    }
+    return MethodCall(obj, *member, args, numArgs, timeout, flags, index);
+}
+
+QStatus MethodCallBatch::Wait(uint32_t timeout)
+{
+    return Event::Wait(calls->completed, (timeout == WAIT_FOREVER) ? Event::WAIT_FOREVER : timeout);
+}
+
+QStatus MethodCallBatch::GetReply(size_t index, Message& reply) const
+{
+    QStatus status;
+    calls->lock.Lock();
+    if (index >= calls->replies.size()) {
+        status = ER_BAD_ARG_1;
+    } else if (!calls->done[index]) {
+        status = ER_WOULDBLOCK;
+    } else {
+        reply = calls->replies[index];
+        status = (reply->GetType() == MESSAGE_ERROR) ? ER_BUS_REPLY_IS_ERROR_MESSAGE : ER_OK;
+    }
+    calls->lock.Unlock();
+    return status;
+}
+
+size_t MethodCallBatch::GetCallCount() const
+{
+    calls->lock.Lock();
+    size_t count = calls->replies.size();
+    calls->lock.Unlock();
+    return count;
+}
+
+size_t MethodCallBatch::GetPendingCount() const
+{
+    calls->lock.Lock();
+    size_t count = calls->pending;
+    calls->lock.Unlock();
+    return count;
+}
+
+void MethodCallBatch::Clear()
+{
+    /*
+     * Outstanding calls are cancelled by moving to a new generation. Their reply handlers stay
+     * registered and drop the late replies when they run so they are never matched against calls
+     * added after the batch was cleared.
+     */
+    calls->lock.Lock();
+    ++calls->generation;
+    calls->replies.clear();
+    calls->done.clear();
+    calls->pending = 0;
+    calls->completed.SetEvent();
+    calls->lock.Unlock();
+}
+
+}
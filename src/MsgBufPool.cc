@@ -0,0 +1,358 @@
+/**
+ * @file
+ * MsgBufPool recycles the buffers that hold marshaled messages.
+ */
+
+/******************************************************************************
+ * Copyright 2011, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+
+#include <qcc/platform.h>
+
+#include <algorithm>
+#include <set>
+
+#if defined(QCC_OS_GROUP_POSIX)
+#include <pthread.h>
+#endif
+
+#include <qcc/Mutex.h>
+
+#include "MsgBufPool.h"
+
+#define QCC_MODULE "ALLJOYN"
+
+using namespace std;
+using namespace qcc;
+
+namespace ajn {
+
+/* Smallest size class is 1 << MIN_CLASS_SHIFT bytes */
+static const size_t MIN_CLASS_SHIFT = 7;
+
+/* Size classes from 128 bytes to 64KB */
+static const size_t NUM_CLASSES = 10;
+
+/* Class recorded for buffers that are not pooled */
+static const size_t HEAP_CLASS = NUM_CLASSES;
+
+/* Maximum bytes kept on the shared free list of each size class */
+static const size_t MAX_SHARED_BYTES = 512 * 1024;
+
+/* Maximum bytes and buffers kept in a thread's cache for each size class */
+static const size_t MAX_CACHE_BYTES = 64 * 1024;
+static const size_t MAX_CACHE_BUFS = 32;
+
+static inline size_t ClassSize(size_t c)
+{
+    return (size_t)1 << (MIN_CLASS_SHIFT + c);
+}
+
+static inline size_t SizeToClass(size_t size)
+{
+    size_t c = 0;
+    while ((c < NUM_CLASSES) && (ClassSize(c) < size)) {
+        ++c;
+    }
+    return c;
+}
+
+static inline size_t CacheLimit(size_t c)
+{
+    return (std::max)((size_t)2, (std::min)(MAX_CACHE_BUFS, MAX_CACHE_BYTES / ClassSize(c)));
+}
+
+/*
+ * Every buffer is preceded by a 64 bit word holding its size class. Free buffers reuse the first
+ * word of the block as the free list link.
+ */
+static inline uint64_t* NewBlock(size_t size, size_t c)
+{
+    uint64_t* block = new uint64_t[1 + ((size + 7) / 8)];
+    block[0] = c;
+    return block;
+}
+
+struct FreeBuf {
+    FreeBuf* next;
+};
+
+/*
+ * Free list for one size class
+ */
+struct FreeList {
+    FreeBuf* head;
+    size_t count;
+
+    FreeList() : head(NULL), count(0) { }
+
+    void Push(FreeBuf* buf)
+    {
+        buf->next = head;
+        head = buf;
+        ++count;
+    }
+
+    FreeBuf* Pop()
+    {
+        FreeBuf* buf = head;
+        if (buf) {
+            head = buf->next;
+            --count;
+        }
+        return buf;
+    }
+};
+
+/*
+ * Per-thread cache of free buffers
+ */
+struct ThreadCache {
+    FreeList lists[NUM_CLASSES];
+    uint32_t numAllocs;
+    uint32_t numHits;
+    uint32_t numHeapAllocs;
+
+    ThreadCache() : numAllocs(0), numHits(0), numHeapAllocs(0) { }
+};
+
+class Pool {
+  public:
+
+    Pool() : enabled(true), numAllocs(0), numHits(0), numHeapAllocs(0)
+    {
+#if defined(QCC_OS_GROUP_POSIX)
+        hasKey = (pthread_key_create(&key, ReleaseCache) == 0);
+#endif
+    }
+
+    /*
+     * Get the calling thread's cache or NULL if there are no thread caches on this platform.
+     */
+    ThreadCache* GetCache()
+    {
+#if defined(QCC_OS_GROUP_POSIX)
+        if (hasKey) {
+            ThreadCache* cache = static_cast<ThreadCache*>(pthread_getspecific(key));
+            if (!cache) {
+                cache = new ThreadCache();
+                if (pthread_setspecific(key, cache) == 0) {
+                    lock.Lock();
+                    caches.insert(cache);
+                    lock.Unlock();
+                } else {
+                    delete cache;
+                    cache = NULL;
+                }
+            }
+            return cache;
+        }
+#endif
+        return NULL;
+    }
+
+    /*
+     * Move up to half a cache worth of buffers from the shared free list into a thread cache.
+     */
+    void Refill(FreeList& list, size_t c)
+    {
+        size_t n = CacheLimit(c) / 2;
+        lock.Lock();
+        while (n-- && shared[c].head) {
+            list.Push(shared[c].Pop());
+        }
+        lock.Unlock();
+    }
+
+    /*
+     * Move buffers from a thread cache to the shared free list until only keep buffers remain in
+     * the cache. Buffers that do not fit on the shared free list go back to the heap.
+     */
+    void Release(FreeList& list, size_t c, size_t keep)
+    {
+        FreeBuf* excess = NULL;
+        lock.Lock();
+        while (list.count > keep) {
+            FreeBuf* buf = list.Pop();
+            if (((shared[c].count + 1) * ClassSize(c)) <= MAX_SHARED_BYTES) {
+                shared[c].Push(buf);
+            } else {
+                buf->next = excess;
+                excess = buf;
+            }
+        }
+        lock.Unlock();
+        while (excess) {
+            FreeBuf* buf = excess;
+            excess = excess->next;
+            delete [] reinterpret_cast<uint64_t*>(buf);
+        }
+    }
+
+#if defined(QCC_OS_GROUP_POSIX)
+    /*
+     * Called when a thread with a cache exits.
+     */
+    static void ReleaseCache(void* arg);
+#endif
+
+    bool enabled;                        /* False if buffers always come from the heap */
+    Mutex lock;                          /* Protects shared, caches and the counters below */
+    FreeList shared[NUM_CLASSES];        /* Free lists shared by all threads */
+    std::set<ThreadCache*> caches;       /* Caches of running threads */
+    uint32_t numAllocs;                  /* Counters for exited threads and threads without a cache */
+    uint32_t numHits;
+    uint32_t numHeapAllocs;
+
+#if defined(QCC_OS_GROUP_POSIX)
+    bool hasKey;                         /* True if key was created */
+    pthread_key_t key;                   /* Key for the calling thread's cache */
+#endif
+};
+
+/*
+ * The pool is never destroyed because threads may still free buffers while static objects are
+ * being destroyed.
+ */
+static Pool& GetPool()
+{
+    static Pool* pool = new Pool();
+    return *pool;
+}
+
+#if defined(QCC_OS_GROUP_POSIX)
+void Pool::ReleaseCache(void* arg)
+{
+    ThreadCache* cache = static_cast<ThreadCache*>(arg);
+    Pool& pool = GetPool();
+    for (size_t c = 0; c < NUM_CLASSES; ++c) {
+        pool.Release(cache->lists[c], c, 0);
+    }
+    pool.lock.Lock();
+    pool.caches.erase(cache);
+    pool.numAllocs += cache->numAllocs;
+    pool.numHits += cache->numHits;
+    pool.numHeapAllocs += cache->numHeapAllocs;
+    pool.lock.Unlock();
+    delete cache;
+}
+#endif
+
+uint64_t* MsgBufPool::Alloc(size_t size)
+{
+    Pool& pool = GetPool();
+    size_t c = SizeToClass(size);
+    bool pooled = (c != HEAP_CLASS) && pool.enabled;
+    FreeBuf* buf = NULL;
+
+    ThreadCache* cache = pool.GetCache();
+    if (cache) {
+        if (pooled) {
+            FreeList& list = cache->lists[c];
+            if (!list.head) {
+                pool.Refill(list, c);
+            }
+            buf = list.Pop();
+        }
+        ++cache->numAllocs;
+        if (buf) {
+            ++cache->numHits;
+        } else {
+            ++cache->numHeapAllocs;
+        }
+    } else {
+        pool.lock.Lock();
+        if (pooled) {
+            buf = pool.shared[c].Pop();
+        }
+        ++pool.numAllocs;
+        if (buf) {
+            ++pool.numHits;
+        } else {
+            ++pool.numHeapAllocs;
+        }
+        pool.lock.Unlock();
+    }
+
+    uint64_t* block;
+    if (buf) {
+        block = reinterpret_cast<uint64_t*>(buf);
+        block[0] = c;
+    } else if (pooled) {
+        block = NewBlock(ClassSize(c), c);
+    } else {
+        block = NewBlock(size, HEAP_CLASS);
+    }
+    return block + 1;
+}
+
+void MsgBufPool::Free(uint64_t* buf)
+{
+    if (!buf) {
+        return;
+    }
+    Pool& pool = GetPool();
+    uint64_t* block = buf - 1;
+    size_t c = static_cast<size_t>(block[0]);
+
+    if ((c >= NUM_CLASSES) || !pool.enabled) {
+        delete [] block;
+        return;
+    }
+
+    FreeBuf* freeBuf = reinterpret_cast<FreeBuf*>(block);
+    ThreadCache* cache = pool.GetCache();
+    if (cache) {
+        FreeList& list = cache->lists[c];
+        list.Push(freeBuf);
+        if (list.count > CacheLimit(c)) {
+            pool.Release(list, c, CacheLimit(c) / 2);
+        }
+    } else {
+        FreeList list;
+        list.Push(freeBuf);
+        pool.Release(list, c, 0);
+    }
+}
+
+void MsgBufPool::GetStats(Stats& stats)
+{
+    Pool& pool = GetPool();
+    pool.lock.Lock();
+    stats.numAllocs = pool.numAllocs;
+    stats.numHits = pool.numHits;
+    stats.numHeapAllocs = pool.numHeapAllocs;
+    stats.bytesRetained = 0;
+    for (size_t c = 0; c < NUM_CLASSES; ++c) {
+        stats.bytesRetained += pool.shared[c].count * ClassSize(c);
+    }
+    for (std::set<ThreadCache*>::iterator it = pool.caches.begin(); it != pool.caches.end(); ++it) {
+        ThreadCache* cache = *it;
+        stats.numAllocs += cache->numAllocs;
+        stats.numHits += cache->numHits;
+        stats.numHeapAllocs += cache->numHeapAllocs;
+        for (size_t c = 0; c < NUM_CLASSES; ++c) {
+            stats.bytesRetained += cache->lists[c].count * ClassSize(c);
+        }
+    }
+    pool.lock.Unlock();
+}
+
+void MsgBufPool::Enable(bool enable)
+{
+    GetPool().enabled = enable;
+}
+
+}
@@ -0,0 +1,83 @@
+/**
+ * @file
+ * MsgBufPool recycles the buffers that hold marshaled messages.
+ */
+
+/******************************************************************************
+ * Copyright 2011, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+#ifndef _ALLJOYN_MSGBUFPOOL_H
+#define _ALLJOYN_MSGBUFPOOL_H
+
+#include <qcc/platform.h>
+
+namespace ajn {
+
+/**
+ * Size-classed pool for _Message buffers. Buffer sizes are rounded up to a power of two between
+ * 128 bytes and 64KB and free buffers are kept per size class. Each thread keeps a small cache of
+ * free buffers so most allocations and frees do not take a lock; caches overflow into (and refill
+ * from) a shared free list that is bounded in size. Larger buffers come straight from the heap.
+ *
+ * Buffers from Alloc() must be released with Free() and never with delete.
+ */
+class MsgBufPool {
+  public:
+
+    /**
+     * Pool statistics. Counters for threads that are still running are read without
+     * synchronization so the values are approximate.
+     */
+    struct Stats {
+        uint32_t numAllocs;       /**< Number of buffers handed out */
+        uint32_t numHits;         /**< Number of buffers handed out from a free list */
+        uint32_t numHeapAllocs;   /**< Number of buffers that had to be allocated from the heap */
+        size_t bytesRetained;     /**< Number of bytes held in free lists */
+    };
+
+    /**
+     * Allocate an 8 byte aligned buffer.
+     *
+     * @param size   Minimum size of the buffer in bytes.
+     * @return  The buffer.
+     */
+    static uint64_t* Alloc(size_t size);
+
+    /**
+     * Return a buffer to the pool.
+     *
+     * @param buf   Buffer returned by Alloc() or NULL.
+     */
+    static void Free(uint64_t* buf);
+
+    /**
+     * Get the pool statistics.
+     *
+     * @param stats  [OUT] Returns the statistics.
+     */
+    static void GetStats(Stats& stats);
+
+    /**
+     * Enable or disable pooling. While disabled every buffer is allocated from and released to the
+     * heap. This is intended for measuring the effect of the pool.
+     *
+     * @param enable  true to enable pooling (the default).
+     */
+    static void Enable(bool enable);
+};
+
+}
+
+#endif
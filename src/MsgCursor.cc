@@ -0,0 +1,543 @@
+/**
+ * @file
+ *
+ * This file implements the MsgCursor class.
+ */
+
+/******************************************************************************
+ * Copyright 2011, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+
+#include <qcc/platform.h>
+
+#include <string.h>
+
+#include <qcc/Debug.h>
+#include <qcc/Util.h>
+
+#include <alljoyn/Message.h>
+#include <alljoyn/MsgCursor.h>
+
+#include "SignatureUtils.h"
+#include "SignaturePlan.h"
+
+#include <Status.h>
+
+#define QCC_MODULE "ALLJOYN"
+
+using namespace qcc;
+using namespace std;
+
+namespace ajn {
+
+static inline const uint8_t* Align(const uint8_t* p, size_t alignment)
+{
+    return (const uint8_t*)(((uintptr_t)p + alignment - 1) & ~((uintptr_t)alignment - 1));
+}
+
+MsgCursor::MsgCursor() :
+    sig(NULL),
+    sigEnd(NULL),
+    elemSig(NULL),
+    pos(NULL),
+    end(NULL),
+    endianSwap(false),
+    handles(NULL),
+    numHandles(0),
+    plan(NULL),
+    planBase(NULL)
+{
+}
+
+MsgCursor::MsgCursor(const char* sig, const char* sigEnd, const uint8_t* pos, const uint8_t* end, bool endianSwap,
+                     const qcc::SocketFd* handles, size_t numHandles, const SignaturePlan* plan) :
+    sig(sig),
+    sigEnd(sigEnd),
+    elemSig(NULL),
+    pos(pos),
+    end(end),
+    endianSwap(endianSwap),
+    handles(handles),
+    numHandles(numHandles),
+    plan(plan),
+    planBase(sig)
+{
+}
+
+AllJoynTypeId MsgCursor::GetTypeId() const
+{
+    if (AtEnd()) {
+        return ALLJOYN_INVALID;
+    }
+    switch (*sig) {
+    case ALLJOYN_STRUCT_OPEN:
+        return ALLJOYN_STRUCT;
+
+    case ALLJOYN_DICT_ENTRY_OPEN:
+        return ALLJOYN_DICT_ENTRY;
+
+    default:
+        return (AllJoynTypeId)(*sig);
+    }
+}
+
+size_t MsgCursor::TypeLen(const char* s) const
+{
+    const SignaturePlan::Op* op = plan ? plan->Find(planBase, s) : NULL;
+    if (op) {
+        return op->sigLen;
+    }
+    const char* t = s;
+    if (SignatureUtils::ParseCompleteType(t) != ER_OK) {
+        return 0;
+    }
+    return t - s;
+}
+
+void MsgCursor::Next(size_t n)
+{
+    sig += n;
+    /*
+     * Array cursors go back to the start of the element signature for the next element.
+     */
+    if (elemSig && (sig >= sigEnd)) {
+        sig = elemSig;
+    }
+}
+
+uint32_t MsgCursor::Len32(const uint8_t* p) const
+{
+    uint32_t n = *((const uint32_t*)p);
+    if (endianSwap) {
+        EndianSwap32(n);
+    }
+    return n;
+}
+
+QStatus MsgCursor::Fixed(AllJoynTypeId typeId, size_t size, const uint8_t*& val)
+{
+    if (AtEnd()) {
+        return ER_BUS_ELEMENT_NOT_FOUND;
+    }
+    if (*sig != (char)typeId) {
+        return ER_BUS_SIGNATURE_MISMATCH;
+    }
+    const uint8_t* p = Align(pos, size);
+    if ((p + size) > end) {
+        return ER_BUS_BAD_LENGTH;
+    }
+    val = p;
+    pos = p + size;
+    Next(1);
+    return ER_OK;
+}
+
+QStatus MsgCursor::Get(uint8_t& val)
+{
+    const uint8_t* p;
+    QStatus status = Fixed(ALLJOYN_BYTE, 1, p);
+    if (status == ER_OK) {
+        val = *p;
+    }
+    return status;
+}
+
+QStatus MsgCursor::Get(bool& val)
+{
+    const uint8_t* p;
+    QStatus status = Fixed(ALLJOYN_BOOLEAN, 4, p);
+    if (status == ER_OK) {
+        uint32_t b = Len32(p);
+        if (b > 1) {
+            status = ER_BUS_BAD_VALUE;
+        } else {
+            val = (b == 1);
+        }
+    }
+    return status;
+}
+
+QStatus MsgCursor::Get(int16_t& val)
+{
+    uint16_t v;
+    const uint8_t* p;
+    QStatus status = Fixed(ALLJOYN_INT16, 2, p);
+    if (status == ER_OK) {
+        v = *((const uint16_t*)p);
+        if (endianSwap) {
+            EndianSwap16(v);
+        }
+        val = (int16_t)v;
+    }
+    return status;
+}
+
+QStatus MsgCursor::Get(uint16_t& val)
+{
+    const uint8_t* p;
+    QStatus status = Fixed(ALLJOYN_UINT16, 2, p);
+    if (status == ER_OK) {
+        val = *((const uint16_t*)p);
+        if (endianSwap) {
+            EndianSwap16(val);
+        }
+    }
+    return status;
+}
+
+QStatus MsgCursor::Get(int32_t& val)
+{
+    const uint8_t* p;
+    QStatus status = Fixed(ALLJOYN_INT32, 4, p);
+    if (status == ER_OK) {
+        val = (int32_t)Len32(p);
+    }
+    return status;
+}
+
+QStatus MsgCursor::Get(uint32_t& val)
+{
+    const uint8_t* p;
+    QStatus status = Fixed(ALLJOYN_UINT32, 4, p);
+    if (status == ER_OK) {
+        val = Len32(p);
+    }
+    return status;
+}
+
+QStatus MsgCursor::Get(int64_t& val)
+{
+    uint64_t v;
+    const uint8_t* p;
+    QStatus status = Fixed(ALLJOYN_INT64, 8, p);
+    if (status == ER_OK) {
+        v = *((const uint64_t*)p);
+        if (endianSwap) {
+            EndianSwap64(v);
+        }
+        val = (int64_t)v;
+    }
+    return status;
+}
+
+QStatus MsgCursor::Get(uint64_t& val)
+{
+    const uint8_t* p;
+    QStatus status = Fixed(ALLJOYN_UINT64, 8, p);
+    if (status == ER_OK) {
+        val = *((const uint64_t*)p);
+        if (endianSwap) {
+            EndianSwap64(val);
+        }
+    }
+    return status;
+}
+
+QStatus MsgCursor::Get(double& val)
+{
+    uint64_t v;
+    const uint8_t* p;
+    QStatus status = Fixed(ALLJOYN_DOUBLE, 8, p);
+    if (status == ER_OK) {
+        v = *((const uint64_t*)p);
+        if (endianSwap) {
+            EndianSwap64(v);
+        }
+        memcpy(&val, &v, sizeof(val));
+    }
+    return status;
+}
+
+QStatus MsgCursor::GetStr(AllJoynTypeId typeId, const char*& str, size_t& len)
+{
+    if (AtEnd()) {
+        return ER_BUS_ELEMENT_NOT_FOUND;
+    }
+    if (*sig != (char)typeId) {
+        return ER_BUS_SIGNATURE_MISMATCH;
+    }
+    const uint8_t* p = Align(pos, 4);
+    if ((p + 4) > end) {
+        return ER_BUS_BAD_LENGTH;
+    }
+    uint32_t n = Len32(p);
+    p += 4;
+    if ((n > ALLJOYN_MAX_PACKET_LEN) || (n >= (size_t)(end - p))) {
+        return ER_BUS_BAD_LENGTH;
+    }
+    if (p[n] != 0) {
+        return ER_BUS_NOT_NUL_TERMINATED;
+    }
+    str = (const char*)p;
+    len = n;
+    pos = p + n + 1;
+    Next(1);
+    return ER_OK;
+}
+
+QStatus MsgCursor::GetSignature(const char*& signature, size_t& len)
+{
+    if (AtEnd()) {
+        return ER_BUS_ELEMENT_NOT_FOUND;
+    }
+    if (*sig != ALLJOYN_SIGNATURE) {
+        return ER_BUS_SIGNATURE_MISMATCH;
+    }
+    if (pos >= end) {
+        return ER_BUS_BAD_LENGTH;
+    }
+    size_t n = *pos;
+    if ((n + 1) >= (size_t)(end - pos)) {
+        return ER_BUS_BAD_LENGTH;
+    }
+    if (pos[n + 1] != 0) {
+        return ER_BUS_NOT_NUL_TERMINATED;
+    }
+    signature = (const char*)(pos + 1);
+    len = n;
+    pos += n + 2;
+    Next(1);
+    return ER_OK;
+}
+
+QStatus MsgCursor::GetHandle(qcc::SocketFd& fd)
+{
+    const uint8_t* p;
+    QStatus status = Fixed(ALLJOYN_HANDLE, 4, p);
+    if (status == ER_OK) {
+        uint32_t index = Len32(p);
+        if (index >= numHandles) {
+            status = ER_BUS_NO_SUCH_HANDLE;
+        } else {
+            fd = handles[index];
+        }
+    }
+    return status;
+}
+
+QStatus MsgCursor::GetBytes(const uint8_t*& bytes, size_t& len)
+{
+    if (AtEnd()) {
+        return ER_BUS_ELEMENT_NOT_FOUND;
+    }
+    if ((sig[0] != ALLJOYN_ARRAY) || (sig[1] != ALLJOYN_BYTE)) {
+        return ER_BUS_SIGNATURE_MISMATCH;
+    }
+    const uint8_t* p = Align(pos, 4);
+    if ((p + 4) > end) {
+        return ER_BUS_BAD_LENGTH;
+    }
+    uint32_t n = Len32(p);
+    p += 4;
+    if ((n > ALLJOYN_MAX_ARRAY_LEN) || (n > (size_t)(end - p))) {
+        return ER_BUS_BAD_LENGTH;
+    }
+    bytes = p;
+    len = n;
+    pos = p + n;
+    Next(2);
+    return ER_OK;
+}
+
+QStatus MsgCursor::Recurse(MsgCursor& sub)
+{
+    QStatus status = ER_OK;
+
+    if (AtEnd()) {
+        return ER_BUS_ELEMENT_NOT_FOUND;
+    }
+    switch (*sig) {
+    case ALLJOYN_ARRAY:
+    {
+        size_t elemLen = TypeLen(sig + 1);
+        if (elemLen == 0) {
+            return ER_BUS_BAD_SIGNATURE;
+        }
+        const uint8_t* p = Align(pos, 4);
+        if ((p + 4) > end) {
+            return ER_BUS_BAD_LENGTH;
+        }
+        uint32_t len = Len32(p);
+        /*
+         * The array length does not include the padding before the first element.
+         */
+        p = Align(p + 4, SignatureUtils::AlignmentForType((AllJoynTypeId)sig[1]));
+        if ((len > ALLJOYN_MAX_ARRAY_LEN) || (p > end) || (len > (size_t)(end - p))) {
+            return ER_BUS_BAD_LENGTH;
+        }
+        sub = MsgCursor(sig + 1, sig + 1 + elemLen, p, p + len, endianSwap, handles, numHandles, plan);
+        sub.planBase = planBase;
+        sub.elemSig = sig + 1;
+        pos = p + len;
+        Next(1 + elemLen);
+    }
+    break;
+
+    case ALLJOYN_STRUCT_OPEN:
+    case ALLJOYN_DICT_ENTRY_OPEN:
+    {
+        size_t n = TypeLen(sig);
+        if (n == 0) {
+            return ER_BUS_BAD_SIGNATURE;
+        }
+        const uint8_t* p = Align(pos, 8);
+        if (p > end) {
+            return ER_BUS_BAD_LENGTH;
+        }
+        sub = MsgCursor(sig + 1, sig + n - 1, p, end, endianSwap, handles, numHandles, plan);
+        sub.planBase = planBase;
+        /*
+         * We have to skip over the members to find where the container ends.
+         */
+        MsgCursor members = sub;
+        while ((status == ER_OK) && !members.AtEnd()) {
+            status = members.Skip();
+        }
+        if (status == ER_OK) {
+            sub.end = members.pos;
+            pos = members.pos;
+            Next(n);
+        }
+    }
+    break;
+
+    case ALLJOYN_VARIANT:
+    {
+        if (pos >= end) {
+            return ER_BUS_BAD_LENGTH;
+        }
+        size_t n = *pos;
+        if ((n + 1) >= (size_t)(end - pos)) {
+            return ER_BUS_BAD_LENGTH;
+        }
+        const char* varSig = (const char*)(pos + 1);
+        if (varSig[n] != 0) {
+            return ER_BUS_NOT_NUL_TERMINATED;
+        }
+        if (!SignatureUtils::IsCompleteType(varSig)) {
+            return ER_BUS_BAD_SIGNATURE;
+        }
+        sub = MsgCursor(varSig, varSig + n, pos + n + 2, end, endianSwap, handles, numHandles, (n > 1) ? SignaturePlan::Lookup(varSig) : NULL);
+        MsgCursor val = sub;
+        status = val.Skip();
+        if (status == ER_OK) {
+            sub.end = val.pos;
+            pos = val.pos;
+            Next(1);
+        }
+    }
+    break;
+
+    default:
+        status = ER_BUS_SIGNATURE_MISMATCH;
+        break;
+    }
+    return status;
+}
+
+QStatus MsgCursor::Skip()
+{
+    const uint8_t* p;
+    const char* str;
+    size_t len;
+
+    if (AtEnd()) {
+        return ER_BUS_ELEMENT_NOT_FOUND;
+    }
+    switch (AllJoynTypeId typeId = (AllJoynTypeId)(*sig)) {
+    case ALLJOYN_BYTE:
+        return Fixed(typeId, 1, p);
+
+    case ALLJOYN_INT16:
+    case ALLJOYN_UINT16:
+        return Fixed(typeId, 2, p);
+
+    case ALLJOYN_BOOLEAN:
+    case ALLJOYN_INT32:
+    case ALLJOYN_UINT32:
+    case ALLJOYN_HANDLE:
+        return Fixed(typeId, 4, p);
+
+    case ALLJOYN_DOUBLE:
+    case ALLJOYN_UINT64:
+    case ALLJOYN_INT64:
+        return Fixed(typeId, 8, p);
+
+    case ALLJOYN_STRING:
+    case ALLJOYN_OBJECT_PATH:
+        return GetStr(typeId, str, len);
+
+    case ALLJOYN_SIGNATURE:
+        return GetSignature(str, len);
+
+    case ALLJOYN_STRUCT_OPEN:
+    case ALLJOYN_DICT_ENTRY_OPEN:
+    {
+        /*
+         * Containers with a fixed size can be skipped without visiting the members.
+         */
+        const SignaturePlan::Op* op = plan ? plan->Find(planBase, sig) : NULL;
+        if (op && op->fixedSize) {
+            p = Align(pos, 8);
+            if ((p > end) || (op->fixedSize > (size_t)(end - p))) {
+                return ER_BUS_BAD_LENGTH;
+            }
+            pos = p + op->fixedSize;
+            Next(op->sigLen);
+            return ER_OK;
+        }
+    }
+
+    /* Falling through */
+    case ALLJOYN_ARRAY:
+    case ALLJOYN_VARIANT:
+    {
+        MsgCursor sub;
+        return Recurse(sub);
+    }
+
+    default:
+        return ER_BUS_BAD_VALUE_TYPE;
+    }
+}
+
+QStatus MsgCursor::FindEntry(const char* key, MsgCursor& val)
+{
+    if (AtEnd()) {
+        return ER_BUS_ELEMENT_NOT_FOUND;
+    }
+    if ((sig[0] != ALLJOYN_ARRAY) || (sig[1] != ALLJOYN_DICT_ENTRY_OPEN) || ((sig[2] != ALLJOYN_STRING) && (sig[2] != ALLJOYN_OBJECT_PATH))) {
+        return ER_BUS_NOT_A_DICTIONARY;
+    }
+    AllJoynTypeId keyType = (AllJoynTypeId)sig[2];
+    MsgCursor entries;
+    QStatus status = Recurse(entries);
+    while ((status == ER_OK) && !entries.AtEnd()) {
+        MsgCursor entry;
+        const char* str;
+        size_t len;
+        status = entries.Recurse(entry);
+        if (status == ER_OK) {
+            status = entry.GetStr(keyType, str, len);
+        }
+        if ((status == ER_OK) && (strcmp(str, key) == 0)) {
+            val = entry;
+            return ER_OK;
+        }
+    }
+    return (status == ER_OK) ? ER_BUS_ELEMENT_NOT_FOUND : status;
+}
+
+}
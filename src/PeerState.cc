@@ -66,20 +66,59 @@ uint32_t _PeerState::EstimateTimestamp(uint32_t remote)
 
 bool _PeerState::IsValidSerial(uint32_t serial, bool secure, bool unreliable)
 {
-    bool ret = false;
     /*
      * Serial 0 is always invalid.
      */
-    if (serial != 0) {
-        const size_t winSize = sizeof(window) / sizeof(window[0]);
-        uint32_t* entry = window + (serial % winSize);
-        if (*entry != serial) {
-            *entry = serial;
-            ret = true;
+    if (serial == 0) {
+        return false;
+    }
+    const uint32_t mask = SERIAL_WINDOW_SIZE - 1;
+    if (highestSerial == 0) {
+        highestSerial = serial;
+    }
+    int32_t delta = static_cast<int32_t>(serial - highestSerial);
+    if (delta > 0) {
+        /*
+         * Slide the window forward, clearing the bits of the serial numbers that enter it. A
+         * whole word is cleared at a time where possible.
+         */
+        if (static_cast<uint32_t>(delta) >= SERIAL_WINDOW_SIZE) {
+            ::memset(window, 0, sizeof(window));
+        } else {
+            uint32_t s = highestSerial + 1;
+            uint32_t end = serial + 1;
+            while (s != end) {
+                uint32_t bit = s & mask;
+                if (((bit & 31) == 0) && ((end - s) >= 32)) {
+                    window[bit >> 5] = 0;
+                    s += 32;
+                } else {
+                    window[bit >> 5] &= ~(1u << (bit & 31));
+                    ++s;
+                }
+            }
+        }
+        highestSerial = serial;
+    } else if ((highestSerial - serial) >= SERIAL_WINDOW_SIZE) {
+        /*
+         * Too old to tell if this is a replay. Secure messages are rejected, other messages are
+         * accepted as there is nothing to protect.
+         */
+        if (secure) {
+            ++outOfWindowCount;
+            QCC_DbgHLPrintf(("Serial %u is outside the window ending at %u", serial, highestSerial));
+            return false;
         }
+        return true;
     }
-    return ret;
-
+    uint32_t bit = serial & mask;
+    uint32_t& word = window[bit >> 5];
+    if (word & (1u << (bit & 31))) {
+        ++replayCount;
+        return false;
+    }
+    word |= (1u << (bit & 31));
+    return true;
 }
 
 PeerStateTable::PeerStateTable()
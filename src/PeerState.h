@@ -41,6 +41,19 @@
 
 #include <Status.h>
 
+#include "AllJoynCrypto.h"
+
+/**
+ * Number of serial numbers tracked per peer for replay detection. Must be a power of 2 and at
+ * least 32. Can be overridden at build time.
+ */
+#ifndef ALLJOYN_SERIAL_WINDOW_SIZE
+#define ALLJOYN_SERIAL_WINDOW_SIZE 1024
+#endif
+#if (ALLJOYN_SERIAL_WINDOW_SIZE < 32) || (ALLJOYN_SERIAL_WINDOW_SIZE & (ALLJOYN_SERIAL_WINDOW_SIZE - 1))
+#error ALLJOYN_SERIAL_WINDOW_SIZE must be a power of 2 and at least 32
+#endif
+
 namespace ajn {
 
 /* Forward declaration */
@@ -79,7 +92,10 @@ class _PeerState {
         firstClockAdjust(true),
         lastDriftAdjustTime(0),
         expectedSerial(0),
-        isSecure(false)
+        isSecure(false),
+        highestSerial(0),
+        replayCount(0),
+        outOfWindowCount(0)
     {
         ::memset(window, 0, sizeof(window));
     }
@@ -96,9 +112,10 @@ class _PeerState {
 
     /**
      * This method is called whenever a message is unmarshaled. It checks that the serial number is
-     * valid by comparing against the last N serial numbers received from this peer. Secure messages
-     * have additional checks for replay attacks. Unreliable messages are checked for in-order
-     * arrival.
+     * valid by comparing against the last SERIAL_WINDOW_SIZE serial numbers received from this
+     * peer. A serial number that was already received in the window is a replay. Secure messages
+     * have an additional check for replay attacks: serial numbers too old to be tracked by the
+     * window are rejected.
      *
      * @param serial      The serial number being checked.
      * @param secure      The message was flagged as secure
@@ -127,7 +144,7 @@ class _PeerState {
      * @param keyType    Indicate if this is the unicast or broadcast key.
      */
     void SetKey(const qcc::KeyBlob& key, PeerKeyType keyType) {
-        keys[keyType] = key;
+        keys[keyType] = MessageCipher(key);
         isSecure = key.IsValid();
     }
 
@@ -141,9 +158,28 @@ class _PeerState {
      *          - ER_BUS_KEY_EXPIRED if there was a session key but the key has expired.
      */
     QStatus GetKey(qcc::KeyBlob& key, PeerKeyType keyType) {
+        MessageCipher cipher;
+        QStatus status = GetCipher(cipher, keyType);
+        if (status == ER_OK) {
+            key = cipher->GetKey();
+        }
+        return status;
+    }
+
+    /**
+     * Gets the session key for this peer together with its expanded key schedule for encrypting
+     * and decrypting messages.
+     *
+     * @param cipher    [out]Returns the cipher for the session key.
+     *
+     * @return  - ER_OK if there is a session key set for this peer.
+     *          - ER_BUS_KEY_UNAVAILABLE if no session key has been set for this peer.
+     *          - ER_BUS_KEY_EXPIRED if there was a session key but the key has expired.
+     */
+    QStatus GetCipher(MessageCipher& cipher, PeerKeyType keyType) {
         if (isSecure) {
-            key = keys[keyType];
-            if (key.HasExpired()) {
+            cipher = keys[keyType];
+            if (cipher->GetKey().HasExpired()) {
                 ClearKeys();
                 return ER_BUS_KEY_EXPIRED;
             } else {
@@ -158,8 +194,8 @@ class _PeerState {
      * Clear the keys for this peer.
      */
     void ClearKeys() {
-        keys[PEER_SESSION_KEY].Erase();
-        keys[PEER_GROUP_KEY].Erase();
+        keys[PEER_SESSION_KEY] = MessageCipher();
+        keys[PEER_GROUP_KEY] = MessageCipher();
         isSecure = false;
     }
 
@@ -182,10 +218,31 @@ class _PeerState {
      *
      * @return Size of the serial number validation window.
      */
-    size_t SerialWindowSize() { return sizeof(window) / sizeof(window[0]); }
+    size_t SerialWindowSize() { return SERIAL_WINDOW_SIZE; }
+
+    /**
+     * Get the number of messages rejected by IsValidSerial() because their serial number was
+     * already received.
+     *
+     * @return  The number of replayed serial numbers.
+     */
+    uint32_t GetReplayCount() { return replayCount; }
+
+    /**
+     * Get the number of secure messages rejected by IsValidSerial() because their serial number
+     * was older than the serial number window.
+     *
+     * @return  The number of out-of-window serial numbers.
+     */
+    uint32_t GetOutOfWindowCount() { return outOfWindowCount; }
 
   private:
 
+    /**
+     * Number of serial numbers tracked by the serial number window.
+     */
+    static const uint32_t SERIAL_WINDOW_SIZE = ALLJOYN_SERIAL_WINDOW_SIZE;
+
     /**
      * True if this peer state is for the local peer.
      */
@@ -223,15 +280,31 @@ class _PeerState {
     qcc::GUID128 guid;
 
     /**
-     * The session keys (unicast and broadcast) for this peer.
+     * The session keys (unicast and broadcast) for this peer with their expanded key schedules.
+     */
+    MessageCipher keys[2];
+
+    /**
+     * The highest serial number received from this peer or 0 if none has been received.
+     */
+    uint32_t highestSerial;
+
+    /**
+     * Serial number window. Used by IsValidSerial() to detect replay attacks. Bit
+     * (serial % SERIAL_WINDOW_SIZE) is set if serial was received and is one of the
+     * SERIAL_WINDOW_SIZE serial numbers ending at highestSerial.
+     */
+    uint32_t window[SERIAL_WINDOW_SIZE / 32];
+
+    /**
+     * Number of replayed serial numbers rejected.
      */
-    qcc::KeyBlob keys[2];
+    uint32_t replayCount;
 
     /**
-     * Serial number window. Used by IsValidSerial() to detect replay attacks. The size of the
-     * window defines that largest tolerable gap between consecutive serial numbers.
+     * Number of out-of-window serial numbers rejected.
      */
-    uint32_t window[128];
+    uint32_t outOfWindowCount;
 
 };
 
@@ -430,6 +430,13 @@ QStatus ProxyBusObject::MethodCallAsync(const InterfaceDescription::Member& meth
             } else {
                 status = bus->GetInternal().GetRouter().PushMessage(msg, localEndpoint);
             }
+            /*
+             * The caller sees the failure and owns the context so the reply handler must not
+             * also be called later.
+             */
+            if ((status != ER_OK) && !(flags & ALLJOYN_FLAG_NO_REPLY_EXPECTED)) {
+                localEndpoint.UnregisterReplyHandler(serial);
+            }
         }
     }
     return status;
@@ -715,14 +722,18 @@ QStatus ProxyBusObject::IntrospectRemoteObjectAsync(ProxyBusObject::Listener* li
     /* Attempt to retrieve introspection from the remote object using async call */
     const InterfaceDescription::Member* introMember = introIntf->GetMember("Introspect");
     assert(introMember);
+    _IntrospectMethodCBContext* cbCtx = new _IntrospectMethodCBContext(this, listener, callback, context);
     QStatus status = MethodCallAsync(*introMember,
                                      this,
                                      static_cast<MessageReceiver::ReplyHandler>(&ProxyBusObject::IntrospectMethodCB),
                                      NULL,
                                      0,
-                                     reinterpret_cast<void*>(new _IntrospectMethodCBContext(this, listener, callback, context)),
+                                     reinterpret_cast<void*>(cbCtx),
                                      5000);
-
+    if (status != ER_OK) {
+        /* The reply handler is not called so the context is ours to free */
+        delete cbCtx;
+    }
     return status;
 }
 
@@ -51,6 +51,15 @@ namespace ajn {
 
 #define ENDPOINT_IS_DEAD_ALERTCODE  1
 
+/* Stop coalescing queued messages into a single write once this many bytes are buffered */
+static const size_t MAX_TX_BATCH = 64 * 1024;
+
+/*
+ * A reactor thread cannot wait for room in a full tx queue so it may exceed the queue limits,
+ * but only by this factor.
+ */
+static const uint32_t REACTOR_TX_QUEUE_SLACK = 4;
+
 static uint32_t threadCount = 0;
 
 /* Endpoint constructor */
@@ -80,18 +89,40 @@ RemoteEndpoint::RemoteEndpoint(BusAttachment& bus,
     idleTimeoutCount(0),
     maxIdleProbes(0),
     idleTimeout(0),
-    probeTimeout(0)
+    probeTimeout(0),
+    reactor(NULL),
+    reactorStream(NULL),
+    reactorStopping(false),
+    reactorTxPending(false),
+    rxBuffer(NULL),
+    txMessages(0),
+    txWrites(0),
+    txLimits(),
+    txStats(),
+    txQueueBytes(0),
+    txInFlight(0)
 {
     ++threadCount;
 }
 
 RemoteEndpoint::~RemoteEndpoint()
 {
+    /*
+     * An endpoint that is deleted while a reactor is still servicing it never went through
+     * ReactorExit() so it has to be unregistered here.
+     */
+    if (reactor && reactor->RemoveEndpoint(*this)) {
+        bus.GetInternal().GetRouter().UnregisterEndpoint(*this);
+    }
+
     /* Request Stop */
     Stop();
 
     /* Wait for thread to shutdown */
     Join();
+
+    delete reactorStream;
+    delete rxBuffer;
 }
 
 QStatus RemoteEndpoint::SetLinkTimeout(uint32_t idleTimeout, uint32_t probeTimeout, uint32_t maxIdleProbes)
@@ -122,6 +153,42 @@ QStatus RemoteEndpoint::Start()
         endpointType = BusEndpoint::ENDPOINT_TYPE_BUS2BUS;
     }
 
+    /* Let the router apply its configuration (e.g. tx queue limits) */
+    router.ConfigureEndpoint(*this);
+
+    /*
+     * Hand socket endpoints over to the router's reactor if it has one. Bus-to-bus endpoints keep
+     * their own threads because link timeout probes and rx pausing are driven by the rx thread.
+     */
+    EndpointReactor* epReactor = router.GetEndpointReactor();
+    if (epReactor && isSocket && !features.isBusToBus) {
+        reactor = epReactor;
+        reactorStream = new ReactorStream(static_cast<SocketStream&>(stream).GetSocketFd());
+        status = router.RegisterEndpoint(*this, false);
+        if (ER_OK == status) {
+            status = reactor->AddEndpoint(*this);
+            if (ER_OK != status) {
+                router.UnregisterEndpoint(*this);
+            }
+        }
+        if (ER_OK != status) {
+            reactor = NULL;
+            delete reactorStream;
+            reactorStream = NULL;
+            QCC_LogError(status, ("AllJoynRemoteEndoint::Start failed"));
+        }
+        return status;
+    }
+
+    /*
+     * Read ahead on other endpoints so a burst of messages is received with a single read.
+     * Bus-to-bus endpoints read exactly one message at a time because their socket can be handed
+     * over to a raw session right after a reply has been received.
+     */
+    if (!features.isBusToBus && !rxBuffer) {
+        rxBuffer = new RxBuffer(stream, features.handlePassing);
+    }
+
     /* Start the TX thread */
     status = txThread.Start(this, this);
     isTxStarted = (ER_OK == status);
@@ -167,8 +234,17 @@ QStatus RemoteEndpoint::Stop(void)
     while (it != txWaitQueue.end()) {
         (*it++)->Alert(ENDPOINT_IS_DEAD_ALERTCODE);
     }
+    if (reactor) {
+        reactorStopping = true;
+    }
     txQueueLock.Unlock();
 
+    /* The reactor thread servicing this endpoint takes care of the exit */
+    if (reactor) {
+        reactor->WakeEndpoint(*this);
+        return ER_OK;
+    }
+
     /*
      * Don't call txThread.Stop() here; the logic in RemoteEndpoint::ThreadExit() takes care of
      * stopping the txThread.
@@ -187,10 +263,13 @@ QStatus RemoteEndpoint::StopAfterTxEmpty(uint32_t maxWaitMs)
     /* Init wait time */
     uint32_t startTime = maxWaitMs ? GetTimestamp() : 0;
 
-    /* Wait for txqueue to empty before triggering stop */
+    /*
+     * Wait for txqueue to empty before triggering stop. A reactor has taken messages off the queue
+     * once they are in the stream's transmit buffer so also wait for that to be written.
+     */
     txQueueLock.Lock();
     while (true) {
-        if (txQueue.empty() || (maxWaitMs && (qcc::GetTimestamp() > (startTime + maxWaitMs)))) {
+        if ((txQueue.empty() && !reactorTxPending) || (maxWaitMs && (qcc::GetTimestamp() > (startTime + maxWaitMs)))) {
             status = Stop();
             break;
         } else {
@@ -255,93 +334,106 @@ static inline bool IsControlMessage(Message& msg)
     return false;
 }
 
+QStatus RemoteEndpoint::HandleRxMessage(Message& msg, QStatus status)
+{
+    const bool bus2bus = BusEndpoint::ENDPOINT_TYPE_BUS2BUS == GetEndpointType();
+    Router& router = bus.GetInternal().GetRouter();
+
+    switch (status) {
+    case ER_OK :
+        idleTimeoutCount = 0;
+        bool isAck;
+        if (IsProbeMsg(msg, isAck)) {
+            QCC_DbgPrintf(("%s: Received %s\n", GetUniqueName().c_str(), isAck ? "ProbeAck" : "ProbeReq"));
+            if (!isAck) {
+                /* Respond to probe request */
+                Message probeMsg(bus);
+                status = GenProbeMsg(true, probeMsg);
+                if (status == ER_OK) {
+                    status = PushMessage(probeMsg);
+                }
+                QCC_DbgPrintf(("%s: Sent ProbeAck (%s)\n", GetUniqueName().c_str(), QCC_StatusText(status)));
+            }
+        } else {
+            status = router.PushMessage(msg, *this);
+            if (status != ER_OK) {
+                /*
+                 * There are three cases where a failure to push a message to the router is ok:
+                 *
+                 * 1) The message received did not match the expected signature.
+                 * 2) The message was a method reply that did not match up to a method call.
+                 * 3) A daemon is pushing the message to a connected client or service.
+                 *
+                 */
+                if ((router.IsDaemon() && !bus2bus) || (status == ER_BUS_SIGNATURE_MISMATCH) || (status == ER_BUS_UNMATCHED_REPLY_SERIAL)) {
+                    QCC_DbgHLPrintf(("Discarding %s: %s", msg->Description().c_str(), QCC_StatusText(status)));
+                    status = ER_OK;
+                }
+            }
+        }
+        break;
+
+    case ER_BUS_CANNOT_EXPAND_MESSAGE :
+        /*
+         * The message could not be expanded so pass it the peer object to request the expansion
+         * rule from the endpoint that sent it.
+         */
+        status = bus.GetInternal().GetLocalEndpoint().GetPeerObj()->RequestHeaderExpansion(msg, this);
+        if ((status != ER_OK) && router.IsDaemon()) {
+            QCC_LogError(status, ("Discarding %s", msg->Description().c_str()));
+            status = ER_OK;
+        }
+        break;
+
+    case ER_BUS_TIME_TO_LIVE_EXPIRED:
+        QCC_DbgHLPrintf(("TTL expired discarding %s", msg->Description().c_str()));
+        status = ER_OK;
+        break;
+
+    case ER_BUS_INVALID_HEADER_SERIAL:
+        /*
+         * Ignore invalid serial numbers for unreliable messages or broadcast messages that come from
+         * bus2bus endpoints as these can be delivered out-of-order or repeated.
+         *
+         * Ignore control messages (i.e. messages targeted at the bus controller)
+         * TODO - need explanation why this is neccessary.
+         *
+         * In all other cases an invalid serial number cause the connection to be dropped.
+         */
+        if (msg->IsUnreliable() || (bus2bus && msg->IsBroadcastSignal()) || IsControlMessage(msg)) {
+            QCC_DbgHLPrintf(("Invalid serial discarding %s", msg->Description().c_str()));
+            status = ER_OK;
+        } else {
+            QCC_LogError(status, ("Invalid serial %s", msg->Description().c_str()));
+        }
+        break;
+
+    default:
+        break;
+    }
+    return status;
+}
+
 void* RemoteEndpoint::RxThread::Run(void* arg)
 {
     QStatus status = ER_OK;
     RemoteEndpoint* ep = reinterpret_cast<RemoteEndpoint*>(arg);
     const bool bus2bus = BusEndpoint::ENDPOINT_TYPE_BUS2BUS == ep->GetEndpointType();
 
-    Router& router = bus.GetInternal().GetRouter();
     qcc::Event& ev = ep->GetSource().GetSourceEvent();
     /* Receive messages until the socket is disconnected */
     while (!IsStopping() && (ER_OK == status)) {
         uint32_t timeout = (ep->idleTimeoutCount == 0) ? ep->idleTimeout : ep->probeTimeout;
-        status = Event::Wait(ev, (timeout > 0) ? (1000 * timeout) : Event::WAIT_FOREVER);
+        /* Messages already in the receive buffer do not set the source event */
+        if (ep->rxBuffer && ep->rxBuffer->HasData()) {
+            status = ER_OK;
+        } else {
+            status = Event::Wait(ev, (timeout > 0) ? (1000 * timeout) : Event::WAIT_FOREVER);
+        }
         if (ER_OK == status) {
             Message msg(bus);
             status = msg->Unmarshal(*ep, (validateSender && !bus2bus));
-            switch (status) {
-            case ER_OK :
-                ep->idleTimeoutCount = 0;
-                bool isAck;
-                if (ep->IsProbeMsg(msg, isAck)) {
-                    QCC_DbgPrintf(("%s: Received %s\n", ep->GetUniqueName().c_str(), isAck ? "ProbeAck" : "ProbeReq"));
-                    if (!isAck) {
-                        /* Respond to probe request */
-                        Message probeMsg(bus);
-                        status = ep->GenProbeMsg(true, probeMsg);
-                        if (status == ER_OK) {
-                            status = ep->PushMessage(probeMsg);
-                        }
-                        QCC_DbgPrintf(("%s: Sent ProbeAck (%s)\n", ep->GetUniqueName().c_str(), QCC_StatusText(status)));
-                    }
-                } else {
-                    status = router.PushMessage(msg, *ep);
-                    if (status != ER_OK) {
-                        /*
-                         * There are three cases where a failure to push a message to the router is ok:
-                         *
-                         * 1) The message received did not match the expected signature.
-                         * 2) The message was a method reply that did not match up to a method call.
-                         * 3) A daemon is pushing the message to a connected client or service.
-                         *
-                         */
-                        if ((router.IsDaemon() && !bus2bus) || (status == ER_BUS_SIGNATURE_MISMATCH) || (status == ER_BUS_UNMATCHED_REPLY_SERIAL)) {
-                            QCC_DbgHLPrintf(("Discarding %s: %s", msg->Description().c_str(), QCC_StatusText(status)));
-                            status = ER_OK;
-                        }
-                    }
-                }
-                break;
-
-            case ER_BUS_CANNOT_EXPAND_MESSAGE :
-                /*
-                 * The message could not be expanded so pass it the peer object to request the expansion
-                 * rule from the endpoint that sent it.
-                 */
-                status = bus.GetInternal().GetLocalEndpoint().GetPeerObj()->RequestHeaderExpansion(msg, ep);
-                if ((status != ER_OK) && router.IsDaemon()) {
-                    QCC_LogError(status, ("Discarding %s", msg->Description().c_str()));
-                    status = ER_OK;
-                }
-                break;
-
-            case ER_BUS_TIME_TO_LIVE_EXPIRED:
-                QCC_DbgHLPrintf(("TTL expired discarding %s", msg->Description().c_str()));
-                status = ER_OK;
-                break;
-
-            case ER_BUS_INVALID_HEADER_SERIAL:
-                /*
-                 * Ignore invalid serial numbers for unreliable messages or broadcast messages that come from
-                 * bus2bus endpoints as these can be delivered out-of-order or repeated.
-                 *
-                 * Ignore control messages (i.e. messages targeted at the bus controller)
-                 * TODO - need explanation why this is neccessary.
-                 *
-                 * In all other cases an invalid serial number cause the connection to be dropped.
-                 */
-                if (msg->IsUnreliable() || (bus2bus && msg->IsBroadcastSignal()) || IsControlMessage(msg)) {
-                    QCC_DbgHLPrintf(("Invalid serial discarding %s", msg->Description().c_str()));
-                    status = ER_OK;
-                } else {
-                    QCC_LogError(status, ("Invalid serial %s", msg->Description().c_str()));
-                }
-                break;
-
-            default:
-                break;
-            }
+            status = ep->HandleRxMessage(msg, status);
 
             /* Check pause condition. Block until stopped */
             if (ep->armRxPause && !IsStopping() && (msg->GetType() == MESSAGE_METHOD_RET)) {
@@ -376,10 +468,64 @@ void* RemoteEndpoint::RxThread::Run(void* arg)
     return (void*) status;
 }
 
+QStatus RemoteEndpoint::TxBatch::PushBytes(const void* buf, size_t numBytes, size_t& numSent)
+{
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(buf);
+    this->buf.insert(this->buf.end(), bytes, bytes + numBytes);
+    numSent = numBytes;
+    return ER_OK;
+}
+
+QStatus RemoteEndpoint::TxBatch::PushBytesAndFds(const void* buf, size_t numBytes, size_t& numSent, SocketFd* fdList, size_t numFds, uint32_t pid)
+{
+    FdRun run;
+    run.offset = this->buf.size();
+    run.fdList = fdList;
+    run.numFds = numFds;
+    run.pid = pid;
+    fdRuns.push_back(run);
+    return PushBytes(buf, numBytes, numSent);
+}
+
+QStatus RemoteEndpoint::TxBatch::Flush(Sink& sink, uint32_t& numWrites)
+{
+    QStatus status = ER_OK;
+    size_t offset = 0;
+    size_t run = 0;
+
+    while ((ER_OK == status) && (offset < buf.size())) {
+        /* Each push ends where the next message with file descriptors starts */
+        const FdRun* fds = NULL;
+        if ((run < fdRuns.size()) && (fdRuns[run].offset == offset)) {
+            fds = &fdRuns[run++];
+        }
+        size_t end = (run < fdRuns.size()) ? fdRuns[run].offset : buf.size();
+        size_t len = end - offset;
+        size_t pushed;
+        if (fds) {
+            status = sink.PushBytesAndFds(&buf[offset], len, pushed, fds->fdList, fds->numFds, fds->pid);
+        } else {
+            status = sink.PushBytes(&buf[offset], len, pushed);
+        }
+        ++numWrites;
+        while ((ER_OK == status) && (pushed != len)) {
+            offset += pushed;
+            len -= pushed;
+            status = sink.PushBytes(&buf[offset], len, pushed);
+            ++numWrites;
+        }
+        offset = end;
+    }
+    buf.clear();
+    fdRuns.clear();
+    return status;
+}
+
 void* RemoteEndpoint::TxThread::Run(void* arg)
 {
     QStatus status = ER_OK;
     RemoteEndpoint* ep = reinterpret_cast<RemoteEndpoint*>(arg);
+    vector<Message> batched;
 
     /* Wait for queue to be non-empty */
     while (!IsStopping() && (ER_OK == status)) {
@@ -390,27 +536,84 @@ void* RemoteEndpoint::TxThread::Run(void* arg)
             stopEvent.ResetEvent();
             status = ER_OK;
             queueLock.Lock();
-            while (!queue.empty() && !IsStopping()) {
+            while (!queue.empty() && !IsStopping() && (ER_OK == status)) {
+
+                /*
+                 * A lone message is delivered straight to the stream. When more messages are
+                 * queued they are coalesced into a single write. Messages stay on the queue until
+                 * they have been written so StopAfterTxEmpty() still waits for them.
+                 */
+                if (queue.size() == 1) {
+                    Message msg = queue.back();
+                    ep->txInFlight = 1;
+
+                    /* Alert next thread on wait queue */
+                    if (0 < waitQueue.size()) {
+                        Thread* wakeMe = waitQueue.back();
+                        waitQueue.pop_back();
+                        status = wakeMe->Alert();
+                        if (ER_OK != status) {
+                            QCC_LogError(status, ("Failed to alert thread blocked on full tx queue"));
+                        }
+                    }
 
-                /* Get next message */
-                Message msg = queue.back();
+                    queueLock.Unlock();
 
-                /* Alert next thread on wait queue */
-                if (0 < waitQueue.size()) {
-                    Thread* wakeMe = waitQueue.back();
-                    waitQueue.pop_back();
-                    status = wakeMe->Alert();
+                    /* Deliver message */
+                    status = msg->Deliver(*ep);
+                    ++ep->txMessages;
+                    ++ep->txWrites;
+                    queueLock.Lock();
+                    ep->PopTxQueue();
+                    continue;
+                }
+
+                size_t count = 0;
+                while ((count < queue.size()) && (batch.GetSize() < MAX_TX_BATCH)) {
+                    Message msg = queue[queue.size() - 1 - count];
+                    ++count;
+                    ep->txInFlight = count;
+
+                    /*
+                     * TTL expiry, encryption and handle passing are still checked per message. A
+                     * message that fails is not added to the batch, the messages before it are
+                     * still written but the batch ends there and the failure is handled as for a
+                     * lone message.
+                     */
+                    queueLock.Unlock();
+                    status = msg->Deliver(*ep, batch);
+                    queueLock.Lock();
                     if (ER_OK != status) {
-                        QCC_LogError(status, ("Failed to alert thread blocked on full tx queue"));
+                        break;
                     }
+                    batched.push_back(msg);
                 }
-
                 queueLock.Unlock();
 
-                /* Deliver message */
-                status = msg->Deliver(*ep);
+                QStatus flushStatus = batch.Flush(ep->GetSink(), ep->txWrites);
+                if (ER_OK != flushStatus) {
+                    QCC_LogError(flushStatus, ("Failed to write %u batched messages", (uint32_t)batched.size()));
+                    if (ER_OK == status) {
+                        status = flushStatus;
+                    }
+                }
+                ep->txMessages += batched.size();
+                batched.clear();
+
                 queueLock.Lock();
-                queue.pop_back();
+                while (count-- && !queue.empty()) {
+                    ep->PopTxQueue();
+
+                    /* Alert next thread on wait queue */
+                    if (0 < waitQueue.size()) {
+                        Thread* wakeMe = waitQueue.back();
+                        waitQueue.pop_back();
+                        QStatus alertStatus = wakeMe->Alert();
+                        if (ER_OK != alertStatus) {
+                            QCC_LogError(alertStatus, ("Failed to alert thread blocked on full tx queue"));
+                        }
+                    }
+                }
             }
             queueLock.Unlock();
         }
@@ -436,49 +639,195 @@ void* RemoteEndpoint::TxThread::Run(void* arg)
     return (void*) status;
 }
 
-QStatus RemoteEndpoint::PushMessage(Message& msg)
+QStatus RemoteEndpoint::ReactorRead()
+{
+    QStatus status = reactorStream->Fill();
+
+    /* Route whatever complete messages arrived before the other end closed */
+    bool closed = (status == ER_SOCK_OTHER_END_CLOSED);
+    if (closed) {
+        status = ER_OK;
+    }
+    while ((ER_OK == status) && !IsReactorStopping() && reactorStream->HasMessage()) {
+        Message msg(bus);
+        status = msg->Unmarshal(*this, incoming && (BusEndpoint::ENDPOINT_TYPE_BUS2BUS != GetEndpointType()));
+        status = HandleRxMessage(msg, status);
+    }
+    if (closed && (ER_OK == status)) {
+        status = ER_SOCK_OTHER_END_CLOSED;
+    }
+    return status;
+}
+
+bool RemoteEndpoint::IsReactorStopping()
+{
+    txQueueLock.Lock();
+    bool stopping = reactorStopping;
+    txQueueLock.Unlock();
+    return stopping;
+}
+
+QStatus RemoteEndpoint::ReactorWrite()
+{
+    if (IsReactorStopping()) {
+        /* Give whatever is left in the transmit buffer one last chance to go out */
+        reactorStream->Flush();
+        return ER_STOPPING_THREAD;
+    }
+
+    /*
+     * Coalesce queued messages in the stream's transmit buffer and write them together. Only
+     * pull more messages off the queue while less than MAX_TX_BATCH bytes are waiting to go out.
+     * This keeps the tx queue (and the flow control that depends on it) working as it does for
+     * the tx thread.
+     */
+    QStatus status = reactorStream->Flush();
+    txQueueLock.Lock();
+    while ((ER_OK == status) && !txQueue.empty() && (reactorStream->GetPendingTx() < MAX_TX_BATCH)) {
+        Message msg = txQueue.back();
+        txInFlight = 1;
+
+        /* Alert next thread on wait queue */
+        if (0 < txWaitQueue.size()) {
+            Thread* wakeMe = txWaitQueue.back();
+            txWaitQueue.pop_back();
+            QStatus alertStatus = wakeMe->Alert();
+            if (ER_OK != alertStatus) {
+                QCC_LogError(alertStatus, ("Failed to alert thread blocked on full tx queue"));
+            }
+        }
+
+        txQueueLock.Unlock();
+        status = msg->Deliver(*this);
+        ++txMessages;
+        txQueueLock.Lock();
+        PopTxQueue();
+        /* The message has left the queue but may still be in the transmit buffer */
+        reactorTxPending = reactorStream->HasPendingTx();
+    }
+    txQueueLock.Unlock();
+    if (ER_OK == status) {
+        status = reactorStream->Flush();
+    }
+    txQueueLock.Lock();
+    reactorTxPending = (ER_OK == status) && reactorStream->HasPendingTx();
+    txQueueLock.Unlock();
+    return status;
+}
+
+void RemoteEndpoint::ReactorExit(QStatus status)
 {
-    static const size_t MAX_TX_QUEUE_SIZE = 10;
+    if ((status != ER_STOPPING_THREAD) && (status != ER_SOCK_OTHER_END_CLOSED) && (status != ER_BUS_STOPPING)) {
+        QCC_LogError(status, ("Endpoint (%s) exiting", GetUniqueName().c_str()));
+    }
+
+    /* Wake any thread waiting on tx queue availability */
+    txQueueLock.Lock();
+    reactorStopping = true;
+    reactorTxPending = false;
+    while (0 < txWaitQueue.size()) {
+        Thread* wakeMe = txWaitQueue.back();
+        QStatus alertStatus = wakeMe->Alert(ENDPOINT_IS_DEAD_ALERTCODE);
+        if (ER_OK != alertStatus) {
+            QCC_LogError(alertStatus, ("Failed to clear tx wait queue"));
+        }
+        txWaitQueue.pop_back();
+    }
+    txQueueLock.Unlock();
+
+    /* On an unexpected disconnect save the status that cause the exit */
+    if (disconnectStatus == ER_OK) {
+        disconnectStatus = (status == ER_STOPPING_THREAD) ? ER_OK : status;
+    }
+
+    /* De-register this remote endpoint */
+    bus.GetInternal().GetRouter().UnregisterEndpoint(*this);
+    if (NULL != listener) {
+        listener->EndpointExit(this);
+    }
+}
 
+QStatus RemoteEndpoint::PushMessage(Message& msg)
+{
     QStatus status = ER_OK;
+    bool disconnect = false;
 
     /*
      * Don't continue if this endpoint is in the process of being closed
      * Otherwise we risk deadlock when sending NameOwnerChanged signal to
      * this dying endpoint
      */
-    if (rxThread.IsStopping() || txThread.IsStopping()) {
+    if (reactor ? IsReactorStopping() : (rxThread.IsStopping() || txThread.IsStopping())) {
         return ER_BUS_ENDPOINT_CLOSING;
     }
     IncrementAndFetch(&numWaiters);
+    size_t msgBytes = GetTxBytes(msg);
     txQueueLock.Lock();
     size_t count = txQueue.size();
     bool wasEmpty = (count == 0);
-    if (MAX_TX_QUEUE_SIZE > count) {
+    if (!IsTxQueueFull(msgBytes)) {
         txQueue.push_front(msg);
+        txQueueBytes += msgBytes;
     } else {
+        ++txStats.numOverflows;
         while (true) {
-            /* Remove a queue entry whose TTLs is expired if possible */
+            /* Remove a queue entry whose TTLs is expired if possible (but not one that is being written) */
             deque<Message>::iterator it = txQueue.begin();
+            deque<Message>::iterator last = txQueue.end() - txInFlight;
             uint32_t maxWait = 20 * 1000;
-            while (it != txQueue.end()) {
+            while (it != last) {
                 uint32_t expMs;
                 if ((*it)->IsExpired(&expMs)) {
+                    txQueueBytes -= GetTxBytes(*it);
                     txQueue.erase(it);
+                    ++txStats.numExpired;
                     break;
                 } else {
                     ++it;
                 }
                 maxWait = (std::min)(maxWait, expMs);
             }
-            if (txQueue.size() < MAX_TX_QUEUE_SIZE) {
+            if (txLimits.policy == TX_OVERFLOW_DROP_OLDEST_UNRELIABLE) {
+                while (IsTxQueueFull(msgBytes) && DropOldestUnreliable()) {
+                    ++txStats.numDropped;
+                }
+            }
+            if (!IsTxQueueFull(msgBytes)) {
                 /* Check queue wasn't drained while we were waiting */
                 if (txQueue.size() == 0) {
                     wasEmpty = true;
                 }
                 txQueue.push_front(msg);
+                txQueueBytes += msgBytes;
                 status = ER_OK;
                 break;
+            } else if ((txLimits.policy == TX_OVERFLOW_DROP_NEWEST) ||
+                       ((txLimits.policy == TX_OVERFLOW_DROP_OLDEST_UNRELIABLE) && msg->IsUnreliable())) {
+                ++txStats.numDropped;
+                status = ER_BUS_WRITE_QUEUE_FULL;
+                break;
+            } else if (txLimits.policy == TX_OVERFLOW_DISCONNECT) {
+                ++txStats.numDropped;
+                disconnect = !txStats.disconnected;
+                txStats.disconnected = true;
+                status = ER_BUS_ENDPOINT_CLOSING;
+                break;
+            } else if (EndpointReactor::IsReactorThread()) {
+                /*
+                 * Reactor threads never wait for room in a tx queue since the queue may only be
+                 * drained by the very thread that would be waiting, and every other endpoint the
+                 * thread services would stall meanwhile. The queue is allowed to grow past its
+                 * limits up to a hard cap, after that the message is dropped.
+                 */
+                if (IsTxQueueFull(msgBytes, REACTOR_TX_QUEUE_SLACK)) {
+                    ++txStats.numDropped;
+                    status = ER_BUS_WRITE_QUEUE_FULL;
+                } else {
+                    txQueue.push_front(msg);
+                    txQueueBytes += msgBytes;
+                    status = ER_OK;
+                }
+                break;
             } else {
                 Thread* thread = Thread::GetThread();
                 assert(thread);
@@ -519,8 +868,19 @@ QStatus RemoteEndpoint::PushMessage(Message& msg)
     }
     txQueueLock.Unlock();
 
+    if (disconnect) {
+        QCC_LogError(ER_BUS_WRITE_QUEUE_FULL, ("Disconnecting slow endpoint %s: %u messages (%u bytes) queued",
+                                               GetUniqueName().c_str(), (uint32_t)count, (uint32_t)txQueueBytes));
+        Stop();
+    }
+
     if (wasEmpty) {
-        status = txThread.Alert();
+        if (reactor) {
+            /* The reactor drains messages queued before the endpoint was added when it is added */
+            reactor->WakeEndpoint(*this);
+        } else {
+            status = txThread.Alert();
+        }
     }
 
 #ifndef NDEBUG
@@ -529,7 +889,12 @@ QStatus RemoteEndpoint::PushMessage(Message& msg)
     static uint32_t lastTime = 0;
     uint32_t now = GetTimestamp();
     if ((now - lastTime) > 1000) {
-        QCC_DbgPrintf(("Tx queue size (%s - %x) = %d", txThread.GetName().c_str(), txThread.GetHandle(), count));
+        uint32_t numMessages;
+        uint32_t numWrites;
+        GetTxStats(numMessages, numWrites);
+        QCC_DbgPrintf(("Tx queue size (%s - %x) = %d (%u bytes), %u messages in %u writes, %u overflows, %u dropped, %u expired",
+                       txThread.GetName().c_str(), txThread.GetHandle(), count, (uint32_t)txQueueBytes, numMessages, numWrites,
+                       txStats.numOverflows, txStats.numDropped, txStats.numExpired));
         lastTime = now;
     }
 #undef QCC_MODULE
@@ -553,6 +918,90 @@ void RemoteEndpoint::DecrementRef()
     }
 }
 
+size_t RemoteEndpoint::PullHandles(SocketFd* fdList, size_t numFds)
+{
+    if (reactorStream) {
+        return reactorStream->PullFds(fdList, numFds);
+    } else if (rxBuffer) {
+        return rxBuffer->PullFds(fdList, numFds);
+    } else {
+        return 0;
+    }
+}
+
+void RemoteEndpoint::SetTxQueueLimits(const TxQueueLimits& limits)
+{
+    txQueueLock.Lock();
+    txLimits = limits;
+
+    /* Let threads waiting for room recheck against the new limits */
+    while (0 < txWaitQueue.size()) {
+        Thread* wakeMe = txWaitQueue.back();
+        txWaitQueue.pop_back();
+        QStatus status = wakeMe->Alert();
+        if (ER_OK != status) {
+            QCC_LogError(status, ("Failed to alert thread blocked on full tx queue"));
+        }
+    }
+    txQueueLock.Unlock();
+}
+
+void RemoteEndpoint::GetTxQueueStats(TxQueueStats& stats)
+{
+    txQueueLock.Lock();
+    stats = txStats;
+    txQueueLock.Unlock();
+}
+
+size_t RemoteEndpoint::GetTxBytes(const Message& msg)
+{
+    return sizeof(msg->msgHeader) + msg->msgHeader.bodyLen;
+}
+
+bool RemoteEndpoint::IsTxQueueFull(size_t msgBytes, uint32_t scale) const
+{
+    if (txLimits.maxMessages && (txQueue.size() >= ((size_t)txLimits.maxMessages * scale))) {
+        return true;
+    }
+    /* A message that is bigger than the byte limit can still be sent on its own */
+    if (txLimits.maxBytes && !txQueue.empty() && ((txQueueBytes + msgBytes) > ((size_t)txLimits.maxBytes * scale))) {
+        return true;
+    }
+    return false;
+}
+
+void RemoteEndpoint::PopTxQueue()
+{
+    txQueueBytes -= GetTxBytes(txQueue.back());
+    txQueue.pop_back();
+    if (txInFlight) {
+        --txInFlight;
+    }
+}
+
+bool RemoteEndpoint::DropOldestUnreliable()
+{
+    for (size_t i = txInFlight; i < txQueue.size(); ++i) {
+        deque<Message>::iterator it = txQueue.end() - 1 - i;
+        if ((*it)->IsUnreliable()) {
+            QCC_DbgHLPrintf(("Tx queue full, dropping %s", (*it)->Description().c_str()));
+            txQueueBytes -= GetTxBytes(*it);
+            txQueue.erase(it);
+            return true;
+        }
+    }
+    return false;
+}
+
+void RemoteEndpoint::GetTxStats(uint32_t& numMessages, uint32_t& numWrites) const
+{
+    numMessages = txMessages;
+    numWrites = txWrites;
+    if (reactorStream) {
+        numWrites += reactorStream->GetNumWrites();
+    }
+}
+
 SocketFd RemoteEndpoint::GetSocketFd()
 {
     if (isSocket) {
@@ -24,6 +24,7 @@
 #include <qcc/platform.h>
 
 #include <deque>
+#include <vector>
 
 #include <qcc/String.h>
 #include <qcc/GUID.h>
@@ -33,6 +34,8 @@
 
 #include "BusEndpoint.h"
 #include "EndpointAuth.h"
+#include "EndpointReactor.h"
+#include "RxBuffer.h"
 
 #include <Status.h>
 
@@ -70,6 +73,42 @@ class RemoteEndpoint : public BusEndpoint, public qcc::ThreadListener {
 
     };
 
+    /**
+     * What PushMessage() does with a message that does not fit in the tx queue.
+     */
+    typedef enum {
+        TX_OVERFLOW_BLOCK = 0,                  /**< Block the sender until there is room (for at most 20 seconds) */
+        TX_OVERFLOW_DROP_OLDEST_UNRELIABLE = 1, /**< Drop the oldest queued unreliable message, block if there are none */
+        TX_OVERFLOW_DROP_NEWEST = 2,            /**< Reject the message being pushed */
+        TX_OVERFLOW_DISCONNECT = 3              /**< Disconnect the endpoint because it is not keeping up */
+    } TxOverflowPolicy;
+
+    /** Default maximum number of messages in the tx queue */
+    static const uint32_t DEFAULT_TX_QUEUE_MESSAGES = 10;
+
+    /**
+     * Limits on the size of the tx queue.
+     */
+    struct TxQueueLimits {
+        uint32_t maxMessages;        /**< Maximum number of queued messages or 0 for no limit */
+        uint32_t maxBytes;           /**< Maximum number of queued message bytes or 0 for no limit */
+        TxOverflowPolicy policy;     /**< What to do with a message that exceeds the limits */
+
+        TxQueueLimits() : maxMessages(DEFAULT_TX_QUEUE_MESSAGES), maxBytes(0), policy(TX_OVERFLOW_BLOCK) { }
+    };
+
+    /**
+     * Counters that show how often the tx queue overflowed and what was done about it.
+     */
+    struct TxQueueStats {
+        uint32_t numOverflows;       /**< Number of pushes that found the tx queue full */
+        uint32_t numDropped;         /**< Number of messages dropped by the overflow policy */
+        uint32_t numExpired;         /**< Number of queued messages discarded because their TTL expired */
+        bool disconnected;           /**< True if the endpoint was disconnected by the overflow policy */
+
+        TxQueueStats() : numOverflows(0), numDropped(0), numExpired(0), disconnected(false) { }
+    };
+
     /**
      * Listener called when endpoint changes state.
      */
@@ -271,14 +310,30 @@ class RemoteEndpoint : public BusEndpoint, public qcc::ThreadListener {
      *
      * @return  The data source for this endpoint.
      */
-    qcc::Source& GetSource() { return stream; };
+    qcc::Source& GetSource()
+    {
+        if (reactorStream) {
+            return *reactorStream;
+        } else if (rxBuffer) {
+            return *rxBuffer;
+        } else {
+            return stream;
+        }
+    }
 
     /**
      * Get the data sink for this endpoint
      *
      * @return  The data sink for this endpoint.
      */
-    qcc::Sink& GetSink() { return stream; };
+    qcc::Sink& GetSink()
+    {
+        if (reactorStream) {
+            return *reactorStream;
+        } else {
+            return stream;
+        }
+    }
 
     /**
      * Get the SocketFd from this endpoint and detach it from the endpoint.
@@ -315,6 +370,88 @@ class RemoteEndpoint : public BusEndpoint, public qcc::ThreadListener {
      */
     void DecrementRef();
 
+    /**
+     * @internal
+     * Take file descriptors that were received ahead of the message being unmarshaled. Buffered
+     * sources queue received file descriptors in arrival order rather than returning them with
+     * the bytes of a particular message.
+     *
+     * @param fdList   Array to receive the file descriptors.
+     * @param numFds   Maximum number of file descriptors to take.
+     * @return  The number of file descriptors returned in fdList.
+     */
+    size_t PullHandles(qcc::SocketFd* fdList, size_t numFds);
+
+    /**
+     * Get transmit batching statistics for this endpoint. Dividing numMessages by numWrites gives
+     * the average number of messages sent per write to the underlying stream.
+     *
+     * @param numMessages  [OUT] Number of messages that have been written.
+     * @param numWrites    [OUT] Number of writes (i.e. send system calls) used to write them.
+     */
+    void GetTxStats(uint32_t& numMessages, uint32_t& numWrites) const;
+
+    /**
+     * Set the tx queue limits and overflow policy for this endpoint. A single message that is
+     * larger than maxBytes is still accepted when the queue is empty.
+     *
+     * @param limits   The new limits.
+     */
+    void SetTxQueueLimits(const TxQueueLimits& limits);
+
+    /**
+     * Get the tx queue limits and overflow policy for this endpoint.
+     *
+     * @return  The current limits.
+     */
+    const TxQueueLimits& GetTxQueueLimits() const { return txLimits; }
+
+    /**
+     * Get the tx queue overflow counters for this endpoint.
+     *
+     * @param stats   [OUT] Returns the counters.
+     */
+    void GetTxQueueStats(TxQueueStats& stats);
+
+    /**
+     * @internal
+     * Get the buffered stream used while this endpoint is serviced by an EndpointReactor.
+     *
+     * @return  The reactor stream or NULL if the endpoint is using its own rx and tx threads.
+     */
+    ReactorStream* GetReactorStream() { return reactorStream; }
+
+    /**
+     * @internal
+     * Called by an EndpointReactor thread when the endpoint's socket is readable. Reads what is
+     * available and routes every complete message.
+     * RemoteEndpoint users should not call this method.
+     *
+     * @return ER_OK if the endpoint should continue to be serviced.
+     */
+    QStatus ReactorRead();
+
+    /**
+     * @internal
+     * Called by an EndpointReactor thread when the endpoint's socket is writable or messages
+     * have been queued. Moves queued messages to the socket until it would block.
+     * RemoteEndpoint users should not call this method.
+     *
+     * @return ER_OK if the endpoint should continue to be serviced.
+     */
+    QStatus ReactorWrite();
+
+    /**
+     * @internal
+     * Called by an EndpointReactor thread after it has stopped servicing the endpoint. This is
+     * the reactor equivalent of both rx and tx threads exiting and the endpoint may be deleted
+     * by the listener before this call returns.
+     * RemoteEndpoint users should not call this method.
+     *
+     * @param status   Status that caused the endpoint to stop being serviced.
+     */
+    void ReactorExit(QStatus status);
+
   protected:
 
     /**
@@ -370,6 +507,50 @@ class RemoteEndpoint : public BusEndpoint, public qcc::ThreadListener {
         bool validateSender;      /**< If true, the sender field on incomming messages will be overwritten with actual endpoint name */
     };
 
+    /**
+     * Sink used by the tx thread to coalesce several marshaled messages into a single write.
+     * File descriptors are not copied so the messages they belong to must stay alive until the
+     * batch has been flushed.
+     */
+    class TxBatch : public qcc::Sink {
+      public:
+        TxBatch() { }
+
+        QStatus PushBytes(const void* buf, size_t numBytes, size_t& numSent);
+        QStatus PushBytesAndFds(const void* buf, size_t numBytes, size_t& numSent, qcc::SocketFd* fdList, size_t numFds, uint32_t pid = -1);
+
+        /**
+         * Write the batch to a sink. Bytes are written with one push per run of messages that
+         * starts with a message that carries file descriptors, so file descriptors still go out
+         * with the first byte of the message they belong to.
+         *
+         * @param sink       Sink to write to.
+         * @param numWrites  [IN,OUT] Incremented by the number of pushes to sink.
+         * @return ER_OK if successful.
+         */
+        QStatus Flush(qcc::Sink& sink, uint32_t& numWrites);
+
+        /**
+         * Get the number of bytes in the batch.
+         *
+         * @return  The number of buffered bytes.
+         */
+        size_t GetSize() const { return buf.size(); }
+
+      private:
+
+        /** File descriptors to be sent with the byte at offset */
+        struct FdRun {
+            size_t offset;
+            qcc::SocketFd* fdList;
+            size_t numFds;
+            uint32_t pid;
+        };
+
+        std::vector<uint8_t> buf;      /**< Marshaled messages */
+        std::vector<FdRun> fdRuns;     /**< Offsets where file descriptors must be sent */
+    };
+
     /**
      * Thread used to send endpoint data.
      */
@@ -390,8 +571,59 @@ class RemoteEndpoint : public BusEndpoint, public qcc::ThreadListener {
         std::deque<Message>& queue;
         std::deque<Thread*>& waitQueue;
         qcc::Mutex& queueLock;
+        TxBatch batch;
     };
 
+    /**
+     * Process a message that has just been unmarshaled (or failed to unmarshal).
+     *
+     * @param msg      The message.
+     * @param status   Status returned by _Message::Unmarshal().
+     * @return  ER_OK if the endpoint should continue receiving.
+     */
+    QStatus HandleRxMessage(Message& msg, QStatus status);
+
+    /**
+     * Get the number of bytes a message counts for in the tx queue byte limit. This is the
+     * fixed header plus the body; header fields are not counted because they can be rewritten
+     * while the message is queued.
+     *
+     * @param msg   The message.
+     * @return  The number of bytes.
+     */
+    static size_t GetTxBytes(const Message& msg);
+
+    /**
+     * Check if a message of msgBytes bytes would exceed the tx queue limits.
+     * Must be called with txQueueLock held.
+     *
+     * @param msgBytes   Size of the message as returned by GetTxBytes().
+     * @param scale      Factor the limits are multiplied by.
+     * @return  true if the message does not fit.
+     */
+    bool IsTxQueueFull(size_t msgBytes, uint32_t scale = 1) const;
+
+    /**
+     * Remove the message at the back (the oldest message) of the tx queue after it has been
+     * written. Must be called with txQueueLock held.
+     */
+    void PopTxQueue();
+
+    /**
+     * Remove the oldest queued unreliable message that is not being written.
+     * Must be called with txQueueLock held.
+     *
+     * @return  true if a message was removed.
+     */
+    bool DropOldestUnreliable();
+
+    /**
+     * Check if a reactor serviced endpoint has been asked to stop.
+     *
+     * @return  true if the endpoint is stopping.
+     */
+    bool IsReactorStopping();
+
     /**
      * Internal callback used to indicate that one of the internal threads (rx or tx) has exited.
      * RemoteEndpoint users should not call this method.
@@ -427,6 +659,17 @@ class RemoteEndpoint : public BusEndpoint, public qcc::ThreadListener {
     uint32_t maxIdleProbes;                  /**< Maximum number of missed idle probes before shutdown */
     uint32_t idleTimeout;                    /**< RX idle seconds before sending probe */
     uint32_t probeTimeout;                   /**< Probe timeout in seconds */
+    EndpointReactor* reactor;                /**< Reactor servicing this endpoint or NULL if using rx and tx threads */
+    ReactorStream* reactorStream;            /**< Buffered stream used instead of 'stream' when serviced by a reactor */
+    bool reactorStopping;                    /**< True once a reactor serviced endpoint has been asked to stop (protected by txQueueLock) */
+    bool reactorTxPending;                   /**< True while reactorStream holds unsent bytes (protected by txQueueLock) */
+    RxBuffer* rxBuffer;                      /**< Read ahead buffer used by the rx thread or NULL */
+    uint32_t txMessages;                     /**< Number of messages written by the tx thread or reactor */
+    uint32_t txWrites;                       /**< Number of writes used to send txMessages */
+    TxQueueLimits txLimits;                  /**< Limits on the size of txQueue */
+    TxQueueStats txStats;                    /**< Tx queue overflow counters */
+    size_t txQueueBytes;                     /**< Bytes (as counted by GetTxBytes()) in txQueue */
+    size_t txInFlight;                       /**< Number of messages at the back of txQueue that are being written */
 };
 
 }
@@ -29,6 +29,10 @@
 
 namespace ajn {
 
+/** @internal Forward references */
+class EndpointReactor;
+class RemoteEndpoint;
+
 /**
  * %Router defines an interface that describes how to route messages between two
  * or more endpoints.
@@ -110,6 +114,22 @@ class Router {
      * @param guid   GUID of bus associated with this router.
      */
     virtual void SetGlobalGUID(const qcc::GUID128& guid) = 0;
+
+    /**
+     * Get the reactor that should service the sockets of remote endpoints registered with this
+     * router.
+     *
+     * @return  The reactor or NULL if each remote endpoint should run its own rx and tx threads.
+     */
+    virtual EndpointReactor* GetEndpointReactor() { return NULL; }
+
+    /**
+     * Apply router specific configuration, such as tx queue limits, to a remote endpoint. This is
+     * called by the endpoint when it is started.
+     *
+     * @param endpoint   The remote endpoint that is starting.
+     */
+    virtual void ConfigureEndpoint(RemoteEndpoint& endpoint) { }
 };
 
 }
@@ -0,0 +1,116 @@
+/**
+ * @file
+ * RxBuffer reads ahead from a stream so that several messages can be unmarshaled from a single read.
+ */
+
+/******************************************************************************
+ * Copyright 2011, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+
+#include <qcc/platform.h>
+
+#include <string.h>
+#include <algorithm>
+
+#include <qcc/Debug.h>
+#include <qcc/Socket.h>
+
+#include "RxBuffer.h"
+
+#define QCC_MODULE "ALLJOYN"
+
+using namespace std;
+using namespace qcc;
+
+namespace ajn {
+
+RxBuffer::RxBuffer(Source& source, bool handlePassing, size_t size) :
+    source(source),
+    handlePassing(handlePassing),
+    buffer(new uint8_t[size]),
+    size(size),
+    pos(0),
+    end(0)
+{
+}
+
+RxBuffer::~RxBuffer()
+{
+    while (!fds.empty()) {
+        qcc::Close(fds.front());
+        fds.pop_front();
+    }
+    delete [] buffer;
+}
+
+QStatus RxBuffer::Read(void* buf, size_t reqBytes, size_t& actualBytes, uint32_t timeout)
+{
+    QStatus status;
+    if (handlePassing) {
+        SocketFd fdList[SOCKET_MAX_FILE_DESCRIPTORS];
+        size_t numFds = SOCKET_MAX_FILE_DESCRIPTORS;
+        status = source.PullBytesAndFds(buf, reqBytes, actualBytes, fdList, numFds, timeout);
+        if (status == ER_OK) {
+            fds.insert(fds.end(), fdList, fdList + numFds);
+        }
+    } else {
+        status = source.PullBytes(buf, reqBytes, actualBytes, timeout);
+    }
+    return status;
+}
+
+QStatus RxBuffer::PullBytes(void* buf, size_t reqBytes, size_t& actualBytes, uint32_t timeout)
+{
+    if (pos == end) {
+        pos = 0;
+        end = 0;
+        /*
+         * Requests that would fill the whole buffer anyway are read straight into the caller's
+         * buffer to save a copy.
+         */
+        if (reqBytes >= size) {
+            return Read(buf, reqBytes, actualBytes, timeout);
+        }
+        size_t received = 0;
+        QStatus status = Read(buffer, size, received, timeout);
+        if (status != ER_OK) {
+            actualBytes = 0;
+            return status;
+        }
+        end = received;
+    }
+    actualBytes = (std::min)(reqBytes, end - pos);
+    memcpy(buf, buffer + pos, actualBytes);
+    pos += actualBytes;
+    return ER_OK;
+}
+
+QStatus RxBuffer::PullBytesAndFds(void* buf, size_t reqBytes, size_t& actualBytes, SocketFd* fdList, size_t& numFds, uint32_t timeout)
+{
+    numFds = 0;
+    return PullBytes(buf, reqBytes, actualBytes, timeout);
+}
+
+size_t RxBuffer::PullFds(SocketFd* fdList, size_t numFds)
+{
+    size_t count = 0;
+    while ((count < numFds) && !fds.empty()) {
+        fdList[count++] = fds.front();
+        fds.pop_front();
+    }
+    return count;
+}
+
+}
@@ -0,0 +1,138 @@
+/**
+ * @file
+ * RxBuffer reads ahead from a stream so that several messages can be unmarshaled from a single read.
+ */
+
+/******************************************************************************
+ * Copyright 2011, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+#ifndef _ALLJOYN_RXBUFFER_H
+#define _ALLJOYN_RXBUFFER_H
+
+#include <qcc/platform.h>
+
+#include <deque>
+
+#include <qcc/Event.h>
+#include <qcc/Socket.h>
+#include <qcc/Stream.h>
+
+#include <Status.h>
+
+namespace ajn {
+
+/**
+ * Receive buffer placed between a RemoteEndpoint's stream and _Message::Unmarshal(). Each read
+ * from the underlying source asks for as much as the buffer can hold so a burst of small messages
+ * is received with one system call instead of two per message.
+ *
+ * File descriptors received with the data are not tied to the bytes they arrived with because a
+ * single read may span several messages. They are queued in arrival order instead and
+ * _Message::Unmarshal() takes as many as each message header declares (see PullFds()).
+ */
+class RxBuffer : public qcc::Source {
+  public:
+
+    /** Default number of bytes read ahead */
+    static const size_t DEFAULT_SIZE = 16 * 1024;
+
+    /**
+     * Constructor
+     *
+     * @param source         Source to read from.
+     * @param handlePassing  True if file descriptors should be received with the data.
+     * @param size           Size of the buffer.
+     */
+    RxBuffer(qcc::Source& source, bool handlePassing, size_t size = DEFAULT_SIZE);
+
+    /**
+     * Destructor
+     */
+    ~RxBuffer();
+
+    /**
+     * Pull bytes from the buffer, reading from the underlying source if the buffer is empty.
+     *
+     * @param buf          Buffer to store pulled bytes
+     * @param reqBytes     Number of bytes requested to be pulled from source.
+     * @param actualBytes  Actual number of bytes retrieved from source.
+     * @param timeout      Timeout in milliseconds if the underlying source has to be read.
+     * @return   ER_OK if successful. ER_NONE if source is exhausted. Otherwise an error.
+     */
+    QStatus PullBytes(void* buf, size_t reqBytes, size_t& actualBytes, uint32_t timeout = qcc::Event::WAIT_FOREVER);
+
+    /**
+     * Pull bytes from the buffer. File descriptors are never returned here, use PullFds() instead.
+     *
+     * @param buf          Buffer to store pulled bytes
+     * @param reqBytes     Number of bytes requested to be pulled from source.
+     * @param actualBytes  Actual number of bytes retrieved from source.
+     * @param fdList       Unused.
+     * @param numFds       [OUT] Always set to 0.
+     * @param timeout      Timeout in milliseconds if the underlying source has to be read.
+     * @return   ER_OK if successful. ER_NONE if source is exhausted. Otherwise an error.
+     */
+    QStatus PullBytesAndFds(void* buf, size_t reqBytes, size_t& actualBytes, qcc::SocketFd* fdList, size_t& numFds, uint32_t timeout = qcc::Event::WAIT_FOREVER);
+
+    /**
+     * Take file descriptors from the queue of received file descriptors. The caller owns the
+     * returned file descriptors.
+     *
+     * @param fdList   Array to receive the file descriptors.
+     * @param numFds   Maximum number of file descriptors to take.
+     * @return  The number of file descriptors returned in fdList.
+     */
+    size_t PullFds(qcc::SocketFd* fdList, size_t numFds);
+
+    /**
+     * Get the event that indicates the underlying source has data. Note that the event is not
+     * set while the data is sitting in this buffer, check HasData() before waiting.
+     *
+     * @return The source event of the underlying source.
+     */
+    qcc::Event& GetSourceEvent() { return source.GetSourceEvent(); }
+
+    /**
+     * Indicate whether any bytes are buffered.
+     *
+     * @return  true if PullBytes() will return data without reading the underlying source.
+     */
+    bool HasData() const { return pos < end; }
+
+  private:
+
+    /**
+     * Assignment and copy are not allowed.
+     */
+    RxBuffer(const RxBuffer& other);
+    RxBuffer& operator=(const RxBuffer& other);
+
+    /**
+     * Read from the underlying source queueing any file descriptors that arrive.
+     */
+    QStatus Read(void* buf, size_t reqBytes, size_t& actualBytes, uint32_t timeout);
+
+    qcc::Source& source;               /**< Source being buffered */
+    bool handlePassing;                /**< True if file descriptors are received with the data */
+    uint8_t* buffer;                   /**< Read ahead buffer */
+    size_t size;                       /**< Size of buffer */
+    size_t pos;                        /**< Offset of the first unconsumed byte in buffer */
+    size_t end;                        /**< Offset one past the last received byte in buffer */
+    std::deque<qcc::SocketFd> fds;     /**< Received file descriptors not yet taken */
+};
+
+}
+
+#endif
@@ -0,0 +1,315 @@
+/**
+ * @file
+ *
+ * This file implements the ScalarArrays kernels.
+ */
+
+/******************************************************************************
+ * Copyright 2011, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+
+#include <qcc/platform.h>
+
+#include <string.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define VECTOR_NAME "AVX2"
+#elif defined(__SSSE3__)
+#include <tmmintrin.h>
+#define VECTOR_NAME "SSSE3"
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#include <emmintrin.h>
+#define VECTOR_NAME "SSE2"
+#define VECTOR_SSE2_ONLY
+#endif
+
+#include "ScalarArrays.h"
+
+#define QCC_MODULE "ALLJOYN"
+
+namespace ajn {
+
+/*
+ * A marshaled boolean true read without swapping from a byte swapped message.
+ */
+static const uint32_t SWAPPED_TRUE = 0x01000000;
+
+static bool useVector = true;
+
+static inline uint16_t Bswap16(uint16_t v)
+{
+    return (uint16_t)((v << 8) | (v >> 8));
+}
+
+static inline uint32_t Bswap32(uint32_t v)
+{
+    return (v << 24) | ((v << 8) & 0x00FF0000) | ((v >> 8) & 0x0000FF00) | (v >> 24);
+}
+
+static inline uint64_t Bswap64(uint64_t v)
+{
+    return ((uint64_t)Bswap32((uint32_t)v) << 32) | Bswap32((uint32_t)(v >> 32));
+}
+
+/*
+ * Scalar loops, these also handle the tail of an array that is too short for a vector.
+ */
+static void SwapTail16(uint8_t* dest, const uint8_t* src, size_t num)
+{
+    for (size_t i = 0; i < num; ++i, src += 2, dest += 2) {
+        uint16_t v;
+        memcpy(&v, src, 2);
+        v = Bswap16(v);
+        memcpy(dest, &v, 2);
+    }
+}
+
+static void SwapTail32(uint8_t* dest, const uint8_t* src, size_t num)
+{
+    for (size_t i = 0; i < num; ++i, src += 4, dest += 4) {
+        uint32_t v;
+        memcpy(&v, src, 4);
+        v = Bswap32(v);
+        memcpy(dest, &v, 4);
+    }
+}
+
+static void SwapTail64(uint8_t* dest, const uint8_t* src, size_t num)
+{
+    for (size_t i = 0; i < num; ++i, src += 8, dest += 8) {
+        uint64_t v;
+        memcpy(&v, src, 8);
+        v = Bswap64(v);
+        memcpy(dest, &v, 8);
+    }
+}
+
+#ifdef VECTOR_NAME
+
+/*
+ * Byte swapping is done with 128 bit vectors for SSE2 and SSSE3 and 256 bit vectors for AVX2.
+ * SSE2 has no byte shuffle so it swaps the 16 bit words with shuffles and then the bytes within
+ * each word with shifts.
+ */
+#if defined(__AVX2__)
+
+typedef __m256i Vec;
+
+static inline Vec Load(const uint8_t* p) { return _mm256_loadu_si256((const __m256i*)p); }
+static inline void Store(uint8_t* p, Vec v) { _mm256_storeu_si256((__m256i*)p, v); }
+static inline Vec Shuffle(Vec v, __m128i m) { return _mm256_shuffle_epi8(v, _mm256_broadcastsi128_si256(m)); }
+
+#else
+
+typedef __m128i Vec;
+
+static inline Vec Load(const uint8_t* p) { return _mm_loadu_si128((const __m128i*)p); }
+static inline void Store(uint8_t* p, Vec v) { _mm_storeu_si128((__m128i*)p, v); }
+#ifndef VECTOR_SSE2_ONLY
+static inline Vec Shuffle(Vec v, __m128i m) { return _mm_shuffle_epi8(v, m); }
+#endif
+
+#endif
+
+#ifdef VECTOR_SSE2_ONLY
+
+static inline Vec SwapVec16(Vec v)
+{
+    return _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+}
+
+static inline Vec SwapVec32(Vec v)
+{
+    v = _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, _MM_SHUFFLE(2, 3, 0, 1)), _MM_SHUFFLE(2, 3, 0, 1));
+    return SwapVec16(v);
+}
+
+static inline Vec SwapVec64(Vec v)
+{
+    v = _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, _MM_SHUFFLE(0, 1, 2, 3)), _MM_SHUFFLE(0, 1, 2, 3));
+    return SwapVec16(v);
+}
+
+#else
+
+static inline Vec SwapVec16(Vec v)
+{
+    return Shuffle(v, _mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14));
+}
+
+static inline Vec SwapVec32(Vec v)
+{
+    return Shuffle(v, _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12));
+}
+
+static inline Vec SwapVec64(Vec v)
+{
+    return Shuffle(v, _mm_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8));
+}
+
+#endif
+
+/*
+ * Swap as many bytes as fill whole vectors, unrolled by two, and return the number of bytes done.
+ */
+#define VECTOR_SWAP_LOOP(swapVec) \
+    size_t done = 0; \
+    if (useVector) { \
+        for (; (done + 2 * sizeof(Vec)) <= len; done += 2 * sizeof(Vec)) { \
+            Vec v0 = Load(src + done); \
+            Vec v1 = Load(src + done + sizeof(Vec)); \
+            Store(dest + done, swapVec(v0)); \
+            Store(dest + done + sizeof(Vec), swapVec(v1)); \
+        } \
+        if ((done + sizeof(Vec)) <= len) { \
+            Store(dest + done, swapVec(Load(src + done))); \
+            done += sizeof(Vec); \
+        } \
+    }
+
+#else
+
+#define VECTOR_SWAP_LOOP(swapVec) \
+    size_t done = 0;
+
+#endif
+
+void ScalarArrays::CopySwapped16(void* d, const void* s, size_t num)
+{
+    uint8_t* dest = (uint8_t*)d;
+    const uint8_t* src = (const uint8_t*)s;
+    size_t len = num * 2;
+    VECTOR_SWAP_LOOP(SwapVec16);
+    SwapTail16(dest + done, src + done, (len - done) / 2);
+}
+
+void ScalarArrays::CopySwapped32(void* d, const void* s, size_t num)
+{
+    uint8_t* dest = (uint8_t*)d;
+    const uint8_t* src = (const uint8_t*)s;
+    size_t len = num * 4;
+    VECTOR_SWAP_LOOP(SwapVec32);
+    SwapTail32(dest + done, src + done, (len - done) / 4);
+}
+
+void ScalarArrays::CopySwapped64(void* d, const void* s, size_t num)
+{
+    uint8_t* dest = (uint8_t*)d;
+    const uint8_t* src = (const uint8_t*)s;
+    size_t len = num * 8;
+    VECTOR_SWAP_LOOP(SwapVec64);
+    SwapTail64(dest + done, src + done, (len - done) / 8);
+}
+
+bool ScalarArrays::UnmarshalBools(uint32_t* data, size_t num, bool swap, bool* bools)
+{
+    const uint32_t wireTrue = swap ? SWAPPED_TRUE : 1;
+    size_t i = 0;
+
+#ifdef VECTOR_NAME
+    /*
+     * Booleans are done 16 at a time with SSE2 for all of the x86 vector instruction sets. The
+     * 0 or 1 results are packed down to bytes so this relies on bool being a one byte 0 or 1.
+     */
+    if (useVector && (sizeof(bool) == 1)) {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i one = _mm_set1_epi32(1);
+        const __m128i invalid = _mm_set1_epi32((int)~wireTrue);
+        __m128i bad = zero;
+        for (; (i + 16) <= num; i += 16) {
+            __m128i w0 = _mm_loadu_si128((const __m128i*)(data + i));
+            __m128i w1 = _mm_loadu_si128((const __m128i*)(data + i + 4));
+            __m128i w2 = _mm_loadu_si128((const __m128i*)(data + i + 8));
+            __m128i w3 = _mm_loadu_si128((const __m128i*)(data + i + 12));
+            bad = _mm_or_si128(bad, _mm_or_si128(_mm_or_si128(_mm_and_si128(w0, invalid), _mm_and_si128(w1, invalid)),
+                                                 _mm_or_si128(_mm_and_si128(w2, invalid), _mm_and_si128(w3, invalid))));
+            w0 = _mm_andnot_si128(_mm_cmpeq_epi32(w0, zero), one);
+            w1 = _mm_andnot_si128(_mm_cmpeq_epi32(w1, zero), one);
+            w2 = _mm_andnot_si128(_mm_cmpeq_epi32(w2, zero), one);
+            w3 = _mm_andnot_si128(_mm_cmpeq_epi32(w3, zero), one);
+            if (swap) {
+                /* Valid values are 0 or 1 so once checked the native value is the result */
+                _mm_storeu_si128((__m128i*)(data + i), w0);
+                _mm_storeu_si128((__m128i*)(data + i + 4), w1);
+                _mm_storeu_si128((__m128i*)(data + i + 8), w2);
+                _mm_storeu_si128((__m128i*)(data + i + 12), w3);
+            }
+            _mm_storeu_si128((__m128i*)(bools + i), _mm_packus_epi16(_mm_packs_epi32(w0, w1), _mm_packs_epi32(w2, w3)));
+        }
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(bad, zero)) != 0xFFFF) {
+            return false;
+        }
+    }
+#endif
+
+    for (; i < num; ++i) {
+        uint32_t b = data[i];
+        if (b & ~wireTrue) {
+            return false;
+        }
+        if (swap) {
+            data[i] = b ? 1 : 0;
+        }
+        bools[i] = (b != 0);
+    }
+    return true;
+}
+
+void ScalarArrays::MarshalBools(const bool* bools, size_t num, bool swap, void* d)
+{
+    const uint32_t wireTrue = swap ? SWAPPED_TRUE : 1;
+    uint8_t* data = (uint8_t*)d;
+    size_t i = 0;
+
+#ifdef VECTOR_NAME
+    if (useVector && (sizeof(bool) == 1)) {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i t = _mm_set1_epi32((int)wireTrue);
+        for (; (i + 16) <= num; i += 16) {
+            /* Widen the all ones bytes for false values to 32 bits and use them to mask out true */
+            __m128i f = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(bools + i)), zero);
+            __m128i lo = _mm_unpacklo_epi8(f, f);
+            __m128i hi = _mm_unpackhi_epi8(f, f);
+            uint8_t* p = data + i * 4;
+            _mm_storeu_si128((__m128i*)p, _mm_andnot_si128(_mm_unpacklo_epi16(lo, lo), t));
+            _mm_storeu_si128((__m128i*)(p + 16), _mm_andnot_si128(_mm_unpackhi_epi16(lo, lo), t));
+            _mm_storeu_si128((__m128i*)(p + 32), _mm_andnot_si128(_mm_unpacklo_epi16(hi, hi), t));
+            _mm_storeu_si128((__m128i*)(p + 48), _mm_andnot_si128(_mm_unpackhi_epi16(hi, hi), t));
+        }
+    }
+#endif
+
+    for (; i < num; ++i) {
+        uint32_t b = bools[i] ? wireTrue : 0;
+        memcpy(data + i * 4, &b, 4);
+    }
+}
+
+void ScalarArrays::EnableVector(bool enable)
+{
+    useVector = enable;
+}
+
+const char* ScalarArrays::GetVectorName()
+{
+#ifdef VECTOR_NAME
+    return VECTOR_NAME;
+#else
+    return "none";
+#endif
+}
+
+}
@@ -0,0 +1,132 @@
+/**
+ * @file
+ * ScalarArrays has bulk endian swapping and boolean conversion for arrays of scalars.
+ */
+
+/******************************************************************************
+ * Copyright 2011, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+#ifndef _ALLJOYN_SCALARARRAYS_H
+#define _ALLJOYN_SCALARARRAYS_H
+
+#include <qcc/platform.h>
+
+namespace ajn {
+
+/**
+ * Kernels for marshaling and unmarshaling arrays of scalars. On x86 these use SSE2, SSSE3 or AVX2
+ * depending on what the compiler has been told it can target; elsewhere, and for the elements
+ * left over at the end of an array, they are plain loops.
+ *
+ * None of the kernels require the data to be aligned. The source and destination of the copying
+ * kernels may be the same buffer but must not otherwise overlap.
+ */
+class ScalarArrays {
+  public:
+
+    /**
+     * Byte swap an array of 16 bit values in place.
+     *
+     * @param data  The values.
+     * @param num   The number of values.
+     */
+    static void Swap16(uint16_t* data, size_t num) { CopySwapped16(data, data, num); }
+
+    /**
+     * Byte swap an array of 32 bit values in place.
+     *
+     * @param data  The values.
+     * @param num   The number of values.
+     */
+    static void Swap32(uint32_t* data, size_t num) { CopySwapped32(data, data, num); }
+
+    /**
+     * Byte swap an array of 64 bit values in place.
+     *
+     * @param data  The values.
+     * @param num   The number of values.
+     */
+    static void Swap64(uint64_t* data, size_t num) { CopySwapped64(data, data, num); }
+
+    /**
+     * Copy an array of 16 bit values, byte swapping each value.
+     *
+     * @param dest  Where to write the swapped values.
+     * @param src   The values to copy.
+     * @param num   The number of values.
+     */
+    static void CopySwapped16(void* dest, const void* src, size_t num);
+
+    /**
+     * Copy an array of 32 bit values, byte swapping each value.
+     *
+     * @param dest  Where to write the swapped values.
+     * @param src   The values to copy.
+     * @param num   The number of values.
+     */
+    static void CopySwapped32(void* dest, const void* src, size_t num);
+
+    /**
+     * Copy an array of 64 bit values, byte swapping each value.
+     *
+     * @param dest  Where to write the swapped values.
+     * @param src   The values to copy.
+     * @param num   The number of values.
+     */
+    static void CopySwapped64(void* dest, const void* src, size_t num);
+
+    /**
+     * Check and convert an array of marshaled booleans. Each value must be a 32 bit 0 or 1. If the
+     * values are byte swapped they are converted to native byte order in place.
+     *
+     * @param data   The marshaled booleans.
+     * @param num    The number of booleans.
+     * @param swap   true if the marshaled values are byte swapped.
+     * @param bools  Returns the booleans.
+     *
+     * @return  true if all values were valid. If false is returned the contents of data and
+     *          bools are undefined.
+     */
+    static bool UnmarshalBools(uint32_t* data, size_t num, bool swap, bool* bools);
+
+    /**
+     * Marshal an array of booleans as 32 bit 0 or 1 values.
+     *
+     * @param bools  The booleans.
+     * @param num    The number of booleans.
+     * @param swap   true if the marshaled values must be byte swapped.
+     * @param data   Where to write the marshaled values.
+     */
+    static void MarshalBools(const bool* bools, size_t num, bool swap, void* data);
+
+    /**
+     * Enable or disable the vector kernels. While disabled all arrays are processed one element at
+     * a time. This is intended for measuring and testing the vector kernels.
+     *
+     * @param enable  true to enable the vector kernels (the default).
+     */
+    static void EnableVector(bool enable);
+
+    /**
+     * Get the name of the vector instruction set the kernels were compiled for.
+     *
+     * @return  "AVX2", "SSSE3", "SSE2" or "none".
+     */
+    static const char* GetVectorName();
+};
+
+}
+
+#endif
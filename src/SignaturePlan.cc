@@ -0,0 +1,304 @@
+/**
+ * @file
+ *
+ * This file implements the SignaturePlan class.
+ */
+
+/******************************************************************************
+ * Copyright 2011, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+
+#include <qcc/platform.h>
+
+#include <assert.h>
+#include <string.h>
+
+#if defined(__GNUC__) && !defined(ANDROID)
+#include <ext/hash_map>
+namespace std {
+using namespace __gnu_cxx;
+}
+#else
+#include <hash_map>
+#endif
+
+#include <qcc/Debug.h>
+#include <qcc/Mutex.h>
+#include <qcc/String.h>
+
+#include <alljoyn/MsgArg.h>
+
+#include "SignatureUtils.h"
+#include "SignaturePlan.h"
+
+#define QCC_MODULE "ALLJOYN"
+
+using namespace std;
+using namespace qcc;
+
+namespace ajn {
+
+#define PadUp(n, i)   (((n) + (i) - 1) & ~((i) - 1))
+
+/*
+ * Equality function for matching signatures
+ */
+struct SigEq { bool operator()(const char* s1, const char* s2) const { return (s1 == s2) || (strcmp(s1, s2) == 0); } };
+
+/*
+ * Plans are keyed by the signature string owned by the plan. Plans are never deleted.
+ */
+static qcc::Mutex planLock;
+static std::hash_map<const char*, SignaturePlan*, std::hash<const char*>, SigEq> plans;
+static size_t maxPlans = SignaturePlan::DEFAULT_MAX_PLANS;
+
+static uint32_t FixedSizeForType(AllJoynTypeId typeId)
+{
+    switch (typeId) {
+    case ALLJOYN_BYTE:
+        return 1;
+
+    case ALLJOYN_INT16:
+    case ALLJOYN_UINT16:
+        return 2;
+
+    case ALLJOYN_BOOLEAN:
+    case ALLJOYN_INT32:
+    case ALLJOYN_UINT32:
+    case ALLJOYN_HANDLE:
+        return 4;
+
+    case ALLJOYN_DOUBLE:
+    case ALLJOYN_UINT64:
+    case ALLJOYN_INT64:
+        return 8;
+
+    default:
+        return 0;
+    }
+}
+
+const SignaturePlan* SignaturePlan::Get(const char* signature)
+{
+    SignaturePlan* plan = NULL;
+    if (!signature) {
+        return NULL;
+    }
+    planLock.Lock();
+    if (maxPlans > 0) {
+        std::hash_map<const char*, SignaturePlan*, std::hash<const char*>, SigEq>::iterator it = plans.find(signature);
+        if (it != plans.end()) {
+            plan = it->second;
+        } else if (SignatureUtils::IsValidSignature(signature) && !strchr(signature, ALLJOYN_WILDCARD)) {
+            plan = Insert(signature, strlen(signature));
+            /*
+             * Array element signatures are only looked up when args are marshaled so compile them
+             * along with the signature they are part of.
+             */
+            for (size_t pos = 0; plan && (pos < plan->ops.size()); ++pos) {
+                if (plan->ops[pos].typeId == ALLJOYN_ARRAY) {
+                    qcc::String elemSig = plan->signature.substr(pos + 1, plan->ops[pos + 1].sigLen);
+                    if ((plans.find(elemSig.c_str()) == plans.end()) && SignatureUtils::IsValidSignature(elemSig.c_str())) {
+                        Insert(elemSig.c_str(), elemSig.size());
+                    }
+                }
+            }
+        }
+    }
+    planLock.Unlock();
+    return plan;
+}
+
+SignaturePlan* SignaturePlan::Insert(const char* signature, size_t len)
+{
+    if (plans.size() >= maxPlans) {
+        return NULL;
+    }
+    SignaturePlan* plan = new SignaturePlan(signature, len);
+    plans[plan->GetSignature()] = plan;
+    QCC_DbgPrintf(("Compiled signature \"%s\" (%u plans)", plan->GetSignature(), plans.size()));
+    return plan;
+}
+
+const SignaturePlan* SignaturePlan::Lookup(const char* signature)
+{
+    SignaturePlan* plan = NULL;
+    if (!signature) {
+        return NULL;
+    }
+    planLock.Lock();
+    if (maxPlans > 0) {
+        std::hash_map<const char*, SignaturePlan*, std::hash<const char*>, SigEq>::iterator it = plans.find(signature);
+        if (it != plans.end()) {
+            plan = it->second;
+        }
+    }
+    planLock.Unlock();
+    return plan;
+}
+
+void SignaturePlan::SetMaxPlans(size_t max)
+{
+    planLock.Lock();
+    maxPlans = max;
+    planLock.Unlock();
+}
+
+SignaturePlan::SignaturePlan(const char* sig, size_t len) : signature(sig, len), ops(len), numCompleteTypes(0)
+{
+    size_t pos = 0;
+    while (pos < len) {
+        pos = Compile(pos);
+        ++numCompleteTypes;
+    }
+}
+
+size_t SignaturePlan::Compile(size_t pos)
+{
+    /*
+     * The signature has already been validated so we don't need to check it again here.
+     */
+    Op& op = ops[pos];
+    AllJoynTypeId typeId = (AllJoynTypeId)signature[pos];
+    size_t next = pos + 1;
+
+    op.typeId = (uint8_t)typeId;
+    op.alignment = (uint8_t)SignatureUtils::AlignmentForType(typeId);
+    op.numMembers = 0;
+    op.fixedSize = FixedSizeForType(typeId);
+
+    switch (typeId) {
+    case ALLJOYN_ARRAY:
+        next = Compile(next);
+        op.numMembers = 1;
+        break;
+
+    case ALLJOYN_STRUCT_OPEN:
+    case ALLJOYN_DICT_ENTRY_OPEN:
+    {
+        /*
+         * A struct or dict entry has a fixed size if all of its members do. Containers are aligned
+         * on an 8 byte boundary so the layout of the members is the same wherever they appear.
+         */
+        bool fixed = true;
+        uint32_t sz = 0;
+        while ((signature[next] != ALLJOYN_STRUCT_CLOSE) && (signature[next] != ALLJOYN_DICT_ENTRY_CLOSE)) {
+            const Op& member = ops[next];
+            next = Compile(next);
+            if (fixed && member.fixedSize) {
+                sz = PadUp(sz, member.alignment) + member.fixedSize;
+            } else {
+                fixed = false;
+            }
+            ++op.numMembers;
+        }
+        Op& close = ops[next++];
+        close.typeId = (uint8_t)signature[next - 1];
+        close.alignment = 0;
+        close.sigLen = 0;
+        close.numMembers = 0;
+        close.fixedSize = 0;
+        op.fixedSize = fixed ? sz : 0;
+    }
+    break;
+
+    default:
+        break;
+    }
+    assert(next - pos <= 255);
+    op.sigLen = (uint8_t)(next - pos);
+    return next;
+}
+
+bool SignaturePlan::Matches(const MsgArg* args, size_t numArgs) const
+{
+    if (!args || (numArgs != numCompleteTypes)) {
+        return false;
+    }
+    size_t pos = 0;
+    for (size_t i = 0; i < numArgs; ++i) {
+        if (!Matches(args[i], pos)) {
+            return false;
+        }
+        pos += ops[pos].sigLen;
+    }
+    return true;
+}
+
+bool SignaturePlan::Matches(const MsgArg& arg, size_t pos) const
+{
+    const Op& op = ops[pos];
+
+    switch (arg.typeId) {
+    case ALLJOYN_DICT_ENTRY:
+        if ((op.typeId != ALLJOYN_DICT_ENTRY_OPEN) || !arg.v_dictEntry.key || !arg.v_dictEntry.val) {
+            return false;
+        }
+        return Matches(*arg.v_dictEntry.key, pos + 1) && Matches(*arg.v_dictEntry.val, pos + 1 + ops[pos + 1].sigLen);
+
+    case ALLJOYN_STRUCT:
+        if ((op.typeId != ALLJOYN_STRUCT_OPEN) || (arg.v_struct.numMembers != op.numMembers) || !arg.v_struct.members) {
+            return false;
+        }
+        ++pos;
+        for (size_t i = 0; i < arg.v_struct.numMembers; ++i) {
+            if (!Matches(arg.v_struct.members[i], pos)) {
+                return false;
+            }
+            pos += ops[pos].sigLen;
+        }
+        return true;
+
+    case ALLJOYN_ARRAY:
+        if ((op.typeId != ALLJOYN_ARRAY) || !arg.v_array.elemSig) {
+            return false;
+        } else {
+            size_t len = ops[pos + 1].sigLen;
+            return (strncmp(arg.v_array.elemSig, &signature[pos + 1], len) == 0) && (arg.v_array.elemSig[len] == 0);
+        }
+
+    case ALLJOYN_BOOLEAN_ARRAY:
+    case ALLJOYN_INT32_ARRAY:
+    case ALLJOYN_UINT32_ARRAY:
+    case ALLJOYN_DOUBLE_ARRAY:
+    case ALLJOYN_UINT64_ARRAY:
+    case ALLJOYN_INT64_ARRAY:
+    case ALLJOYN_INT16_ARRAY:
+    case ALLJOYN_UINT16_ARRAY:
+    case ALLJOYN_BYTE_ARRAY:
+        return (op.typeId == ALLJOYN_ARRAY) && (ops[pos + 1].typeId == (uint8_t)(arg.typeId >> 8));
+
+    case ALLJOYN_BOOLEAN:
+    case ALLJOYN_INT32:
+    case ALLJOYN_UINT32:
+    case ALLJOYN_DOUBLE:
+    case ALLJOYN_UINT64:
+    case ALLJOYN_INT64:
+    case ALLJOYN_SIGNATURE:
+    case ALLJOYN_INT16:
+    case ALLJOYN_UINT16:
+    case ALLJOYN_OBJECT_PATH:
+    case ALLJOYN_STRING:
+    case ALLJOYN_VARIANT:
+    case ALLJOYN_BYTE:
+    case ALLJOYN_HANDLE:
+        return op.typeId == (uint8_t)arg.typeId;
+
+    default:
+        return false;
+    }
+}
+
+}
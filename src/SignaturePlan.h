@@ -0,0 +1,191 @@
+#ifndef _ALLJOYN_SIGNATUREPLAN_H
+#define _ALLJOYN_SIGNATUREPLAN_H
+/**
+ * @file
+ * This file defines a class for compiling AllJoyn signatures into cached marshaling plans.
+ */
+
+/******************************************************************************
+ * Copyright 2011, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+
+#ifndef __cplusplus
+#error Only include SignaturePlan.h in C++ code.
+#endif
+
+#include <qcc/platform.h>
+
+#include <vector>
+
+#include <qcc/String.h>
+
+#include <alljoyn/MsgArg.h>
+
+#include <Status.h>
+
+namespace ajn {
+
+/**
+ * A %SignaturePlan is a signature that has been validated and compiled into a flat array of
+ * operations, one per signature character. The operation for the first character of a complete
+ * type records everything the marshaling code would otherwise have to work out by re-scanning the
+ * signature: the alignment, the length of the complete type, the number of members of a struct
+ * and the marshaled size of the type if that is fixed.
+ *
+ * Plans are compiled once and cached for the life of the process so a pointer to a plan returned
+ * by Get() is always valid. Because the same few signatures are used over and over again the
+ * cache is small and when it is full signatures are interpreted as before.
+ */
+class SignaturePlan {
+  public:
+
+    /**
+     * Operation for one position in the signature.
+     */
+    struct Op {
+        uint8_t typeId;      /**< The signature character at this position */
+        uint8_t alignment;   /**< Wire alignment for the type */
+        uint8_t sigLen;      /**< Length of the complete type that starts here, 0 for closing brackets */
+        uint8_t numMembers;  /**< Number of members of a struct or dict entry, 1 for an array */
+        uint32_t fixedSize;  /**< Marshaled size if all values of the type have the same size, 0 otherwise */
+    };
+
+    /**
+     * Default maximum number of plans that will be cached.
+     */
+    static const size_t DEFAULT_MAX_PLANS = 256;
+
+    /**
+     * Get the compiled plan for a signature, compiling and caching it if this is the first time
+     * the signature has been seen. The element signatures of any arrays in the signature are
+     * compiled and cached as well. Plans are never evicted so this must only be called for
+     * signatures that come from the local application such as the members of the interfaces it
+     * calls or implements. Signatures received from a peer, including the element signatures of
+     * args that may have been received from a peer, must use Lookup().
+     *
+     * @param signature  The signature.
+     *
+     * @return  The plan or NULL if the signature is not valid, contains wildcards or the cache is
+     *          full and the signature is not in it.
+     */
+    static const SignaturePlan* Get(const char* signature);
+
+    /**
+     * Get the compiled plan for a signature if it is already in the cache. A signature that is not
+     * cached is not compiled so a peer cannot fill the cache by sending arbitrary signatures.
+     *
+     * @param signature  The signature.
+     *
+     * @return  The plan or NULL if the signature is not in the cache.
+     */
+    static const SignaturePlan* Lookup(const char* signature);
+
+    /**
+     * Set the maximum number of plans that will be cached. Plans already in the cache are kept.
+     * Setting the maximum to zero disables compiled plans altogether so all signatures are
+     * interpreted, this is used for benchmarking.
+     *
+     * @param maxPlans  The maximum number of plans.
+     */
+    static void SetMaxPlans(size_t maxPlans);
+
+    /**
+     * Get the signature this plan was compiled from.
+     */
+    const char* GetSignature() const { return signature.c_str(); }
+
+    /**
+     * Get the length of the signature this plan was compiled from.
+     */
+    size_t GetLength() const { return ops.size(); }
+
+    /**
+     * Get the number of complete types in the signature.
+     */
+    uint8_t GetNumCompleteTypes() const { return numCompleteTypes; }
+
+    /**
+     * Get the operation for a position in the signature.
+     *
+     * @param pos  Offset of the position in the signature.
+     */
+    const Op& operator[](size_t pos) const { return ops[pos]; }
+
+    /**
+     * Find the operation for a signature pointer into a copy of the signature this plan was
+     * compiled from.
+     *
+     * @param base    The start of the signature the plan is being applied to.
+     * @param sigPtr  A pointer into the signature.
+     *
+     * @return  The operation or NULL if sigPtr does not point into the signature.
+     */
+    const Op* Find(const char* base, const char* sigPtr) const
+    {
+        size_t pos = (size_t)(sigPtr - base);
+        return (sigPtr >= base && pos < ops.size()) ? &ops[pos] : NULL;
+    }
+
+    /**
+     * Check if a value has the signature of the complete type at a position in the plan. This is
+     * equivalent to MsgArg::HasSignature() but does not build the signature for the value.
+     *
+     * @param arg  The value to check.
+     * @param pos  Offset of the complete type in the signature.
+     *
+     * @return  Returns true if the value has the complete type's signature.
+     */
+    bool Matches(const MsgArg& arg, size_t pos = 0) const;
+
+    /**
+     * Check if a list of values has exactly the signature this plan was compiled from.
+     *
+     * @param args     The values to check.
+     * @param numArgs  The number of values.
+     *
+     * @return  Returns true if the values have the signature.
+     */
+    bool Matches(const MsgArg* args, size_t numArgs) const;
+
+  private:
+
+    /**
+     * Constructor, compiles a valid signature.
+     */
+    SignaturePlan(const char* signature, size_t len);
+
+    /**
+     * Compile a valid signature and add it to the cache if the cache is not full. Must be called
+     * with the cache locked.
+     *
+     * @return  The plan or NULL if the cache is full.
+     */
+    static SignaturePlan* Insert(const char* signature, size_t len);
+
+    /**
+     * Compile the complete type at a position in the signature.
+     *
+     * @return  The position after the complete type.
+     */
+    size_t Compile(size_t pos);
+
+    qcc::String signature;    /**< The signature that was compiled */
+    std::vector<Op> ops;      /**< One operation per signature character */
+    uint8_t numCompleteTypes; /**< Number of complete types in the signature */
+};
+
+}
+
+#endif
@@ -31,6 +31,7 @@
 
 #include <alljoyn/MsgArg.h>
 #include "SignatureUtils.h"
+#include "SignaturePlan.h"
 
 #define QCC_MODULE "ALLJOYN"
 
@@ -227,7 +228,21 @@ size_t SignatureUtils::GetSize(const MsgArg* values, size_t numValues, size_t of
 
         case ALLJOYN_ARRAY:
             sz = PadUp(sz, 4) + 4;
-            if (values->v_array.numElements) {
+            if (values->v_array.numElements > 1) {
+                /*
+                 * If the elements have a fixed size we don't need to visit every one of them.
+                 * Elements that don't have the element signature are rejected when marshaled.
+                 * The values may have come from a peer so the plan is only looked up.
+                 */
+                const SignaturePlan* plan = SignaturePlan::Lookup(values->v_array.elemSig);
+                if (plan && (plan->GetNumCompleteTypes() == 1) && (*plan)[0].fixedSize) {
+                    const SignaturePlan::Op& elem = (*plan)[0];
+                    sz = PadUp(sz, elem.alignment);
+                    sz += (values->v_array.numElements - 1) * PadUp(elem.fixedSize, elem.alignment) + elem.fixedSize;
+                } else {
+                    sz = GetSize(values->v_array.elements, values->v_array.numElements, sz);
+                }
+            } else if (values->v_array.numElements) {
                 sz = GetSize(values->v_array.elements, values->v_array.numElements, sz);
             } else {
                 size_t alignment = AlignmentForType((AllJoynTypeId)(values->v_array.elemSig[0]));
@@ -37,6 +37,7 @@
 #include <alljoyn/BusAttachment.h>
 #include <alljoyn/DBusStd.h>
 #include <alljoyn/AllJoynStd.h>
+#include <alljoyn/MethodCallBatch.h>
 #include <alljoyn/version.h>
 
 #include <Status.h>
@@ -175,6 +176,7 @@ static void usage(void)
     printf("   -ta                   = Like -t except calls asynchronously\n");
     printf("   -rt [run time]        = Round trip timer (optional run time in ms)\n");
     printf("   -w                    = Don't wait for service\n");
+    printf("   -p <depth>            = Pipeline the pings sending up to <depth> calls before waiting for replies\n");
     printf("   -s                    = Call BusAttachment::WaitStop before exiting");
     printf("\n");
 }
@@ -330,6 +332,64 @@ class MyMessageReceiver : public MessageReceiver {
 
 
 
+/** Send count pings keeping up to depth calls outstanding and report latency and throughput */
+static QStatus PipelinedPings(const ProxyBusObject& remoteObj, unsigned long count, unsigned long depth)
+{
+    const InterfaceDescription* ifc = remoteObj.GetInterface(::org::alljoyn::alljoyn_test::InterfaceName);
+    if (ifc == NULL) {
+        QCC_SyncPrintf("Unable to Get InterfaceDecription for the %s interface\n", ::org::alljoyn::alljoyn_test::InterfaceName);
+        return ER_BUS_NO_SUCH_INTERFACE;
+    }
+    const InterfaceDescription::Member* pingMethod = ifc->GetMember("my_ping");
+    MethodCallBatch batch(*g_msgBus);
+    QStatus status = ER_OK;
+    unsigned long sent = 0;
+    unsigned long errors = 0;
+    unsigned long batches = 0;
+    uint64_t latencySum = 0;
+    uint32_t minLatency = 0xFFFFFFFF;
+    uint32_t maxLatency = 0;
+    uint32_t start = GetTimestamp();
+
+    while ((ER_OK == status) && (sent < count)) {
+        unsigned long n = ((count - sent) < depth) ? (count - sent) : depth;
+        uint32_t batchStart = GetTimestamp();
+        batch.Clear();
+        for (unsigned long i = 0; (ER_OK == status) && (i < n); ++i) {
+            char buf[80];
+            sprintf(buf, "Ping String %lu", ++sent);
+            MsgArg pingArg("s", buf);
+            status = batch.MethodCall(remoteObj, *pingMethod, &pingArg, 1, METHODCALL_TIMEOUT);
+            if (ER_OK != status) {
+                QCC_LogError(status, ("MethodCall on %s.%s failed", ::org::alljoyn::alljoyn_test::InterfaceName, pingMethod->name.c_str()));
+            }
+        }
+        if (ER_OK == status) {
+            status = batch.Wait();
+        }
+        uint32_t latency = GetTimestamp() - batchStart;
+        latencySum += latency;
+        minLatency = (latency < minLatency) ? latency : minLatency;
+        maxLatency = (latency > maxLatency) ? latency : maxLatency;
+        ++batches;
+        for (size_t i = 0; i < batch.GetCallCount(); ++i) {
+            Message reply(*g_msgBus);
+            if (batch.GetReply(i, reply) != ER_OK) {
+                ++errors;
+            }
+        }
+    }
+    uint32_t elapsed = GetTimestamp() - start;
+
+    QCC_SyncPrintf("Pipelined %lu calls with depth %lu in %u ms (%lu calls/sec) %lu errors\n",
+                   sent, depth, elapsed, (sent * 1000) / (elapsed ? elapsed : 1), errors);
+    if (batches) {
+        QCC_SyncPrintf("Batch latency MIN/AVG/MAX: %u/%llu/%u ms\n", minLatency, latencySum / batches, maxLatency);
+    }
+    return status;
+}
+
+
 /** Main entry point */
 int main(int argc, char** argv)
 {
@@ -356,6 +416,7 @@ int main(int argc, char** argv)
     uint32_t pingInterval = 0;
     bool waitStop = false;
     bool roundtrip = false;
+    unsigned long pipelineDepth = 0;
 
 #ifdef _WIN32
     WSADATA wsaData;
@@ -501,6 +562,18 @@ int main(int argc, char** argv)
             } else if (pingCount == 1) {
                 pingCount = 1000;
             }
+        } else if (0 == strcmp("-p", argv[i])) {
+            ++i;
+            if (i == argc) {
+                printf("option %s requires a parameter\n", argv[i - 1]);
+                usage();
+                exit(1);
+            } else {
+                pipelineDepth = strtoul(argv[i], NULL, 10);
+                if (pingCount == 1) {
+                    pingCount = 10000;
+                }
+            }
         } else if (0 == strcmp("-s", argv[i])) {
             waitStop = true;
         } else {
@@ -670,6 +743,12 @@ int main(int argc, char** argv)
             uint64_t max_delta = 0;
             uint64_t min_delta = ~0;
 
+            /* Pipeline the calls to the remote method */
+            if ((ER_OK == status) && (pipelineDepth > 0)) {
+                status = PipelinedPings(remoteObj, pings, pipelineDepth);
+                pings = 0;
+            }
+
             /* Call the remote method */
             while ((ER_OK == status) && pings--) {
                 Message reply(*g_msgBus);
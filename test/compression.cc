@@ -27,6 +27,10 @@
 #include <qcc/StringUtil.h>
 #include <qcc/Util.h>
 #include <qcc/Thread.h>
+#include <qcc/time.h>
+
+#include <set>
+#include <vector>
 
 #include <alljoyn/BusAttachment.h>
 #include <alljoyn/Message.h>
@@ -35,6 +39,7 @@
 #include <Status.h>
 
 /* Private files included for unit testing */
+#include <CompressionRules.h>
 #include <RemoteEndpoint.h>
 
 
@@ -82,6 +87,172 @@ class MyMessage : public _Message {
 
 };
 
+/* Build the compressible header fields for a signal. The strings must outlive the header fields. */
+static void MakeFields(HeaderFields& hdrFields, const qcc::String& member, const qcc::String& path)
+{
+    hdrFields.field[ALLJOYN_HDR_FIELD_PATH].Set("o", path.c_str());
+    hdrFields.field[ALLJOYN_HDR_FIELD_INTERFACE].Set("s", "foo.bar");
+    hdrFields.field[ALLJOYN_HDR_FIELD_MEMBER].Set("s", member.c_str());
+    hdrFields.field[ALLJOYN_HDR_FIELD_DESTINATION].Set("s", ":1.99");
+}
+
+/* Repeatedly gets tokens for a working set of headers that is shared with other threads */
+class TokenThread : public qcc::Thread {
+  public:
+    TokenThread(CompressionRules& rules, std::vector<HeaderFields>& fields, std::vector<uint32_t>& tokens, uint32_t iterations) :
+        qcc::Thread("TokenThread"), rules(rules), fields(fields), tokens(tokens), iterations(iterations), mismatches(0) { }
+
+    qcc::ThreadReturn STDCALL Run(void* arg)
+    {
+        for (uint32_t i = 0; i < iterations; ++i) {
+            size_t n = i % fields.size();
+            if (rules.GetToken(fields[n]) != tokens[n]) {
+                ++mismatches;
+            }
+        }
+        return 0;
+    }
+
+    CompressionRules& rules;
+    std::vector<HeaderFields>& fields;
+    std::vector<uint32_t>& tokens;
+    uint32_t iterations;
+    uint32_t mismatches;
+};
+
+static bool TestEviction()
+{
+    const size_t maxRules = 64;
+    CompressionRules rules(maxRules);
+    std::vector<qcc::String> members;
+    std::vector<uint32_t> tokens;
+    std::set<uint32_t> unique;
+
+    for (uint32_t i = 0; i < 1000; ++i) {
+        members.push_back("member" + qcc::U32ToString(i));
+    }
+    qcc::String path = "/foo/bar";
+    for (size_t i = 0; i < members.size(); ++i) {
+        HeaderFields hdrFields;
+        MakeFields(hdrFields, members[i], path);
+        uint32_t token = rules.GetToken(hdrFields);
+        tokens.push_back(token);
+        unique.insert(token);
+    }
+    /* Compression rules are bounded and tokens are never reused */
+    if (rules.Size() > maxRules) {
+        printf("\nFAILED eviction: %u compression rules\n", (uint32_t)rules.Size());
+        return false;
+    }
+    if (unique.size() != members.size()) {
+        printf("\nFAILED eviction: duplicate tokens\n");
+        return false;
+    }
+    /* The most recent compression rule is still cached and expands to the original fields */
+    HeaderFields newest;
+    MakeFields(newest, members.back(), path);
+    HeaderFields expansion;
+    if ((rules.GetToken(newest) != tokens.back()) ||
+        !rules.GetExpansion(tokens.back(), expansion) || (members.back() != expansion.field[ALLJOYN_HDR_FIELD_MEMBER].v_string.str)) {
+        printf("\nFAILED eviction: recent compression rule evicted\n");
+        return false;
+    }
+    /* The oldest compression rule has been evicted and its token retired */
+    if (rules.GetExpansion(tokens.front(), expansion)) {
+        printf("\nFAILED eviction: oldest compression rule not evicted\n");
+        return false;
+    }
+    HeaderFields oldest;
+    MakeFields(oldest, members.front(), path);
+    uint32_t reissued = rules.GetToken(oldest);
+    if ((unique.find(reissued) != unique.end()) ||
+        !rules.GetExpansion(reissued, expansion) || (members.front() != expansion.field[ALLJOYN_HDR_FIELD_MEMBER].v_string.str)) {
+        printf("\nFAILED eviction: retired token reused\n");
+        return false;
+    }
+    unique.insert(reissued);
+
+    /* Fill the table with expansions from a peer using tokens that do not collide with ours */
+    qcc::String peerPath = "/peer";
+    std::vector<uint32_t> peerTokens;
+    for (uint32_t token = 1; peerTokens.size() < members.size(); ++token) {
+        if (unique.find(token) == unique.end()) {
+            HeaderFields hdrFields;
+            MakeFields(hdrFields, members[peerTokens.size()], peerPath);
+            rules.AddExpansion(hdrFields, token);
+            peerTokens.push_back(token);
+        }
+    }
+    /* The number of expansion rules is bounded separately from the compression rules */
+    if (rules.Size() > 2 * maxRules) {
+        printf("\nFAILED eviction: %u rules\n", (uint32_t)rules.Size());
+        return false;
+    }
+    /* Expansions from the peer don't evict our compression rules */
+    if (rules.GetToken(oldest) != reissued) {
+        printf("\nFAILED eviction: compression rule evicted by expansions\n");
+        return false;
+    }
+    /* The most recent expansion is still cached */
+    if (!rules.GetExpansion(peerTokens.back(), expansion) || (members.back() != expansion.field[ALLJOYN_HDR_FIELD_MEMBER].v_string.str)) {
+        printf("\nFAILED eviction: recent expansion evicted\n");
+        return false;
+    }
+    /* The oldest expansion has been evicted */
+    if (rules.GetExpansion(peerTokens.front(), expansion)) {
+        printf("\nFAILED eviction: oldest expansion not evicted\n");
+        return false;
+    }
+    /* An evicted expansion can be relearned from a peer */
+    HeaderFields relearn;
+    MakeFields(relearn, members.front(), peerPath);
+    rules.AddExpansion(relearn, peerTokens.front());
+    HeaderFields compressed;
+    if (!rules.Expand(peerTokens.front(), compressed) || (members.front() != compressed.field[ALLJOYN_HDR_FIELD_MEMBER].v_string.str)) {
+        printf("\nFAILED eviction: expansion not relearned\n");
+        return false;
+    }
+    return true;
+}
+
+static bool TestContention(uint32_t numThreads, uint32_t iterations)
+{
+    CompressionRules rules;
+    std::vector<qcc::String> members;
+    std::vector<HeaderFields> fields;
+    std::vector<uint32_t> tokens;
+    qcc::String path = "/foo/bar";
+
+    for (uint32_t i = 0; i < 256; ++i) {
+        members.push_back("member" + qcc::U32ToString(i));
+    }
+    fields.resize(members.size());
+    for (size_t i = 0; i < members.size(); ++i) {
+        MakeFields(fields[i], members[i], path);
+        tokens.push_back(rules.GetToken(fields[i]));
+    }
+
+    std::vector<TokenThread*> threads;
+    uint32_t start = GetTimestamp();
+    for (uint32_t t = 0; t < numThreads; ++t) {
+        threads.push_back(new TokenThread(rules, fields, tokens, iterations));
+        threads.back()->Start();
+    }
+    uint32_t mismatches = 0;
+    for (uint32_t t = 0; t < numThreads; ++t) {
+        threads[t]->Join();
+        mismatches += threads[t]->mismatches;
+        delete threads[t];
+    }
+    uint32_t elapsed = GetTimestamp() - start;
+    printf("%u threads x %u GetToken calls in %u ms\n", numThreads, iterations, elapsed);
+    if (mismatches) {
+        printf("\nFAILED contention: %u token mismatches\n", mismatches);
+        return false;
+    }
+    return true;
+}
+
 
 int main(int argc, char** argv)
 {
@@ -237,6 +408,16 @@ int main(int argc, char** argv)
         }
     }
 
+    if (!TestEviction()) {
+        return -1;
+    }
+
+    for (uint32_t numThreads = 1; numThreads <= 8; numThreads *= 2) {
+        if (!TestContention(numThreads, 200000)) {
+            return -1;
+        }
+    }
+
     printf("PASSED\n");
 
     return 0;
@@ -25,6 +25,8 @@
 
 #include <qcc/platform.h>
 
+#include <vector>
+
 #include <qcc/Crypto.h>
 #include <qcc/Debug.h>
 #include <qcc/FileStream.h>
@@ -269,6 +271,54 @@ int main(int argc, char** argv)
 
     }
 
+    printf("Testing key store JOURNAL\n");
+    {
+        const size_t numKeys = 500;
+        std::vector<qcc::GUID128> guids(numKeys);
+        {
+            KeyStore keyStore("keystore_journal_test");
+            keyStore.Init("keystore_journal_test", false);
+            keyStore.Clear();
+
+            /* Store is write-behind so adding keys doesn't wait for the key store to be written */
+            uint32_t start = GetTimestamp();
+            for (size_t i = 0; i < numKeys; ++i) {
+                key.Rand(Crypto_AES::AES128_SIZE, KeyBlob::AES);
+                keyStore.AddKey(guids[i], key);
+                keyStore.Store();
+            }
+            printf("Added and stored %u keys in %u ms\n", static_cast<uint32_t>(numKeys), GetTimestamp() - start);
+
+            /* Delete every other key */
+            for (size_t i = 0; i < numKeys; i += 2) {
+                keyStore.DelKey(guids[i]);
+            }
+            start = GetTimestamp();
+            status = keyStore.Flush();
+            if (status != ER_OK) {
+                printf("Failed to flush keystore %s\n", QCC_StatusText(status));
+                goto ErrorExit;
+            }
+            printf("Flushed keystore in %u ms\n", GetTimestamp() - start);
+        }
+        {
+            /* Reload the key store replaying the journal */
+            KeyStore keyStore("keystore_journal_test");
+            keyStore.Init("keystore_journal_test", false);
+            for (size_t i = 0; i < numKeys; ++i) {
+                status = keyStore.GetKey(guids[i], key);
+                if ((i & 1) ? (status != ER_OK) : (status == ER_OK)) {
+                    printf("Key %u was not restored from the journal\n", static_cast<uint32_t>(i));
+                    status = ER_FAIL;
+                    goto ErrorExit;
+                }
+            }
+            status = ER_OK;
+        }
+        DeleteFile(GetHomeDir() + "/keystore_journal_test");
+        DeleteFile(GetHomeDir() + "/keystore_journal_test.journal");
+    }
+
     printf("keystore unit test PASSED\n");
     return 0;
 
@@ -30,9 +30,11 @@
 #include <qcc/Pipe.h>
 #include <qcc/String.h>
 #include <qcc/StringUtil.h>
+#include <qcc/time.h>
 
 #include <alljoyn/BusAttachment.h>
 #include <alljoyn/Message.h>
+#include <alljoyn/MsgCursor.h>
 #include <alljoyn/version.h>
 
 #include <Status.h>
@@ -40,6 +42,7 @@
 /* Private files included for unit testing */
 #include <PeerState.h>
 #include <SignatureUtils.h>
+#include <SignaturePlan.h>
 #include <RemoteEndpoint.h>
 
 #define QCC_MODULE "ALLJOYN"
@@ -148,6 +151,8 @@ class MyMessage : public _Message {
 
     QStatus UnmarshalBody() { return UnmarshalArgs("*"); }
 
+    QStatus UnmarshalBodyLazy() { return UnmarshalArgs("*", NULL, true); }
+
     QStatus Unmarshal(RemoteEndpoint& ep, const qcc::String& endpointName, bool pedantic = true)
     {
         return _Message::Unmarshal(ep, pedantic);
@@ -991,6 +996,256 @@ QStatus TestMsgUnpack()
 
 }
 
+/*
+ * Read a message body in place with a MsgCursor and then unmarshal it on demand
+ */
+static QStatus TestCursor()
+{
+    QStatus status;
+    TestPipe stream;
+    MyMessage msg;
+    uint32_t serial;
+    RemoteEndpoint ep(*gBus, false, "", stream, "dummy", false);
+
+    MsgArg vals[3];
+    vals[0].Set("s", "fred");
+    vals[1].Set("u", 42);
+    vals[2].Set("(dd)", 1.5, -2.5);
+    MsgArg entries[3];
+    entries[0].Set("{sv}", "Name", &vals[0]);
+    entries[1].Set("{sv}", "Volume", &vals[1]);
+    entries[2].Set("{sv}", "Coords", &vals[2]);
+    MsgArg args[4];
+    args[0].Set("a{sv}", ArraySize(entries), entries);
+    args[1].Set("(ibs)", -7, true, "tail");
+    args[2].Set("ay", ArraySize(ay), ay);
+    args[3].Set("ai", ArraySize(ai), ai);
+
+    status = msg.MethodCall("desti.nation", "/foo/bar", "foo.bar", "test", serial, args, ArraySize(args));
+    if (status == ER_OK) {
+        status = msg.Deliver(ep);
+    }
+    if (status == ER_OK) {
+        status = msg.Unmarshal(ep, ":88.88");
+    }
+    if (status == ER_OK) {
+        status = msg.UnmarshalBodyLazy();
+    }
+    /*
+     * Missing dictionary entry
+     */
+    MsgCursor cursor;
+    MsgCursor val;
+    if (status == ER_OK) {
+        status = msg.GetBodyCursor(cursor);
+    }
+    if ((status == ER_OK) && (cursor.FindEntry("Missing", val) != ER_BUS_ELEMENT_NOT_FOUND)) {
+        status = ER_FAIL;
+    }
+    /*
+     * Pick one value out of the dictionary then read the rest of the args in order
+     */
+    if (status == ER_OK) {
+        status = msg.GetBodyCursor(cursor);
+    }
+    if (status == ER_OK) {
+        status = cursor.FindEntry("Volume", val);
+    }
+    if (status == ER_OK) {
+        MsgCursor var;
+        uint32_t volume = 0;
+        status = val.Recurse(var);
+        if (status == ER_OK) {
+            status = var.Get(volume);
+        }
+        if ((status == ER_OK) && (volume != 42)) {
+            status = ER_FAIL;
+        }
+    }
+    if (status == ER_OK) {
+        MsgCursor members;
+        int32_t n = 0;
+        bool flag = false;
+        const char* str = NULL;
+        size_t len = 0;
+        status = cursor.Recurse(members);
+        if (status == ER_OK) {
+            status = members.Get(n);
+        }
+        if (status == ER_OK) {
+            status = members.Get(flag);
+        }
+        if (status == ER_OK) {
+            status = members.GetString(str, len);
+        }
+        if ((status == ER_OK) && ((n != -7) || !flag || (len != 4) || (strcmp(str, "tail") != 0) || !members.AtEnd())) {
+            status = ER_FAIL;
+        }
+    }
+    if (status == ER_OK) {
+        const uint8_t* bytes = NULL;
+        size_t len = 0;
+        status = cursor.GetBytes(bytes, len);
+        if ((status == ER_OK) && ((len != ArraySize(ay)) || (memcmp(bytes, ay, len) != 0))) {
+            status = ER_FAIL;
+        }
+    }
+    if (status == ER_OK) {
+        MsgCursor elems;
+        size_t count = 0;
+        status = cursor.Recurse(elems);
+        while ((status == ER_OK) && !elems.AtEnd()) {
+            int32_t n;
+            status = elems.Get(n);
+            if ((status == ER_OK) && ((count >= ArraySize(ai)) || (n != ai[count]))) {
+                status = ER_FAIL;
+            }
+            ++count;
+        }
+        if ((status == ER_OK) && ((count != ArraySize(ai)) || !cursor.AtEnd())) {
+            status = ER_FAIL;
+        }
+    }
+    /*
+     * The args are unmarshaled when they are asked for
+     */
+    if (status == ER_OK) {
+        status = msg.GetBodyCursor(cursor);
+    }
+    if (status == ER_OK) {
+        size_t numArgs;
+        const MsgArg* outArgs;
+        status = msg.GetArgs(numArgs, outArgs);
+        if ((status == ER_OK) && (MsgArg::ToString(outArgs, numArgs) != MsgArg::ToString(args, ArraySize(args)))) {
+            status = ER_FAIL;
+        }
+    }
+    /*
+     * A cursor obtained before the args were unmarshaled is still valid
+     */
+    if (status == ER_OK) {
+        status = cursor.FindEntry("Volume", val);
+    }
+    if (status == ER_OK) {
+        MsgCursor var;
+        uint32_t volume = 0;
+        status = val.Recurse(var);
+        if (status == ER_OK) {
+            status = var.Get(volume);
+        }
+        if ((status == ER_OK) && (volume != 42)) {
+            status = ER_FAIL;
+        }
+    }
+    /*
+     * A message without any args has a cursor that is already at the end
+     */
+    if (status == ER_OK) {
+        MyMessage empty;
+        status = empty.MethodCall("desti.nation", "/foo/bar", "foo.bar", "test", serial, NULL, 0);
+        if (status == ER_OK) {
+            status = empty.Deliver(ep);
+        }
+        if (status == ER_OK) {
+            status = empty.Unmarshal(ep, ":88.88");
+        }
+        if (status == ER_OK) {
+            status = empty.UnmarshalBody();
+        }
+        if (status == ER_OK) {
+            status = empty.GetBodyCursor(cursor);
+        }
+        if ((status == ER_OK) && !cursor.AtEnd()) {
+            status = ER_FAIL;
+        }
+    }
+    if (status != ER_OK) {
+        printf("Message cursor test FAILED: %s\n", QCC_StatusText(status));
+    }
+    return status;
+}
+
+/*
+ * Time marshaling and unmarshaling a message with interpreted and then with compiled signatures
+ */
+static QStatus BenchmarkSignature(const MsgArg* argList, size_t numArgs, size_t iterations)
+{
+    QStatus status = ER_OK;
+    bool wasQuiet = quiet;
+    qcc::String sig = MsgArg::Signature(argList, numArgs);
+
+    quiet = true;
+    for (int pass = 0; (pass < 2) && (status == ER_OK); ++pass) {
+        bool compiled = (pass == 1);
+        SignaturePlan::SetMaxPlans(compiled ? SignaturePlan::DEFAULT_MAX_PLANS : 0);
+        TestPipe stream;
+        RemoteEndpoint ep(*gBus, false, "", stream, "dummy", false);
+        uint32_t start = GetTimestamp();
+        for (size_t i = 0; (i < iterations) && (status == ER_OK); ++i) {
+            MyMessage msg;
+            uint32_t serial;
+            status = msg.MethodCall("desti.nation", "/foo/bar", "foo.bar", "test", serial, argList, numArgs);
+            if (status == ER_OK) {
+                status = msg.Deliver(ep);
+            }
+            if (status == ER_OK) {
+                status = msg.Unmarshal(ep, ":88.88");
+            }
+            if (status == ER_OK) {
+                status = msg.UnmarshalBody();
+            }
+        }
+        uint32_t elapsed = GetTimestamp() - start;
+        if (status == ER_OK) {
+            printf("%-24s %-12s %6u ms  %10.0f msgs/sec\n", sig.c_str(), compiled ? "compiled" : "interpreted", elapsed,
+                   iterations / ((elapsed ? elapsed : 1) / 1000.0));
+        } else {
+            printf("Benchmark of \"%s\" failed: %s\n", sig.c_str(), QCC_StatusText(status));
+        }
+    }
+    SignaturePlan::SetMaxPlans(SignaturePlan::DEFAULT_MAX_PLANS);
+    quiet = wasQuiet;
+    return status;
+}
+
+static QStatus SignatureBenchmarks()
+{
+    QStatus status = ER_OK;
+    if (status == ER_OK) {
+        MsgArg* structs = new MsgArg[1000];
+        for (int32_t i = 0; i < 1000; ++i) {
+            structs[i].Set("(ii)", i, -i);
+        }
+        MsgArg arg;
+        status = arg.Set("a(ii)", (size_t)1000, structs);
+        if (status == ER_OK) {
+            status = BenchmarkSignature(&arg, 1, 2000);
+        }
+        delete [] structs;
+    }
+    if (status == ER_OK) {
+        MsgArg* entries = new MsgArg[100];
+        for (uint32_t i = 0; i < 100; ++i) {
+            entries[i].Set("{s(uud)}", s, i, u, d);
+        }
+        MsgArg arg;
+        status = arg.Set("a{s(uud)}", (size_t)100, entries);
+        if (status == ER_OK) {
+            status = BenchmarkSignature(&arg, 1, 10000);
+        }
+        delete [] entries;
+    }
+    if (status == ER_OK) {
+        MsgArg args[4];
+        args[0].Set("(ybnqiuxtd)", y, b, n, q, i, u, x, t, d);
+        args[1].Set("s", s);
+        args[2].Set("o", o);
+        args[3].Set("ai", ArraySize(ai), ai);
+        status = BenchmarkSignature(args, ArraySize(args), 100000);
+    }
+    return status;
+}
+
 
 static void usage(void)
 {
@@ -999,11 +1254,13 @@ static void usage(void)
     printf("   -f         = fuzzing\n");
     printf("   -q         = Quiet\n");
     printf("   -b         = Suppress big array test (which takes a long time)\n");
+    printf("   -s         = Benchmark interpreted against compiled signatures\n");
 }
 
 int main(int argc, char** argv)
 {
     bool fuzz = false;
+    bool benchmark = false;
     QStatus status = ER_OK;
 
     printf("AllJoyn Library version: %s\n", ajn::GetVersion());
@@ -1017,6 +1274,8 @@ int main(int argc, char** argv)
             nobig = true;
         } else if (0 == strcmp("-q", argv[i])) {
             quiet = true;
+        } else if (0 == strcmp("-s", argv[i])) {
+            benchmark = true;
         } else {
             usage();
             exit(1);
@@ -1054,6 +1313,42 @@ int main(int argc, char** argv)
                     status = ER_FAIL;
                 }
             }
+            /*
+             * Compiled plan must agree with the interpreted signature
+             */
+            if (status == ER_OK) {
+                const SignaturePlan* plan = SignaturePlan::Get(good[i]);
+                if (!plan || (plan->GetNumCompleteTypes() != SignatureUtils::CountCompleteTypes(good[i]))) {
+                    if (!quiet) printf("Compiled plan for \"%s\" is wrong\n", good[i]);
+                    status = ER_FAIL;
+                }
+            }
+        }
+    }
+    /*
+     * Signatures received from a peer are only looked up, they must not be compiled into the cache
+     */
+    if (status == ER_OK) {
+        const char* peerSig = "(qqqqqqqqqqqqqqqqy)";
+        if (SignaturePlan::Lookup(peerSig)) {
+            if (!quiet) printf("Lookup compiled a plan for \"%s\"\n", peerSig);
+            status = ER_FAIL;
+        } else {
+            const SignaturePlan* plan = SignaturePlan::Get(peerSig);
+            if (!plan || (SignaturePlan::Lookup(peerSig) != plan)) {
+                if (!quiet) printf("Lookup did not find the cached plan for \"%s\"\n", peerSig);
+                status = ER_FAIL;
+            }
+        }
+    }
+    /*
+     * Compiling a signature also compiles the element signatures of its arrays
+     */
+    if (status == ER_OK) {
+        const char* elemSig = "(qqqqqqqqqqqqqqqqn)";
+        if (!SignaturePlan::Get("ua(qqqqqqqqqqqqqqqqn)") || !SignaturePlan::Lookup(elemSig)) {
+            if (!quiet) printf("Element signature \"%s\" was not compiled\n", elemSig);
+            status = ER_FAIL;
         }
     }
     /*
@@ -1170,6 +1465,12 @@ int main(int argc, char** argv)
     if (status == ER_OK) {
         status = MarshalTests();
     }
+    if (status == ER_OK) {
+        status = TestCursor();
+    }
+    if ((status == ER_OK) && benchmark) {
+        status = SignatureBenchmarks();
+    }
 
     if (status == ER_OK) {
         printf("\nPASSED\n");
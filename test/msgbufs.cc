@@ -0,0 +1,187 @@
+/**
+ * @file
+ *
+ * Benchmark for message buffer allocation with and without the message buffer pool.
+ */
+
+/******************************************************************************
+ * Copyright 2011, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+
+#include <qcc/platform.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include <qcc/Pipe.h>
+#include <qcc/String.h>
+#include <qcc/Util.h>
+#include <qcc/time.h>
+
+#include <alljoyn/BusAttachment.h>
+#include <alljoyn/Message.h>
+#include <alljoyn/version.h>
+
+#include <Status.h>
+
+/* Private files included for unit testing */
+#include <MsgBufPool.h>
+#include <RemoteEndpoint.h>
+
+#define QCC_MODULE "ALLJOYN"
+
+using namespace qcc;
+using namespace std;
+using namespace ajn;
+
+static BusAttachment* gBus;
+
+class BenchMessage : public _Message {
+  public:
+
+    BenchMessage() : _Message(*gBus) { }
+
+    QStatus Signal(const MsgArg* argList, size_t numArgs)
+    {
+        qcc::String sig = MsgArg::Signature(argList, numArgs);
+        return SignalMsg(sig, NULL, 0, "/org/alljoyn/alljoyn_test", "org.alljoyn.alljoyn_test", "my_signal", argList, numArgs, 0, 0);
+    }
+
+    QStatus Unmarshal(RemoteEndpoint& ep) { return _Message::Unmarshal(ep, false); }
+
+    QStatus UnmarshalBody() { return UnmarshalArgs("*"); }
+
+    QStatus Deliver(RemoteEndpoint& ep) { return _Message::Deliver(ep); }
+};
+
+/* Marshal, deliver and unmarshal numMsgs signals with a body of payloadSize bytes */
+static QStatus Run(RemoteEndpoint& ep, unsigned long numMsgs, size_t payloadSize, bool pooled)
+{
+    QStatus status = ER_OK;
+    vector<uint8_t> payload(payloadSize, 0xA5);
+    MsgArg args[2];
+    args[0].Set("u", 0);
+    args[1].Set("ay", payload.size(), payload.empty() ? NULL : &payload[0]);
+
+    MsgBufPool::Enable(pooled);
+    MsgBufPool::Stats before;
+    MsgBufPool::GetStats(before);
+
+    uint32_t start = GetTimestamp();
+    for (unsigned long i = 0; (i < numMsgs) && (status == ER_OK); ++i) {
+        args[0].v_uint32 = i;
+        BenchMessage tx;
+        status = tx.Signal(args, ArraySize(args));
+        if (status == ER_OK) {
+            status = tx.Deliver(ep);
+        }
+        if (status == ER_OK) {
+            BenchMessage rx;
+            status = rx.Unmarshal(ep);
+            if (status == ER_OK) {
+                status = rx.UnmarshalBody();
+            }
+        }
+    }
+    uint32_t elapsed = GetTimestamp() - start;
+
+    MsgBufPool::Stats after;
+    MsgBufPool::GetStats(after);
+
+    if (status != ER_OK) {
+        printf("Failed: %s\n", QCC_StatusText(status));
+        return status;
+    }
+    uint32_t allocs = after.numAllocs - before.numAllocs;
+    uint32_t hits = after.numHits - before.numHits;
+    uint32_t heapAllocs = after.numHeapAllocs - before.numHeapAllocs;
+    printf("%-8s %6u bytes  %6u ms  %6.2f heap allocations/msg  %5.1f%% hit rate  %8u bytes retained\n",
+           pooled ? "pool" : "no pool",
+           (uint32_t)payloadSize,
+           elapsed,
+           numMsgs ? (double)heapAllocs / numMsgs : 0.0,
+           allocs ? (100.0 * hits) / allocs : 0.0,
+           (uint32_t)after.bytesRetained);
+    return status;
+}
+
+static void usage(void)
+{
+    printf("Usage: msgbufs [-h] [-c #] [-s #]\n\n");
+    printf("Options:\n");
+    printf("   -h    = Print this help message\n");
+    printf("   -c #  = Number of messages per run (default = 100000)\n");
+    printf("   -s #  = Only run with a payload of # bytes (default = 16, 256, 4096 and 32768)\n");
+}
+
+int main(int argc, char** argv)
+{
+    QStatus status = ER_OK;
+    unsigned long numMsgs = 100000;
+    vector<size_t> sizes;
+
+    printf("AllJoyn Library version: %s\n", ajn::GetVersion());
+    printf("AllJoyn Library build info: %s\n", ajn::GetBuildInfo());
+
+    for (int i = 1; i < argc; ++i) {
+        if (0 == strcmp("-h", argv[i])) {
+            usage();
+            exit(0);
+        } else if ((0 == strcmp("-c", argv[i])) || (0 == strcmp("-s", argv[i]))) {
+            if ((i + 1) == argc) {
+                printf("option %s requires a parameter\n", argv[i]);
+                usage();
+                exit(1);
+            }
+            unsigned long val = strtoul(argv[i + 1], NULL, 10);
+            if (argv[i][1] == 'c') {
+                numMsgs = val;
+            } else {
+                sizes.push_back(val);
+            }
+            ++i;
+        } else {
+            printf("Unknown option %s\n", argv[i]);
+            usage();
+            exit(1);
+        }
+    }
+    if (sizes.empty()) {
+        sizes.push_back(16);
+        sizes.push_back(256);
+        sizes.push_back(4096);
+        sizes.push_back(32768);
+    }
+
+    gBus = new BusAttachment("msgbufs");
+    gBus->Start();
+
+    {
+        Pipe stream;
+        RemoteEndpoint ep(*gBus, false, "", stream, "dummy", false);
+
+        for (size_t s = 0; (s < sizes.size()) && (status == ER_OK); ++s) {
+            status = Run(ep, numMsgs, sizes[s], false);
+            if (status == ER_OK) {
+                status = Run(ep, numMsgs, sizes[s], true);
+            }
+        }
+    }
+
+    delete gBus;
+    return (status == ER_OK) ? 0 : 1;
+}
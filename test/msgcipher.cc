@@ -0,0 +1,170 @@
+/**
+ * @file
+ *
+ * Throughput benchmark for AES-CCM message encryption with and without a cached key schedule.
+ */
+
+/******************************************************************************
+ * Copyright 2011, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+
+#include <qcc/platform.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include <qcc/Crypto.h>
+#include <qcc/KeyBlob.h>
+#include <qcc/Util.h>
+#include <qcc/time.h>
+
+#include <alljoyn/version.h>
+
+#include <Status.h>
+
+/* Private files included for unit testing */
+#include <AllJoynCrypto.h>
+
+using namespace qcc;
+using namespace std;
+using namespace ajn;
+
+/* Size of the clear text header that is authenticated but not encrypted */
+static const size_t HDR_LEN = 64;
+
+static void MakeNonce(uint32_t serial, uint8_t nd[5])
+{
+    nd[0] = 0;
+    nd[1] = (uint8_t)(serial >> 24);
+    nd[2] = (uint8_t)(serial >> 16);
+    nd[3] = (uint8_t)(serial >> 8);
+    nd[4] = (uint8_t)(serial);
+}
+
+/*
+ * Encrypt and decrypt numMsgs messages with bodies of bodyLen bytes. When cached is false the key
+ * schedule is expanded for every encryption and decryption like it was before _MessageCipher.
+ */
+static QStatus Run(const KeyBlob& key, size_t bodyLen, unsigned long numMsgs, bool cached)
+{
+    QStatus status = ER_OK;
+    vector<uint8_t> msg(HDR_LEN + bodyLen + Crypto::ExpansionBytes);
+    vector<uint8_t> body(bodyLen);
+    for (size_t i = 0; i < msg.size(); ++i) {
+        msg[i] = (uint8_t)i;
+    }
+    memcpy(&body[0], &msg[HDR_LEN], bodyLen);
+
+    _MessageCipher cipher(key);
+    uint32_t start = GetTimestamp();
+    for (unsigned long i = 0; (i < numMsgs) && (status == ER_OK); ++i) {
+        uint8_t nd[5];
+        MakeNonce(i + 1, nd);
+        KeyBlob nonce(nd, sizeof(nd), KeyBlob::GENERIC);
+        uint8_t* data = &msg[HDR_LEN];
+        size_t len = bodyLen;
+        if (cached) {
+            status = cipher.Encrypt_CCM(data, data, len, nonce, &msg[0], HDR_LEN);
+            if (status == ER_OK) {
+                status = cipher.Decrypt_CCM(data, data, len, nonce, &msg[0], HDR_LEN);
+            }
+        } else {
+            Crypto_AES encAes(key, Crypto_AES::CCM);
+            status = encAes.Encrypt_CCM(data, data, len, nonce, &msg[0], HDR_LEN);
+            if (status == ER_OK) {
+                Crypto_AES decAes(key, Crypto_AES::CCM);
+                status = decAes.Decrypt_CCM(data, data, len, nonce, &msg[0], HDR_LEN);
+            }
+        }
+        if ((status == ER_OK) && ((len != bodyLen) || (memcmp(data, &body[0], bodyLen) != 0))) {
+            status = ER_FAIL;
+        }
+    }
+    uint32_t elapsed = GetTimestamp() - start;
+
+    if (status != ER_OK) {
+        printf("Failed: %s\n", QCC_StatusText(status));
+        return status;
+    }
+    double secs = (elapsed ? elapsed : 1) / 1000.0;
+    printf("%7u bytes  %-16s %6u ms  %10.0f msgs/sec  %8.2f MB/sec\n",
+           (uint32_t)bodyLen,
+           cached ? "cached schedule" : "per message",
+           elapsed,
+           numMsgs / secs,
+           (numMsgs * (double)bodyLen) / (secs * 1024.0 * 1024.0));
+    return status;
+}
+
+static void usage(void)
+{
+    printf("Usage: msgcipher [-h] [-b #] [-m #]\n\n");
+    printf("Options:\n");
+    printf("   -h    = Print this help message\n");
+    printf("   -b #  = Number of body bytes to process per run (default = 16777216)\n");
+    printf("   -m #  = Minimum number of messages per run (default = 2000)\n");
+}
+
+int main(int argc, char** argv)
+{
+    QStatus status = ER_OK;
+    unsigned long totalBytes = 16 * 1024 * 1024;
+    unsigned long minMsgs = 2000;
+
+    printf("AllJoyn Library version: %s\n", ajn::GetVersion());
+    printf("AllJoyn Library build info: %s\n", ajn::GetBuildInfo());
+
+    for (int i = 1; i < argc; ++i) {
+        if (0 == strcmp("-h", argv[i])) {
+            usage();
+            exit(0);
+        } else if ((0 == strcmp("-b", argv[i])) || (0 == strcmp("-m", argv[i]))) {
+            if ((i + 1) == argc) {
+                printf("option %s requires a parameter\n", argv[i]);
+                usage();
+                exit(1);
+            }
+            unsigned long val = strtoul(argv[i + 1], NULL, 10);
+            if (argv[i][1] == 'b') {
+                totalBytes = val;
+            } else {
+                minMsgs = val ? val : 1;
+            }
+            ++i;
+        } else {
+            printf("Unknown option %s\n", argv[i]);
+            usage();
+            exit(1);
+        }
+    }
+
+    KeyBlob key;
+    key.Rand(Crypto_AES::AES128_SIZE, KeyBlob::AES);
+
+    for (size_t bodyLen = 64; (bodyLen <= 128 * 1024) && (status == ER_OK); bodyLen *= 2) {
+        unsigned long numMsgs = totalBytes / bodyLen;
+        if (numMsgs < minMsgs) {
+            numMsgs = minMsgs;
+        }
+        status = Run(key, bodyLen, numMsgs, false);
+        if (status == ER_OK) {
+            status = Run(key, bodyLen, numMsgs, true);
+        }
+    }
+
+    return (status == ER_OK) ? 0 : 1;
+}
@@ -25,11 +25,14 @@
 #include <qcc/platform.h>
 
 #include <assert.h>
+#include <ctype.h>
+#include <stdlib.h>
 
 #include <qcc/Debug.h>
 #include <qcc/String.h>
 #include <qcc/StringUtil.h>
 #include <qcc/Util.h>
+#include <qcc/time.h>
 
 #include <alljoyn/Message.h>
 #include <alljoyn/version.h>
@@ -112,13 +115,240 @@ void PadTo(char* buf, const char* str, size_t len, char pad)
     buf[len] = 0;
 }
 
+/*
+ * Byte at a time reference versions of the name checks, the library versions must give the same
+ * answer for every string.
+ */
+#define REF_MAX_NAME_LEN 256
+
+static bool RefUniqueName(const char* str)
+{
+    const char* p = str;
+    char c = *p++;
+    if (c != ':' || !(isalnum((uint8_t)*p) || (*p == '-') || (*p == '_'))) {
+        return false;
+    }
+    p++;
+    size_t periods = 0;
+    while ((c = *p++)) {
+        if (!isalnum((uint8_t)c) && (c != '-') && (c != '_')) {
+            if ((c != '.') || (*p == '.') || (*p == 0)) {
+                return false;
+            }
+            periods++;
+        }
+    }
+    return (periods > 0) && ((p - str) <= REF_MAX_NAME_LEN);
+}
+
+static bool RefBusName(const char* str)
+{
+    if (*str == ':') {
+        return RefUniqueName(str);
+    }
+    const char* p = str;
+    size_t periods = 0;
+    char c = *p++;
+    if (!isalpha((uint8_t)c) && (c != '_') && (c != '-')) {
+        return false;
+    }
+    while ((c = *p++) != 0) {
+        if (!isalnum((uint8_t)c) && (c != '_') && (c != '-')) {
+            if ((c != '.') || (*p == '.') || (*p == 0) || isdigit((uint8_t)*p)) {
+                return false;
+            }
+            periods++;
+        }
+    }
+    return (periods > 0) && ((p - str) <= REF_MAX_NAME_LEN);
+}
+
+static bool RefObjectPath(const char* str)
+{
+    char c = *str++;
+    if (c != '/') {
+        return false;
+    }
+    while ((c = *str++) != 0) {
+        if (!isalnum((uint8_t)c) && (c != '_')) {
+            if ((c != '/') || (*str == '/') || (*str == 0)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static bool RefInterfaceName(const char* str)
+{
+    const char* p = str;
+    char c = *p++;
+    if (!isalpha((uint8_t)c) && (c != '_')) {
+        return false;
+    }
+    size_t periods = 0;
+    while ((c = *p++) != 0) {
+        if (!isalnum((uint8_t)c) && (c != '_')) {
+            if ((c != '.') || (*p == '.') || (*p == 0)) {
+                return false;
+            }
+            periods++;
+        }
+    }
+    return (periods > 0) && ((p - str) <= REF_MAX_NAME_LEN);
+}
+
+static bool RefMemberName(const char* str)
+{
+    const char* p = str;
+    char c = *p++;
+    if (!isalpha((uint8_t)c) && (c != '_')) {
+        return false;
+    }
+    while ((c = *p++) != 0) {
+        if (!isalnum((uint8_t)c) && (c != '_')) {
+            return false;
+        }
+    }
+    return (p - str) <= REF_MAX_NAME_LEN;
+}
+
+/*
+ * Compare the library name checks against the reference versions on random strings. The strings
+ * are mostly made of name characters so that a good fraction of them are legal names, they are
+ * up to 300 characters long and start at every alignment.
+ */
+static bool Fuzz(size_t iterations)
+{
+    static const char nameChars[] = "abcxyzABCXYZ0189_-./:";
+    char buf[512];
+    size_t numLegal = 0;
+
+    for (size_t i = 0; i < iterations; ++i) {
+        size_t off = rand() % 16;
+        size_t len = (rand() % 4) ? (rand() % 40) : (rand() % 300);
+        char* str = buf + off;
+        for (size_t j = 0; j < len; ++j) {
+            int r = rand() % 64;
+            if (r == 0) {
+                str[j] = (char)(1 + rand() % 255);
+            } else if (r < 8) {
+                str[j] = (j == 0) ? ':' : '.';
+            } else {
+                str[j] = nameChars[rand() % (sizeof(nameChars) - 1)];
+            }
+        }
+        str[len] = 0;
+        /* Garbage after the nul must not affect the result */
+        for (size_t j = len + 1; (j < len + 20) && ((off + j) < sizeof(buf)); ++j) {
+            str[j] = nameChars[rand() % (sizeof(nameChars) - 1)];
+        }
+        bool legal[5] = {
+            IsLegalUniqueName(str), IsLegalBusName(str), IsLegalObjectPath(str), IsLegalInterfaceName(str), IsLegalMemberName(str)
+        };
+        bool ref[5] = {
+            RefUniqueName(str), RefBusName(str), RefObjectPath(str), RefInterfaceName(str), RefMemberName(str)
+        };
+        for (size_t k = 0; k < ArraySize(legal); ++k) {
+            if (legal[k] != ref[k]) {
+                printf("Name check %u of \"%s\" returned %s\n", (uint32_t)k, str, legal[k] ? "true" : "false");
+                return false;
+            }
+            numLegal += legal[k] ? 1 : 0;
+        }
+    }
+    printf("Name checks matched the reference for %u strings (%u legal names)\n", (uint32_t)iterations, (uint32_t)numLegal);
+    return true;
+}
+
+/*
+ * Time the name checks on the kinds of names found in message headers.
+ */
+static void Benchmark(size_t iterations)
+{
+    static const char* uniqueNames[] = { ":1.0", ":1.32", ":Abc3_Xq.2", ":q4X-9hZ_.117" };
+    static const char* busNames[] = { "org.alljoyn.Bus", "org.freedesktop.DBus", "org.alljoyn.bus.samples.chat.a1b2c3d4", ":1.32" };
+    static const char* paths[] = { "/", "/org/alljoyn/Bus", "/org/alljoyn/bus/samples/chat/room_42", "/com/example/sensors/temperature/unit_7/reading" };
+    static const char* interfaces[] = { "org.alljoyn.Bus", "org.freedesktop.DBus.Properties", "org.alljoyn.Bus.Peer.Authentication", "com.example.sensors.Temperature" };
+    static const char* members[] = { "Ping", "GetAll", "AdvertiseName", "NameOwnerChanged" };
+    static const char* const* names[] = { uniqueNames, busNames, paths, interfaces, members };
+    static const char* kinds[] = { "unique", "bus", "path", "interface", "member" };
+
+    for (int pass = 0; pass < 2; ++pass) {
+        EnableVectorNameChecks(pass == 1);
+        for (size_t k = 0; k < ArraySize(names); ++k) {
+            size_t numLegal = 0;
+            uint32_t start = GetTimestamp();
+            for (size_t i = 0; i < iterations; ++i) {
+                const char* str = names[k][i & 3];
+                switch (k) {
+                case 0:
+                    numLegal += IsLegalUniqueName(str) ? 1 : 0;
+                    break;
+
+                case 1:
+                    numLegal += IsLegalBusName(str) ? 1 : 0;
+                    break;
+
+                case 2:
+                    numLegal += IsLegalObjectPath(str) ? 1 : 0;
+                    break;
+
+                case 3:
+                    numLegal += IsLegalInterfaceName(str) ? 1 : 0;
+                    break;
+
+                default:
+                    numLegal += IsLegalMemberName(str) ? 1 : 0;
+                    break;
+                }
+            }
+            uint32_t elapsed = GetTimestamp() - start;
+            printf("%-10s %-7s %6u ms  %10.0f checks/sec%s\n", kinds[k], (pass == 1) ? "vector" : "scalar", elapsed,
+                   iterations / ((elapsed ? elapsed : 1) / 1000.0), (numLegal == iterations) ? "" : "  FAILED");
+        }
+    }
+    EnableVectorNameChecks(true);
+}
+
+static void usage(void)
+{
+    printf("Usage: names [-h] [-b] [-f #]\n\n");
+    printf("Options:\n");
+    printf("   -h    = Print this help message\n");
+    printf("   -b    = Benchmark the name checks\n");
+    printf("   -f #  = Number of random strings to check against the reference (default = 200000)\n");
+}
+
 int main(int argc, char** argv)
 {
     char buf[512];
+    bool benchmark = false;
+    size_t fuzzIterations = 200000;
 
     printf("AllJoyn Library version: %s\n", ajn::GetVersion());
     printf("AllJoyn Library build info: %s\n", ajn::GetBuildInfo());
 
+    for (int i = 1; i < argc; ++i) {
+        if (0 == strcmp("-h", argv[i])) {
+            usage();
+            exit(0);
+        } else if (0 == strcmp("-b", argv[i])) {
+            benchmark = true;
+        } else if (0 == strcmp("-f", argv[i])) {
+            if ((i + 1) == argc) {
+                printf("option %s requires a parameter\n", argv[i]);
+                usage();
+                exit(1);
+            }
+            fuzzIterations = strtoul(argv[++i], NULL, 10);
+        } else {
+            printf("Unknown option %s\n", argv[i]);
+            usage();
+            exit(1);
+        }
+    }
+
     /*
      * Basic checks - should all pass
      */
@@ -203,5 +433,21 @@ int main(int argc, char** argv)
     for (size_t i = 0; i < ArraySize(strings); i++) {
         check(strings[i]);
     }
+
+    /*
+     * The vector and scalar checks must both match the reference
+     */
+    for (int pass = 0; pass < 2; ++pass) {
+        EnableVectorNameChecks(pass == 0);
+        if (!Fuzz(fuzzIterations)) {
+            printf("failed %s name checks\n", (pass == 0) ? "vector" : "scalar");
+            return 1;
+        }
+    }
+    EnableVectorNameChecks(true);
+
+    if (benchmark) {
+        Benchmark(10000000);
+    }
     return 0;
 }
@@ -140,20 +140,38 @@ static QStatus TestRemarshal(const MsgArg* argList, size_t numArgs, const char*
     }
 
     msg.ReMarshal("from.sender");
-    status = msg.Deliver(ep);
-    if (status != ER_OK) {
-        printf("Message::ReMarshal status:%s\n", QCC_StatusText(status));
-        return status;
+    /*
+     * A copy of a remarshaled message shares the body so remarshal the copy as well and check
+     * both are delivered intact.
+     */
+    MyMessage copy(msg);
+    copy.ReMarshal("other.sender");
+    status = copy.Deliver(ep);
+    if (status == ER_OK) {
+        status = msg.Deliver(ep);
     }
-    status = msg.Unmarshal(ep);
     if (status != ER_OK) {
-        printf("Message::Unmarshal status:%s\n", QCC_StatusText(status));
+        printf("Message::ReMarshal status:%s\n", QCC_StatusText(status));
         return status;
     }
-    status = msg.UnmarshalBody();
-    if (status != ER_OK) {
-        printf("Message::UnmarshalArgs status:%s\n", QCC_StatusText(status));
-        return status;
+    for (size_t i = 0; i < 2; ++i) {
+        status = msg.Unmarshal(ep);
+        if (status != ER_OK) {
+            printf("Message::Unmarshal status:%s\n", QCC_StatusText(status));
+            return status;
+        }
+        status = msg.UnmarshalBody();
+        if (status != ER_OK) {
+            printf("Message::UnmarshalArgs status:%s\n", QCC_StatusText(status));
+            return status;
+        }
+        size_t numOut;
+        const MsgArg* outList;
+        msg.GetArgs(numOut, outList);
+        if (MsgArg::ToString(outList, numOut) != inargList) {
+            printf("Remarshaled message args are not the same as the original\n");
+            return ER_FAIL;
+        }
     }
 
     return status;
@@ -0,0 +1,268 @@
+/**
+ * @file
+ *
+ * Test and benchmark for the scalar array endian swapping and boolean kernels.
+ */
+
+/******************************************************************************
+ * Copyright 2011, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+
+#include <qcc/platform.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include <qcc/Util.h>
+#include <qcc/time.h>
+
+#include <alljoyn/Message.h>
+#include <alljoyn/version.h>
+
+#include <Status.h>
+
+/* Private files included for unit testing */
+#include <ScalarArrays.h>
+
+#define QCC_MODULE "ALLJOYN"
+
+using namespace qcc;
+using namespace std;
+using namespace ajn;
+
+/* Longest array checked and number of byte offsets each length is checked at */
+static const size_t CHECK_MAX_ELEMS = 100;
+static const size_t CHECK_OFFSETS = 8;
+
+static const uint32_t SWAPPED_TRUE = 0x01000000;
+
+/* Reference byte swap of num values of the given width */
+static void RefSwap(uint8_t* dest, const uint8_t* src, size_t num, size_t width)
+{
+    for (size_t i = 0; i < num; ++i) {
+        for (size_t j = 0; j < width; ++j) {
+            dest[i * width + j] = src[i * width + width - 1 - j];
+        }
+    }
+}
+
+static void Swap(uint8_t* dest, const uint8_t* src, size_t num, size_t width)
+{
+    switch (width) {
+    case 2:
+        ScalarArrays::CopySwapped16(dest, src, num);
+        break;
+
+    case 4:
+        ScalarArrays::CopySwapped32(dest, src, num);
+        break;
+
+    default:
+        ScalarArrays::CopySwapped64(dest, src, num);
+        break;
+    }
+}
+
+/*
+ * Check the kernels against a reference at every length up to CHECK_MAX_ELEMS and with the data
+ * at every alignment.
+ */
+static QStatus Check()
+{
+    uint8_t src[CHECK_MAX_ELEMS * 8 + CHECK_OFFSETS];
+    uint8_t dest[CHECK_MAX_ELEMS * 8 + CHECK_OFFSETS];
+    uint8_t ref[CHECK_MAX_ELEMS * 8];
+    uint32_t wire[CHECK_MAX_ELEMS];
+    bool bools[CHECK_MAX_ELEMS];
+    bool out[CHECK_MAX_ELEMS];
+
+    for (size_t i = 0; i < sizeof(src); ++i) {
+        src[i] = (uint8_t)rand();
+    }
+    for (size_t num = 0; num <= CHECK_MAX_ELEMS; ++num) {
+        for (size_t width = 2; width <= 8; width *= 2) {
+            for (size_t off = 0; off < CHECK_OFFSETS; ++off) {
+                RefSwap(ref, src + off, num, width);
+                Swap(dest + off, src + off, num, width);
+                if (memcmp(ref, dest + off, num * width) != 0) {
+                    printf("%u bit swap of %u values at offset %u is wrong\n", (uint32_t)(width * 8), (uint32_t)num, (uint32_t)off);
+                    return ER_FAIL;
+                }
+                /* Swap in place */
+                memcpy(dest, src + off, num * width);
+                Swap(dest, dest, num, width);
+                if (memcmp(ref, dest, num * width) != 0) {
+                    printf("%u bit in place swap of %u values is wrong\n", (uint32_t)(width * 8), (uint32_t)num);
+                    return ER_FAIL;
+                }
+            }
+        }
+        for (int swap = 0; swap < 2; ++swap) {
+            uint32_t wireTrue = swap ? SWAPPED_TRUE : 1;
+            for (size_t i = 0; i < num; ++i) {
+                bools[i] = (rand() & 1) != 0;
+            }
+            ScalarArrays::MarshalBools(bools, num, swap != 0, wire);
+            for (size_t i = 0; i < num; ++i) {
+                if (wire[i] != (bools[i] ? wireTrue : 0)) {
+                    printf("Marshaling %u booleans (swap=%d) is wrong\n", (uint32_t)num, swap);
+                    return ER_FAIL;
+                }
+            }
+            if (!ScalarArrays::UnmarshalBools(wire, num, swap != 0, out)) {
+                printf("Unmarshaling %u valid booleans (swap=%d) failed\n", (uint32_t)num, swap);
+                return ER_FAIL;
+            }
+            for (size_t i = 0; i < num; ++i) {
+                if ((out[i] != bools[i]) || (swap && (wire[i] != (bools[i] ? 1u : 0u)))) {
+                    printf("Unmarshaling %u booleans (swap=%d) is wrong\n", (uint32_t)num, swap);
+                    return ER_FAIL;
+                }
+            }
+            /* Any value other than 0 or 1 in any position must be rejected */
+            for (size_t i = 0; i < num; ++i) {
+                ScalarArrays::MarshalBools(bools, num, swap != 0, wire);
+                wire[i] = swap ? 1 : 2;
+                if (ScalarArrays::UnmarshalBools(wire, num, swap != 0, out)) {
+                    printf("Invalid boolean %u of %u (swap=%d) was accepted\n", (uint32_t)i, (uint32_t)num, swap);
+                    return ER_FAIL;
+                }
+            }
+        }
+    }
+    return ER_OK;
+}
+
+static const char* kernels[] = { "swap16", "swap32", "swap64", "bools" };
+
+/* Run one kernel over an array of len bytes for at least totalBytes bytes and report the rate */
+static void Bench(size_t kernel, size_t len, size_t totalBytes, bool useVector)
+{
+    vector<uint32_t> data((len + 3) / 4 + 1, 0);
+    bool* bools = new bool[len / 4 + 1];
+    uint8_t* buf = (uint8_t*)&data[0];
+    size_t iterations = (totalBytes + len - 1) / len;
+    bool ok = true;
+
+    ScalarArrays::EnableVector(useVector);
+    uint32_t start = GetTimestamp();
+    for (size_t i = 0; i < iterations; ++i) {
+        switch (kernel) {
+        case 0:
+            ScalarArrays::Swap16((uint16_t*)buf, len / 2);
+            break;
+
+        case 1:
+            ScalarArrays::Swap32((uint32_t*)buf, len / 4);
+            break;
+
+        case 2:
+            ScalarArrays::Swap64((uint64_t*)buf, len / 8);
+            break;
+
+        default:
+            /* All false is valid in both byte orders */
+            ok = ScalarArrays::UnmarshalBools((uint32_t*)buf, len / 4, true, bools) && ok;
+            break;
+        }
+    }
+    uint32_t elapsed = GetTimestamp() - start;
+    ScalarArrays::EnableVector(true);
+
+    printf("%-8s %-6s %8u bytes  %6u ms  %10.1f MB/sec%s\n",
+           kernels[kernel],
+           useVector ? ScalarArrays::GetVectorName() : "scalar",
+           (uint32_t)len,
+           elapsed,
+           (iterations * (double)len) / (1024.0 * 1024.0) / ((elapsed ? elapsed : 1) / 1000.0),
+           ok ? "" : "  FAILED");
+    delete [] bools;
+}
+
+static void usage(void)
+{
+    printf("Usage: scalararrays [-h] [-c #] [-s #]\n\n");
+    printf("Options:\n");
+    printf("   -h    = Print this help message\n");
+    printf("   -c #  = Megabytes processed per run (default = 256)\n");
+    printf("   -s #  = Only run with arrays of # bytes (default = 64, 1024, 16384 and %u)\n", (uint32_t)ALLJOYN_MAX_ARRAY_LEN);
+}
+
+int main(int argc, char** argv)
+{
+    QStatus status = ER_OK;
+    size_t totalBytes = 256 * 1024 * 1024;
+    vector<size_t> sizes;
+
+    printf("AllJoyn Library version: %s\n", ajn::GetVersion());
+    printf("AllJoyn Library build info: %s\n", ajn::GetBuildInfo());
+
+    for (int i = 1; i < argc; ++i) {
+        if (0 == strcmp("-h", argv[i])) {
+            usage();
+            exit(0);
+        } else if ((0 == strcmp("-c", argv[i])) || (0 == strcmp("-s", argv[i]))) {
+            if ((i + 1) == argc) {
+                printf("option %s requires a parameter\n", argv[i]);
+                usage();
+                exit(1);
+            }
+            unsigned long val = strtoul(argv[i + 1], NULL, 10);
+            if (argv[i][1] == 'c') {
+                totalBytes = (size_t)val * 1024 * 1024;
+            } else if ((val & 7) || (val == 0) || (val > ALLJOYN_MAX_ARRAY_LEN)) {
+                printf("array size must be a non-zero multiple of 8 no larger than %u\n", (uint32_t)ALLJOYN_MAX_ARRAY_LEN);
+                exit(1);
+            } else {
+                sizes.push_back(val);
+            }
+            ++i;
+        } else {
+            printf("Unknown option %s\n", argv[i]);
+            usage();
+            exit(1);
+        }
+    }
+    if (sizes.empty()) {
+        sizes.push_back(64);
+        sizes.push_back(1024);
+        sizes.push_back(16384);
+        sizes.push_back(ALLJOYN_MAX_ARRAY_LEN);
+    }
+
+    /*
+     * Check the vector kernels and the scalar loops
+     */
+    for (int pass = 0; (pass < 2) && (status == ER_OK); ++pass) {
+        ScalarArrays::EnableVector(pass == 0);
+        status = Check();
+    }
+    ScalarArrays::EnableVector(true);
+    if (status != ER_OK) {
+        printf("Scalar array kernel check FAILED\n");
+        return 1;
+    }
+    printf("Scalar array kernels (%s) passed\n", ScalarArrays::GetVectorName());
+
+    for (size_t k = 0; k < ArraySize(kernels); ++k) {
+        for (size_t s = 0; s < sizes.size(); ++s) {
+            Bench(k, sizes[s], totalBytes, false);
+            Bench(k, sizes[s], totalBytes, true);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,195 @@
+/**
+ * @file
+ *
+ * Benchmark for delivering secure broadcast signals to a growing number of session members.
+ */
+
+/******************************************************************************
+ * Copyright 2011, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+
+#include <qcc/platform.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include <qcc/Pipe.h>
+#include <qcc/String.h>
+#include <qcc/Util.h>
+#include <qcc/time.h>
+
+#include <alljoyn/BusAttachment.h>
+#include <alljoyn/Message.h>
+#include <alljoyn/version.h>
+
+#include <Status.h>
+
+/* Private files included for unit testing */
+#include <RemoteEndpoint.h>
+
+#define QCC_MODULE "ALLJOYN"
+
+using namespace qcc;
+using namespace std;
+using namespace ajn;
+
+static BusAttachment* gBus;
+
+class BenchMessage : public _Message {
+  public:
+
+    BenchMessage() : _Message(*gBus) { }
+
+    BenchMessage(const BenchMessage& other) : _Message(other) { }
+
+    QStatus SecureSignal(const MsgArg* argList, size_t numArgs)
+    {
+        qcc::String sig = MsgArg::Signature(argList, numArgs);
+        return SignalMsg(sig, NULL, 0, "/org/alljoyn/alljoyn_test", "org.alljoyn.alljoyn_test", "my_signal", argList, numArgs, ALLJOYN_FLAG_ENCRYPTED, 0);
+    }
+
+    QStatus Unmarshal(RemoteEndpoint& ep) { return _Message::Unmarshal(ep, false); }
+
+    QStatus Deliver(RemoteEndpoint& ep) { return _Message::Deliver(ep); }
+};
+
+/* Read back the signal that was delivered to an endpoint so its pipe does not grow */
+static QStatus Drain(RemoteEndpoint& ep)
+{
+    BenchMessage rx;
+    return rx.Unmarshal(ep);
+}
+
+/*
+ * Deliver numMsgs secure signals to every member. When shared is false each member gets its own
+ * copy of the signal which has to be encrypted separately.
+ */
+static QStatus Run(vector<RemoteEndpoint*>& members, unsigned long numMsgs, size_t payloadSize, bool shared)
+{
+    QStatus status = ER_OK;
+    vector<uint8_t> payload(payloadSize, 0xA5);
+    MsgArg args[2];
+    args[0].Set("u", 0);
+    args[1].Set("ay", payload.size(), payload.empty() ? NULL : &payload[0]);
+
+    uint32_t start = GetTimestamp();
+    for (unsigned long i = 0; (i < numMsgs) && (status == ER_OK); ++i) {
+        args[0].v_uint32 = i;
+        BenchMessage msg;
+        status = msg.SecureSignal(args, ArraySize(args));
+        for (size_t m = 0; (m < members.size()) && (status == ER_OK); ++m) {
+            if (shared) {
+                status = msg.Deliver(*members[m]);
+            } else {
+                BenchMessage copy(msg);
+                status = copy.Deliver(*members[m]);
+            }
+            if (status == ER_OK) {
+                status = Drain(*members[m]);
+            }
+        }
+    }
+    uint32_t elapsed = GetTimestamp() - start;
+
+    if (status != ER_OK) {
+        printf("Failed: %s\n", QCC_StatusText(status));
+        return status;
+    }
+    double secs = (elapsed ? elapsed : 1) / 1000.0;
+    printf("%4u members  %-14s %6u ms  %10.0f signals/sec  %10.0f deliveries/sec\n",
+           (uint32_t)members.size(),
+           shared ? "encrypt once" : "per member",
+           elapsed,
+           numMsgs / secs,
+           (numMsgs * members.size()) / secs);
+    return status;
+}
+
+static void usage(void)
+{
+    printf("Usage: securecast [-h] [-c #] [-m #] [-s #]\n\n");
+    printf("Options:\n");
+    printf("   -h    = Print this help message\n");
+    printf("   -c #  = Number of signals per run (default = 2000)\n");
+    printf("   -m #  = Maximum number of session members, runs double from 1 (default = 64)\n");
+    printf("   -s #  = Signal payload size in bytes (default = 256)\n");
+}
+
+int main(int argc, char** argv)
+{
+    QStatus status = ER_OK;
+    unsigned long numMsgs = 2000;
+    unsigned long maxMembers = 64;
+    unsigned long payloadSize = 256;
+
+    printf("AllJoyn Library version: %s\n", ajn::GetVersion());
+    printf("AllJoyn Library build info: %s\n", ajn::GetBuildInfo());
+
+    for (int i = 1; i < argc; ++i) {
+        if (0 == strcmp("-h", argv[i])) {
+            usage();
+            exit(0);
+        } else if ((0 == strcmp("-c", argv[i])) || (0 == strcmp("-m", argv[i])) || (0 == strcmp("-s", argv[i]))) {
+            if ((i + 1) == argc) {
+                printf("option %s requires a parameter\n", argv[i]);
+                usage();
+                exit(1);
+            }
+            unsigned long val = strtoul(argv[i + 1], NULL, 10);
+            if (argv[i][1] == 'c') {
+                numMsgs = val;
+            } else if (argv[i][1] == 'm') {
+                maxMembers = val;
+            } else {
+                payloadSize = val;
+            }
+            ++i;
+        } else {
+            printf("Unknown option %s\n", argv[i]);
+            usage();
+            exit(1);
+        }
+    }
+
+    gBus = new BusAttachment("securecast");
+    gBus->Start();
+
+    {
+        vector<Pipe*> streams;
+        vector<RemoteEndpoint*> members;
+
+        for (unsigned long n = 1; (n <= maxMembers) && (status == ER_OK); n *= 2) {
+            while (members.size() < n) {
+                Pipe* stream = new Pipe();
+                streams.push_back(stream);
+                members.push_back(new RemoteEndpoint(*gBus, false, "", *stream, "member", false));
+            }
+            status = Run(members, numMsgs, payloadSize, false);
+            if (status == ER_OK) {
+                status = Run(members, numMsgs, payloadSize, true);
+            }
+        }
+
+        for (size_t m = 0; m < members.size(); ++m) {
+            delete members[m];
+            delete streams[m];
+        }
+    }
+
+    delete gBus;
+    return (status == ER_OK) ? 0 : 1;
+}
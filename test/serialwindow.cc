@@ -0,0 +1,128 @@
+/**
+ * @file
+ *
+ * This file tests the serial number replay window in _PeerState::IsValidSerial
+ */
+
+/******************************************************************************
+ * Copyright 2011, Qualcomm Innovation Center, Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ ******************************************************************************/
+
+#include <qcc/platform.h>
+
+#include <stdio.h>
+
+#include <qcc/time.h>
+
+#include <alljoyn/version.h>
+
+#include <Status.h>
+
+/* Private files included for unit testing */
+#include <PeerState.h>
+
+using namespace qcc;
+using namespace std;
+using namespace ajn;
+
+static unsigned long failures = 0;
+
+static void Check(bool ok, const char* what, uint32_t serial)
+{
+    if (!ok) {
+        if (failures < 10) {
+            printf("FAILED: %s (serial %u)\n", what, serial);
+        }
+        ++failures;
+    }
+}
+
+/* Advance a serial number the way message serial numbers are allocated, skipping 0 */
+static uint32_t Next(uint32_t serial)
+{
+    return (serial == 0xFFFFFFFF) ? 1 : serial + 1;
+}
+
+int main(int argc, char** argv)
+{
+    printf("AllJoyn Library version: %s\n", ajn::GetVersion());
+    printf("AllJoyn Library build info: %s\n", ajn::GetBuildInfo());
+
+    PeerState peer;
+    uint32_t winSize = (uint32_t)peer->SerialWindowSize();
+
+    /* In-order serials are all valid and replays of any of the window are not */
+    Check(!peer->IsValidSerial(0, true, false), "serial 0 accepted", 0);
+    for (uint32_t s = 1; s <= 8 * winSize; ++s) {
+        Check(peer->IsValidSerial(s, true, false), "in-order serial rejected", s);
+    }
+    for (uint32_t s = 7 * winSize + 1; s <= 8 * winSize; ++s) {
+        Check(!peer->IsValidSerial(s, true, false), "replay accepted", s);
+    }
+    Check(peer->GetReplayCount() == winSize, "wrong replay count", peer->GetReplayCount());
+
+    /* Serials older than the window are rejected for secure messages only */
+    Check(!peer->IsValidSerial(winSize, true, false), "out-of-window secure serial accepted", winSize);
+    Check(peer->GetOutOfWindowCount() == 1, "wrong out-of-window count", peer->GetOutOfWindowCount());
+    Check(peer->IsValidSerial(winSize, false, false), "out-of-window serial rejected", winSize);
+
+    /*
+     * Out-of-order serials anywhere in the window are valid, including ones a direct-mapped window
+     * of the same size would have confused.
+     */
+    PeerState reorder;
+    for (uint32_t block = 0; block < 64; ++block) {
+        for (uint32_t i = winSize / 2; i > 0; --i) {
+            uint32_t s = block * (winSize / 2) + i;
+            Check(reorder->IsValidSerial(s, true, false), "reordered serial rejected", s);
+        }
+    }
+    PeerState gaps;
+    Check(gaps->IsValidSerial(5, true, false), "first serial rejected", 5);
+    Check(gaps->IsValidSerial(5 + winSize - 1, true, false), "serial at end of window rejected", 5 + winSize - 1);
+    Check(gaps->IsValidSerial(6, true, false), "late serial rejected", 6);
+    Check(!gaps->IsValidSerial(6, true, false), "late serial replay accepted", 6);
+
+    /* Serial numbers wrap around */
+    PeerState wrap;
+    uint32_t start = 0xFFFFFFFF - winSize / 2;
+    uint32_t s = start;
+    for (uint32_t i = 0; i < winSize; ++i) {
+        Check(wrap->IsValidSerial(s, true, false), "serial across wrap rejected", s);
+        s = Next(s);
+    }
+    s = start + 1;
+    for (uint32_t i = 1; i < winSize; ++i) {
+        Check(!wrap->IsValidSerial(s, true, false), "replay across wrap accepted", s);
+        s = Next(s);
+    }
+
+    /* Throughput of in-order validation */
+    PeerState perf;
+    uint32_t numSerials = 10000000;
+    uint32_t begin = GetTimestamp();
+    for (uint32_t i = 1; i <= numSerials; ++i) {
+        perf->IsValidSerial(i, true, false);
+    }
+    uint32_t elapsed = GetTimestamp() - begin;
+    printf("Validated %u serials in %u ms with a window of %u\n", numSerials, elapsed, winSize);
+
+    if (failures) {
+        printf("Serial window unit test FAILED (%lu failures)\n", failures);
+        return -1;
+    }
+    printf("Serial window unit test PASSED\n");
+    return 0;
+}